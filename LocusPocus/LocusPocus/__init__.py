@@ -27,6 +27,7 @@ from . import proteins
 from . import mrnas
 from . import exons
 from . import stats
+from . import native
 try:
     FileNotFoundError
 except NameError:  # pragma: no cover
@@ -28,22 +28,16 @@ def intervals(db, delta=500, ilcformat='{}ILC-%05lu', logstream=sys.stderr):
 
     nameformat = ilcformat.format(db.label)
     specdir = '%s/%s' % (db.workdir, db.label)
-    command = 'lpdriver.py --namefmt=%s' % nameformat
+    command = 'locuspocus --verbose --cds --unannot'
+    command += ' --namefmt=%s' % nameformat
     command += ' --delta=%d' % delta
-    command += ' --ilenfile=%s/ilens.temp' % specdir
-    command += ' --out=%s/%s.iloci.gff3' % (specdir, db.label)
+    command += ' --ilens=%s/ilens.temp' % specdir
+    command += ' --outfile=%s/%s.iloci.gff3' % (specdir, db.label)
+    command += ' --miloci=%s/%s.miloci.gff3' % (specdir, db.label)
     command += ' %s/%s.gff3' % (specdir, db.label)
     cmd = command.split(' ')
     subprocess.check_call(cmd)
 
-    if logstream is not None:  # pragma: no cover
-        logmsg = '[Genome: %s] merging iLoci' % db.config['species']
-        print(logmsg, file=logstream)
-    infile = '%s/%s.iloci.gff3' % (specdir, db.label)
-    outfile = '%s/%s.miloci.gff3' % (specdir, db.label)
-    with open(infile, 'r') as instream, open(outfile, 'w') as outstream:
-        subprocess.check_call('miloci.py', stdin=instream, stdout=outstream)
-
 
 def simple(db, logstream=sys.stderr):
     """Determine simple iLoci (those containing a single gene)."""
@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+#
+# -----------------------------------------------------------------------------
+# Copyright (c) 2016   Indiana University
+#
+# This file is part of AEGeAn (http://github.com/BrendelGroup/AEGeAn) and is
+# licensed under the ISC license: see LICENSE.
+# -----------------------------------------------------------------------------
+
+"""
+Native bindings to the AEGeAn Toolkit.
+
+The `_aegean` extension module is built against libaegean when it is available
+at install time. It computes loci, iLoci, ParsEval comparisons, and sequence
+statistics directly on in-memory GFF3 text and sequences, with no intermediate
+files or subprocesses, and releases the GIL while doing so. Check `available`
+before use; callers should fall back on the command-line tools otherwise.
+"""
+
+from __future__ import print_function
+try:
+    from ._aegean import API_VERSION, compare, iloci, seqstats
+    available = True
+except ImportError:  # pragma: no cover
+    available = False
+
+
+def loci(gff3):
+    """Compute gene loci: iLoci containing at least one gene, sans flanks."""
+    if not available:  # pragma: no cover
+        raise RuntimeError('LocusPocus was installed without libaegean')
+    return [locus for locus in iloci(gff3, delta=0) if locus['genes'] > 0]
+
+
+# -----------------------------------------------------------------------------
+# Unit tests
+# -----------------------------------------------------------------------------
+
+testgff3 = '\n'.join([
+    '##gff-version   3',
+    '##sequence-region   chr1 1 1000',
+    'chr1\tAEGeAn\tgene\t201\t800\t.\t+\t.\tID=gene1',
+    'chr1\tAEGeAn\tmRNA\t201\t800\t.\t+\t.\tID=mrna1;Parent=gene1',
+    'chr1\tAEGeAn\texon\t201\t400\t.\t+\t.\tParent=mrna1',
+    'chr1\tAEGeAn\texon\t601\t800\t.\t+\t.\tParent=mrna1',
+    'chr1\tAEGeAn\tCDS\t251\t400\t.\t+\t0\tParent=mrna1',
+    'chr1\tAEGeAn\tCDS\t601\t750\t.\t+\t0\tParent=mrna1',
+    ''
+])
+
+
+def test_seqstats():
+    """native: sequence composition"""
+    if not available:  # pragma: no cover
+        return
+    gccontent, gcskew, ncontent = seqstats('ACGTNNGGCCSW')
+    assert gccontent == 0.7
+    assert gcskew == 0.0
+    assert ncontent == 2.0 / 12.0
+    assert seqstats('') == (0.0, 0.0, 0.0)
+
+
+def test_iloci():
+    """native: iLocus and locus computation"""
+    if not available:  # pragma: no cover
+        return
+    genic = [il for il in iloci(testgff3, delta=50) if il['genes'] > 0]
+    assert len(genic) == 1
+    assert (genic[0]['start'], genic[0]['end']) == (151, 850)
+    genes = loci(testgff3)
+    assert len(genes) == 1
+    assert (genes[0]['start'], genes[0]['end']) == (201, 800)
+
+
+def test_compare():
+    """native: ParsEval comparison"""
+    if not available:  # pragma: no cover
+        return
+    result = compare(testgff3, testgff3)
+    assert result['num_loci'] == 1
+    assert result['stats']['cds_struc']['correct'] == 2
+    assert result['stats']['cds_struc']['wrong'] == 0
@@ -64,6 +64,13 @@ def n_content(dna):
     return float(ncount) / float(len(dna))
 
 
+def seq_stats(dna):
+    """Calculate GC content, GC skew, and N content in a single pass."""
+    if LocusPocus.native.available:
+        return LocusPocus.native.seqstats(dna)
+    return gc_content(dna), gc_skew(dna), n_content(dna)
+
+
 def ilocus_desc(gff3, fasta, miloci=False):
     """
     Generate a tabular record for each iLocus in the input.
@@ -94,9 +101,7 @@ def ilocus_desc(gff3, fasta, miloci=False):
         assert len(locusseq) == locuslen, \
             'Locus "%s": length mismatch; gff=%d, fa=%d' % (
             locusid, locuslen, len(locusseq))
-        gccontent = gc_content(locusseq)
-        gcskew = gc_skew(locusseq)
-        ncontent = n_content(locusseq)
+        gccontent, gcskew, ncontent = seq_stats(locusseq)
 
         classmatch = re.search(r'iLocus_type=([^;\n]+)', fields[8])
         assert(classmatch), fields[8]
@@ -156,9 +161,7 @@ def premrna_desc(gff3, fasta):
                 message += '; most likely a duplicated accession, discarding'
                 print(message, file=sys.stderr)
                 mrnaacc = ''
-            gccontent = gc_content(mrnaseq)
-            gcskew = gc_skew(mrnaseq)
-            ncontent = n_content(mrnaseq)
+            gccontent, gcskew, ncontent = seq_stats(mrnaseq)
         elif '\texon\t' in entry:
             exoncount += 1
         elif '\tintron\t' in entry:
@@ -218,9 +221,7 @@ def mrna_desc(gff3, fasta):
                 message += '; most likely a duplicated accession, discarding'
                 print(message, file=sys.stderr)
             else:
-                gccontent = gc_content(mrnaseq)
-                gcskew = gc_skew(mrnaseq)
-                ncontent = n_content(mrnaseq)
+                gccontent, gcskew, ncontent = seq_stats(mrnaseq)
                 values = '%s %d %.3f %.3f %.3f' % (
                     mrnaacc, mrnalen, gccontent, gcskew, ncontent)
                 yield values.split(' ')
@@ -257,9 +258,7 @@ def cds_desc(gff3, fasta):
                     message += ', discarding'
                     print(message, file=sys.stderr)
                 else:
-                    gccontent = gc_content(cdsseq)
-                    gcskew = gc_skew(cdsseq)
-                    ncontent = n_content(cdsseq)
+                    gccontent, gcskew, ncontent = seq_stats(cdsseq)
                     values = '%s %d %.3f %.3f %.3f' % (
                         accession, cdslen, gccontent, gcskew, ncontent)
                     yield values.split(' ')
@@ -392,9 +391,7 @@ def exon_desc(gff3, fasta):
                 assert len(exonseq) == exonlength, \
                     'exon "%s": length mismatch; gff=%d, fa=%d' % (
                     exonpos, exonlength, len(exonseq))
-                gccontent = gc_content(exonseq)
-                gcskew = gc_skew(exonseq)
-                ncontent = n_content(exonseq)
+                gccontent, gcskew, ncontent = seq_stats(exonseq)
                 context = exon_context(exon, start, stop)
                 phase = None
                 remainder = None
@@ -491,9 +488,7 @@ def intron_desc(gff3, fasta):
                     assert len(intronseq) == intronlength, \
                         'intron "%s": length mismatch; gff=%d, fa=%d' % (
                             intronpos, intronlength, len(intronseq))
-                    gccontent = gc_content(intronseq)
-                    gcskew = gc_skew(intronseq)
-                    ncontent = n_content(intronseq)
+                    gccontent, gcskew, ncontent = seq_stats(intronseq)
                     context = intron_context(intron, start, stop)
                     values = '%s %s %d %.3f %.3f %.3f %s' % (
                         intronpos, mrnaid, intronlength, gccontent, gcskew,
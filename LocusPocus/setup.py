@@ -10,10 +10,27 @@
 
 """Setup configuration for LocusPocus"""
 
+import os
 import setuptools
 import versioneer
 
 
+# Native bindings, built against an installed libaegean (`make install` in the
+# AEGeAn root directory). The extension is optional: if it fails to build,
+# LocusPocus falls back on the AEGeAn command-line tools.
+prefix = os.environ.get('AEGEAN_PREFIX', '/usr/local')
+aegean = setuptools.Extension(
+    'LocusPocus._aegean',
+    sources=['src/_aegean.c'],
+    include_dirs=[prefix + '/include/aegean',
+                  prefix + '/include/genometools'],
+    library_dirs=[prefix + '/lib'],
+    runtime_library_dirs=[prefix + '/lib'],
+    libraries=['aegean', 'genometools'],
+    optional=True
+)
+
+
 setuptools.setup(name='LocusPocus',
                  version=versioneer.get_version(),
                  cmdclass=versioneer.get_cmdclass(),
@@ -24,6 +41,7 @@ setuptools.setup(name='LocusPocus',
                  author_email='daniel.standage@gmail.com',
                  license='BSD-3',
                  packages=['LocusPocus'],
+                 ext_modules=[aegean],
                  scripts=['scripts/fidibus',
                           'scripts/fidibus-filens.py',
                           'scripts/fidibus-format-gff3.py',
@@ -0,0 +1,302 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+/*
+ * CPython bindings for the in-memory AEGeAn API (see AgnApi.h). Annotations
+ * are given as GFF3 text and results are returned as Python dictionaries. The
+ * interpreter lock is released while AEGeAn is doing the work, so calls from
+ * separate Python threads run concurrently, but only if GenomeTools is compiled
+ * with 'threads=yes' (see AgnApi.h); otherwise the lock is held throughout.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "genometools.h"
+#include "aegean.h"
+
+#define AEGEAN_BEGIN_ALLOW_THREADS\
+        { PyThreadState *_save = NULL;\
+          if(gt_multithread_support()) _save = PyEval_SaveThread();
+#define AEGEAN_END_ALLOW_THREADS\
+          if(_save != NULL) PyEval_RestoreThread(_save); }
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Build a dictionary from the given comparison stats.
+ */
+static PyObject *aegean_comparison_dict(AgnComparison *stats);
+
+/**
+ * @function Raise a Python ``ValueError`` with the message in ``error``, then
+ * free ``error``. Always returns NULL.
+ */
+static PyObject *aegean_error(GtError *error);
+
+/**
+ * @function Add ``value`` to ``dict`` under ``key``, releasing the caller's
+ * reference to ``value``. Returns -1 on failure.
+ */
+static int aegean_dict_steal(PyObject *dict, const char *key, PyObject *value);
+
+/**
+ * @function Build a dictionary from the given structure-level stats.
+ */
+static PyObject *aegean_struc_dict(AgnCompStatsBinary *stats);
+
+/**
+ * @function Build a dictionary from the given nucleotide-level stats.
+ */
+static PyObject *aegean_nuc_dict(AgnCompStatsScaled *stats);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+static PyObject *aegean_compare(PyObject *self, PyObject *args)
+{
+  const char *refrdata, *preddata;
+  Py_ssize_t refrlength, predlength;
+  if(!PyArg_ParseTuple(args, "s#s#", &refrdata, &refrlength,
+                       &preddata, &predlength))
+    return NULL;
+
+  GtError *error = gt_error_new();
+  GtArray *records = NULL;
+  AgnComparisonData summary;
+  AEGEAN_BEGIN_ALLOW_THREADS
+  GtArray *refr = agn_api_parse_gff3(refrdata, refrlength, "reference", error);
+  GtArray *pred = NULL;
+  if(refr != NULL)
+    pred = agn_api_parse_gff3(preddata, predlength, "prediction", error);
+  if(pred != NULL)
+    records = agn_api_compare(refr, pred, &summary, error);
+  if(refr != NULL)
+    agn_api_node_array_delete(refr);
+  if(pred != NULL)
+    agn_api_node_array_delete(pred);
+  AEGEAN_END_ALLOW_THREADS
+  if(records == NULL)
+    return aegean_error(error);
+  gt_error_delete(error);
+
+  PyObject *loci = PyList_New(0);
+  GtUword i;
+  for(i = 0; loci != NULL && i < gt_array_size(records); i++)
+  {
+    AgnApiLocusRecord *record = gt_array_get(records, i);
+    PyObject *locus = Py_BuildValue("{s:s,s:k,s:k,s:k,s:k}",
+                                    "seqid", record->seqid,
+                                    "start", record->range.start,
+                                    "end", record->range.end,
+                                    "refr_mrnas", record->refr_mrnas,
+                                    "pred_mrnas", record->pred_mrnas);
+    if(locus == NULL ||
+       aegean_dict_steal(locus, "stats",
+                         aegean_comparison_dict(&record->stats)) == -1 ||
+       PyList_Append(loci, locus) == -1)
+    {
+      Py_CLEAR(loci);
+    }
+    Py_XDECREF(locus);
+  }
+  agn_api_locus_records_delete(records);
+  if(loci == NULL)
+    return NULL;
+
+  AgnCompInfo *info = &summary.info;
+  PyObject *result = Py_BuildValue("{s:N,s:k,s:k,s:k,s:k,s:k,s:k,s:k,s:k}",
+                                   "loci", loci,
+                                   "num_loci", info->num_loci,
+                                   "unique_refr_loci", info->unique_refr_loci,
+                                   "unique_pred_loci", info->unique_pred_loci,
+                                   "refr_genes", info->refr_genes,
+                                   "pred_genes", info->pred_genes,
+                                   "refr_transcripts", info->refr_transcripts,
+                                   "pred_transcripts", info->pred_transcripts,
+                                   "num_comparisons", info->num_comparisons);
+  if(result != NULL &&
+     aegean_dict_steal(result, "stats",
+                       aegean_comparison_dict(&summary.stats)) == -1)
+  {
+    Py_CLEAR(result);
+  }
+  return result;
+}
+
+static PyObject *aegean_iloci(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+  static char *kwlist[] = { "gff3", "delta", "refine", NULL };
+  const char *data;
+  Py_ssize_t length;
+  unsigned long delta = 500;
+  int refine = 0;
+  if(!PyArg_ParseTupleAndKeywords(args, kwargs, "s#|kp", kwlist, &data,
+                                  &length, &delta, &refine))
+    return NULL;
+
+  GtError *error = gt_error_new();
+  GtArray *records = NULL;
+  AEGEAN_BEGIN_ALLOW_THREADS
+  GtArray *nodes = agn_api_parse_gff3(data, length, "iloci", error);
+  if(nodes != NULL)
+  {
+    records = agn_api_iloci(nodes, delta, refine, error);
+    agn_api_node_array_delete(nodes);
+  }
+  AEGEAN_END_ALLOW_THREADS
+  if(records == NULL)
+    return aegean_error(error);
+  gt_error_delete(error);
+
+  PyObject *iloci = PyList_New(0);
+  GtUword i;
+  for(i = 0; iloci != NULL && i < gt_array_size(records); i++)
+  {
+    AgnApiIlocusRecord *record = gt_array_get(records, i);
+    PyObject *ilocus = Py_BuildValue("{s:s,s:k,s:k,s:z,s:z,s:k,s:k}",
+                                     "seqid", record->seqid,
+                                     "start", record->range.start,
+                                     "end", record->range.end,
+                                     "name", record->name,
+                                     "type", record->type,
+                                     "genes", record->num_genes,
+                                     "mrnas", record->num_mrnas);
+    if(ilocus == NULL || PyList_Append(iloci, ilocus) == -1)
+      Py_CLEAR(iloci);
+    Py_XDECREF(ilocus);
+  }
+  agn_api_ilocus_records_delete(records);
+  return iloci;
+}
+
+static PyObject *aegean_seqstats(PyObject *self, PyObject *args)
+{
+  const char *seq;
+  Py_ssize_t length;
+  if(!PyArg_ParseTuple(args, "s#", &seq, &length))
+    return NULL;
+
+  // Same definitions as the pure-Python functions in fidibus-stats.py: W and S
+  // count toward AT and GC content respectively, and N and X are ambiguous.
+  AgnSeqComposition comp;
+  agn_seq_composition_reset(&comp);
+  AEGEAN_BEGIN_ALLOW_THREADS
+  agn_seq_composition_count(&comp, seq, length);
+  AEGEAN_END_ALLOW_THREADS
+
+  double gccontent = agn_seq_composition_gc_content(&comp);
+  double gcskew = agn_seq_composition_gc_skew(&comp);
+  double ncontent = agn_seq_composition_n_content(&comp);
+  return Py_BuildValue("(ddd)", gccontent, gcskew, ncontent);
+}
+
+static PyObject *aegean_comparison_dict(AgnComparison *stats)
+{
+  PyObject *dict = Py_BuildValue("{s:k,s:k}",
+                                 "overall_matches", stats->overall_matches,
+                                 "overall_length", stats->overall_length);
+  if(dict == NULL ||
+     aegean_dict_steal(dict, "cds_nuc",
+                       aegean_nuc_dict(&stats->cds_nuc_stats)) == -1 ||
+     aegean_dict_steal(dict, "utr_nuc",
+                       aegean_nuc_dict(&stats->utr_nuc_stats)) == -1 ||
+     aegean_dict_steal(dict, "cds_struc",
+                       aegean_struc_dict(&stats->cds_struc_stats)) == -1 ||
+     aegean_dict_steal(dict, "exon_struc",
+                       aegean_struc_dict(&stats->exon_struc_stats)) == -1 ||
+     aegean_dict_steal(dict, "utr_struc",
+                       aegean_struc_dict(&stats->utr_struc_stats)) == -1)
+  {
+    Py_CLEAR(dict);
+  }
+  return dict;
+}
+
+static int aegean_dict_steal(PyObject *dict, const char *key, PyObject *value)
+{
+  if(value == NULL)
+    return -1;
+  int result = PyDict_SetItemString(dict, key, value);
+  Py_DECREF(value);
+  return result;
+}
+
+static PyObject *aegean_error(GtError *error)
+{
+  PyErr_SetString(PyExc_ValueError, gt_error_is_set(error)
+                                    ? gt_error_get(error)
+                                    : "unknown AEGeAn error");
+  gt_error_delete(error);
+  return NULL;
+}
+
+static PyObject *aegean_nuc_dict(AgnCompStatsScaled *stats)
+{
+  return Py_BuildValue("{s:k,s:k,s:k,s:k,s:d,s:d,s:d,s:d,s:d,s:d}",
+                       "tp", stats->tp, "fn", stats->fn,
+                       "fp", stats->fp, "tn", stats->tn,
+                       "mc", stats->mc, "cc", stats->cc,
+                       "sn", stats->sn, "sp", stats->sp,
+                       "f1", stats->f1, "ed", stats->ed);
+}
+
+static PyObject *aegean_struc_dict(AgnCompStatsBinary *stats)
+{
+  return Py_BuildValue("{s:k,s:k,s:k,s:d,s:d,s:d,s:d}",
+                       "correct", stats->correct, "missing", stats->missing,
+                       "wrong", stats->wrong,
+                       "sn", stats->sn, "sp", stats->sp,
+                       "f1", stats->f1, "ed", stats->ed);
+}
+
+//------------------------------------------------------------------------------
+// Module definition
+//------------------------------------------------------------------------------
+
+static PyMethodDef aegean_methods[] =
+{
+  { "compare", aegean_compare, METH_VARARGS,
+    "compare(refr, pred) -> dict\n\n"
+    "Compare reference and prediction annotations (GFF3 text) as ParsEval "
+    "does, returning per-locus and summary statistics." },
+  { "iloci", (PyCFunction)aegean_iloci, METH_VARARGS | METH_KEYWORDS,
+    "iloci(gff3, delta=500, refine=False) -> list\n\n"
+    "Compute interval loci from gene annotations (GFF3 text) as LocusPocus "
+    "does." },
+  { "seqstats", aegean_seqstats, METH_VARARGS,
+    "seqstats(seq) -> (gc_content, gc_skew, n_content)\n\n"
+    "Compute composition statistics for a nucleotide sequence." },
+  { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef aegean_module =
+{
+  PyModuleDef_HEAD_INIT, "_aegean",
+  "Native bindings for the AEGeAn Toolkit", -1, aegean_methods
+};
+
+PyMODINIT_FUNC PyInit__aegean(void)
+{
+  gt_lib_init();
+  PyObject *module = PyModule_Create(&aegean_module);
+  if(module == NULL)
+    return NULL;
+  if(PyModule_AddIntConstant(module, "API_VERSION", AGN_API_VERSION) == -1 ||
+     agn_api_version() != AGN_API_VERSION)
+  {
+    if(!PyErr_Occurred())
+      PyErr_SetString(PyExc_ImportError, "libaegean API version mismatch");
+    Py_DECREF(module);
+    return NULL;
+  }
+  return module;
+}
@@ -8,19 +8,26 @@
 
 from __future__ import print_function
 import argparse
-import os
 import re
 import subprocess
 import sys
 
 
-def run_locuspocus(infile, outfile, delta, ilenfile=None, debug=False):
-    command = 'locuspocus --verbose --namefmt=prelocus%lu'
+def c_name_format(namefmt):
+    """Convert a Python-style serial number format to a printf format."""
+    return re.sub(r'%(\d*)l?d', r'%\1lu', namefmt)
+
+
+def run_locuspocus(infile, outfile, delta, namefmt, ilenfile=None,
+                   miloci=None, debug=False):
+    command = 'locuspocus --verbose --cds --unannot'
+    command += ' --namefmt=%s' % c_name_format(namefmt)
     command += ' --delta %d' % delta
-    command += ' --outfile %s.lp' % outfile
-    command += ' --cds'
+    command += ' --outfile %s' % outfile
     if ilenfile:
         command += ' --ilens %s' % ilenfile
+    if miloci:
+        command += ' --miloci %s' % miloci
     command += ' %s' % infile
     if debug:
         print('command: %s' % command, file=sys.stderr)
@@ -28,52 +35,6 @@ def run_locuspocus(infile, outfile, delta, ilenfile=None, debug=False):
     cmd = command.split(' ')
     subprocess.check_call(cmd)
 
-    numloci = 0
-    with open('%s.lp' % outfile, 'r') as fp:
-        for line in fp:
-            if '\tlocus\t' in line:
-                numloci += 1
-    if debug:
-        print('numloci: %s' % numloci, file=sys.stderr)
-    return numloci
-
-
-def run_uloci(infile, outfile, counter, debug=False):
-    command = 'uloci.py --counter %d' % counter
-    command += ' --src AEGeAn::uloci.py'
-    command += ' %s' % infile
-    if debug:
-        print('command: %s' % command, file=sys.stderr)
-
-    cmd = command.split(' ')
-    with open('%s.ul' % outfile, 'w') as fp:
-        result = subprocess.call(cmd, stdout=fp)
-    if result:
-        print('command resulted in return status %d: %s' % (result, command),
-              file=sys.stderr)
-        exit(result)
-
-
-def combine_output(outfile, namefmt):
-    locusids = {}
-    with open(outfile, 'w') as fp:
-        command = 'gt gff3 -retainids -sort -tidy '
-        command += '%s.lp %s.ul' % (outfile, outfile)
-        cmd = command.split(' ')
-        p = subprocess.Popen(cmd, stdout=subprocess.PIPE,
-                             universal_newlines=True)
-        counter = 0
-        while True:
-            line = p.stdout.readline().rstrip()
-            if line:
-                if '\tlocus\t' in line:
-                    counter += 1
-                    locusname = namefmt % counter
-                    line = re.sub('Name=[^;\n]+', 'Name=%s' % locusname, line)
-                print(line, file=fp)
-            else:
-                break
-
 
 if __name__ == '__main__':
     desc = 'Report all iLoci for an annotation file'
@@ -87,6 +48,9 @@ if __name__ == '__main__':
                         ' locus; default format is "locus%%d"')
     parser.add_argument('--delta', type=int, default=500,
                         help='Delta for extending iLoci; default is 500')
+    parser.add_argument('--miloci', type=str, default=None,
+                        help='File to which merged iLoci (miLoci) will be '
+                        'written')
     parser.add_argument('--out', type=str, default=None,
                         help='Output file; default is $infile.loci')
     parser.add_argument('infile', help='Input data in GFF3 format')
@@ -94,10 +58,5 @@ if __name__ == '__main__':
     if not args.out:
         args.out = '%s.loci' % args.infile
 
-    numloci = run_locuspocus(args.infile, args.out, args.delta, args.ilenfile,
-                             args.debug)
-    run_uloci(args.infile, args.out, numloci + 1, args.debug)
-    combine_output(args.out, args.namefmt)
-
-    os.unlink('%s.lp' % args.out)
-    os.unlink('%s.ul' % args.out)
+    run_locuspocus(args.infile, args.out, args.delta, args.namefmt,
+                   args.ilenfile, args.miloci, args.debug)
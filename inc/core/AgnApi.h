@@ -0,0 +1,155 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_API
+#define AEGEAN_API
+
+#include "core/array_api.h"
+#include "core/error_api.h"
+#include "core/range_api.h"
+#include "AgnComparison.h"
+#include "AgnGaevalVisitor.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @module AgnApi
+ *
+ * Stable entry points for using ParsEval, LocusPocus, and GAEVAL functionality
+ * from other programs without writing files or spawning processes. Input is
+ * given as arrays of genome nodes, which can be built in memory or parsed from
+ * GFF3 text held in a buffer with ``agn_api_parse_gff3``. Results are returned
+ * as arrays of plain records. The functions in this module keep no state
+ * between calls, but GenomeTools interns feature types in a global table, so
+ * they may only be called from several threads at once if GenomeTools is
+ * compiled with ``threads=yes``. Even then, concurrent calls must not share
+ * nodes, since nodes are modified and GenomeTools reference counts are not
+ * atomic. ``AGN_API_VERSION`` is
+ * incremented whenever a function or record in this module changes in an
+ * incompatible way, and matches the SONAME version of ``libaegean.so``.
+ */ //;
+
+#define AGN_API_VERSION 1
+
+/**
+ * @type Comparison of reference and prediction annotations for a single locus.
+ */
+struct AgnApiLocusRecord
+{
+  char *seqid;
+  GtRange range;
+  GtUword refr_mrnas;
+  GtUword pred_mrnas;
+  AgnComparison stats;
+};
+typedef struct AgnApiLocusRecord AgnApiLocusRecord;
+
+/**
+ * @type An interval locus. The ``type`` is the value of the ``iLocus_type``
+ * attribute and is NULL unless iLoci were refined.
+ */
+struct AgnApiIlocusRecord
+{
+  char *seqid;
+  GtRange range;
+  char *name;
+  char *type;
+  GtUword num_genes;
+  GtUword num_mrnas;
+};
+typedef struct AgnApiIlocusRecord AgnApiIlocusRecord;
+
+/**
+ * @type GAEVAL scores for a single transcript.
+ */
+struct AgnApiGaevalRecord
+{
+  char *mrna;
+  double coverage;
+  double integrity;
+};
+typedef struct AgnApiGaevalRecord AgnApiGaevalRecord;
+
+/**
+ * @function Compare reference and prediction annotations, as ParsEval does.
+ * The ``refr`` and ``pred`` arrays contain genome nodes; the nodes are
+ * consumed by this function and both arrays are left empty. The source of each
+ * node is given by the array that holds it, so nodes built in memory and nodes
+ * parsed with the same label can be compared; the GenomeTools mark bit of every
+ * feature is used to record its source. Returns an array of
+ * ``AgnApiLocusRecord`` objects, one per locus, to be freed with
+ * ``agn_api_locus_records_delete``; if ``summary`` is not NULL, it is filled
+ * with the aggregate of all loci. Returns NULL and sets ``error`` on failure.
+ */
+GtArray *agn_api_compare(GtArray *refr, GtArray *pred,
+                         AgnComparisonData *summary, GtError *error);
+
+/**
+ * @function Compute GAEVAL coverage and integrity scores for each transcript
+ * in ``genes`` using the alignments in ``alignments``. Both arrays contain
+ * genome nodes, which are consumed by this function. Returns an array of
+ * ``AgnApiGaevalRecord`` objects, to be freed with
+ * ``agn_api_gaeval_records_delete``, or NULL on failure.
+ */
+GtArray *agn_api_gaeval(GtArray *genes, GtArray *alignments,
+                        AgnGaevalParams params, GtError *error);
+
+/**
+ * @function Free an array returned by ``agn_api_gaeval``.
+ */
+void agn_api_gaeval_records_delete(GtArray *records);
+
+/**
+ * @function Compute interval loci from the gene annotations in ``nodes``, as
+ * LocusPocus does. The nodes are consumed by this function. If ``refine`` is
+ * true, overlapping genes are split into separate iLoci where possible and
+ * each iLocus is classified. Returns an array of ``AgnApiIlocusRecord``
+ * objects, to be freed with ``agn_api_ilocus_records_delete``, or NULL on
+ * failure.
+ */
+GtArray *agn_api_iloci(GtArray *nodes, GtUword delta, bool refine,
+                       GtError *error);
+
+/**
+ * @function Free an array returned by ``agn_api_iloci``.
+ */
+void agn_api_ilocus_records_delete(GtArray *records);
+
+/**
+ * @function Free an array returned by ``agn_api_compare``.
+ */
+void agn_api_locus_records_delete(GtArray *records);
+
+/**
+ * @function Free an array of genome nodes, along with any nodes it contains.
+ */
+void agn_api_node_array_delete(GtArray *nodes);
+
+/**
+ * @function Parse ``length`` bytes of GFF3 text from ``buffer`` and return the
+ * resulting feature and region nodes in sorted order. Every node is labeled
+ * with ``label`` in place of a filename, for use in error messages. Returns
+ * NULL and sets
+ * ``error`` if the text is not valid GFF3.
+ */
+GtArray *agn_api_parse_gff3(const char *buffer, size_t length,
+                            const char *label, GtError *error);
+
+/**
+ * @function Run unit tests for this module. Returns true if all tests passed.
+ */
+bool agn_api_unit_test(AgnUnitTest *test);
+
+/**
+ * @function Return the value of ``AGN_API_VERSION`` the library was built
+ * with, so that callers can detect a mismatch with their headers.
+ */
+int agn_api_version();
+
+#endif
@@ -0,0 +1,51 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_ARENA
+#define AEGEAN_ARENA
+
+#include "core/types_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnArena
+ *
+ * A simple bump allocator. Memory is handed out sequentially from large blocks
+ * and is never freed individually; all of it is released at once when the
+ * arena is deleted. Intended for short-lived objects that share a common
+ * lifetime. At present only the clique pairs enumerated while comparing the
+ * annotations of a locus are allocated from an arena; the transcript cliques
+ * they refer to, and the arrays that hold them, are allocated individually.
+ */
+typedef struct AgnArena AgnArena;
+
+/**
+ * @function Allocate ``size`` bytes from the arena. The memory is suitably
+ * aligned for any type and remains valid until the arena is deleted.
+ */
+void *agn_arena_alloc(AgnArena *arena, size_t size);
+
+/**
+ * @function Class destructor. Releases all memory allocated from the arena.
+ */
+void agn_arena_delete(AgnArena *arena);
+
+/**
+ * @function Class constructor. Memory is reserved in blocks of ``blocksize``
+ * bytes (larger requests are given a block of their own).
+ */
+AgnArena *agn_arena_new(size_t blocksize);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_arena_unit_test(AgnUnitTest *test);
+
+#endif
@@ -10,6 +10,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #ifndef AEGEAN_CLIQUE_PAIR
 #define AEGEAN_CLIQUE_PAIR
 
+#include "AgnArena.h"
 #include "AgnComparison.h"
 #include "AgnTranscriptClique.h"
 
@@ -79,6 +80,16 @@ AgnComparison *agn_clique_pair_get_stats(AgnCliquePair *pair);
 AgnCliquePair* agn_clique_pair_new(AgnTranscriptClique *refr,
                                    AgnTranscriptClique *pred);
 
+/**
+ * @function Alternative constructor that allocates the pair from ``arena``
+ * rather than the heap. ``agn_clique_pair_delete`` releases the pair's
+ * references to its cliques, but the memory itself is reclaimed only when the
+ * arena is deleted.
+ */
+AgnCliquePair* agn_clique_pair_new_in_arena(AgnArena *arena,
+                                            AgnTranscriptClique *refr,
+                                            AgnTranscriptClique *pred);
+
 /**
  * @function Run unit tests for this class. Returns true if all tests passed.
  */
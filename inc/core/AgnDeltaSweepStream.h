@@ -0,0 +1,60 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_DELTA_SWEEP_STREAM
+#define AEGEAN_DELTA_SWEEP_STREAM
+
+#include <stdio.h>
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnDeltaSweepStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * that passes all nodes through unchanged, and reports the iLocus boundaries
+ * each gene-containing ``locus`` feature would have for each of several delta
+ * values. Grouping genes into loci does not depend on delta, so the loci
+ * produced by an ``AgnLocusStream`` with any delta can be used: the gene locus
+ * is recovered from the extent of each locus' subfeatures, and its left and
+ * right extension is computed for each delta using the same rules as the
+ * ``AgnLocusStream`` class. Splitting loci with an ``AgnLocusRefineStream``
+ * does not depend on delta either, so in refine mode the split is read from
+ * the refined iLoci and their boundaries are computed with the same rules as
+ * that class. Loci without subfeatures (such as iiLoci) are ignored, so the
+ * stream must be placed before subfeatures are removed. Sequence lengths are
+ * taken from region nodes.
+ */
+typedef struct AgnDeltaSweepStream AgnDeltaSweepStream;
+
+/**
+ * @function Class constructor. ``deltas`` is a list of ``GtUword`` values,
+ * which is copied. A tab-delimited table is written to ``outfile``, with one
+ * row for each gene locus (or refined iLocus): its sequence ID and
+ * coordinates, followed by the start and end coordinates of the corresponding
+ * iLocus and the length of the intergenic iLocus to its left (``NA`` for the
+ * first locus of a sequence, 0 for all but the first iLocus refined from a
+ * gene locus) for each delta value.
+ */
+GtNodeStream *agn_delta_sweep_stream_new(GtNodeStream *in_stream,
+                                         GtArray *deltas, FILE *outfile);
+
+/**
+ * @function Treat the input as the output of an ``AgnLocusRefineStream``:
+ * overlapping iLoci are taken to be refined from the same gene locus, and a
+ * row is written for each of them.
+ */
+void agn_delta_sweep_stream_refine(AgnDeltaSweepStream *stream);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_delta_sweep_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,59 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_EXTERNAL_SORT_STREAM
+#define AEGEAN_EXTERNAL_SORT_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnExternalSortStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a drop-in
+ * replacement for the ``GtSortStream`` class for inputs too large to hold in
+ * memory. Top-level features are buffered until a configurable number of
+ * feature nodes is reached; the buffer is then sorted and written to temporary
+ * GFF3 files, one per input file, and cleared. Once the input is exhausted,
+ * the sorted runs are read back and merged, so at most one feature per run is
+ * held in memory at a time. Region nodes and other non-feature nodes are kept
+ * in memory. As with ``GtSortStream``, features that compare equal are
+ * delivered in input order. Nodes read back from temporary files retain their
+ * original file name, line numbers, and IDs (no IDs are added), but not any
+ * user data, so this stream should be placed upstream of any stream that
+ * attaches user data. Subfeatures keep their exact line numbers only when the
+ * lines of the original feature are no more than 1000 lines apart in total.
+ * Features with several discontinuous parts sharing a single ID are only kept
+ * together if all parts fall in the same run.
+ */
+typedef struct AgnExternalSortStream AgnExternalSortStream;
+
+/**
+ * @function Class constructor. At most ``maxfeatures`` feature nodes (counting
+ * all nodes of each feature graph) are held in memory before the buffer is
+ * written to disk; if the input contains no more than ``maxfeatures`` feature
+ * nodes, nothing is written to disk at all.
+ */
+GtNodeStream *agn_external_sort_stream_new(GtNodeStream *in_stream,
+                                           GtUword maxfeatures);
+
+/**
+ * @function Write temporary files to ``tmpdir`` instead of the default, which
+ * is the value of the ``TMPDIR`` environment variable or ``/tmp`` if it is not
+ * set. Temporary files are unlinked as soon as they are created.
+ */
+void agn_external_sort_stream_set_tmpdir(AgnExternalSortStream *stream,
+                                         const char *tmpdir);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_external_sort_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,153 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_ILOCUS_INDEX
+#define AEGEAN_ILOCUS_INDEX
+
+#include <stdint.h>
+#include "core/array_api.h"
+#include "core/error_api.h"
+#include "core/range_api.h"
+#include "extended/feature_node_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnIlocusIndex
+ *
+ * A compact binary index of the iLoci computed by LocusPocus, for answering
+ * region and ID queries without parsing GFF3. An index is built in memory by
+ * adding iLocus features one at a time and is then written to a file; a
+ * written index is opened read-only by mapping the file into memory, so
+ * opening is cheap regardless of index size and no records are copied.
+ *
+ * Records are sorted by sequence and start coordinate. Each record stores the
+ * largest end coordinate of any record up to and including it on the same
+ * sequence, so the first record that can overlap a query region is found by
+ * binary search. iLoci are looked up by label in an open-addressing hash
+ * table. The label of an iLocus is its ``Name`` attribute, or its ``ID`` if it
+ * has no name, or ``seqid_start-end`` if it has neither. Integers are stored
+ * in the byte order of the machine that wrote the index; opening an index
+ * written with a different byte order fails with an error.
+ */
+typedef struct AgnIlocusIndex AgnIlocusIndex;
+
+/**
+ * @type A single iLocus as stored in an index. ``genes``, ``mrnas``, and
+ * ``effective_length`` are the values of the ``child_gene``, ``child_mRNA``,
+ * and ``effective_length`` attributes. The flanks are
+ * the lengths of the neighboring intergenic iLoci (``liil`` and ``riil``), and
+ * ``orient`` is the orientation of the flanking genes of an intergenic iLocus
+ * (``fg_orient``); each is 0 or empty if the attribute is absent. Use the
+ * ``agn_ilocus_index_record_*`` functions to get string values.
+ */
+struct AgnIlocusIndexRecord
+{
+  uint64_t start;
+  uint64_t end;
+  uint64_t maxend;
+  uint64_t effective_length;
+  uint64_t left_flank;
+  uint64_t right_flank;
+  uint32_t seqid;
+  uint32_t label;
+  uint32_t type;
+  uint32_t genes;
+  uint32_t mrnas;
+  char orient[4];
+};
+typedef struct AgnIlocusIndexRecord AgnIlocusIndexRecord;
+
+/**
+ * @function Add the iLocus ``locus`` to an index created with
+ * ``agn_ilocus_index_new``.
+ */
+void agn_ilocus_index_add(AgnIlocusIndex *index, GtFeatureNode *locus);
+
+/**
+ * @function Class destructor.
+ */
+void agn_ilocus_index_delete(AgnIlocusIndex *index);
+
+/**
+ * @function Find the iLocus labeled ``label``. Returns true and sets ``pos`` to
+ * its position in the index if it is found, false otherwise.
+ */
+bool agn_ilocus_index_find(AgnIlocusIndex *index, const char *label,
+                           GtUword *pos);
+
+/**
+ * @function Get the record at position ``pos`` of an open index.
+ */
+const AgnIlocusIndexRecord *agn_ilocus_index_get(AgnIlocusIndex *index,
+                                                 GtUword pos);
+
+/**
+ * @function Class constructor for an empty index, to which iLoci can be added
+ * before it is written.
+ */
+AgnIlocusIndex *agn_ilocus_index_new();
+
+/**
+ * @function Open the index in ``filename`` for queries. Returns NULL and sets
+ * ``error`` if the file cannot be read or is not a valid index.
+ */
+AgnIlocusIndex *agn_ilocus_index_open(const char *filename, GtError *error);
+
+/**
+ * @function Add the position of every iLocus on sequence ``seqid`` that
+ * overlaps ``range`` to ``positions`` (an array of ``GtUword`` values), in
+ * sorted order. Returns the number of positions added.
+ */
+GtUword agn_ilocus_index_query(AgnIlocusIndex *index, const char *seqid,
+                               GtRange *range, GtArray *positions);
+
+/**
+ * @function The label of iLocus ``rec``.
+ */
+const char *agn_ilocus_index_record_label(AgnIlocusIndex *index,
+                                          const AgnIlocusIndexRecord *rec);
+
+/**
+ * @function The flanking gene orientation of iLocus ``rec``, or "NA".
+ */
+const char *agn_ilocus_index_record_orient(AgnIlocusIndex *index,
+                                           const AgnIlocusIndexRecord *rec);
+
+/**
+ * @function The sequence ID of iLocus ``rec``.
+ */
+const char *agn_ilocus_index_record_seqid(AgnIlocusIndex *index,
+                                          const AgnIlocusIndexRecord *rec);
+
+/**
+ * @function The ``iLocus_type`` of iLocus ``rec``, or an empty string if it
+ * has none (iLoci are only classified in refine mode).
+ */
+const char *agn_ilocus_index_record_type(AgnIlocusIndex *index,
+                                         const AgnIlocusIndexRecord *rec);
+
+/**
+ * @function Number of iLoci in an open index.
+ */
+GtUword agn_ilocus_index_size(AgnIlocusIndex *index);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_ilocus_index_unit_test(AgnUnitTest *test);
+
+/**
+ * @function Write the iLoci added to ``index`` to ``filename``. Returns 0 on
+ * success; returns -1 and sets ``error`` otherwise.
+ */
+int agn_ilocus_index_write(AgnIlocusIndex *index, const char *filename,
+                           GtError *error);
+
+#endif
@@ -0,0 +1,48 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_ILOCUS_INDEX_STREAM
+#define AEGEAN_ILOCUS_INDEX_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnIlocusIndexStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * that passes all nodes through unchanged, adding each ``locus`` feature to an
+ * ``AgnIlocusIndex``. The index is written once the input is exhausted. Only
+ * attributes of the iLoci themselves are indexed, so the stream can be placed
+ * before or after subfeatures are removed.
+ */
+typedef struct AgnIlocusIndexStream AgnIlocusIndexStream;
+
+/**
+ * @function Class constructor. The index is written to ``filename``.
+ */
+GtNodeStream *agn_ilocus_index_stream_new(GtNodeStream *in_stream,
+                                          const char *filename);
+
+/**
+ * @function Before indexing an iLocus that has subfeatures but no ``ID``
+ * attribute, set its ID to ``locus<n>``, numbering such iLoci in the order
+ * they are seen. These are the IDs the GFF3 visitor creates for iLoci, so
+ * when subfeatures are printed the index can be queried with the IDs in the
+ * output.
+ */
+void agn_ilocus_index_stream_number_loci(AgnIlocusIndexStream *stream);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_ilocus_index_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -90,7 +90,12 @@ typedef struct AgnLocusFilter AgnLocusFilter;
  * following macros: ``agn_locus_add_pred_feature(locus, gene)`` and
  * ``agn_locus_add_refr_feature(locus, gene)``, to be used when keeping
  * track of an annotation's source is important (i.e. for pairwise comparison);
- * and ``agn_locus_add_feature(locus, gene)`` otherwise.
+ * and ``agn_locus_add_feature(locus, gene)`` otherwise. The source of a feature
+ * is tagged on the feature itself with the GenomeTools mark bit (set for
+ * predictions and cleared for references), so a feature must not be added to
+ * loci with different sources, and its mark must not be changed while it
+ * belongs to a locus. The locus itself is marked once it holds any feature
+ * added with a source.
  */
 void agn_locus_add(AgnLocus *locus, GtFeatureNode *feature,
                    AgnComparisonSource source);
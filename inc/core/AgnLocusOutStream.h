@@ -0,0 +1,41 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_LOCUS_OUT_STREAM
+#define AEGEAN_LOCUS_OUT_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnLocusOutStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * that passes all nodes through unchanged, writing them in GFF3 format. It is
+ * a faster replacement for an ``AgnRemoveChildrenStream`` followed by a
+ * ``GtGFF3OutStream`` when only top-level features are to be reported: each
+ * feature is formatted as a single line, without visiting its subfeatures,
+ * into a large buffer that is written to the output file in blocks. Output is
+ * identical to that of the generic writer, except that ``ID`` attributes are
+ * never reported.
+ */
+typedef struct AgnLocusOutStream AgnLocusOutStream;
+
+/**
+ * @function Class constructor. Output is written to ``outfile``.
+ */
+GtNodeStream *agn_locus_out_stream_new(GtNodeStream *in_stream,
+                                       GtFile *outfile);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_locus_out_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -21,7 +21,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
  * Implements the ``GtNodeStream`` interface. The only feature nodes delivered
  * by this stream have type ``locus``, and the only direct children of these
  * features are gene features present in the input stream. Any overlapping genes
- * are children of the same locus feature.
+ * are children of the same locus feature. The input stream must be sorted.
  */
 typedef struct AgnLocusStream AgnLocusStream;
 
@@ -35,6 +35,14 @@ typedef struct AgnLocusStream AgnLocusStream;
 void agn_locus_stream_label_pairwise(AgnLocusStream *stream,
                                      const char *refrfile,const char *predfile);
 
+/**
+ * @function Like ``agn_locus_stream_label_pairwise``, but label each feature by
+ * its GenomeTools mark bit rather than by its filename: marked features are
+ * predictions and unmarked features are references. Use this for features
+ * built in memory, which are not associated with a file.
+ */
+void agn_locus_stream_label_pairwise_marked(AgnLocusStream *stream);
+
 /**
  * @function Calculate iLoci from a node stream which may or may not include
  * data from multiple sources. Extend each iLocus boundary as far as possible
@@ -64,12 +72,40 @@ void agn_locus_stream_set_name_format(AgnLocusStream *stream, const char *fmt);
  */
 void agn_locus_stream_skip_iiLoci(AgnLocusStream *stream);
 
+/**
+ * @function By default, sequences with no features are not represented in the
+ * output. This function enables reporting an iLocus that spans each such
+ * sequence, marked with the ``unannot=true`` attribute and typed as an
+ * fiLocus, in its sorted position among the other iLoci. These are the iLoci
+ * formerly added by the ``uloci.py`` script. They are reported regardless of
+ * ``agn_locus_stream_set_endmode`` and ``agn_locus_stream_skip_iiLoci``.
+ */
+void agn_locus_stream_report_unannotated(AgnLocusStream *stream);
+
 /**
  * @function Set the source value to be used for all iLoci created by this
  * stream. Default value is 'AEGeAn::AgnLocusStream'.
  */
 void agn_locus_stream_set_source(AgnLocusStream *stream, const char *source);
 
+/**
+ * @function By default, each feature is added to its locus with its complete
+ * subfeature graph. This function enables a lean mode, intended for when only
+ * iLocus coordinates and counts are needed: as soon as a feature is read, it
+ * is replaced by a summary and its subfeatures are released. The summary
+ * retains the feature's type, coordinates, strand, source, and attributes, and
+ * a copy of each of its direct children (such as mRNAs) without
+ * subfeatures, so that gene and transcript counts are unchanged. The CDS
+ * range of each child is kept as a single ``CDS`` subfeature, and the
+ * feature's exons are merged into non-overlapping ``exon`` subfeatures of its
+ * first child. Has no effect for pairwise loci (see
+ * ``agn_locus_stream_label_pairwise``). Memory use is only reduced if the
+ * streams upstream of the locus stream do not hold all features themselves,
+ * as a ``GtSortStream`` does: the input should be sorted already (see
+ * ``AgnSortCheckStream``) or sorted in external memory.
+ */
+void agn_locus_stream_summarize_features(AgnLocusStream *stream);
+
 /**
  * @function Record the length of each intergenic iLocus as loci are being
  * parsed.
@@ -0,0 +1,44 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_MILOCUS_STREAM
+#define AEGEAN_MILOCUS_STREAM
+
+#include "core/file_api.h"
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnMilocusStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * that passes refined iLoci through unchanged while computing merged iLoci
+ * (miLoci) from them. Consecutive gene-containing iLoci (siLoci and niLoci,
+ * excluding those with an intron gene exception) on the same sequence are
+ * merged into a single ``locus`` feature with an ``iLocus_type`` of
+ * ``miLocus``. Numeric attributes of the merged iLoci are summed, each gene is
+ * described in a ``miLocusGeneN`` attribute, and the score is the number of
+ * iLoci merged. All other iLoci are copied as is. The ``ID`` and ``Name``
+ * attributes of the input are not retained. miLoci are written in GFF3 format
+ * as soon as the last iLocus of each merge has been read, so the input must be
+ * the output of ``AgnLocusRefineStream`` with gene features still attached.
+ */
+typedef struct AgnMilocusStream AgnMilocusStream;
+
+/**
+ * @function Class constructor. miLoci are written to ``outfile``.
+ */
+GtNodeStream *agn_milocus_stream_new(GtNodeStream *in_stream, GtFile *outfile);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_milocus_stream_unit_test(AgnUnitTest *test);
+
+#endif
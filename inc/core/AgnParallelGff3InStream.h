@@ -0,0 +1,74 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_PARALLEL_GFF3_IN_STREAM
+#define AEGEAN_PARALLEL_GFF3_IN_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnParallelGff3InStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a drop-in
+ * replacement for an unsorted ``GtGFF3InStream`` with ID attribute checking and
+ * tidy mode enabled, which parses each input file on several threads. Each
+ * file is memory-mapped and split into chunks of roughly equal size at ``###``
+ * lines: since all forward references must be resolved at a ``###`` line,
+ * each chunk can be parsed by a separate GFF3 parser. Chunks are first scanned
+ * in parallel for the sequence IDs they use and the ``##sequence-region``
+ * directives they contain, and each chunk is then parsed with the directives
+ * of the sequences it uses from preceding chunks. Parsed chunks are passed
+ * downstream in their original order, after checking that no ID is used in
+ * more than one chunk of a file, so the nodes (and their line numbers) are the
+ * same as those of the serial parser.
+ *
+ * A file is parsed as a whole if it has no ``###`` lines, uses a sequence that
+ * is not declared by a ``##sequence-region`` directive (in which case the
+ * parser creates a region node only after reading the entire file), or
+ * declares a sequence more than once. Compressed files and standard input
+ * (``-``) are always parsed as a whole, but several such files are still
+ * parsed concurrently. Everything following a ``##FASTA`` directive is parsed
+ * together with the chunk in which it occurs.
+ *
+ * GenomeTools reference counts are not atomic, so a node, and any data it
+ * shares with other nodes, must only be used by one thread at a time. Each
+ * chunk is parsed by its own parser, which keeps its own copies of the
+ * sequence IDs, sources, and file name of the nodes it creates, so the nodes of
+ * a chunk share no reference counted data with nodes on other threads until
+ * the chunk is passed downstream. Feature types are interned in the GenomeTools
+ * symbol table, however, which is only thread safe if GenomeTools is compiled
+ * with ``threads=yes``. Otherwise, chunks are parsed one at a time on the
+ * calling thread, as their nodes are requested.
+ */
+typedef struct AgnParallelGff3InStream AgnParallelGff3InStream;
+
+/**
+ * @function Class constructor. ``filenames`` is not copied, and must remain
+ * valid for the lifetime of the stream. Input is split and parsed using
+ * ``numthreads`` threads when the first node is requested.
+ */
+GtNodeStream *agn_parallel_gff3_in_stream_new(int numfiles,
+                                              const char **filenames,
+                                              int numthreads);
+
+/**
+ * @function Split each input file into chunks of at least ``chunksize`` bytes
+ * (up to the next ``###`` line) instead of the default of 4 MB. Must be called
+ * before the first node is requested.
+ */
+void agn_parallel_gff3_in_stream_set_chunk_size(AgnParallelGff3InStream *stream,
+                                                GtUword chunksize);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_parallel_gff3_in_stream_unit_test(AgnUnitTest *test);
+
+#endif
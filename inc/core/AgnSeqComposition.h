@@ -0,0 +1,81 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_SEQ_COMPOSITION
+#define AEGEAN_SEQ_COMPOSITION
+
+#include "core/types_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @module AgnSeqComposition
+ *
+ * Nucleotide composition of DNA sequences. A, T, and W count toward AT
+ * content, and C, G, and S count toward GC content. N and X are counted as
+ * ambiguous. Other characters contribute only to the sequence length. Case is
+ * ignored. Where the compiler targets SSE2, bases are counted 16 at a time.
+ */ //;
+
+/**
+ * @type Base counts for a sequence. ``gc`` includes S in addition to ``g`` and
+ * ``c``, and ``at`` includes W.
+ */
+struct AgnSeqComposition
+{
+  GtUword length;
+  GtUword at;
+  GtUword gc;
+  GtUword g;
+  GtUword c;
+  GtUword n;
+};
+typedef struct AgnSeqComposition AgnSeqComposition;
+
+/**
+ * @function Add the bases of the first ``length`` characters of ``seq`` to the
+ * counts in ``comp``, which must be zeroed with ``agn_seq_composition_reset``
+ * before the first call.
+ */
+void agn_seq_composition_count(AgnSeqComposition *comp, const char *seq,
+                               GtUword length);
+
+/**
+ * @function Fraction of unambiguous bases that are G or C, or 0.0 if there are
+ * no unambiguous bases.
+ */
+double agn_seq_composition_gc_content(AgnSeqComposition *comp);
+
+/**
+ * @function GC skew, (G - C) / (G + C), or 0.0 if there are no Gs or Cs.
+ */
+double agn_seq_composition_gc_skew(AgnSeqComposition *comp);
+
+/**
+ * @function Fraction of the sequence made up of ambiguous bases.
+ */
+double agn_seq_composition_n_content(AgnSeqComposition *comp);
+
+/**
+ * @function Set all counts in ``comp`` to zero.
+ */
+void agn_seq_composition_reset(AgnSeqComposition *comp);
+
+/**
+ * @function Swap the G and C counts, giving the composition of the reverse
+ * complement of the counted sequence.
+ */
+void agn_seq_composition_reverse(AgnSeqComposition *comp);
+
+/**
+ * @function Run unit tests for this module. Returns true if all tests passed.
+ */
+bool agn_seq_composition_unit_test(AgnUnitTest *test);
+
+#endif
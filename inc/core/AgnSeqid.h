@@ -0,0 +1,46 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_SEQID
+#define AEGEAN_SEQID
+
+#include "extended/genome_node_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @module AgnSeqid
+ *
+ * Functions for comparing the sequence IDs of genome nodes. The GFF3 parser
+ * stores a single ``GtStr`` object per sequence per file, so the sequence IDs
+ * of nodes from the same file are equal if they are the same object. Sequence
+ * IDs from different files are only compared character by character if they
+ * have the same length. These comparisons use no shared state, take no locks,
+ * and do not reference the nodes' ``GtStr`` objects, so they may be used from
+ * several threads at once.
+ */ //;
+
+/**
+ * @function Compare the sequence IDs of two genome nodes, returning 0 if the
+ * sequence IDs are identical. Otherwise, the sequence IDs are ordered
+ * lexicographically, consistent with ``gt_str_cmp``.
+ */
+int agn_seqid_compare(GtGenomeNode *gn1, GtGenomeNode *gn2);
+
+/**
+ * @function Return true if the two genome nodes have the same sequence ID.
+ */
+bool agn_seqid_equal(GtGenomeNode *gn1, GtGenomeNode *gn2);
+
+/**
+ * @function Run unit tests for this module. Returns true if all tests passed.
+ */
+bool agn_seqid_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,52 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_SORT_CHECK_STREAM
+#define AEGEAN_SORT_CHECK_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnSortCheckStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * that passes its input through unchanged, verifying as each node arrives that
+ * the input satisfies the ordering required by ``AgnLocusStream``: features
+ * for each sequence are contiguous, sorted by start position, and preceded by
+ * a region node for that sequence. It can replace a sort stream when the
+ * input is known to be sorted, so that nodes are processed as they are read
+ * rather than after the entire input has been loaded. The stream reports an
+ * error identifying the first out-of-order feature. Note that the GenomeTools
+ * GFF3 parser infers the region of any sequence without a
+ * ``##sequence-region`` pragma from its features, and so holds back every
+ * feature until the end of the file. Input should therefore declare each
+ * sequence with a pragma, as the output of ``gt gff3 -sort -tidy`` does;
+ * otherwise nothing is gained over sorting the input in memory.
+ */
+typedef struct AgnSortCheckStream AgnSortCheckStream;
+
+/**
+ * @function Class constructor.
+ */
+GtNodeStream *agn_sort_check_stream_new(GtNodeStream *in_stream);
+
+/**
+ * @function Also require that sequences appear in lexicographic order of their
+ * IDs, as in the output of ``gt gff3 -sort``. The output of several streams
+ * checked this way can be combined with a ``GtMergeStream``.
+ */
+void agn_sort_check_stream_check_seqid_order(AgnSortCheckStream *stream);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_sort_check_stream_unit_test(AgnUnitTest *test);
+
+#endif
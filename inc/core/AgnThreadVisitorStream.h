@@ -0,0 +1,54 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_THREAD_VISITOR_STREAM
+#define AEGEAN_THREAD_VISITOR_STREAM
+
+#include "extended/node_stream_api.h"
+#include "extended/node_visitor_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnThreadVisitorStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. Like a
+ * ``GtVisitorStream``, this stream applies a node visitor to every node that
+ * passes through it, but the visitor runs on a separate thread. Nodes are
+ * pulled from the input stream on the calling thread and handed to the visitor
+ * in batches through a bounded queue, and each batch is passed downstream (in
+ * the original order) once it has been visited. The visitor, which is
+ * typically an output stage such as a GFF3 writer, thus overlaps with all of
+ * the processing upstream of it, and throughput is that of the slower of the
+ * two rather than their sum.
+ *
+ * GenomeTools reference counts are not atomic, so a node, and any data it
+ * shares with other nodes, must only be used by one thread at a time. The
+ * nodes passed to the visitor share reference counted data (such as sequence
+ * IDs) with nodes still being created and deleted upstream, so they are only
+ * ever created, referenced, and deleted on the calling thread: the visitor
+ * must only read the nodes it visits, and must not take or release references
+ * to them or create new nodes. It must also not share any other state with
+ * streams or visitors running on the calling thread.
+ */
+typedef struct AgnThreadVisitorStream AgnThreadVisitorStream;
+
+/**
+ * @function Class constructor. The stream takes ownership of ``visitor``, as
+ * ``gt_visitor_stream_new`` does. The visitor thread is started when the first
+ * node is requested.
+ */
+GtNodeStream *agn_thread_visitor_stream_new(GtNodeStream *in_stream,
+                                            GtNodeVisitor *visitor);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_thread_visitor_stream_unit_test(AgnUnitTest *test);
+
+#endif
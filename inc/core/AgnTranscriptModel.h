@@ -0,0 +1,100 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_TRANSCRIPT_MODEL
+#define AEGEAN_TRANSCRIPT_MODEL
+
+#include "extended/feature_node_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnTranscriptModel
+ *
+ * A flat, read-only summary of the structure of a single transcript. The
+ * exon, CDS, UTR, and intron subfeatures of the transcript are collected (and
+ * sorted) exactly once, and their coordinates and combined lengths are stored
+ * in contiguous arrays. ``AgnGeneStream`` attaches a model to every mRNA it
+ * validates, and functions such as ``agn_typecheck_select``,
+ * ``agn_feature_node_get_cds_range``, and ``agn_mrna_cds_length`` use the
+ * attached model rather than traversing the feature graph again. The model
+ * refers to the transcript's subfeatures, and thus is only valid as long as
+ * the structure of the transcript is not modified after it is attached.
+ */
+typedef struct AgnTranscriptModel AgnTranscriptModel;
+
+struct AgnTranscriptModel
+{
+  GtRange range;
+  GtRange cds_range;
+  GtUword exon_length;
+  GtUword cds_length;
+  GtUword utr5p_length;
+  GtUword utr3p_length;
+  GtUword num_exons;
+  GtUword num_cds;
+  GtUword num_utr5p;
+  GtUword num_utr3p;
+  GtUword num_introns;
+  GtRange *exons;
+  GtRange *cds;
+  GtRange *utr5p;
+  GtRange *utr3p;
+  GtRange *introns;
+  GtFeatureNode **exon_nodes;
+  GtFeatureNode **cds_nodes;
+  GtFeatureNode **utr5p_nodes;
+  GtFeatureNode **utr3p_nodes;
+  GtFeatureNode **intron_nodes;
+};
+
+/**
+ * @function Store ``model`` with ``transcript`` so that it is available to
+ * downstream components. The transcript takes ownership of the model.
+ */
+void agn_transcript_model_attach(GtFeatureNode *transcript,
+                                 AgnTranscriptModel *model);
+
+/**
+ * @function Class destructor.
+ */
+void agn_transcript_model_delete(AgnTranscriptModel *model);
+
+/**
+ * @function Retrieve the model attached to ``transcript``, or NULL if no model
+ * has been attached.
+ */
+AgnTranscriptModel *agn_transcript_model_get(GtFeatureNode *transcript);
+
+/**
+ * @function Class constructor. Summarizes the structure of the given
+ * transcript. The model is allocated as a single block of memory.
+ */
+AgnTranscriptModel *agn_transcript_model_new(GtFeatureNode *transcript);
+
+/**
+ * @function Look up the subfeatures selected by ``func``, which must be one of
+ * ``agn_typecheck_exon``, ``agn_typecheck_cds``, ``agn_typecheck_utr5p``,
+ * ``agn_typecheck_utr3p``, or ``agn_typecheck_intron``. On success, ``nodes``
+ * is set to the model's sorted array of the subfeatures, ``count`` to its size,
+ * and ``length`` to the subfeatures' combined length (any of these may be
+ * NULL). Returns false if the model does not track features selected by
+ * ``func``.
+ */
+bool agn_transcript_model_lookup(AgnTranscriptModel *model,
+                                 bool (*func)(GtFeatureNode *),
+                                 GtFeatureNode ***nodes, GtUword *count,
+                                 GtUword *length);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_transcript_model_unit_test(AgnUnitTest *test);
+
+#endif
@@ -16,14 +16,46 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 /**
  * @module AgnTypecheck
  *
- * Functions for testing feature types.
+ * Functions for testing feature types. Each feature type (including synonyms
+ * such as ``messenger_RNA`` for ``mRNA``) is resolved to an integer class the
+ * first time it is seen. GenomeTools interns feature type strings, so later
+ * checks on any feature sharing that type reduce to a pointer lookup and an
+ * integer comparison rather than a series of string comparisons.
  */ //;
 
+/**
+ * @type Integer classes to which feature types are mapped. Types not
+ * recognized by AEGeAn map to ``AGN_FEATURE_OTHER``.
+ */
+enum AgnFeatureClass
+{
+  AGN_FEATURE_OTHER,
+  AGN_FEATURE_GENE,
+  AGN_FEATURE_PSEUDOGENE,
+  AGN_FEATURE_MRNA,
+  AGN_FEATURE_TRNA,
+  AGN_FEATURE_RRNA,
+  AGN_FEATURE_EXON,
+  AGN_FEATURE_INTRON,
+  AGN_FEATURE_CDS,
+  AGN_FEATURE_UTR,
+  AGN_FEATURE_UTR3P,
+  AGN_FEATURE_UTR5P,
+  AGN_FEATURE_START_CODON,
+  AGN_FEATURE_STOP_CODON
+};
+typedef enum AgnFeatureClass AgnFeatureClass;
+
 /**
  * @function Returns true if the given feature is a CDS; false otherwise.
  */
 bool agn_typecheck_cds(GtFeatureNode *fn);
 
+/**
+ * @function Determine the type class of the given feature.
+ */
+AgnFeatureClass agn_typecheck_class(GtFeatureNode *fn);
+
 /**
  * @function Count the number of ``fn``'s children that have the given type.
  */
@@ -65,6 +97,9 @@ bool agn_typecheck_pseudogene(GtFeatureNode *fn);
 /**
  * @function Gather the children of a given feature that have a certain type.
  * Type is tested by ``func``, which accepts a single ``GtFeatureNode`` object.
+ * The children are sorted by position, features with identical positions
+ * remaining in depth-first order, whether or not they are taken from an
+ * attached ``AgnTranscriptModel``.
  */
 GtArray *agn_typecheck_select(GtFeatureNode *fn, bool (*func)(GtFeatureNode *));
 
@@ -11,6 +11,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #define AGN_UTILS
 
 #include "core/array_api.h"
+#include "core/logger_api.h"
 #include "core/str_api.h"
 #include "extended/feature_index_api.h"
 #include "extended/genome_node_api.h"
@@ -35,6 +36,22 @@ struct AgnSequenceRegion
 };
 typedef struct AgnSequenceRegion AgnSequenceRegion;
 
+/**
+ * @type How the space between two adjacent gene loci is divided when each is
+ * extended by delta to form an iLocus. Only ``AGN_ILOCUS_GAP_IILOCUS`` leaves
+ * room for an intergenic iLocus; the others correspond to the
+ * ``delta-overlap-gene``, ``delta-overlap-delta``, and ``delta-re-extend``
+ * iiLocus exceptions.
+ */
+enum AgnIlocusGap
+{
+  AGN_ILOCUS_GAP_OVERLAP_GENE,
+  AGN_ILOCUS_GAP_OVERLAP_DELTA,
+  AGN_ILOCUS_GAP_RE_EXTEND,
+  AGN_ILOCUS_GAP_IILOCUS
+};
+typedef enum AgnIlocusGap AgnIlocusGap;
+
 #ifndef NDEBUG
 /* Stolen shamelessley from gt_assert() */
 #define agn_assert(expression)                                               \
@@ -128,6 +145,48 @@ bool agn_feature_overlap_check(GtArray *feats);
  */
 int agn_genome_node_compare(GtGenomeNode **gn_a, GtGenomeNode **gn_b);
 
+/**
+ * @function Divide the space between a gene locus ending at ``prevend`` and
+ * the next gene locus on the same sequence, starting at ``start``. The end of
+ * the first iLocus is stored in ``newend`` and the start of the second in
+ * ``newstart``; for ``AGN_ILOCUS_GAP_IILOCUS``, the intergenic iLocus lies
+ * between them.
+ */
+AgnIlocusGap agn_ilocus_gap(GtUword prevend, GtUword start, GtRange *seqrange,
+                            GtUword delta, GtUword *newend,
+                            GtUword *newstart);
+
+/**
+ * @function Start of the iLocus for the first gene locus on a sequence, which
+ * starts at ``start``.
+ */
+GtUword agn_ilocus_initial_start(GtUword start, GtRange *seqrange,
+                                 GtUword delta);
+
+/**
+ * @function Refine an iLocus spanning ``origrange`` into the ``num`` iLoci
+ * whose gene ranges are given in ``ranges``, sorted by start coordinate. Each
+ * range is extended by delta without leaving ``origrange``, and then the
+ * first iLocus and the one reaching furthest right are stretched to the ends
+ * of ``origrange``. The iLocus boundaries are stored in ``ranges``. This is
+ * how ``AgnLocusRefineStream`` places the iLoci it splits a locus into.
+ */
+void agn_ilocus_refine(GtRange *ranges, GtUword num, GtRange *origrange,
+                       GtUword delta);
+
+/**
+ * @function End of the iLocus for the last gene locus on a sequence, which
+ * ends at ``end``.
+ */
+GtUword agn_ilocus_terminal_end(GtUword end, GtRange *seqrange, GtUword delta);
+
+/**
+ * @function Wrapper for ``gt_logger_log``. The logger's output stream is
+ * locked for the duration of the call, so that messages logged concurrently
+ * from several threads sharing a logger are never interleaved.
+ */
+void agn_logger_log(GtLogger *logger, const char *format, ...);
+
 /**
  * @function Determine the length of an mRNA's 3' UTR.
  */
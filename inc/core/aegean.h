@@ -8,26 +8,40 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include "AgnApi.h"
+#include "AgnArena.h"
 #include "AgnAttributeFilterStream.h"
 #include "AgnCliquePair.h"
 #include "AgnCompareReportHTML.h"
 #include "AgnCompareReportText.h"
 #include "AgnComparison.h"
+#include "AgnDeltaSweepStream.h"
+#include "AgnExternalSortStream.h"
 #include "AgnFilterStream.h"
 #include "AgnGeneStream.h"
 #include "AgnIdFilterStream.h"
+#include "AgnIlocusIndex.h"
+#include "AgnIlocusIndexStream.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
 #include "AgnInferParentStream.h"
 #include "AgnLocus.h"
 #include "AgnLocusFilterStream.h"
 #include "AgnLocusMapVisitor.h"
+#include "AgnLocusOutStream.h"
 #include "AgnLocusRefineStream.h"
 #include "AgnLocusStream.h"
+#include "AgnMilocusStream.h"
 #include "AgnMrnaRepVisitor.h"
+#include "AgnParallelGff3InStream.h"
 #include "AgnPseudogeneFixVisitor.h"
 #include "AgnRemoveChildrenVisitor.h"
+#include "AgnSeqComposition.h"
+#include "AgnSeqid.h"
+#include "AgnSortCheckStream.h"
+#include "AgnThreadVisitorStream.h"
 #include "AgnTranscriptClique.h"
+#include "AgnTranscriptModel.h"
 #include "AgnTypecheck.h"
 #include "AgnUnitTest.h"
 #include "AgnUtils.h"
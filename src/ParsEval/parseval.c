@@ -8,6 +8,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 #include "pe_options.h"
+#include "pe_server.h"
 #include "pe_utils.h"
 
 int main(int argc, char **argv)
@@ -34,7 +35,7 @@ int main(int argc, char **argv)
     return 1;
   }
   int numfiles = argc - optind;
-  if(numfiles != 2)
+  if(numfiles != 2 && options.socketpath == NULL)
   {
     fprintf(stderr, "[ParsEval] error: must provide two GFF3 files as input");
     pe_print_usage(stderr);
@@ -42,6 +43,19 @@ int main(int argc, char **argv)
   }
 
   logger = gt_logger_new(true, "", stderr);
+  if(options.socketpath != NULL)
+  {
+    int result = pe_server_run(&options, logger, error);
+    if(result == -1)
+      fprintf(stderr, "[ParsEval] error: %s\n", gt_error_get(error));
+    gt_free(start_time);
+    pe_free_option_memory(&options);
+    gt_logger_delete(logger);
+    gt_error_delete(error);
+    gt_lib_clean();
+    return result == -1 ? 1 : 0;
+  }
+
   streams = gt_queue_new();
 
 
@@ -55,7 +69,11 @@ int main(int argc, char **argv)
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = gt_sort_stream_new(last_stream);
+  if(options.sortbuffer > 0)
+    current_stream = agn_external_sort_stream_new(last_stream,
+                                                  options.sortbuffer);
+  else
+    current_stream = gt_sort_stream_new(last_stream);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
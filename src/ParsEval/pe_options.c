@@ -21,10 +21,11 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "a:df:ghkl:o:pr:st:Vvwx:y:";
+  const char *optstr = "a:b:df:ghkl:o:pr:S:st:Vvwx:y:";
   const struct option parseval_options[] =
   {
     { "datashare",  required_argument, NULL, 'a' },
+    { "sortbuffer", required_argument, NULL, 'b' },
     { "debug",      no_argument,       NULL, 'd' },
     { "outformat",  required_argument, NULL, 'f' },
     { "printgff3",  no_argument,       NULL, 'g' },
@@ -34,6 +35,7 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     { "outfile",    required_argument, NULL, 'o' },
     { "nopng",      no_argument,       NULL, 'p' },
     { "filterfile", required_argument, NULL, 'r' },
+    { "server",     required_argument, NULL, 'S' },
     { "summary",    no_argument,       NULL, 's' },
     { "maxtrans",   required_argument, NULL, 't' },
     { "verbose",    no_argument,       NULL, 'V' },
@@ -52,6 +54,15 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     {
       options->data_path = optarg;
     }
+    else if(opt == 'b')
+    {
+      if(sscanf(optarg, "%lu", &options->sortbuffer) != 1)
+      {
+        fprintf(stderr, "error: could not convert sortbuffer '%s' to an "
+                "integer\n", optarg);
+        exit(1);
+      }
+    }
     else if(opt == 'd')
     {
       options->debug = true;
@@ -110,6 +121,10 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
       agn_locus_filter_parse(filterfile, options->filters);
       fclose(filterfile);
     }
+    else if(opt == 'S')
+    {
+      options->socketpath = optarg;
+    }
     else if(opt == 's')
     {
       options->summary_only = true;
@@ -180,6 +195,20 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     gt_array_add(options->filters, filter);
   }
 
+  if(options->socketpath != NULL)
+  {
+    if(argc - optind != 1)
+    {
+      pe_print_usage(stderr);
+      fprintf(stderr, "error: must provide 1 (and only 1) reference file in "
+              "server mode, you provided %d\n\n", argc - optind);
+      exit(1);
+    }
+    options->refrfile = argv[optind];
+    options->graphics = false;
+    return optind;
+  }
+
   if(argc - optind != 2)
   {
     pe_print_usage(stderr);
@@ -315,8 +344,13 @@ void pe_print_usage(FILE *outstream)
   fprintf(outstream,
 "\nParsEval: comparative analysis of two alternative sources of annotation\n"
 "Usage: parseval [options] reference.gff3 prediction.gff3\n"
+"       parseval [options] --server=SOCKET reference.gff3\n"
 "  Basic options:\n"
 "    -d|--debug:                 Print debugging messages\n"
+"    -b|--sortbuffer: INT        Sort input in external memory, holding at\n"
+"                                most INT features in memory at a time;\n"
+"                                temporary files are written to $TMPDIR\n"
+"                                (default /tmp)\n"
 "    -h|--help:                  Print help message and exit\n"
 "    -l|--delta: INT             Extend gene loci by this many nucleotides;\n"
 "                                default is 0\n"
@@ -349,7 +383,16 @@ void pe_print_usage(FILE *outstream)
 "    -r|--filterfile: STRING     Use the indicated configuration file to\n"
 "                                filter reported results;\n"
 "    -t|--maxtrans: INT          Maximum transcripts allowed per locus; use 0\n"
-"                                to disable limit; default is 32\n\n");
+"                                to disable limit; default is 32\n\n"
+"  Server options:\n"
+"    -S|--server: SOCKET         Load the reference annotation once and serve\n"
+"                                comparisons on the given Unix-domain socket\n"
+"                                until interrupted; each request is a line\n"
+"                                with the length in bytes of the prediction\n"
+"                                GFF3 that follows, and is answered with one\n"
+"                                tab-separated line of stats per locus and a\n"
+"                                '###' line; output and filtering options do\n"
+"                                not apply in this mode\n\n");
 }
 
 void pe_set_option_defaults(ParsEvalOptions *options)
@@ -375,4 +418,6 @@ void pe_set_option_defaults(ParsEvalOptions *options)
   options->verbose = false;
   options->max_transcripts = 32;
   options->delta = 0;
+  options->socketpath = NULL;
+  options->sortbuffer = 0;
 }
@@ -50,6 +50,8 @@ struct ParsEvalOptions
   bool verbose;
   int max_transcripts;
   GtUword delta;
+  const char *socketpath;
+  GtUword sortbuffer;
 };
 typedef struct ParsEvalOptions ParsEvalOptions;
 
@@ -0,0 +1,634 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "pe_server.h"
+
+// Label given to prediction annotations received from clients, in place of a
+// filename.
+#define PE_SERVER_QUERY_LABEL "query"
+
+static volatile sig_atomic_t pe_server_shutdown = 0;
+
+// State shared by all connections. The reference genes in the index are
+// never modified after loading; requests compare private copies of them.
+// GenomeTools reference counts are not atomic, so the index and its nodes are
+// only accessed while holding the lock, which also guards the list of client
+// sockets being served.
+typedef struct
+{
+  GtFeatureIndex *refr;
+  GtLogger *logger;
+  GtArray *clients;
+  pthread_mutex_t lock;
+  pthread_cond_t idle;
+} PeServer;
+
+// A client connection handed to a thread of its own
+typedef struct
+{
+  PeServer *server;
+  int client;
+} PeServerConnection;
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Parse the prediction GFF3 in ``request``, compare it against the
+ * reference, and return the resulting locus records, or NULL on error.
+ */
+static GtArray *pe_server_compare(PeServer *server, GtStr *request,
+                                  GtError *error);
+
+/**
+ * @function Copy ``fn`` and its subfeatures (recursively) with the given
+ * sequence ID, so that the copy shares no reference counted data with the
+ * original. ``copies`` maps each feature already copied to its copy, so that a
+ * subfeature with several parents is copied once.
+ */
+static GtFeatureNode *pe_server_feature_copy(GtFeatureNode *fn, GtStr *seqid,
+                                             GtHashmap *copies);
+
+/**
+ * @function Copy a reference gene with ``pe_server_feature_copy``, including
+ * any multi-feature relationships among its subfeatures.
+ */
+static GtGenomeNode *pe_server_gene_copy(GtFeatureNode *gene, GtStr *seqid);
+
+/**
+ * @function Parse the reference annotation into a feature index of gene
+ * features, sorted and validated as they would be for a ParsEval run.
+ */
+static GtFeatureIndex *pe_server_load(const char *refrfile, GtLogger *logger,
+                                      GtError *error);
+
+/**
+ * @function Read the next request from the client into ``request``. Returns 1
+ * if a request was read, 0 if the client closed the connection, or -1 (setting
+ * ``error``) if the request is malformed or incomplete.
+ */
+static int pe_server_read(FILE *instream, GtStr *request, GtError *error);
+
+/**
+ * @function Copy the reference genes belonging to the same loci as the given
+ * predictions, including genes that overlap them only indirectly, plus a
+ * region node for each sequence involved.
+ */
+static GtArray *pe_server_refr_genes(PeServer *server, GtArray *pred,
+                                     GtError *error);
+
+/**
+ * @function Remove the client from the list of sockets being served.
+ */
+static void pe_server_release(PeServer *server, int client);
+
+/**
+ * @function Serve requests on the given connection until the client closes it
+ * or sends a malformed request, then close it.
+ */
+static void pe_server_serve(PeServer *server, int client);
+
+/**
+ * @function Signal handler: finish the current request, then shut down.
+ */
+static void pe_server_signal(int signum);
+
+/**
+ * @function Serve the given connection on a separate thread, which does not
+ * receive the shutdown signals.
+ */
+static void pe_server_spawn(PeServer *server, int client);
+
+/**
+ * @function Thread function: serve a single connection.
+ */
+static void *pe_server_thread(void *data);
+
+/**
+ * @function Write the comparison results to the client.
+ */
+static void pe_server_write(FILE *outstream, GtArray *records);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+int pe_server_run(ParsEvalOptions *options, GtLogger *logger, GtError *error)
+{
+  struct sockaddr_un addr;
+  if(strlen(options->socketpath) >= sizeof (addr.sun_path))
+  {
+    gt_error_set(error, "socket path '%s' is too long", options->socketpath);
+    return -1;
+  }
+
+  // Remove a socket left over from a previous run, but nothing else.
+  struct stat sockstat;
+  if(stat(options->socketpath, &sockstat) == 0)
+  {
+    if(!S_ISSOCK(sockstat.st_mode))
+    {
+      gt_error_set(error, "'%s' exists and is not a socket",
+                   options->socketpath);
+      return -1;
+    }
+    unlink(options->socketpath);
+  }
+
+  PeServer server;
+  server.refr = pe_server_load(options->refrfile, logger, error);
+  if(server.refr == NULL)
+    return -1;
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, options->socketpath);
+  if(sock == -1 ||
+     bind(sock, (struct sockaddr *)&addr, sizeof (addr)) == -1 ||
+     listen(sock, SOMAXCONN) == -1)
+  {
+    gt_error_set(error, "cannot listen on socket '%s': %s",
+                 options->socketpath, strerror(errno));
+    if(sock != -1)
+      close(sock);
+    gt_feature_index_delete(server.refr);
+    return -1;
+  }
+
+  server.logger = logger;
+  server.clients = gt_array_new( sizeof(int) );
+  pthread_mutex_init(&server.lock, NULL);
+  pthread_cond_init(&server.idle, NULL);
+
+  // No SA_RESTART: a signal must interrupt a blocking accept().
+  struct sigaction action;
+  memset(&action, 0, sizeof (action));
+  action.sa_handler = pe_server_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  // Comparisons intern feature types in the GenomeTools symbol table, which is
+  // only thread safe if GenomeTools is compiled with 'threads=yes'.
+  bool threaded = gt_multithread_support();
+  agn_logger_log(logger, "[ParsEval] listening on %s", options->socketpath);
+  while(!pe_server_shutdown)
+  {
+    int client = accept(sock, NULL, NULL);
+    if(client == -1)
+    {
+      if(errno != EINTR)
+      {
+        agn_logger_log(logger, "[ParsEval] warning: accept failed: %s",
+                       strerror(errno));
+      }
+      continue;
+    }
+    if(threaded)
+      pe_server_spawn(&server, client);
+    else
+      pe_server_serve(&server, client);
+  }
+
+  // Stop reading from open connections, so that each finishes the request it
+  // is handling and then closes.
+  agn_logger_log(logger, "[ParsEval] shutting down");
+  close(sock);
+  pthread_mutex_lock(&server.lock);
+  GtUword i;
+  for(i = 0; i < gt_array_size(server.clients); i++)
+  {
+    int client = *(int *)gt_array_get(server.clients, i);
+    shutdown(client, SHUT_RD);
+  }
+  while(gt_array_size(server.clients) > 0)
+    pthread_cond_wait(&server.idle, &server.lock);
+  pthread_mutex_unlock(&server.lock);
+
+  unlink(options->socketpath);
+  pthread_cond_destroy(&server.idle);
+  pthread_mutex_destroy(&server.lock);
+  gt_array_delete(server.clients);
+  gt_feature_index_delete(server.refr);
+  return 0;
+}
+
+static GtArray *pe_server_compare(PeServer *server, GtStr *request,
+                                  GtError *error)
+{
+  GtArray *records = NULL;
+  GtArray *pred = agn_api_parse_gff3(gt_str_get(request),
+                                     gt_str_length(request),
+                                     PE_SERVER_QUERY_LABEL, error);
+  GtArray *genes = NULL;
+  if(pred != NULL)
+    genes = pe_server_refr_genes(server, pred, error);
+  if(genes != NULL)
+    records = agn_api_compare(genes, pred, NULL, error);
+
+  if(genes != NULL)
+    agn_api_node_array_delete(genes);
+  if(pred != NULL)
+    agn_api_node_array_delete(pred);
+  return records;
+}
+
+static GtFeatureNode *pe_server_feature_copy(GtFeatureNode *fn, GtStr *seqid,
+                                             GtHashmap *copies)
+{
+  GtFeatureNode *copy = gt_hashmap_get(copies, fn);
+  if(copy != NULL)
+    return (GtFeatureNode *)gt_genome_node_ref((GtGenomeNode *)copy);
+
+  GtRange range = gt_genome_node_get_range((GtGenomeNode *)fn);
+  GtGenomeNode *gn = gt_feature_node_new(seqid, gt_feature_node_get_type(fn),
+                                         range.start, range.end,
+                                         gt_feature_node_get_strand(fn));
+  copy = gt_feature_node_cast(gn);
+  GtStr *source = gt_str_new_cstr(gt_feature_node_get_source(fn));
+  gt_feature_node_set_source(copy, source);
+  gt_str_delete(source);
+  if(gt_feature_node_score_is_defined(fn))
+    gt_feature_node_set_score(copy, gt_feature_node_get_score(fn));
+  gt_feature_node_set_phase(copy, gt_feature_node_get_phase(fn));
+
+  GtStrArray *attrs = gt_feature_node_get_attribute_list(fn);
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(attrs); i++)
+  {
+    const char *key = gt_str_array_get(attrs, i);
+    gt_feature_node_add_attribute(copy, key,
+                                  gt_feature_node_get_attribute(fn, key));
+  }
+  gt_str_array_delete(attrs);
+  gt_hashmap_add(copies, fn, copy);
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    gt_feature_node_add_child(copy, pe_server_feature_copy(child, seqid,
+                                                           copies));
+  }
+  gt_feature_node_iterator_delete(iter);
+  return copy;
+}
+
+static GtGenomeNode *pe_server_gene_copy(GtFeatureNode *gene, GtStr *seqid)
+{
+  GtHashmap *copies = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  GtFeatureNode *copy = pe_server_feature_copy(gene, seqid, copies);
+
+  // Representatives must be marked as such before they are assigned. The
+  // iterator visits a subfeature with several parents more than once.
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(gene);
+  GtFeatureNode *fn;
+  for(fn  = gt_feature_node_iterator_next(iter);
+      fn != NULL;
+      fn  = gt_feature_node_iterator_next(iter))
+  {
+    GtFeatureNode *fncopy = gt_hashmap_get(copies, fn);
+    if(gt_feature_node_is_multi(fn) && !gt_feature_node_is_multi(fncopy) &&
+       gt_feature_node_get_multi_representative(fn) == fn)
+      gt_feature_node_make_multi_representative(fncopy);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  iter = gt_feature_node_iterator_new(gene);
+  for(fn  = gt_feature_node_iterator_next(iter);
+      fn != NULL;
+      fn  = gt_feature_node_iterator_next(iter))
+  {
+    GtFeatureNode *fncopy = gt_hashmap_get(copies, fn);
+    if(!gt_feature_node_is_multi(fn) || gt_feature_node_is_multi(fncopy))
+      continue;
+    GtFeatureNode *rep = gt_feature_node_get_multi_representative(fn);
+    GtFeatureNode *repcopy = gt_hashmap_get(copies, rep);
+    if(repcopy != NULL)
+      gt_feature_node_set_multi_representative(fncopy, repcopy);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  gt_hashmap_delete(copies);
+  return (GtGenomeNode *)copy;
+}
+
+static GtFeatureIndex *pe_server_load(const char *refrfile, GtLogger *logger,
+                                      GtError *error)
+{
+  GtFeatureIndex *refr = gt_feature_index_memory_new();
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *current_stream, *last_stream;
+
+  current_stream = gt_gff3_in_stream_new_unsorted(1, &refrfile);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_sort_stream_new(last_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_gene_stream_new(last_stream, logger);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_feature_out_stream_new(last_stream, refr);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  int result = gt_node_stream_pull(last_stream, error);
+  while(gt_queue_size(streams) > 0)
+  {
+    current_stream = gt_queue_get(streams);
+    gt_node_stream_delete(current_stream);
+  }
+  gt_queue_delete(streams);
+
+  if(result == -1)
+  {
+    gt_feature_index_delete(refr);
+    return NULL;
+  }
+  return refr;
+}
+
+static int pe_server_read(FILE *instream, GtStr *request, GtError *error)
+{
+  char header[32];
+  if(fgets(header, sizeof (header), instream) == NULL)
+    return 0;
+
+  char *end;
+  errno = 0;
+  unsigned long length = strtoul(header, &end, 10);
+  if(end == header || *end != '\n' || header[0] == '-' || errno != 0)
+  {
+    gt_error_set(error, "malformed request: expected the length of the GFF3 "
+                 "text, in bytes, on a line of its own");
+    return -1;
+  }
+
+  gt_str_reset(request);
+  char buffer[65536];
+  while(length > 0)
+  {
+    size_t chunk = length < sizeof (buffer) ? length : sizeof (buffer);
+    size_t bytes = fread(buffer, 1, chunk, instream);
+    if(bytes == 0)
+    {
+      gt_error_set(error, "incomplete request: %lu bytes missing", length);
+      return -1;
+    }
+    gt_str_append_cstr_nt(request, buffer, bytes);
+    length -= bytes;
+  }
+  return 1;
+}
+
+static GtArray *pe_server_refr_genes(PeServer *server, GtArray *pred,
+                                     GtError *error)
+{
+  GtArray *genes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtArray *overlapping = gt_array_new( sizeof(GtFeatureNode *) );
+  GtHashmap *seen = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  GtHashmap *seqids = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                     (GtFree)gt_str_delete);
+  int had_err = 0;
+
+  pthread_mutex_lock(&server->lock);
+  GtUword i, j;
+  for(i = 0; !had_err && i < gt_array_size(pred); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(pred, i);
+    if(gt_feature_node_try_cast(gn) == NULL)
+      continue;
+
+    const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+    bool hasseqid;
+    had_err = gt_feature_index_has_seqid(server->refr, &hasseqid, seqid,
+                                         error);
+    if(had_err || !hasseqid)
+      continue;
+
+    // Grow the query range until it covers every gene it overlaps, so that the
+    // loci are the same as they would be in a full ParsEval run.
+    GtRange range = gt_genome_node_get_range(gn);
+    while(!had_err)
+    {
+      gt_array_reset(overlapping);
+      had_err = gt_feature_index_get_features_for_range(server->refr,
+                                                        overlapping, seqid,
+                                                        &range, error);
+      GtRange joined = range;
+      for(j = 0; j < gt_array_size(overlapping); j++)
+      {
+        GtGenomeNode *gene = *(GtGenomeNode **)gt_array_get(overlapping, j);
+        GtRange generange = gt_genome_node_get_range(gene);
+        joined = gt_range_join(&joined, &generange);
+      }
+      if(gt_range_compare(&joined, &range) == 0)
+        break;
+      range = joined;
+    }
+
+    // Copies are made with a sequence ID of their own, one per sequence.
+    GtStr *seqidstr = gt_hashmap_get(seqids, seqid);
+    if(!had_err && seqidstr == NULL)
+    {
+      GtRange seqrange;
+      had_err = gt_feature_index_get_range_for_seqid(server->refr, &seqrange,
+                                                     seqid, error);
+      if(!had_err)
+      {
+        seqidstr = gt_str_new_cstr(seqid);
+        GtGenomeNode *region = gt_region_node_new(seqidstr, seqrange.start,
+                                                  seqrange.end);
+        gt_array_add(genes, region);
+        gt_hashmap_add(seqids, gt_cstr_dup(seqid), seqidstr);
+      }
+    }
+
+    for(j = 0; !had_err && j < gt_array_size(overlapping); j++)
+    {
+      GtFeatureNode *gene = *(GtFeatureNode **)gt_array_get(overlapping, j);
+      if(gt_hashmap_get(seen, gene) != NULL)
+        continue;
+      gt_hashmap_add(seen, gene, gene);
+      GtGenomeNode *copy = pe_server_gene_copy(gene, seqidstr);
+      gt_array_add(genes, copy);
+    }
+  }
+  pthread_mutex_unlock(&server->lock);
+
+  gt_array_delete(overlapping);
+  gt_hashmap_delete(seen);
+  gt_hashmap_delete(seqids);
+  if(had_err)
+  {
+    agn_api_node_array_delete(genes);
+    return NULL;
+  }
+  return genes;
+}
+
+static void pe_server_release(PeServer *server, int client)
+{
+  pthread_mutex_lock(&server->lock);
+  GtUword i;
+  for(i = 0; i < gt_array_size(server->clients); i++)
+  {
+    if(*(int *)gt_array_get(server->clients, i) == client)
+    {
+      gt_array_rem(server->clients, i);
+      break;
+    }
+  }
+  if(gt_array_size(server->clients) == 0)
+    pthread_cond_broadcast(&server->idle);
+  pthread_mutex_unlock(&server->lock);
+}
+
+static void pe_server_serve(PeServer *server, int client)
+{
+  FILE *instream = fdopen(client, "r");
+  int outfd = instream == NULL ? -1 : dup(client);
+  FILE *outstream = outfd == -1 ? NULL : fdopen(outfd, "w");
+  if(outstream == NULL)
+  {
+    if(outfd != -1)
+      close(outfd);
+    pe_server_release(server, client);
+    if(instream != NULL)
+      fclose(instream);
+    else
+      close(client);
+    return;
+  }
+
+  GtStr *request = gt_str_new();
+  GtError *error = gt_error_new();
+  int status;
+  while((status = pe_server_read(instream, request, error)) != 0)
+  {
+    GtArray *records = NULL;
+    if(status == 1)
+      records = pe_server_compare(server, request, error);
+    if(records != NULL)
+    {
+      pe_server_write(outstream, records);
+      agn_api_locus_records_delete(records);
+    }
+    else
+    {
+      fprintf(outstream, "#error\t%s\n", gt_error_get(error));
+      agn_logger_log(server->logger, "[ParsEval] warning: request failed: %s",
+                     gt_error_get(error));
+      gt_error_unset(error);
+    }
+    fputs("###\n", outstream);
+    if(fflush(outstream) == EOF || status == -1)
+      break;
+  }
+
+  gt_error_delete(error);
+  gt_str_delete(request);
+  pe_server_release(server, client);
+  fclose(outstream);
+  fclose(instream);
+}
+
+static void pe_server_signal(int signum)
+{
+  pe_server_shutdown = 1;
+}
+
+static void pe_server_spawn(PeServer *server, int client)
+{
+  PeServerConnection *connection = gt_malloc( sizeof(PeServerConnection) );
+  connection->server = server;
+  connection->client = client;
+  pthread_mutex_lock(&server->lock);
+  gt_array_add(server->clients, client);
+  pthread_mutex_unlock(&server->lock);
+
+  // Threads inherit the signal mask, so the signals are left to this thread,
+  // where they interrupt accept().
+  sigset_t block, orig;
+  sigemptyset(&block);
+  sigaddset(&block, SIGINT);
+  sigaddset(&block, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &block, &orig);
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_t thread;
+  int result = pthread_create(&thread, &attr, pe_server_thread, connection);
+  pthread_attr_destroy(&attr);
+  pthread_sigmask(SIG_SETMASK, &orig, NULL);
+
+  if(result != 0)
+  {
+    agn_logger_log(server->logger, "[ParsEval] warning: cannot start thread: "
+                   "%s", strerror(result));
+    pe_server_thread(connection);
+  }
+}
+
+static void *pe_server_thread(void *data)
+{
+  PeServerConnection *connection = data;
+  pe_server_serve(connection->server, connection->client);
+  gt_free(connection);
+  return NULL;
+}
+
+static void pe_server_write(FILE *outstream, GtArray *records)
+{
+  fputs("#seqid\tstart\tend\trefr_mrnas\tpred_mrnas\tcds_nuc_sn\tcds_nuc_sp\t"
+        "cds_nuc_f1\tcds_struc_sn\tcds_struc_sp\texon_struc_sn\t"
+        "exon_struc_sp\tutr_struc_sn\tutr_struc_sp\tidentity\n", outstream);
+  GtUword i;
+  for(i = 0; i < gt_array_size(records); i++)
+  {
+    AgnApiLocusRecord *record = gt_array_get(records, i);
+    AgnComparison *stats = &record->stats;
+    fprintf(outstream, "%s\t%lu\t%lu\t%lu\t%lu\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t"
+            "%s\t%s\t", record->seqid, record->range.start, record->range.end,
+            record->refr_mrnas, record->pred_mrnas,
+            stats->cds_nuc_stats.sns, stats->cds_nuc_stats.sps,
+            stats->cds_nuc_stats.f1s,
+            stats->cds_struc_stats.sns, stats->cds_struc_stats.sps,
+            stats->exon_struc_stats.sns, stats->exon_struc_stats.sps,
+            stats->utr_struc_stats.sns, stats->utr_struc_stats.sps);
+    if(stats->overall_length == 0)
+      fputs("--\n", outstream);
+    else
+    {
+      fprintf(outstream, "%.3lf\n",
+              (double)stats->overall_matches / (double)stats->overall_length);
+    }
+  }
+}
@@ -0,0 +1,29 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef PARSEVAL_SERVER
+#define PARSEVAL_SERVER
+
+#include "pe_options.h"
+
+/**
+ * @function Load, validate, and index the reference annotation, then serve
+ * comparisons on the Unix-domain socket given in the options until interrupted.
+ * A client may send any number of requests over one connection. Each request
+ * is a line giving the length in bytes of the prediction GFF3 that follows,
+ * then the GFF3 itself; the server compares the predictions against copies of
+ * the overlapping reference genes and replies with one tab-separated line per
+ * locus (or an ``#error`` line), followed by a ``###`` line. Connections are
+ * served concurrently if GenomeTools is compiled with ``threads=yes``, and one
+ * at a time otherwise. Returns 0 on a clean shutdown, or -1 (setting
+ * ``error``) if the server could not be started.
+ */
+int pe_server_run(ParsEvalOptions *options, GtLogger *logger, GtError *error);
+
+#endif
@@ -130,9 +130,10 @@ int main(int argc, char * const *argv)
     last_stream = stream;
   }
 
-  stream = gt_gff3_out_stream_new(last_stream, options.outstream);
+  GtNodeVisitor *gff3 = gt_gff3_visitor_new(options.outstream);
   if(!options.infer)
-    gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
+    gt_gff3_visitor_retain_id_attributes((GtGFF3Visitor *)gff3);
+  stream = agn_thread_visitor_stream_new(last_stream, gff3);
   gt_queue_add(streams, stream);
   last_stream = stream;
 
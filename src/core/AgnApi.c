@@ -0,0 +1,617 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core/cstr_table_api.h"
+#include "core/hashmap_api.h"
+#include "core/logger_api.h"
+#include "core/queue_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/array_out_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/gff3_parser_api.h"
+#include "extended/region_node_api.h"
+#include "extended/sort_stream_api.h"
+#include "extended/visitor_stream_api.h"
+#include "AgnApi.h"
+#include "AgnFilterStream.h"
+#include "AgnGeneStream.h"
+#include "AgnInferCDSVisitor.h"
+#include "AgnInferExonsVisitor.h"
+#include "AgnLocus.h"
+#include "AgnLocusRefineStream.h"
+#include "AgnLocusStream.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Delete every node in the array and leave the array empty.
+ */
+static void api_array_clear(GtArray *nodes);
+
+/**
+ * @function Move the nodes of ``source`` into ``dest``. Region nodes are
+ * merged with any region node already present for the same sequence, as is
+ * done when several GFF3 files are read by a single stream. Uses ``regions``
+ * to track the region node kept for each sequence.
+ */
+static void api_array_merge(GtArray *dest, GtArray *source,
+                            GtHashmap *regions);
+
+/**
+ * @function Tag every feature in the array, including subfeatures, with the
+ * given source (see ``agn_locus_stream_label_pairwise_marked``).
+ */
+static void api_array_tag(GtArray *nodes, AgnComparisonSource source);
+
+/**
+ * @function Pull all nodes through ``last_stream``, then delete every stream in
+ * the queue along with the queue itself. ``nodes`` is the array feeding the
+ * pipeline and ``progress`` the position of its array stream; the array is
+ * emptied, and any nodes left unread because of an error are deleted.
+ */
+static int api_streams_run(GtQueue *streams, GtNodeStream *last_stream,
+                           GtArray *nodes, GtUword *progress, GtError *error);
+
+/**
+ * @function Test data for the unit tests: a region with a single two-exon gene,
+ * optionally followed by alignments covering both exons.
+ */
+static GtArray *api_test_data(const char *label, bool alignments);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtArray *agn_api_compare(GtArray *refr, GtArray *pred,
+                         AgnComparisonData *summary, GtError *error)
+{
+  agn_assert(refr && pred && error);
+
+  api_array_tag(refr, REFERENCESOURCE);
+  api_array_tag(pred, PREDICTIONSOURCE);
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtHashmap *regions = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  api_array_merge(nodes, refr, regions);
+  api_array_merge(nodes, pred, regions);
+  gt_hashmap_delete(regions);
+  gt_array_sort_stable(nodes, (GtCompare)agn_genome_node_compare);
+
+  GtLogger *logger = gt_logger_new(false, "", stderr);
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *current_stream, *last_stream;
+  GtUword progress;
+
+  current_stream = gt_array_in_stream_new(nodes, &progress, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_gene_stream_new(last_stream, logger);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_locus_stream_new(last_stream, 0);
+  agn_locus_stream_label_pairwise_marked((AgnLocusStream *)current_stream);
+  agn_locus_stream_skip_iiLoci((AgnLocusStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  GtArray *loci = gt_array_new( sizeof(AgnLocus *) );
+  current_stream = gt_array_out_stream_new(last_stream, loci, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  int had_err = api_streams_run(streams, last_stream, nodes, &progress, error);
+  gt_array_delete(nodes);
+
+  GtArray *records = NULL;
+  if(!had_err)
+  {
+    records = gt_array_new( sizeof(AgnApiLocusRecord) );
+    if(summary != NULL)
+      agn_comparison_data_init(summary);
+  }
+  GtUword i;
+  for(i = 0; i < gt_array_size(loci); i++)
+  {
+    AgnLocus *locus = *(AgnLocus **)gt_array_get(loci, i);
+    if(!had_err)
+    {
+      AgnApiLocusRecord record;
+      GtStr *seqid = gt_genome_node_get_seqid(locus);
+      agn_locus_comparative_analysis(locus, logger);
+      record.seqid = gt_cstr_dup(gt_str_get(seqid));
+      record.range = gt_genome_node_get_range(locus);
+      record.refr_mrnas = agn_locus_mrna_num(locus, REFERENCESOURCE);
+      record.pred_mrnas = agn_locus_mrna_num(locus, PREDICTIONSOURCE);
+      agn_comparison_init(&record.stats);
+      agn_locus_comparison_aggregate(locus, &record.stats);
+      agn_comparison_resolve(&record.stats);
+      gt_array_add(records, record);
+      if(summary != NULL)
+        agn_locus_data_aggregate(locus, summary);
+    }
+    agn_locus_delete(locus);
+  }
+  gt_array_delete(loci);
+  gt_logger_delete(logger);
+  return records;
+}
+
+GtArray *agn_api_gaeval(GtArray *genes, GtArray *alignments,
+                        AgnGaevalParams params, GtError *error)
+{
+  agn_assert(genes && alignments && error);
+
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *current_stream, *last_stream, *align_stream;
+  GtUword gprogress, aprogress;
+
+  // The visitor loads every alignment into memory when it is created.
+  align_stream = gt_array_in_stream_new(alignments, &aprogress, error);
+  GtNodeVisitor *nv = agn_gaeval_visitor_new(align_stream, params);
+  gt_node_stream_delete(align_stream);
+  gt_array_reset(alignments);
+  if(nv == NULL)
+  {
+    gt_error_set(error, "unable to load alignments");
+    gt_queue_delete(streams);
+    api_array_clear(genes);
+    return NULL;
+  }
+
+  GtStr *source = gt_str_new_cstr("AEGeAn::GAEVAL");
+  GtLogger *logger = gt_logger_new(false, "", stderr);
+  current_stream = gt_array_in_stream_new(genes, &gprogress, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_infer_cds_stream_new(last_stream, source, logger);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_infer_exons_stream_new(last_stream, source, logger);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+  gt_str_delete(source);
+
+  current_stream = gt_visitor_stream_new(last_stream, nv);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  GtArray *scored = gt_array_new( sizeof(GtFeatureNode *) );
+  current_stream = gt_array_out_stream_new(last_stream, scored, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  int had_err = api_streams_run(streams, last_stream, genes, &gprogress,
+                                error);
+  gt_logger_delete(logger);
+
+  GtArray *records = NULL;
+  if(!had_err)
+    records = gt_array_new( sizeof(AgnApiGaevalRecord) );
+  GtUword i;
+  for(i = 0; i < gt_array_size(scored); i++)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(scored, i);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feature;
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL && !had_err;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      const char *covstr = gt_feature_node_get_attribute(feature,
+                                                         "gaeval_coverage");
+      const char *intstr = gt_feature_node_get_attribute(feature,
+                                                         "gaeval_integrity");
+      if(!agn_typecheck_mrna(feature) || covstr == NULL || intstr == NULL)
+        continue;
+
+      AgnApiGaevalRecord record;
+      record.mrna = gt_cstr_dup(agn_feature_node_get_label(feature));
+      record.coverage = strtod(covstr, NULL);
+      record.integrity = strtod(intstr, NULL);
+      gt_array_add(records, record);
+    }
+    gt_feature_node_iterator_delete(iter);
+    gt_genome_node_delete((GtGenomeNode *)fn);
+  }
+  gt_array_delete(scored);
+  return records;
+}
+
+void agn_api_gaeval_records_delete(GtArray *records)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(records); i++)
+  {
+    AgnApiGaevalRecord *record = gt_array_get(records, i);
+    gt_free(record->mrna);
+  }
+  gt_array_delete(records);
+}
+
+GtArray *agn_api_iloci(GtArray *nodes, GtUword delta, bool refine,
+                       GtError *error)
+{
+  agn_assert(nodes && error);
+
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *current_stream, *last_stream;
+  GtUword progress;
+
+  current_stream = gt_array_in_stream_new(nodes, &progress, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  GtHashmap *filter = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  gt_hashmap_add(filter, "gene", "gene");
+  current_stream = agn_filter_stream_new(last_stream, filter);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_sort_stream_new(last_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_locus_stream_new(last_stream, delta);
+  agn_locus_stream_set_source((AgnLocusStream *)current_stream,
+                              "AEGeAn::LocusPocus");
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  if(refine)
+  {
+    current_stream = agn_locus_refine_stream_new(last_stream, delta, 1, false);
+    agn_locus_refine_stream_set_source((AgnLocusRefineStream *)current_stream,
+                                       "AEGeAn::LocusPocus");
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  GtArray *loci = gt_array_new( sizeof(AgnLocus *) );
+  current_stream = gt_array_out_stream_new(last_stream, loci, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  int had_err = api_streams_run(streams, last_stream, nodes, &progress, error);
+  gt_hashmap_delete(filter);
+
+  GtArray *records = NULL;
+  if(!had_err)
+    records = gt_array_new( sizeof(AgnApiIlocusRecord) );
+  GtUword i;
+  for(i = 0; i < gt_array_size(loci); i++)
+  {
+    AgnLocus *locus = *(AgnLocus **)gt_array_get(loci, i);
+    if(!had_err)
+    {
+      GtFeatureNode *fn = gt_feature_node_cast(locus);
+      const char *name = gt_feature_node_get_attribute(fn, "Name");
+      const char *type = gt_feature_node_get_attribute(fn, "iLocus_type");
+      AgnApiIlocusRecord record;
+      record.seqid = gt_cstr_dup(gt_str_get(gt_genome_node_get_seqid(locus)));
+      record.range = gt_genome_node_get_range(locus);
+      record.name = name == NULL ? NULL : gt_cstr_dup(name);
+      record.type = type == NULL ? NULL : gt_cstr_dup(type);
+      record.num_genes = agn_locus_gene_num(locus, DEFAULTSOURCE);
+      record.num_mrnas = agn_locus_mrna_num(locus, DEFAULTSOURCE);
+      gt_array_add(records, record);
+    }
+    agn_locus_delete(locus);
+  }
+  gt_array_delete(loci);
+  return records;
+}
+
+void agn_api_ilocus_records_delete(GtArray *records)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(records); i++)
+  {
+    AgnApiIlocusRecord *record = gt_array_get(records, i);
+    gt_free(record->seqid);
+    gt_free(record->name);
+    gt_free(record->type);
+  }
+  gt_array_delete(records);
+}
+
+void agn_api_locus_records_delete(GtArray *records)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(records); i++)
+  {
+    AgnApiLocusRecord *record = gt_array_get(records, i);
+    gt_free(record->seqid);
+  }
+  gt_array_delete(records);
+}
+
+void agn_api_node_array_delete(GtArray *nodes)
+{
+  api_array_clear(nodes);
+  gt_array_delete(nodes);
+}
+
+GtArray *agn_api_parse_gff3(const char *buffer, size_t length,
+                            const char *label, GtError *error)
+{
+  agn_assert((buffer || length == 0) && label && error);
+
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  if(length == 0)
+    return nodes;
+
+  FILE *instream = fmemopen((void *)buffer, length, "r");
+  if(instream == NULL)
+  {
+    gt_error_set(error, "unable to read GFF3 buffer '%s': %s", label,
+                 strerror(errno));
+    gt_array_delete(nodes);
+    return NULL;
+  }
+
+  GtFile *infile = gt_file_new_from_fileptr(instream);
+  GtStr *filename = gt_str_new_cstr(label);
+  GtCstrTable *used_types = gt_cstr_table_new();
+  GtQueue *queue = gt_queue_new();
+  GtGFF3Parser *parser = gt_gff3_parser_new(NULL);
+  gt_gff3_parser_check_id_attributes(parser);
+  gt_gff3_parser_enable_tidy_mode(parser);
+
+  GtUword line_number = 0;
+  int status = 0, had_err = 0;
+  while(!had_err && status != EOF)
+  {
+    had_err = gt_gff3_parser_parse_genome_nodes(parser, &status, queue,
+                                                used_types, filename,
+                                                &line_number, infile, error);
+    while(gt_queue_size(queue) > 0)
+    {
+      GtGenomeNode *gn = gt_queue_get(queue);
+      if(gt_feature_node_try_cast(gn) || gt_region_node_try_cast(gn))
+        gt_array_add(nodes, gn);
+      else
+        gt_genome_node_delete(gn);
+    }
+  }
+
+  gt_gff3_parser_delete(parser);
+  gt_queue_delete(queue);
+  gt_cstr_table_delete(used_types);
+  gt_str_delete(filename);
+  gt_file_delete_without_handle(infile);
+  fclose(instream);
+
+  if(had_err)
+  {
+    agn_api_node_array_delete(nodes);
+    return NULL;
+  }
+  gt_array_sort_stable(nodes, (GtCompare)agn_genome_node_compare);
+  return nodes;
+}
+
+bool agn_api_unit_test(AgnUnitTest *test)
+{
+  GtError *error = gt_error_new();
+  GtArray *refr = api_test_data("refr", false);
+  GtArray *pred = api_test_data("pred", false);
+  AgnComparisonData summary;
+  GtArray *loci = agn_api_compare(refr, pred, &summary, error);
+  bool test1 = loci != NULL && gt_array_size(loci) == 1;
+  if(test1)
+  {
+    AgnApiLocusRecord *record = gt_array_get(loci, 0);
+    test1 = strcmp(record->seqid, "chr1") == 0 &&
+            record->range.start == 201 && record->range.end == 800 &&
+            record->refr_mrnas == 1 && record->pred_mrnas == 1 &&
+            record->stats.overall_matches == record->stats.overall_length &&
+            record->stats.cds_struc_stats.correct == 2 &&
+            record->stats.cds_struc_stats.missing == 0 &&
+            record->stats.cds_struc_stats.wrong == 0 &&
+            summary.info.num_loci == 1 &&
+            summary.summary.perfect_matches.comparison_count == 1;
+  }
+  agn_unit_test_result(test, "compare identical", test1);
+  if(loci != NULL)
+    agn_api_locus_records_delete(loci);
+  bool test2 = gt_array_size(refr) == 0 && gt_array_size(pred) == 0;
+  agn_unit_test_result(test, "compare consumes nodes", test2);
+  gt_array_delete(refr);
+  gt_array_delete(pred);
+
+  refr = api_test_data("generated", false);
+  pred = api_test_data("generated", false);
+  loci = agn_api_compare(refr, pred, NULL, error);
+  bool test3 = loci != NULL && gt_array_size(loci) == 1;
+  if(test3)
+  {
+    AgnApiLocusRecord *record = gt_array_get(loci, 0);
+    test3 = record->refr_mrnas == 1 && record->pred_mrnas == 1 &&
+            record->stats.cds_struc_stats.correct == 2;
+    agn_api_locus_records_delete(loci);
+  }
+  agn_unit_test_result(test, "compare same label", test3);
+  gt_array_delete(refr);
+  gt_array_delete(pred);
+
+  GtArray *nodes = api_test_data("iloci", false);
+  GtArray *iloci = agn_api_iloci(nodes, 50, false, error);
+  bool test4 = iloci != NULL;
+  if(test4)
+  {
+    GtUword i, numgeneloci = 0;
+    for(i = 0; i < gt_array_size(iloci); i++)
+    {
+      AgnApiIlocusRecord *record = gt_array_get(iloci, i);
+      if(record->num_genes == 0)
+        continue;
+      numgeneloci++;
+      test4 = test4 && record->range.start == 151 && record->range.end == 850 &&
+              record->num_genes == 1 && record->num_mrnas == 1 &&
+              record->type == NULL;
+    }
+    test4 = test4 && numgeneloci == 1;
+    agn_api_ilocus_records_delete(iloci);
+  }
+  agn_unit_test_result(test, "iLoci", test4);
+  gt_array_delete(nodes);
+
+  nodes = api_test_data("genes", false);
+  GtArray *alignments = api_test_data("alignments", true);
+  AgnGaevalParams params = { 0.6, 0.3, 0.05, 0.05, 400, 200, 100 };
+  GtArray *scores = agn_api_gaeval(nodes, alignments, params, error);
+  bool test5 = scores != NULL && gt_array_size(scores) == 1;
+  if(test5)
+  {
+    AgnApiGaevalRecord *record = gt_array_get(scores, 0);
+    test5 = strcmp(record->mrna, "mrna1") == 0 && record->coverage > 0.999;
+  }
+  agn_unit_test_result(test, "GAEVAL", test5);
+  if(scores != NULL)
+    agn_api_gaeval_records_delete(scores);
+  gt_array_delete(nodes);
+  gt_array_delete(alignments);
+
+  bool test6 = agn_api_version() == AGN_API_VERSION;
+  agn_unit_test_result(test, "version", test6);
+
+  gt_error_delete(error);
+  return agn_unit_test_success(test);
+}
+
+int agn_api_version()
+{
+  return AGN_API_VERSION;
+}
+
+static void api_array_clear(GtArray *nodes)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(nodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(nodes, i);
+    gt_genome_node_delete(gn);
+  }
+  gt_array_reset(nodes);
+}
+
+static void api_array_merge(GtArray *dest, GtArray *source,
+                            GtHashmap *regions)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(source); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(source, i);
+    if(gt_region_node_try_cast(gn) == NULL)
+    {
+      gt_array_add(dest, gn);
+      continue;
+    }
+
+    const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+    GtGenomeNode *region = gt_hashmap_get(regions, seqid);
+    if(region == NULL)
+    {
+      gt_hashmap_add(regions, gt_cstr_dup(seqid), gn);
+      gt_array_add(dest, gn);
+    }
+    else
+    {
+      GtRange r1 = gt_genome_node_get_range(region);
+      GtRange r2 = gt_genome_node_get_range(gn);
+      GtRange joined = gt_range_join(&r1, &r2);
+      gt_genome_node_set_range(region, &joined);
+      gt_genome_node_delete(gn);
+    }
+  }
+  gt_array_reset(source);
+}
+
+static void api_array_tag(GtArray *nodes, AgnComparisonSource source)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(nodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(nodes, i);
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn == NULL)
+      continue;
+
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feature;
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      if(source == PREDICTIONSOURCE)
+        gt_feature_node_mark(feature);
+      else
+        gt_feature_node_unmark(feature);
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+}
+
+static int api_streams_run(GtQueue *streams, GtNodeStream *last_stream,
+                           GtArray *nodes, GtUword *progress, GtError *error)
+{
+  int result = gt_node_stream_pull(last_stream, error);
+  while(gt_queue_size(streams) > 0)
+  {
+    GtNodeStream *stream = gt_queue_get(streams);
+    gt_node_stream_delete(stream);
+  }
+  gt_queue_delete(streams);
+
+  // Nodes not yet read when an error occurred still belong to the array.
+  GtUword i;
+  for(i = *progress; result == -1 && i < gt_array_size(nodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(nodes, i);
+    gt_genome_node_delete(gn);
+  }
+  gt_array_reset(nodes);
+  return result == -1 ? -1 : 0;
+}
+
+static GtArray *api_test_data(const char *label, bool alignments)
+{
+  const char *genes =
+    "##gff-version   3\n"
+    "##sequence-region   chr1 1 1000\n"
+    "chr1\tAEGeAn\tgene\t201\t800\t.\t+\t.\tID=gene1\n"
+    "chr1\tAEGeAn\tmRNA\t201\t800\t.\t+\t.\tID=mrna1;Parent=gene1\n"
+    "chr1\tAEGeAn\texon\t201\t400\t.\t+\t.\tParent=mrna1\n"
+    "chr1\tAEGeAn\texon\t601\t800\t.\t+\t.\tParent=mrna1\n"
+    "chr1\tAEGeAn\tCDS\t251\t400\t.\t+\t0\tParent=mrna1\n"
+    "chr1\tAEGeAn\tCDS\t601\t750\t.\t+\t0\tParent=mrna1\n";
+  const char *aligns =
+    "##gff-version   3\n"
+    "##sequence-region   chr1 1 1000\n"
+    "chr1\tAEGeAn\tcDNA_match\t201\t400\t.\t+\t.\tID=aln1\n"
+    "chr1\tAEGeAn\tcDNA_match\t601\t800\t.\t+\t.\tID=aln1\n";
+  const char *data = alignments ? aligns : genes;
+
+  GtError *error = gt_error_new();
+  GtArray *nodes = agn_api_parse_gff3(data, strlen(data), label, error);
+  agn_assert(nodes != NULL);
+  gt_error_delete(error);
+  return nodes;
+}
@@ -0,0 +1,138 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <stdint.h>
+#include <string.h>
+#include "core/ma_api.h"
+#include "AgnArena.h"
+#include "AgnUtils.h"
+
+#define ARENA_ALIGNMENT sizeof (long double)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+typedef struct ArenaBlock
+{
+  struct ArenaBlock *next;
+  size_t size;
+  size_t used;
+} ArenaBlock;
+
+struct AgnArena
+{
+  ArenaBlock *blocks;
+  size_t blocksize;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Round ``size`` up to a multiple of the arena alignment.
+ */
+static size_t arena_align(size_t size);
+
+/**
+ * @function Add a new block with room for at least ``size`` bytes to the
+ * arena.
+ */
+static ArenaBlock *arena_block_new(AgnArena *arena, size_t size);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void *agn_arena_alloc(AgnArena *arena, size_t size)
+{
+  agn_assert(arena);
+  size = arena_align(size == 0 ? 1 : size);
+  ArenaBlock *block = arena->blocks;
+  if(block == NULL || block->size - block->used < size)
+    block = arena_block_new(arena, size);
+
+  void *ptr = (char *)block + arena_align(sizeof (ArenaBlock)) + block->used;
+  block->used += size;
+  return ptr;
+}
+
+void agn_arena_delete(AgnArena *arena)
+{
+  if(arena == NULL)
+    return;
+
+  while(arena->blocks != NULL)
+  {
+    ArenaBlock *block = arena->blocks;
+    arena->blocks = block->next;
+    gt_free(block);
+  }
+  gt_free(arena);
+}
+
+AgnArena *agn_arena_new(size_t blocksize)
+{
+  AgnArena *arena = gt_malloc( sizeof(AgnArena) );
+  arena->blocks = NULL;
+  arena->blocksize = arena_align(blocksize);
+  return arena;
+}
+
+bool agn_arena_unit_test(AgnUnitTest *test)
+{
+  AgnArena *arena = agn_arena_new(64);
+  char *c1 = agn_arena_alloc(arena, 3);
+  GtUword *u1 = agn_arena_alloc(arena, sizeof (GtUword) * 2);
+  bool test1 = ((uintptr_t)u1 % ARENA_ALIGNMENT) == 0 &&
+               (char *)u1 >= c1 + 3;
+  agn_unit_test_result(test, "alignment", test1);
+
+  u1[0] = 42;
+  u1[1] = 1024;
+  char *big = agn_arena_alloc(arena, 1000);
+  memset(big, 'x', 1000);
+  GtUword *u2 = agn_arena_alloc(arena, sizeof (GtUword));
+  *u2 = 7;
+  bool test2 = u1[0] == 42 && u1[1] == 1024 && big[999] == 'x' && *u2 == 7;
+  agn_unit_test_result(test, "large allocations", test2);
+
+  agn_arena_delete(arena);
+  return agn_unit_test_success(test);
+}
+
+static size_t arena_align(size_t size)
+{
+  return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+static ArenaBlock *arena_block_new(AgnArena *arena, size_t size)
+{
+  size_t capacity = size > arena->blocksize ? size : arena->blocksize;
+  ArenaBlock *block = gt_malloc(arena_align(sizeof (ArenaBlock)) + capacity);
+  block->size = capacity;
+  block->used = 0;
+
+  // Oversized requests get a dedicated block, which is placed behind the
+  // current block so that the remaining space in the latter is not wasted.
+  if(capacity > arena->blocksize && arena->blocks != NULL)
+  {
+    block->next = arena->blocks->next;
+    arena->blocks->next = block;
+  }
+  else
+  {
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+  return block;
+}
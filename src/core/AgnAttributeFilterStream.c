@@ -8,6 +8,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <pthread.h>
 #include <string.h>
 #include "extended/array_in_stream_api.h"
 #include "extended/array_out_stream_api.h"
@@ -39,6 +40,11 @@ struct AgnAttributeFilterStream
  */
 static const GtNodeStreamClass* attribute_filter_stream_class(void);
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void attribute_filter_stream_class_init(void);
+
 /**
  * @function Class destructor.
  */
@@ -74,18 +80,22 @@ GtNodeStream* agn_attribute_filter_stream_new(GtNodeStream *in_stream,
   return ns;
 }
 
+static const GtNodeStreamClass *nsc = NULL;
+
 static const GtNodeStreamClass *attribute_filter_stream_class(void)
 {
-  static const GtNodeStreamClass *nsc = NULL;
-  if(!nsc)
-  {
-    nsc = gt_node_stream_class_new(sizeof (AgnAttributeFilterStream),
-                                   attribute_filter_stream_free,
-                                   attribute_filter_stream_next);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, attribute_filter_stream_class_init);
   return nsc;
 }
 
+static void attribute_filter_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnAttributeFilterStream),
+                                 attribute_filter_stream_free,
+                                 attribute_filter_stream_next);
+}
+
 bool agn_attribute_filter_stream_unit_test(AgnUnitTest *test)
 {
   GtQueue *queue = gt_queue_new();
@@ -11,6 +11,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include <string.h>
 #include "core/queue_api.h"
 #include "AgnCliquePair.h"
+#include "AgnSeqid.h"
 #include "AgnUtils.h"
 
 #define char_is_exonic(C) (C == 'F' || C == 'T' || C == 'C')
@@ -29,14 +30,16 @@ struct AgnCliquePair
   AgnTranscriptClique *pred_clique;
   AgnComparison stats;
   double tolerance;
+  bool in_arena;
 };
 
 typedef struct
 {
-  GtArray *refrstarts;
-  GtArray *refrends;
-  GtArray *predstarts;
-  GtArray *predends;
+  GtUword refrstart;
+  GtUword predstart;
+  GtUword refrcount;
+  GtUword predcount;
+  GtUword matches;
   AgnCompStatsBinary *stats;
 } StructuralData;
 
@@ -46,9 +49,9 @@ typedef struct
 //------------------------------------------------------------------------------
 
 /**
- * @function Given a set of of start and end coordinates for reference and
- * prediction structures (exons, CDS segments, or UTR segments), determine the
- * number of congruent and incongruent structures.
+ * @function Given the number of reference and prediction structures (exons,
+ * CDS segments, or UTR segments) and the number of structures they share,
+ * determine the number of congruent and incongruent structures.
  */
 static void clique_pair_calc_struct_stats(StructuralData *dat);
 
@@ -59,23 +62,35 @@ static void clique_pair_calc_struct_stats(StructuralData *dat);
 static void clique_pair_comparative_analysis(AgnCliquePair *pair);
 
 /**
- * @function Initialize the data structure used to store start and end
- * coordinates for reference and prediction structures (exons, CDS segments, or
- * UTR segments) and associated statistics.
+ * @function Initialize the data structure used to count reference and
+ * prediction structures (exons, CDS segments, or UTR segments) and associated
+ * statistics.
  */
 static void clique_pair_init_struct_dat(StructuralData *dat,
                                         AgnCompStatsBinary *stats);
 
 /**
- * @function Free the memory previously occupied by the data structure.
+ * @function Shared implementation of the class constructors.
  */
-static void clique_pair_term_struct_dat(StructuralData *dat);
+static void clique_pair_setup(AgnCliquePair *pair, AgnTranscriptClique *refr,
+                              AgnTranscriptClique *pred);
 
 /**
  * @function Generate data for unit testing.
  */
 static void clique_pair_test_data(GtQueue *queue);
 
+/**
+ * @function Record the reference and prediction structures that begin or end
+ * at position ``i`` of the model vectors. Structures of one annotation never
+ * overlap, so a reference structure and a prediction structure are identical
+ * exactly when they end at the same position after starting at the same
+ * position.
+ */
+static void clique_pair_update_struct_dat(StructuralData *dat, GtUword i,
+                                          bool refrstart, bool refrend,
+                                          bool predstart, bool predend);
+
 
 //------------------------------------------------------------------------------
 // Method implementations
@@ -210,7 +225,8 @@ void agn_clique_pair_delete(AgnCliquePair *pair)
 {
   agn_transcript_clique_delete(pair->refr_clique);
   agn_transcript_clique_delete(pair->pred_clique);
-  gt_free(pair);
+  if(!pair->in_arena)
+    gt_free(pair);
 }
 
 AgnTranscriptClique *agn_clique_pair_get_pred_clique(AgnCliquePair *pair)
@@ -231,23 +247,19 @@ AgnComparison *agn_clique_pair_get_stats(AgnCliquePair *pair)
 AgnCliquePair* agn_clique_pair_new(AgnTranscriptClique *refr,
                                    AgnTranscriptClique *pred)
 {
-  GtStr *seqidrefr = gt_genome_node_get_seqid(refr);
-  GtStr *seqidpred = gt_genome_node_get_seqid(pred);
-  agn_assert(gt_genome_node_get_start(refr) == gt_genome_node_get_start(pred) &&
-             gt_genome_node_get_end(refr) == gt_genome_node_get_end(pred) &&
-             gt_str_cmp(seqidrefr, seqidpred) == 0);
-
   AgnCliquePair *pair = (AgnCliquePair *)gt_malloc( sizeof(AgnCliquePair) );
-  pair->refr_clique = gt_genome_node_ref(refr);
-  pair->pred_clique = gt_genome_node_ref(pred);
-
-  agn_comparison_init(&pair->stats);
-  double perc = 1.0 / (double)gt_genome_node_get_length(refr);
-  pair->tolerance = 1.0;
-  while(pair->tolerance > perc)
-    pair->tolerance /= 10;
+  clique_pair_setup(pair, refr, pred);
+  pair->in_arena = false;
+  return pair;
+}
 
-  clique_pair_comparative_analysis(pair);
+AgnCliquePair* agn_clique_pair_new_in_arena(AgnArena *arena,
+                                            AgnTranscriptClique *refr,
+                                            AgnTranscriptClique *pred)
+{
+  AgnCliquePair *pair = agn_arena_alloc(arena, sizeof(AgnCliquePair));
+  clique_pair_setup(pair, refr, pred);
+  pair->in_arena = true;
   return pair;
 }
 
@@ -281,50 +293,11 @@ bool agn_clique_pair_unit_test(AgnUnitTest *test)
 
 static void clique_pair_calc_struct_stats(StructuralData *dat)
 {
-  GtUword num_refr = gt_array_size(dat->refrstarts);
-  GtUword num_pred = gt_array_size(dat->predstarts);
-  agn_assert(num_refr == gt_array_size(dat->refrends));
-  agn_assert(num_pred == gt_array_size(dat->predends));
-  GtUword i, j;
-  for(i = 0; i < num_refr; i++)
-  {
-    bool found_match = 0;
-    GtUword *refrstart = gt_array_get(dat->refrstarts, i);
-    GtUword *refrend   = gt_array_get(dat->refrends,   i);
-    for(j = 0; j < num_pred; j++)
-    {
-      GtUword *predstart = gt_array_get(dat->predstarts, j);
-      GtUword *predend   = gt_array_get(dat->predends,   j);
-      if(*refrstart == *predstart && *refrend == *predend)
-      {
-        dat->stats->correct++;
-        found_match = 1;
-        break;
-      }
-    }
-    if(!found_match)
-      dat->stats->missing++;
-  }
-  for(i = 0; i < num_pred; i++)
-  {
-    bool found_match = 0;
-    GtUword *predstart = gt_array_get(dat->predstarts, i);
-    GtUword *predend   = gt_array_get(dat->predends,   i);
-    for(j = 0; j < num_refr; j++)
-    {
-      GtUword *refrstart = gt_array_get(dat->refrstarts, j);
-      GtUword *refrend   = gt_array_get(dat->refrends,   j);
-      if(*refrstart == *predstart && *refrend == *predend)
-      {
-        found_match = 1;
-        break;
-      }
-    }
-    if(!found_match)
-      dat->stats->wrong++;
-  }
+  agn_assert(dat->matches <= dat->refrcount && dat->matches <= dat->predcount);
+  dat->stats->correct += dat->matches;
+  dat->stats->missing += dat->refrcount - dat->matches;
+  dat->stats->wrong   += dat->predcount - dat->matches;
   agn_comp_stats_binary_resolve(dat->stats);
-  clique_pair_term_struct_dat(dat);
 }
 
 static void clique_pair_comparative_analysis(AgnCliquePair *pair)
@@ -374,58 +347,31 @@ static void clique_pair_comparative_analysis(AgnCliquePair *pair)
       pair->stats.overall_matches++;
 
     // CDS structure counts
-    if(refr_vector[i] == 'C')
-    {
-      if(i == 0 || refr_vector[i-1] != 'C')
-        gt_array_add(cdsstruct.refrstarts, i);
-
-      if(i == locus_length - 1 || refr_vector[i+1] != 'C')
-        gt_array_add(cdsstruct.refrends, i);
-    }
-    if(pred_vector[i] == 'C')
-    {
-      if(i == 0 || pred_vector[i-1] != 'C')
-        gt_array_add(cdsstruct.predstarts, i);
-
-      if(i == locus_length - 1 || pred_vector[i+1] != 'C')
-        gt_array_add(cdsstruct.predends, i);
-    }
+    bool refr_cds = refr_vector[i] == 'C';
+    bool pred_cds = pred_vector[i] == 'C';
+    clique_pair_update_struct_dat(&cdsstruct, i,
+        refr_cds && (i == 0 || refr_vector[i-1] != 'C'),
+        refr_cds && (i == locus_length - 1 || refr_vector[i+1] != 'C'),
+        pred_cds && (i == 0 || pred_vector[i-1] != 'C'),
+        pred_cds && (i == locus_length - 1 || pred_vector[i+1] != 'C'));
 
     // Exon structure counts
-    if(char_is_exonic(refr_vector[i]))
-    {
-      if(i == 0 || !char_is_exonic(refr_vector[i-1]))
-        gt_array_add(exonstruct.refrstarts, i);
-
-      if(i == locus_length - 1 || !char_is_exonic(refr_vector[i+1]))
-        gt_array_add(exonstruct.refrends, i);
-    }
-    if(char_is_exonic(pred_vector[i]))
-    {
-      if(i == 0 || !char_is_exonic(pred_vector[i-1]))
-        gt_array_add(exonstruct.predstarts, i);
-
-      if(i == locus_length - 1 || !char_is_exonic(pred_vector[i+1]))
-        gt_array_add(exonstruct.predends, i);
-    }
+    bool refr_exon = char_is_exonic(refr_vector[i]);
+    bool pred_exon = char_is_exonic(pred_vector[i]);
+    clique_pair_update_struct_dat(&exonstruct, i,
+        refr_exon && (i == 0 || !char_is_exonic(refr_vector[i-1])),
+        refr_exon && (i == locus_length - 1 ||
+                      !char_is_exonic(refr_vector[i+1])),
+        pred_exon && (i == 0 || !char_is_exonic(pred_vector[i-1])),
+        pred_exon && (i == locus_length - 1 ||
+                      !char_is_exonic(pred_vector[i+1])));
 
     // UTR structure counts
-    if(char_is_utric(refr_vector[i]))
-    {
-      if(i == 0 || !char_is_utric(refr_vector[i-1]))
-        gt_array_add(utrstruct.refrstarts, i);
-
-      if(i == locus_length - 1 || !char_is_utric(refr_vector[i+1]))
-        gt_array_add(utrstruct.refrends, i);
-    }
-    if(char_is_utric(pred_vector[i]))
-    {
-      if(i == 0 || !char_is_utric(pred_vector[i-1]))
-        gt_array_add(utrstruct.predstarts, i);
-
-      if(i == locus_length - 1 || !char_is_utric(pred_vector[i+1]))
-        gt_array_add(utrstruct.predends, i);
-    }
+    clique_pair_update_struct_dat(&utrstruct, i,
+        refr_utr && (i == 0 || !char_is_utric(refr_vector[i-1])),
+        refr_utr && (i == locus_length - 1 || !char_is_utric(refr_vector[i+1])),
+        pred_utr && (i == 0 || !char_is_utric(pred_vector[i-1])),
+        pred_utr && (i == locus_length - 1 || !char_is_utric(pred_vector[i+1])));
   }
 
   // Calculate nucleotide-level statistics from counts
@@ -441,19 +387,31 @@ static void clique_pair_comparative_analysis(AgnCliquePair *pair)
 static void clique_pair_init_struct_dat(StructuralData *dat,
                                         AgnCompStatsBinary *stats)
 {
-  dat->refrstarts = gt_array_new( sizeof(GtUword) );
-  dat->refrends   = gt_array_new( sizeof(GtUword) );
-  dat->predstarts = gt_array_new( sizeof(GtUword) );
-  dat->predends   = gt_array_new( sizeof(GtUword) );
-  dat->stats      = stats;
+  dat->refrstart = 0;
+  dat->predstart = 0;
+  dat->refrcount = 0;
+  dat->predcount = 0;
+  dat->matches   = 0;
+  dat->stats     = stats;
 }
 
-static void clique_pair_term_struct_dat(StructuralData *dat)
+static void clique_pair_setup(AgnCliquePair *pair, AgnTranscriptClique *refr,
+                              AgnTranscriptClique *pred)
 {
-  gt_array_delete(dat->refrstarts);
-  gt_array_delete(dat->refrends);
-  gt_array_delete(dat->predstarts);
-  gt_array_delete(dat->predends);
+  agn_assert(gt_genome_node_get_start(refr) == gt_genome_node_get_start(pred) &&
+             gt_genome_node_get_end(refr) == gt_genome_node_get_end(pred) &&
+             agn_seqid_equal(refr, pred));
+
+  pair->refr_clique = gt_genome_node_ref(refr);
+  pair->pred_clique = gt_genome_node_ref(pred);
+
+  agn_comparison_init(&pair->stats);
+  double perc = 1.0 / (double)gt_genome_node_get_length(refr);
+  pair->tolerance = 1.0;
+  while(pair->tolerance > perc)
+    pair->tolerance /= 10;
+
+  clique_pair_comparative_analysis(pair);
 }
 
 static void clique_pair_test_data(GtQueue *queue)
@@ -548,3 +506,19 @@ static void clique_pair_test_data(GtQueue *queue)
   gt_array_delete(predfeats);
   gt_error_delete(error);
 }
+
+static void clique_pair_update_struct_dat(StructuralData *dat, GtUword i,
+                                          bool refrstart, bool refrend,
+                                          bool predstart, bool predend)
+{
+  if(refrstart)
+    dat->refrstart = i;
+  if(predstart)
+    dat->predstart = i;
+  if(refrend)
+    dat->refrcount++;
+  if(predend)
+    dat->predcount++;
+  if(refrend && predend && dat->refrstart == dat->predstart)
+    dat->matches++;
+}
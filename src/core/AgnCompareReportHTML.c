@@ -8,11 +8,13 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <pthread.h>
 #include <string.h>
 #include "core/hashmap_api.h"
 #include "AgnComparison.h"
 #include "AgnCompareReportHTML.h"
 #include "AgnLocus.h"
+#include "AgnUtils.h"
 #include "AgnVersion.h"
 
 #define compare_report_html_cast(GV)\
@@ -58,6 +60,11 @@ typedef struct
  */
 static const GtNodeVisitorClass *compare_report_html_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void compare_report_html_class_init(void);
+
 /**
  * @function Print overall comparison statistics for a particular class of
  * feature comparisons in the summary report.
@@ -286,20 +293,24 @@ void agn_compare_report_html_set_overview_func(AgnCompareReportHTML *rpt,
   rpt->ofuncdata = funcdata;
 }
 
-static const GtNodeVisitorClass *compare_report_html_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *compare_report_html_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportHTML),
-                                    compare_report_html_free, NULL,
-                                    compare_report_html_visit_feature_node,
-                                    compare_report_html_visit_region_node,
-                                    NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, compare_report_html_class_init);
   return nvc;
 }
 
+static void compare_report_html_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportHTML),
+                                  compare_report_html_free, NULL,
+                                  compare_report_html_visit_feature_node,
+                                  compare_report_html_visit_region_node,
+                                  NULL, NULL);
+}
+
 
 static void compare_report_html_compclass_header(FILE *outstream,
                                                  const char *compclass)
@@ -8,10 +8,12 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <pthread.h>
 #include <string.h>
 #include "AgnComparison.h"
 #include "AgnCompareReportText.h"
 #include "AgnLocus.h"
+#include "AgnUtils.h"
 
 #define compare_report_text_cast(GV)\
         gt_node_visitor_cast(compare_report_text_class(), GV)
@@ -47,6 +49,11 @@ static void compare_report_text_annot_summary(AgnCompInfo *info,
  */
 static const GtNodeVisitorClass *compare_report_text_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void compare_report_text_class_init(void);
+
 /**
  * @function Print overall comparison statistics for a particular class of
  * feature comparisons in the summary report.
@@ -248,20 +255,24 @@ static void compare_report_text_annot_summary(AgnCompInfo *info,
            (float)info->pred_transcripts / (float)info->pred_genes );
 }
 
-static const GtNodeVisitorClass *compare_report_text_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *compare_report_text_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportText),
-                                    compare_report_text_free, NULL,
-                                    compare_report_text_visit_feature_node,
-                                    compare_report_text_visit_region_node,
-                                    NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, compare_report_text_class_init);
   return nvc;
 }
 
+static void compare_report_text_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportText),
+                                  compare_report_text_free, NULL,
+                                  compare_report_text_visit_feature_node,
+                                  compare_report_text_visit_region_node,
+                                  NULL, NULL);
+}
+
 static void compare_report_text_comp_class_summary(AgnCompClassDesc *summ,
                                                    GtUword num_comparisons,
                                                    const char *label,
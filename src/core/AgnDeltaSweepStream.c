@@ -0,0 +1,424 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core/cstr_api.h"
+#include "extended/array_in_stream_api.h"
+#include "AgnDeltaSweepStream.h"
+#include "AgnUtils.h"
+
+#define delta_sweep_stream_cast(GS)\
+        gt_node_stream_cast(delta_sweep_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnDeltaSweepStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtArray *deltas;
+  FILE *outfile;
+  GtHashmap *seqranges;
+  bool refine;
+  GtStr *seqid;
+  GtArray *ranges;
+  GtUword numchildren;
+  GtRange range;
+  GtRange seqrange;
+  bool first;
+  GtUword prevend;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *delta_sweep_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void delta_sweep_stream_class_init(void);
+
+/**
+ * @function Write the table rows for the iLoci of the pending gene locus, if
+ * any. If ``nextstart`` is NULL, the locus is the last one on its sequence.
+ */
+static void delta_sweep_stream_flush(AgnDeltaSweepStream *stream,
+                                     GtUword *nextstart);
+
+/**
+ * @function Destructor: write the last row and release instance data.
+ */
+static void delta_sweep_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pass the next node through, recording region nodes and gene loci.
+ */
+static int delta_sweep_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                   GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_delta_sweep_stream_new(GtNodeStream *in_stream,
+                                         GtArray *deltas, FILE *outfile)
+{
+  agn_assert(in_stream && deltas && outfile);
+  GtNodeStream *ns = gt_node_stream_create(delta_sweep_stream_class(), false);
+  AgnDeltaSweepStream *stream = delta_sweep_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->deltas = gt_array_clone(deltas);
+  stream->outfile = outfile;
+  stream->seqranges = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                     gt_free_func);
+  stream->refine = false;
+  stream->seqid = NULL;
+  stream->ranges = gt_array_new( sizeof(GtRange) );
+  stream->numchildren = 0;
+  stream->first = true;
+  stream->prevend = 0;
+
+  fputs("SeqID\tStart\tEnd", outfile);
+  GtUword i;
+  for(i = 0; i < gt_array_size(deltas); i++)
+  {
+    GtUword delta = *(GtUword *)gt_array_get(deltas, i);
+    fprintf(outfile, "\tStart_%lu\tEnd_%lu\tliil_%lu", delta, delta, delta);
+  }
+  fputc('\n', outfile);
+  return ns;
+}
+
+void agn_delta_sweep_stream_refine(AgnDeltaSweepStream *stream)
+{
+  agn_assert(stream);
+  stream->refine = true;
+}
+
+bool agn_delta_sweep_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *seqid1 = gt_str_new_cstr("chr1");
+  GtStr *seqid2 = gt_str_new_cstr("chr2");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn = gt_region_node_new(seqid1, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(seqid2, 1, 1500);
+  gt_array_add(nodes, gn);
+
+  GtUword genes[] = { 1000, 2000, 2600, 3000, 4200, 4500, 4400, 5000 };
+  GtUword loci[] = { 0, 1, 2, 2 };
+  GtGenomeNode *locus = NULL;
+  GtUword i;
+  for(i = 0; i < 4; i++)
+  {
+    if(i == 0 || loci[i] != loci[i-1])
+    {
+      locus = gt_feature_node_new(seqid1, "locus", genes[2*i] - 100,
+                                  genes[2*i+1] + 100, GT_STRAND_BOTH);
+      gt_array_add(nodes, locus);
+    }
+    GtGenomeNode *gene = gt_feature_node_new(seqid1, "gene", genes[2*i],
+                                             genes[2*i+1], GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)locus, (GtFeatureNode *)gene);
+  }
+  gn = gt_feature_node_new(seqid1, "locus", 5101, 10000, GT_STRAND_BOTH);
+  gt_array_add(nodes, gn);
+  locus = gt_feature_node_new(seqid2, "locus", 1, 1500, GT_STRAND_BOTH);
+  gn = gt_feature_node_new(seqid2, "gene", 100, 1400, GT_STRAND_REVERSE);
+  gt_feature_node_add_child((GtFeatureNode *)locus, (GtFeatureNode *)gn);
+  gt_array_add(nodes, locus);
+  GtUword numnodes = gt_array_size(nodes);
+
+  GtArray *deltas = gt_array_new( sizeof(GtUword) );
+  GtUword deltavalues[] = { 0, 200, 500 };
+  gt_array_add_elems(deltas, deltavalues, 3);
+
+  char *buffer;
+  size_t buffersize;
+  FILE *outfp = open_memstream(&buffer, &buffersize);
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *dss = agn_delta_sweep_stream_new(ais, deltas, outfp);
+  GtUword count = 0;
+  int result;
+  while((result = gt_node_stream_next(dss, &gn, error)) == 0 && gn != NULL)
+  {
+    count++;
+    gt_genome_node_delete(gn);
+  }
+  gt_node_stream_delete(dss);
+  gt_node_stream_delete(ais);
+  fclose(outfp);
+
+  bool test1 = result == 0 && count == numnodes;
+  agn_unit_test_result(test, "pass through", test1);
+
+  const char *exp = "SeqID\tStart\tEnd\tStart_0\tEnd_0\tliil_0\tStart_200\t"
+                    "End_200\tliil_200\tStart_500\tEnd_500\tliil_500\n"
+                    "chr1\t1000\t2000\t1000\t2000\tNA\t800\t2300\tNA\t"
+                    "1\t2500\tNA\n"
+                    "chr1\t2600\t3000\t2600\t3000\t599\t2301\t3200\t0\t"
+                    "2100\t3600\t0\n"
+                    "chr1\t4200\t5000\t4200\t5000\t1199\t4000\t5200\t799\t"
+                    "3601\t5500\t0\n"
+                    "chr2\t100\t1400\t100\t1400\tNA\t1\t1500\tNA\t"
+                    "1\t1500\tNA\n";
+  bool test2 = strcmp(buffer, exp) == 0;
+  agn_unit_test_result(test, "boundaries", test2);
+  free(buffer);
+  gt_array_delete(nodes);
+
+  // Two overlapping refined iLoci split from one gene locus, an iiLocus, and
+  // an iLocus that was not split
+  nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  gn = gt_region_node_new(seqid1, 1, 10000);
+  gt_array_add(nodes, gn);
+  GtUword refined[] = { 1000, 2000, 1800, 3000, 6000, 7000 };
+  for(i = 0; i < 3; i++)
+  {
+    if(i == 2)
+    {
+      gn = gt_feature_node_new(seqid1, "locus", 3001, 5999, GT_STRAND_BOTH);
+      gt_array_add(nodes, gn);
+    }
+    locus = gt_feature_node_new(seqid1, "locus", refined[2*i],
+                                refined[2*i+1], GT_STRAND_BOTH);
+    GtGenomeNode *gene = gt_feature_node_new(seqid1, "gene", refined[2*i],
+                                             refined[2*i+1], GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)locus, (GtFeatureNode *)gene);
+    gt_array_add(nodes, locus);
+  }
+  numnodes = gt_array_size(nodes);
+  gt_array_reset(deltas);
+  gt_array_add_elems(deltas, deltavalues, 1);
+  gt_array_add(deltas, deltavalues[2]);
+
+  outfp = open_memstream(&buffer, &buffersize);
+  progress = 0;
+  ais = gt_array_in_stream_new(nodes, &progress, error);
+  dss = agn_delta_sweep_stream_new(ais, deltas, outfp);
+  agn_delta_sweep_stream_refine((AgnDeltaSweepStream *)dss);
+  count = 0;
+  while((result = gt_node_stream_next(dss, &gn, error)) == 0 && gn != NULL)
+  {
+    count++;
+    gt_genome_node_delete(gn);
+  }
+  gt_node_stream_delete(dss);
+  gt_node_stream_delete(ais);
+  fclose(outfp);
+
+  exp = "SeqID\tStart\tEnd\tStart_0\tEnd_0\tliil_0\tStart_500\tEnd_500\t"
+        "liil_500\n"
+        "chr1\t1000\t2000\t1000\t2000\tNA\t1\t2500\tNA\n"
+        "chr1\t1800\t3000\t1800\t3000\t0\t1300\t3500\t0\n"
+        "chr1\t6000\t7000\t6000\t7000\t2999\t5500\t7500\t1999\n";
+  bool test3 = result == 0 && count == numnodes && strcmp(buffer, exp) == 0;
+  agn_unit_test_result(test, "refined boundaries", test3);
+
+  free(buffer);
+  gt_error_delete(error);
+  gt_array_delete(deltas);
+  gt_array_delete(nodes);
+  gt_str_delete(seqid1);
+  gt_str_delete(seqid2);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *delta_sweep_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, delta_sweep_stream_class_init);
+  return nsc;
+}
+
+static void delta_sweep_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnDeltaSweepStream),
+                                 delta_sweep_stream_free,
+                                 delta_sweep_stream_next);
+}
+
+static void delta_sweep_stream_flush(AgnDeltaSweepStream *stream,
+                                     GtUword *nextstart)
+{
+  if(stream->seqid == NULL)
+    return;
+
+  // Compute the iLocus of the gene locus for each delta as AgnLocusStream
+  // does, and then, if it was split, the refined iLoci within it as
+  // AgnLocusRefineStream does
+  GtUword numloci = gt_array_size(stream->ranges);
+  GtUword numdeltas = gt_array_size(stream->deltas);
+  bool refined = stream->refine && (numloci > 1 || stream->numchildren > 1);
+  GtRange *iloci = gt_malloc( sizeof(GtRange) * numloci * numdeltas );
+  GtUword *liil = gt_malloc( sizeof(GtUword) * numdeltas );
+  GtUword i, j;
+  for(i = 0; i < numdeltas; i++)
+  {
+    GtUword delta = *(GtUword *)gt_array_get(stream->deltas, i);
+    GtRange ilocus;
+    GtUword newend, newstart;
+    liil[i] = 0;
+    if(stream->first)
+      ilocus.start = agn_ilocus_initial_start(stream->range.start,
+                                              &stream->seqrange, delta);
+    else if(agn_ilocus_gap(stream->prevend, stream->range.start,
+                           &stream->seqrange, delta, &newend,
+                           &ilocus.start) == AGN_ILOCUS_GAP_IILOCUS)
+      liil[i] = ilocus.start - newend - 1;
+    if(nextstart == NULL)
+      ilocus.end = agn_ilocus_terminal_end(stream->range.end,
+                                           &stream->seqrange, delta);
+    else
+      agn_ilocus_gap(stream->range.end, *nextstart, &stream->seqrange, delta,
+                     &ilocus.end, &newstart);
+
+    GtRange *ranges = iloci + (i * numloci);
+    if(refined)
+    {
+      memcpy(ranges, gt_array_get_space(stream->ranges),
+             sizeof (GtRange) * numloci);
+      agn_ilocus_refine(ranges, numloci, &ilocus, delta);
+    }
+    else
+      ranges[0] = ilocus;
+  }
+
+  for(j = 0; j < numloci; j++)
+  {
+    GtRange *range = gt_array_get(stream->ranges, j);
+    fprintf(stream->outfile, "%s\t%lu\t%lu", gt_str_get(stream->seqid),
+            range->start, range->end);
+    for(i = 0; i < numdeltas; i++)
+    {
+      GtRange *ilocus = iloci + (i * numloci) + j;
+      fprintf(stream->outfile, "\t%lu\t%lu\t", ilocus->start, ilocus->end);
+      if(j > 0)
+        fputc('0', stream->outfile);
+      else if(!stream->first)
+        fprintf(stream->outfile, "%lu", liil[i]);
+      else
+        fputs("NA", stream->outfile);
+    }
+    fputc('\n', stream->outfile);
+  }
+  gt_free(iloci);
+  gt_free(liil);
+
+  stream->first = nextstart == NULL;
+  stream->prevend = stream->range.end;
+  gt_str_delete(stream->seqid);
+  stream->seqid = NULL;
+  gt_array_reset(stream->ranges);
+}
+
+static void delta_sweep_stream_free(GtNodeStream *ns)
+{
+  AgnDeltaSweepStream *stream = delta_sweep_stream_cast(ns);
+  delta_sweep_stream_flush(stream, NULL);
+  gt_node_stream_delete(stream->in_stream);
+  gt_array_delete(stream->deltas);
+  gt_hashmap_delete(stream->seqranges);
+  gt_array_delete(stream->ranges);
+}
+
+static int delta_sweep_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                   GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnDeltaSweepStream *stream = delta_sweep_stream_cast(ns);
+  int result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result)
+    return result;
+
+  if(*gn == NULL)
+  {
+    delta_sweep_stream_flush(stream, NULL);
+    return 0;
+  }
+
+  GtStr *seqid = gt_genome_node_get_seqid(*gn);
+  if(gt_region_node_try_cast(*gn))
+  {
+    GtRange *seqrange = gt_malloc( sizeof(GtRange) );
+    *seqrange = gt_genome_node_get_range(*gn);
+    gt_hashmap_add(stream->seqranges, gt_cstr_dup(gt_str_get(seqid)),
+                   seqrange);
+    return 0;
+  }
+
+  GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+  if(fn == NULL || !gt_feature_node_has_type(fn, "locus"))
+    return 0;
+
+  GtRange range = { 0, 0 };
+  GtUword numchildren = 0;
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    GtRange childrange = gt_genome_node_get_range((GtGenomeNode *)child);
+    if(range.end == 0)
+      range = childrange;
+    else
+      range = gt_range_join(&range, &childrange);
+    numchildren++;
+  }
+  gt_feature_node_iterator_delete(iter);
+  if(range.end == 0)
+    return 0;
+
+  // Refined iLoci split from the same gene locus overlap one another, and
+  // iLoci from different gene loci do not
+  bool same_seqid = stream->seqid != NULL &&
+                    gt_str_cmp(stream->seqid, seqid) == 0;
+  if(same_seqid && range.start <= stream->range.end)
+  {
+    gt_array_add(stream->ranges, range);
+    stream->range = gt_range_join(&stream->range, &range);
+    return 0;
+  }
+
+  if(same_seqid)
+    delta_sweep_stream_flush(stream, &range.start);
+  else
+  {
+    delta_sweep_stream_flush(stream, NULL);
+    GtRange *seqrange = gt_hashmap_get(stream->seqranges, gt_str_get(seqid));
+    if(seqrange != NULL)
+      stream->seqrange = *seqrange;
+    else
+    {
+      stream->seqrange.start = 1;
+      stream->seqrange.end = range.end;
+    }
+  }
+  stream->seqid = gt_str_ref(seqid);
+  gt_array_add(stream->ranges, range);
+  stream->numchildren = numchildren;
+  stream->range = range;
+  return 0;
+}
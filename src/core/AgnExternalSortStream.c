@@ -0,0 +1,1146 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "core/cstr_table_api.h"
+#include "core/queue_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/gff3_in_stream_api.h"
+#include "extended/gff3_parser_api.h"
+#include "extended/gff3_visitor_api.h"
+#include "extended/region_node_api.h"
+#include "extended/sort_stream_api.h"
+#include "AgnExternalSortStream.h"
+#include "AgnSeqid.h"
+#include "AgnUtils.h"
+
+#define external_sort_stream_cast(GS)\
+        gt_node_stream_cast(external_sort_stream_class(), GS)
+#define EXTERNAL_SORT_ID_PREFIX  "agn-sort-id"
+#define EXTERNAL_SORT_MAX_FILLER 1000
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+/**
+ * @type A node along with its position in the input, which is used to break
+ * ties so that the sort is stable.
+ */
+typedef struct
+{
+  GtGenomeNode *gn;
+  GtUword seqnum;
+} AgnSortNode;
+
+/**
+ * @type A top-level feature written to a temporary file: its position in the
+ * input, the line of the temporary file on which it starts, and the original
+ * line number of that line.
+ */
+typedef struct
+{
+  GtUword seqnum;
+  GtUword tmpline;
+  GtUword line;
+} AgnSortTree;
+
+/**
+ * @type A line of GFF3 written for a feature, with the feature's original
+ * line number.
+ */
+typedef struct
+{
+  const char *text;
+  GtUword length;
+  GtUword line;
+} AgnSortLine;
+
+/**
+ * @type A sorted run of nodes, held either in memory or in a temporary GFF3
+ * file. ``nodes`` holds the nodes of a run in memory, and ``trees`` holds the
+ * features of a run on disk, in the order they were written.
+ */
+typedef struct
+{
+  AgnSortNode head;
+  GtArray *nodes;
+  GtArray *trees;
+  GtUword next;
+  GtUword started;
+  GtUword numlines;
+  GtUword lines_read;
+  FILE *fp;
+  GtFile *file;
+  GtStr *origin;
+  GtGFF3Parser *parser;
+  GtCstrTable *used_types;
+  GtQueue *queue;
+  GtUword line_number;
+  int status;
+} AgnSortRun;
+
+struct AgnExternalSortStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtUword maxfeatures;
+  GtStr *tmpdir;
+  bool merging;
+  GtArray *buffer;
+  GtUword buffered;
+  GtUword numnodes;
+  GtUword numids;
+  GtArray *others;
+  GtArray *runs;
+  GtArray *heap;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Add a run to the merge heap.
+ */
+static void external_sort_heap_push(GtArray *heap, AgnSortRun *run);
+
+/**
+ * @function Restore heap order after the head of the top run has changed. If
+ * the top run is exhausted, it is removed from the heap.
+ */
+static void external_sort_heap_update(GtArray *heap);
+
+/**
+ * @function Compare two lines by original line number.
+ */
+static int external_sort_line_compare(const AgnSortLine *l1,
+                                      const AgnSortLine *l2);
+
+/**
+ * @function Return true if ``line`` is the GFF3 line for ``fn``, judging by
+ * its type and coordinates.
+ */
+static bool external_sort_line_shows(AgnSortLine *line, GtFeatureNode *fn);
+
+/**
+ * @function Give a temporary ID to each feature of ``fn`` that has children
+ * but no ID, so that the GFF3 written for it does not introduce new IDs.
+ */
+static void external_sort_mark_ids(GtFeatureNode *fn, GtUword *numids);
+
+/**
+ * @function Compare two nodes by position, and then by input order.
+ */
+static int external_sort_node_compare(const AgnSortNode *n1,
+                                      const AgnSortNode *n2);
+
+/**
+ * @function Remove the temporary IDs given by ``external_sort_mark_ids``, and
+ * any references to them, from a feature read back from disk.
+ */
+static void external_sort_restore_ids(GtFeatureNode *fn);
+
+/**
+ * @function Return true if the head of run ``r1`` sorts before the head of run
+ * ``r2``.
+ */
+static bool external_sort_run_before(AgnSortRun *r1, AgnSortRun *r2);
+
+/**
+ * @function Load the next node of the given run, setting its head to NULL if
+ * the run is exhausted.
+ */
+static int external_sort_run_advance(AgnSortRun *run, GtError *error);
+
+/**
+ * @function Release a run and any nodes it still holds.
+ */
+static void external_sort_run_delete(AgnSortRun *run);
+
+/**
+ * @function Create a new run holding the given nodes in memory.
+ */
+static AgnSortRun *external_sort_run_new_memory(AgnExternalSortStream *stream,
+                                                GtArray *nodes);
+
+/**
+ * @function Write the GFF3 ``text`` produced for ``node`` to the run's
+ * temporary file. The lines of each feature are written in their original
+ * order and, where the gaps are small enough, padded with empty comments so
+ * that the parser assigns each line its original line number.
+ */
+static void external_sort_run_write(AgnSortRun *run, AgnSortNode *node,
+                                    const char *text, GtUword length);
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *external_sort_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void external_sort_stream_class_init(void);
+
+/**
+ * @function Destructor: release instance data.
+ */
+static void external_sort_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Read the entire input stream, writing sorted runs to disk as the
+ * buffer fills, then prepare all runs for merging.
+ */
+static int external_sort_stream_load(AgnExternalSortStream *stream,
+                                     GtError *error);
+
+/**
+ * @function Emit the next node in sorted order.
+ */
+static int external_sort_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error);
+
+/**
+ * @function Sort the feature buffer and write it to temporary files, one per
+ * file of origin, then empty the buffer.
+ */
+static int external_sort_stream_spill(AgnExternalSortStream *stream,
+                                      GtError *error);
+
+/**
+ * @function Create and open a temporary file for writing and reading. The
+ * file is unlinked immediately, so it is removed when closed.
+ */
+static FILE *external_sort_stream_tmpfile(AgnExternalSortStream *stream,
+                                          GtError *error);
+
+/**
+ * @function Load all feature nodes from the given stream, sorted either with
+ * a ``GtSortStream`` (if ``maxfeatures`` is 0) or with an external sort.
+ */
+static GtArray *external_sort_stream_test_data(GtUword maxfeatures);
+
+/**
+ * @function Compare the features of an external sort with those of an
+ * in-memory sort, including the line numbers of all subfeatures.
+ */
+static void external_sort_stream_test_compare(GtArray *expected,
+                                              GtArray *external, bool *order,
+                                              bool *origins, bool *lines);
+
+/**
+ * @function Sort features without and with IDs through temporary files and
+ * check that no IDs are added.
+ */
+static bool external_sort_stream_test_ids(void);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_external_sort_stream_new(GtNodeStream *in_stream,
+                                           GtUword maxfeatures)
+{
+  agn_assert(in_stream && maxfeatures > 0);
+  GtNodeStream *ns = gt_node_stream_create(external_sort_stream_class(), true);
+  AgnExternalSortStream *stream = external_sort_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->maxfeatures = maxfeatures;
+  const char *tmpdir = getenv("TMPDIR");
+  stream->tmpdir = gt_str_new_cstr(tmpdir != NULL ? tmpdir : "/tmp");
+  stream->merging = false;
+  stream->buffer = gt_array_new( sizeof(AgnSortNode) );
+  stream->buffered = 0;
+  stream->numnodes = 0;
+  stream->numids = 0;
+  stream->others = gt_array_new( sizeof(AgnSortNode) );
+  stream->runs = gt_array_new( sizeof(AgnSortRun *) );
+  stream->heap = gt_array_new( sizeof(AgnSortRun *) );
+  return ns;
+}
+
+void agn_external_sort_stream_set_tmpdir(AgnExternalSortStream *stream,
+                                         const char *tmpdir)
+{
+  agn_assert(stream && tmpdir);
+  gt_str_reset(stream->tmpdir);
+  gt_str_append_cstr(stream->tmpdir, tmpdir);
+}
+
+bool agn_external_sort_stream_unit_test(AgnUnitTest *test)
+{
+  GtArray *expected = external_sort_stream_test_data(0);
+  GtArray *inmemory = external_sort_stream_test_data(1000000);
+  GtArray *external = external_sort_stream_test_data(25);
+
+  bool test1 = gt_array_size(expected) > 0 &&
+               gt_array_size(inmemory) == gt_array_size(expected);
+  GtUword i;
+  for(i = 0; test1 && i < gt_array_size(expected); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(expected, i);
+    GtGenomeNode *gn1 = *(GtGenomeNode **)gt_array_get(inmemory, i);
+    test1 = gt_genome_node_cmp(gn, gn1) == 0;
+  }
+  agn_unit_test_result(test, "grape: in-memory sort", test1);
+
+  bool test2, test3, test4;
+  external_sort_stream_test_compare(expected, external, &test2, &test3, &test4);
+  agn_unit_test_result(test, "grape: external sort order", test2);
+  agn_unit_test_result(test, "grape: external sort origins", test3);
+  agn_unit_test_result(test, "grape: external sort line numbers", test4);
+
+  // With this buffer size, the first run written to disk contains the genes
+  // at chr8:48012-48984 from both files, and the run for the second file
+  // holds the first feature of the buffer.
+  GtArray *ties = external_sort_stream_test_data(360);
+  bool test5, test6, test7;
+  external_sort_stream_test_compare(expected, ties, &test5, &test6, &test7);
+  agn_unit_test_result(test, "grape: ties across files", test5 && test6);
+
+  bool test8 = external_sort_stream_test_ids();
+  agn_unit_test_result(test, "no IDs added", test8);
+
+  GtArray *arrays[] = { expected, inmemory, external, ties };
+  int j;
+  for(j = 0; j < 4; j++)
+  {
+    while(gt_array_size(arrays[j]) > 0)
+    {
+      GtGenomeNode **gn = gt_array_pop(arrays[j]);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(arrays[j]);
+  }
+
+  return agn_unit_test_success(test);
+}
+
+static void external_sort_heap_push(GtArray *heap, AgnSortRun *run)
+{
+  gt_array_add(heap, run);
+  AgnSortRun **runs = gt_array_get_space(heap);
+  GtUword i = gt_array_size(heap) - 1;
+  while(i > 0)
+  {
+    GtUword parent = (i - 1) / 2;
+    if(!external_sort_run_before(runs[i], runs[parent]))
+      break;
+    AgnSortRun *temp = runs[i];
+    runs[i] = runs[parent];
+    runs[parent] = temp;
+    i = parent;
+  }
+}
+
+static void external_sort_heap_update(GtArray *heap)
+{
+  AgnSortRun **runs = gt_array_get_space(heap);
+  GtUword size = gt_array_size(heap);
+  if(runs[0]->head.gn == NULL)
+  {
+    runs[0] = runs[size - 1];
+    gt_array_rem(heap, size - 1);
+    size--;
+  }
+
+  GtUword i = 0;
+  while(1)
+  {
+    GtUword left = 2*i + 1, right = 2*i + 2, least = i;
+    if(left < size && external_sort_run_before(runs[left], runs[least]))
+      least = left;
+    if(right < size && external_sort_run_before(runs[right], runs[least]))
+      least = right;
+    if(least == i)
+      break;
+    AgnSortRun *temp = runs[i];
+    runs[i] = runs[least];
+    runs[least] = temp;
+    i = least;
+  }
+}
+
+static int external_sort_line_compare(const AgnSortLine *l1,
+                                      const AgnSortLine *l2)
+{
+  if(l1->line == l2->line)
+    return 0;
+  return l1->line < l2->line ? -1 : 1;
+}
+
+static bool external_sort_line_shows(AgnSortLine *line, GtFeatureNode *fn)
+{
+  char type[64];
+  GtUword start, end;
+  int numfields = sscanf(line->text, "%*[^\t]\t%*[^\t]\t%63[^\t]\t%lu\t%lu",
+                         type, &start, &end);
+  GtRange range = gt_genome_node_get_range((GtGenomeNode *)fn);
+  return numfields == 3 && strcmp(type, gt_feature_node_get_type(fn)) == 0 &&
+         start == range.start && end == range.end;
+}
+
+static void external_sort_mark_ids(GtFeatureNode *fn, GtUword *numids)
+{
+  char id[64];
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    if(gt_feature_node_is_pseudo(feature) ||
+       gt_feature_node_number_of_children(feature) == 0 ||
+       gt_feature_node_get_attribute(feature, "ID") != NULL)
+      continue;
+    sprintf(id, "%s%lu", EXTERNAL_SORT_ID_PREFIX, ++(*numids));
+    gt_feature_node_add_attribute(feature, "ID", id);
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
+static int external_sort_node_compare(const AgnSortNode *n1,
+                                      const AgnSortNode *n2)
+{
+  int result = gt_genome_node_cmp(n1->gn, n2->gn);
+  if(result != 0)
+    return result;
+  if(n1->seqnum == n2->seqnum)
+    return 0;
+  return n1->seqnum < n2->seqnum ? -1 : 1;
+}
+
+static void external_sort_restore_ids(GtFeatureNode *fn)
+{
+  size_t prefixlength = strlen(EXTERNAL_SORT_ID_PREFIX);
+  GtStr *parents = gt_str_new();
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    const char *id = gt_feature_node_get_attribute(feature, "ID");
+    if(id != NULL && strncmp(id, EXTERNAL_SORT_ID_PREFIX, prefixlength) == 0)
+      gt_feature_node_remove_attribute(feature, "ID");
+
+    const char *parentattr = gt_feature_node_get_attribute(feature, "Parent");
+    if(parentattr == NULL ||
+       strstr(parentattr, EXTERNAL_SORT_ID_PREFIX) == NULL)
+      continue;
+    gt_str_reset(parents);
+    const char *parent = parentattr;
+    while(*parent != '\0')
+    {
+      const char *comma = strchr(parent, ',');
+      size_t length = comma == NULL ? strlen(parent) : comma - parent;
+      if(strncmp(parent, EXTERNAL_SORT_ID_PREFIX, prefixlength) != 0)
+      {
+        if(gt_str_length(parents) > 0)
+          gt_str_append_char(parents, ',');
+        gt_str_append_cstr_nt(parents, parent, length);
+      }
+      parent += length;
+      if(*parent == ',')
+        parent++;
+    }
+    if(gt_str_length(parents) == 0)
+      gt_feature_node_remove_attribute(feature, "Parent");
+    else
+      gt_feature_node_set_attribute(feature, "Parent", gt_str_get(parents));
+  }
+  gt_feature_node_iterator_delete(iter);
+  gt_str_delete(parents);
+}
+
+static bool external_sort_run_before(AgnSortRun *r1, AgnSortRun *r2)
+{
+  return external_sort_node_compare(&r1->head, &r2->head) < 0;
+}
+
+static int external_sort_run_advance(AgnSortRun *run, GtError *error)
+{
+  run->head.gn = NULL;
+  if(run->nodes != NULL)
+  {
+    if(run->next < gt_array_size(run->nodes))
+    {
+      run->head = *(AgnSortNode *)gt_array_get(run->nodes, run->next);
+      run->next++;
+    }
+    return 0;
+  }
+
+  // Region nodes created by the parser are discarded; the original region
+  // nodes were kept in memory. The same goes for comment nodes.
+  GtUword numtrees = gt_array_size(run->trees);
+  while(run->head.gn == NULL)
+  {
+    if(gt_queue_size(run->queue) > 0)
+    {
+      GtGenomeNode *gn = gt_queue_get(run->queue);
+      GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+      if(fn == NULL)
+      {
+        gt_genome_node_delete(gn);
+        continue;
+      }
+      agn_assert(run->next < numtrees);
+      AgnSortTree *tree = gt_array_get(run->trees, run->next);
+      run->next++;
+      external_sort_restore_ids(fn);
+      run->head.gn = gn;
+      run->head.seqnum = tree->seqnum;
+      continue;
+    }
+    if(run->status == EOF)
+      break;
+
+    // If the next line starts a feature, set the parser's line counter so the
+    // line gets its original line number. A line of 0 (unknown) wraps around.
+    while(run->started < numtrees)
+    {
+      AgnSortTree *tree = gt_array_get(run->trees, run->started);
+      if(tree->tmpline > run->lines_read)
+      {
+        if(tree->tmpline == run->lines_read + 1)
+        {
+          run->line_number = tree->line - 1;
+          run->started++;
+        }
+        break;
+      }
+      run->started++;
+    }
+    GtUword line_number = run->line_number;
+    int had_err = gt_gff3_parser_parse_genome_nodes(run->parser, &run->status,
+                                                    run->queue,
+                                                    run->used_types,
+                                                    run->origin,
+                                                    &run->line_number,
+                                                    run->file, error);
+    if(had_err)
+      return -1;
+    run->lines_read += run->line_number - line_number;
+  }
+  return 0;
+}
+
+static void external_sort_run_delete(AgnSortRun *run)
+{
+  if(run->head.gn != NULL)
+    gt_genome_node_delete(run->head.gn);
+  if(run->nodes != NULL)
+  {
+    GtUword i;
+    for(i = run->next; i < gt_array_size(run->nodes); i++)
+    {
+      AgnSortNode *node = gt_array_get(run->nodes, i);
+      gt_genome_node_delete(node->gn);
+    }
+    gt_array_delete(run->nodes);
+  }
+  if(run->trees != NULL)
+    gt_array_delete(run->trees);
+  if(run->queue != NULL)
+  {
+    while(gt_queue_size(run->queue) > 0)
+      gt_genome_node_delete(gt_queue_get(run->queue));
+    gt_queue_delete(run->queue);
+  }
+  if(run->parser != NULL)
+    gt_gff3_parser_delete(run->parser);
+  if(run->used_types != NULL)
+    gt_cstr_table_delete(run->used_types);
+  if(run->file != NULL)
+    gt_file_delete_without_handle(run->file);
+  if(run->fp != NULL)
+    fclose(run->fp);
+  if(run->origin != NULL)
+    gt_str_delete(run->origin);
+  gt_free(run);
+}
+
+static AgnSortRun *external_sort_run_new_memory(AgnExternalSortStream *stream,
+                                                GtArray *nodes)
+{
+  AgnSortRun *run = gt_calloc(1, sizeof (AgnSortRun));
+  run->nodes = nodes;
+  gt_array_sort(run->nodes, (GtCompare)external_sort_node_compare);
+  gt_array_add(stream->runs, run);
+  return run;
+}
+
+static void external_sort_run_write(AgnSortRun *run, AgnSortNode *node,
+                                    const char *text, GtUword length)
+{
+  // The GFF3 visitor writes the features of a graph in depth-first order,
+  // which is also the order of the iterator. Graphs in which a feature has
+  // several parents are written in a different order.
+  GtArray *features = gt_array_new( sizeof(GtFeatureNode *) );
+  GtHashmap *seen = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  bool inorder = true;
+  GtFeatureNodeIterator *iter;
+  iter = gt_feature_node_iterator_new((GtFeatureNode *)node->gn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    if(gt_feature_node_is_pseudo(feature))
+      continue;
+    if(gt_hashmap_get(seen, feature) != NULL)
+      inorder = false;
+    gt_hashmap_add(seen, feature, feature);
+    gt_array_add(features, feature);
+  }
+  gt_feature_node_iterator_delete(iter);
+  gt_hashmap_delete(seen);
+
+  // Pragmas and terminators are written as they are; the line of each feature
+  // is paired with the feature's original line number, if the line shows the
+  // expected feature.
+  GtArray *lines = gt_array_new( sizeof(AgnSortLine) );
+  const char *end = text + length;
+  const char *linestart;
+  for(linestart = text; linestart < end; )
+  {
+    const char *lineend = memchr(linestart, '\n', end - linestart);
+    lineend = lineend == NULL ? end : lineend + 1;
+    AgnSortLine line = { linestart, lineend - linestart, 0 };
+    if(*linestart == '#')
+    {
+      fwrite(line.text, 1, line.length, run->fp);
+      run->numlines++;
+    }
+    else
+    {
+      GtUword i = gt_array_size(lines);
+      if(inorder && i < gt_array_size(features))
+      {
+        GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(features, i);
+        inorder = external_sort_line_shows(&line, fn);
+        line.line = gt_genome_node_get_line_number((GtGenomeNode *)fn);
+      }
+      gt_array_add(lines, line);
+    }
+    linestart = lineend;
+  }
+  inorder = inorder && gt_array_size(lines) == gt_array_size(features);
+
+  GtUword numlines = gt_array_size(lines), filler = 0, i;
+  if(inorder)
+  {
+    gt_array_sort_stable(lines, (GtCompare)external_sort_line_compare);
+    for(i = 1; i < numlines; i++)
+    {
+      AgnSortLine *prev = gt_array_get(lines, i - 1);
+      AgnSortLine *line = gt_array_get(lines, i);
+      if(line->line > prev->line + 1)
+        filler += line->line - prev->line - 1;
+    }
+  }
+
+  AgnSortTree tree = { node->seqnum, run->numlines + 1,
+                       gt_genome_node_get_line_number(node->gn) };
+  if(inorder)
+    tree.line = ((AgnSortLine *)gt_array_get(lines, 0))->line;
+  gt_array_add(run->trees, tree);
+  for(i = 0; i < numlines; i++)
+  {
+    AgnSortLine *line = gt_array_get(lines, i);
+    if(i > 0 && inorder && filler <= EXTERNAL_SORT_MAX_FILLER)
+    {
+      AgnSortLine *prev = gt_array_get(lines, i - 1);
+      GtUword j;
+      for(j = prev->line + 1; j < line->line; j++)
+      {
+        fputs("#\n", run->fp);
+        run->numlines++;
+      }
+    }
+    fwrite(line->text, 1, line->length, run->fp);
+    run->numlines++;
+  }
+
+  // The terminator line allows the parser to release each feature as soon
+  // as it is read back.
+  fputs("###\n", run->fp);
+  run->numlines++;
+  gt_array_delete(lines);
+  gt_array_delete(features);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *external_sort_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, external_sort_stream_class_init);
+  return nsc;
+}
+
+static void external_sort_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnExternalSortStream),
+                                 external_sort_stream_free,
+                                 external_sort_stream_next);
+}
+
+static void external_sort_stream_free(GtNodeStream *ns)
+{
+  AgnExternalSortStream *stream = external_sort_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  gt_str_delete(stream->tmpdir);
+  GtArray *arrays[] = { stream->buffer, stream->others };
+  int i;
+  for(i = 0; i < 2; i++)
+  {
+    if(arrays[i] == NULL)
+      continue;
+    while(gt_array_size(arrays[i]) > 0)
+    {
+      AgnSortNode *node = gt_array_pop(arrays[i]);
+      gt_genome_node_delete(node->gn);
+    }
+    gt_array_delete(arrays[i]);
+  }
+  while(gt_array_size(stream->runs) > 0)
+  {
+    AgnSortRun **run = gt_array_pop(stream->runs);
+    external_sort_run_delete(*run);
+  }
+  gt_array_delete(stream->runs);
+  gt_array_delete(stream->heap);
+}
+
+static int external_sort_stream_load(AgnExternalSortStream *stream,
+                                     GtError *error)
+{
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(stream->in_stream, &gn, error)) == 0 &&
+        gn != NULL)
+  {
+    AgnSortNode node = { gn, stream->numnodes++ };
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn == NULL)
+    {
+      gt_array_add(stream->others, node);
+      continue;
+    }
+
+    gt_array_add(stream->buffer, node);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feature;
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      stream->buffered++;
+    }
+    gt_feature_node_iterator_delete(iter);
+
+    if(stream->buffered >= stream->maxfeatures)
+    {
+      result = external_sort_stream_spill(stream, error);
+      if(result)
+        return result;
+    }
+  }
+  if(result)
+    return result;
+
+  // As with GtSortStream, region nodes for the same sequence are merged.
+  gt_array_sort(stream->others, (GtCompare)external_sort_node_compare);
+  GtUword i;
+  for(i = 1; i < gt_array_size(stream->others); i++)
+  {
+    AgnSortNode *prev = gt_array_get(stream->others, i-1);
+    AgnSortNode *node = gt_array_get(stream->others, i);
+    if(gt_region_node_try_cast(prev->gn) && gt_region_node_try_cast(node->gn) &&
+       agn_seqid_equal(prev->gn, node->gn))
+    {
+      GtRange prevrange = gt_genome_node_get_range(prev->gn);
+      GtRange range = gt_genome_node_get_range(node->gn);
+      range = gt_range_join(&prevrange, &range);
+      gt_genome_node_set_range(prev->gn, &range);
+      gt_genome_node_delete(node->gn);
+      gt_array_rem(stream->others, i);
+      i--;
+    }
+  }
+
+  // Non-feature nodes and the final partial buffer are kept in memory as two
+  // more runs. Ties between runs are broken by input order.
+  external_sort_run_new_memory(stream, stream->others);
+  stream->others = NULL;
+  external_sort_run_new_memory(stream, stream->buffer);
+  stream->buffer = NULL;
+  GtUword numruns = gt_array_size(stream->runs);
+  for(i = 0; i < numruns; i++)
+  {
+    AgnSortRun *run = *(AgnSortRun **)gt_array_get(stream->runs, i);
+    if(run->fp != NULL)
+    {
+      rewind(run->fp);
+      run->file = gt_file_new_from_fileptr(run->fp);
+      run->parser = gt_gff3_parser_new(NULL);
+      run->used_types = gt_cstr_table_new();
+      run->queue = gt_queue_new();
+    }
+    if(external_sort_run_advance(run, error))
+      return -1;
+    if(run->head.gn != NULL)
+      external_sort_heap_push(stream->heap, run);
+  }
+  return 0;
+}
+
+static int external_sort_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                     GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnExternalSortStream *stream = external_sort_stream_cast(ns);
+
+  if(!stream->merging)
+  {
+    stream->merging = true;
+    if(external_sort_stream_load(stream, error))
+      return -1;
+  }
+
+  if(gt_array_size(stream->heap) == 0)
+  {
+    *gn = NULL;
+    return 0;
+  }
+
+  AgnSortRun *top = *(AgnSortRun **)gt_array_get(stream->heap, 0);
+  *gn = top->head.gn;
+  top->head.gn = NULL;
+  if(external_sort_run_advance(top, error))
+    return -1;
+  external_sort_heap_update(stream->heap);
+  return 0;
+}
+
+static int external_sort_stream_spill(AgnExternalSortStream *stream,
+                                      GtError *error)
+{
+  gt_array_sort(stream->buffer, (GtCompare)external_sort_node_compare);
+
+  // One run per file of origin; the run's origin is given to the parser as
+  // the file name when the run is read back.
+  GtHashmap *partsbyorigin = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  GtArray *parts = gt_array_new( sizeof(GtArray *) );
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->buffer); i++)
+  {
+    AgnSortNode *node = gt_array_get(stream->buffer, i);
+    const char *origin = gt_genome_node_get_filename(node->gn);
+    GtArray *part = gt_hashmap_get(partsbyorigin, origin);
+    if(part == NULL)
+    {
+      part = gt_array_new( sizeof(AgnSortNode) );
+      gt_array_add(parts, part);
+      gt_hashmap_add(partsbyorigin, (char *)origin, part);
+    }
+    gt_array_add(part, *node);
+  }
+  gt_hashmap_delete(partsbyorigin);
+
+  int had_err = 0;
+  while(gt_array_size(parts) > 0)
+  {
+    GtArray *part = *(GtArray **)gt_array_get(parts, 0);
+    gt_array_rem(parts, 0);
+    FILE *fp = NULL;
+    if(!had_err)
+    {
+      fp = external_sort_stream_tmpfile(stream, error);
+      had_err = fp == NULL ? -1 : 0;
+    }
+    if(had_err)
+    {
+      gt_array_delete(part);
+      continue;
+    }
+
+    AgnSortNode *first = gt_array_get(part, 0);
+    AgnSortRun *run = gt_calloc(1, sizeof (AgnSortRun));
+    run->fp = fp;
+    run->origin = gt_str_new_cstr(gt_genome_node_get_filename(first->gn));
+    run->trees = gt_array_new( sizeof(AgnSortTree) );
+    gt_array_add(stream->runs, run);
+
+    // The GFF3 of each node is written to memory first, so that the lines of
+    // each feature can be put back in their original order.
+    char *text = NULL;
+    size_t textsize = 0;
+    FILE *textfp = open_memstream(&text, &textsize);
+    GtFile *textfile = gt_file_new_from_fileptr(textfp);
+    GtNodeVisitor *visitor = gt_gff3_visitor_new(textfile);
+    gt_gff3_visitor_retain_id_attributes((GtGFF3Visitor *)visitor);
+
+    // Without a sequence-region pragma for each sequence, the parser would
+    // hold every feature back until the end of the file to infer the regions.
+    GtUword j, k;
+    for(j = 0; j < gt_array_size(part) && !had_err; j = k)
+    {
+      AgnSortNode *node = gt_array_get(part, j);
+      GtRange range = gt_genome_node_get_range(node->gn);
+      for(k = j + 1; k < gt_array_size(part); k++)
+      {
+        AgnSortNode *next = gt_array_get(part, k);
+        if(!agn_seqid_equal(node->gn, next->gn))
+          break;
+        GtRange nextrange = gt_genome_node_get_range(next->gn);
+        range = gt_range_join(&range, &nextrange);
+      }
+      GtStr *seqid = gt_genome_node_get_seqid(node->gn);
+      GtGenomeNode *region = gt_region_node_new(seqid, range.start, range.end);
+      had_err = gt_genome_node_accept(region, visitor, error);
+      gt_genome_node_delete(region);
+    }
+    fflush(textfp);
+    fwrite(text, 1, textsize, fp);
+    for(j = 0; j < textsize; j++)
+    {
+      if(text[j] == '\n')
+        run->numlines++;
+    }
+
+    for(j = 0; j < gt_array_size(part) && !had_err; j++)
+    {
+      AgnSortNode *node = gt_array_get(part, j);
+      external_sort_mark_ids((GtFeatureNode *)node->gn, &stream->numids);
+      rewind(textfp);
+      had_err = gt_genome_node_accept(node->gn, visitor, error);
+      fflush(textfp);
+      if(!had_err)
+        external_sort_run_write(run, node, text, textsize);
+    }
+    gt_node_visitor_delete(visitor);
+    gt_file_delete_without_handle(textfile);
+    fclose(textfp);
+    free(text);
+    gt_array_delete(part);
+  }
+  gt_array_delete(parts);
+
+  while(gt_array_size(stream->buffer) > 0)
+  {
+    AgnSortNode *node = gt_array_pop(stream->buffer);
+    gt_genome_node_delete(node->gn);
+  }
+  stream->buffered = 0;
+  return had_err;
+}
+
+static FILE *external_sort_stream_tmpfile(AgnExternalSortStream *stream,
+                                          GtError *error)
+{
+  GtStr *path = gt_str_clone(stream->tmpdir);
+  gt_str_append_cstr(path, "/aegean-sort-XXXXXX");
+  int fd = mkstemp(gt_str_get(path));
+  if(fd == -1)
+  {
+    gt_error_set(error, "could not create temporary file in '%s': %s",
+                 gt_str_get(stream->tmpdir), strerror(errno));
+    gt_str_delete(path);
+    return NULL;
+  }
+  unlink(gt_str_get(path));
+  gt_str_delete(path);
+
+  FILE *fp = fdopen(fd, "w+");
+  if(fp == NULL)
+  {
+    gt_error_set(error, "could not open temporary file: %s", strerror(errno));
+    close(fd);
+  }
+  return fp;
+}
+
+static GtArray *external_sort_stream_test_data(GtUword maxfeatures)
+{
+  const char *filenames[] = { "data/gff3/grape-refr.gff3",
+                              "data/gff3/grape-pred.gff3" };
+  GtNodeStream *gff3 = gt_gff3_in_stream_new_unsorted(2, filenames);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3);
+  GtNodeStream *sort;
+  if(maxfeatures == 0)
+    sort = gt_sort_stream_new(gff3);
+  else
+    sort = agn_external_sort_stream_new(gff3, maxfeatures);
+
+  GtError *error = gt_error_new();
+  GtArray *features = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(sort, &gn, error)) == 0 && gn != NULL)
+  {
+    if(gt_feature_node_try_cast(gn))
+      gt_array_add(features, gn);
+    else
+      gt_genome_node_delete(gn);
+  }
+  if(result == -1)
+  {
+    fprintf(stderr, "error loading unit test data: %s\n", gt_error_get(error));
+    exit(1);
+  }
+
+  gt_node_stream_delete(sort);
+  gt_node_stream_delete(gff3);
+  gt_error_delete(error);
+  return features;
+}
+
+static void external_sort_stream_test_compare(GtArray *expected,
+                                              GtArray *external, bool *order,
+                                              bool *origins, bool *lines)
+{
+  *order = gt_array_size(external) == gt_array_size(expected);
+  *origins = *order;
+  *lines = *order;
+  GtUword i;
+  for(i = 0; *order && i < gt_array_size(expected); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(expected, i);
+    GtGenomeNode *gn2 = *(GtGenomeNode **)gt_array_get(external, i);
+    GtFeatureNode *fn = gt_feature_node_cast(gn);
+    GtFeatureNode *fn2 = gt_feature_node_cast(gn2);
+    const char *id = gt_feature_node_get_attribute(fn, "ID");
+    const char *id2 = gt_feature_node_get_attribute(fn2, "ID");
+    *order = gt_genome_node_cmp(gn, gn2) == 0 &&
+             strcmp(gt_feature_node_get_type(fn),
+                    gt_feature_node_get_type(fn2)) == 0 &&
+             (id == NULL ? id2 == NULL : id2 != NULL && strcmp(id, id2) == 0);
+    *origins = *origins && strcmp(gt_genome_node_get_filename(gn),
+                                  gt_genome_node_get_filename(gn2)) == 0;
+
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNodeIterator *iter2 = gt_feature_node_iterator_new(fn2);
+    GtFeatureNode *feature = gt_feature_node_iterator_next(iter);
+    GtFeatureNode *feature2 = gt_feature_node_iterator_next(iter2);
+    while(*lines && feature != NULL && feature2 != NULL)
+    {
+      *lines = gt_genome_node_get_line_number((GtGenomeNode *)feature) ==
+               gt_genome_node_get_line_number((GtGenomeNode *)feature2);
+      feature = gt_feature_node_iterator_next(iter);
+      feature2 = gt_feature_node_iterator_next(iter2);
+    }
+    *lines = *lines && feature == NULL && feature2 == NULL;
+    gt_feature_node_iterator_delete(iter);
+    gt_feature_node_iterator_delete(iter2);
+  }
+  *origins = *origins && *order;
+  *lines = *lines && *order;
+}
+
+static bool external_sort_stream_test_ids(void)
+{
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *region = gt_region_node_new(seqid, 1, 10000);
+  gt_array_add(nodes, region);
+
+  // A gene and mRNA without IDs, and a gene and mRNA with IDs
+  GtGenomeNode *genes[2];
+  int i, j;
+  for(i = 0; i < 2; i++)
+  {
+    GtUword start = 5000 - (i * 4000);
+    genes[i] = gt_feature_node_new(seqid, "gene", start, start + 2000,
+                                   GT_STRAND_FORWARD);
+    GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", start,
+                                             start + 2000, GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)genes[i], (GtFeatureNode *)mrna);
+    if(i == 1)
+    {
+      gt_feature_node_add_attribute((GtFeatureNode *)genes[i], "ID", "gene2");
+      gt_feature_node_add_attribute((GtFeatureNode *)mrna, "ID", "mRNA2");
+      gt_feature_node_add_attribute((GtFeatureNode *)mrna, "Parent", "gene2");
+    }
+    for(j = 0; j < 2; j++)
+    {
+      GtGenomeNode *exon = gt_feature_node_new(seqid, "exon",
+                                               start + (j * 1500),
+                                               start + (j * 1500) + 500,
+                                               GT_STRAND_FORWARD);
+      gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)exon);
+    }
+    gt_array_add(nodes, genes[i]);
+  }
+
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *sort = agn_external_sort_stream_new(ais, 1);
+  GtArray *features = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(sort, &gn, error)) == 0 && gn != NULL)
+  {
+    if(gt_feature_node_try_cast(gn))
+      gt_array_add(features, gn);
+    else
+      gt_genome_node_delete(gn);
+  }
+
+  bool success = result == 0 && gt_array_size(features) == 2;
+  for(i = 0; success && i < 2; i++)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(features, i);
+    GtUword numfeatures = 0, numids = 0, numparents = 0;
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feature;
+    for(feature  = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature  = gt_feature_node_iterator_next(iter))
+    {
+      numfeatures++;
+      if(gt_feature_node_get_attribute(feature, "ID") != NULL)
+        numids++;
+      if(gt_feature_node_get_attribute(feature, "Parent") != NULL)
+        numparents++;
+    }
+    gt_feature_node_iterator_delete(iter);
+
+    const char *id = gt_feature_node_get_attribute(fn, "ID");
+    if(i == 0)
+      success = id != NULL && strcmp(id, "gene2") == 0 && numfeatures == 4 &&
+                numids == 2 && numparents == 3;
+    else
+      success = id == NULL && numfeatures == 4 && numids == 0 &&
+                numparents == 0;
+  }
+
+  while(gt_array_size(features) > 0)
+  {
+    GtGenomeNode **feature = gt_array_pop(features);
+    gt_genome_node_delete(*feature);
+  }
+  gt_array_delete(features);
+  gt_node_stream_delete(sort);
+  gt_node_stream_delete(ais);
+  gt_array_delete(nodes);
+  gt_error_delete(error);
+  gt_str_delete(seqid);
+  return success;
+}
@@ -9,6 +9,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 
 #include <math.h>
+#include <pthread.h>
 #include <string.h>
 #include "core/array_api.h"
 #include "core/queue_api.h"
@@ -17,6 +18,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnGaevalVisitor.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
+#include "AgnTranscriptModel.h"
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
 
@@ -61,6 +63,11 @@ static double gaeval_visitor_calculate_integrity(AgnGaevalVisitor *v,
  */
 static const GtNodeVisitorClass* gaeval_visitor_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void gaeval_visitor_class_init(void);
+
 /**
  * @function Add up exon and match lengths to calculate coverage.
  */
@@ -255,19 +262,23 @@ bool agn_gaeval_visitor_unit_test(AgnUnitTest *test)
   return agn_unit_test_success(test);
 }
 
-static const GtNodeVisitorClass* gaeval_visitor_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *gaeval_visitor_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (AgnGaevalVisitor),
-                                    gaeval_visitor_free, NULL,
-                                    gaeval_visitor_visit_feature_node,
-                                    NULL, NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, gaeval_visitor_class_init);
   return nvc;
 }
 
+static void gaeval_visitor_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (AgnGaevalVisitor),
+                                  gaeval_visitor_free, NULL,
+                                  gaeval_visitor_visit_feature_node,
+                                  NULL, NULL, NULL);
+}
+
 static double gaeval_visitor_calculate_coverage(AgnGaevalVisitor *v,
                                                 GtFeatureNode *genemodel,
                                                 GtError *error)
@@ -426,12 +437,27 @@ gaeval_visitor_intersect(GtGenomeNode *genemodel, GtGenomeNode *alignment)
     return NULL;
 
   GtArray *covered_parts = gt_array_new( sizeof(GtRange) );
-  GtArray *exons = agn_typecheck_select(genefn, agn_typecheck_exon);
+  GtArray *exons = NULL;
+  GtUword num_exons;
+  AgnTranscriptModel *model = agn_transcript_model_get(genefn);
+  if(model != NULL)
+    num_exons = model->num_exons;
+  else
+  {
+    exons = agn_typecheck_select(genefn, agn_typecheck_exon);
+    num_exons = gt_array_size(exons);
+  }
   GtWord i;
-  for(i = 0; i < gt_array_size(exons); i++)
+  for(i = 0; i < num_exons; i++)
   {
-    GtGenomeNode *exon = *(GtGenomeNode **)gt_array_get(exons, i);
-    GtRange exonrange = gt_genome_node_get_range(exon);
+    GtRange exonrange;
+    if(model != NULL)
+      exonrange = model->exons[i];
+    else
+    {
+      GtGenomeNode *exon = *(GtGenomeNode **)gt_array_get(exons, i);
+      exonrange = gt_genome_node_get_range(exon);
+    }
 
     GtFeatureNodeIterator *aniter = gt_feature_node_iterator_new(algnfn);
     GtFeatureNode *tempaln;
@@ -450,7 +476,8 @@ gaeval_visitor_intersect(GtGenomeNode *genemodel, GtGenomeNode *alignment)
     }
     gt_feature_node_iterator_delete(aniter);
   }
-  gt_array_delete(exons);
+  if(exons != NULL)
+    gt_array_delete(exons);
 
   for(i = 0; i < gt_array_size(covered_parts); i++)
   {
@@ -562,6 +589,8 @@ gaeval_visitor_visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn,
   {
     if(agn_typecheck_mrna(tempfeat) == false)
       continue;
+    if(agn_transcript_model_get(tempfeat) == NULL)
+      agn_transcript_model_attach(tempfeat, agn_transcript_model_new(tempfeat));
 
     double coverage = gaeval_visitor_calculate_coverage(v, tempfeat, error);
     char covstr[16];
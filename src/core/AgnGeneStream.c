@@ -7,6 +7,7 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include "core/hashmap_api.h"
 #include "core/logger_api.h"
 #include "core/queue_api.h"
@@ -14,6 +15,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnGeneStream.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
+#include "AgnTranscriptModel.h"
 #include "AgnUtils.h"
 #include "AgnTypecheck.h"
 
@@ -42,6 +44,11 @@ struct AgnGeneStream
  */
 static const GtNodeStreamClass* gene_stream_class(void);
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void gene_stream_class_init(void);
+
 /**
  * @function Class destructor.
  */
@@ -177,18 +184,22 @@ bool agn_gene_stream_unit_test(AgnUnitTest *test)
   return agn_unit_test_success(test);
 }
 
+static const GtNodeStreamClass *nsc = NULL;
+
 static const GtNodeStreamClass *gene_stream_class(void)
 {
-  static const GtNodeStreamClass *nsc = NULL;
-  if(!nsc)
-  {
-    nsc = gt_node_stream_class_new(sizeof (AgnGeneStream),
-                                   gene_stream_free,
-                                   gene_stream_next);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, gene_stream_class_init);
   return nsc;
 }
 
+static void gene_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnGeneStream),
+                                 gene_stream_free,
+                                 gene_stream_next);
+}
+
 static void gene_stream_free(GtNodeStream *ns)
 {
   AgnGeneStream *stream = gene_stream_cast(ns);
@@ -238,44 +249,43 @@ static int gene_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error)
         continue;
       }
 
-      GtArray *cds     = agn_typecheck_select(current, agn_typecheck_cds);
-      GtArray *exons   = agn_typecheck_select(current, agn_typecheck_exon);
-      GtArray *introns = agn_typecheck_select(current, agn_typecheck_intron);
+      AgnTranscriptModel *model = agn_transcript_model_new(current);
 
       bool keepmrna = true;
-      if(gt_array_size(cds) < 1)
+      if(model->num_cds < 1)
       {
         const char *mrnaid = agn_feature_node_get_label(current);
-        gt_logger_log(stream->logger, "ignoring mRNA '%s': no CDS", mrnaid);
+        agn_logger_log(stream->logger, "ignoring mRNA '%s': no CDS", mrnaid);
         keepmrna = false;
       }
-      if(gt_array_size(exons) != gt_array_size(introns) + 1)
+      if(model->num_exons != model->num_introns + 1)
       {
         const char *mrnaid = agn_feature_node_get_label(current);
-        gt_logger_log(stream->logger, "error: mRNA '%s' has %lu exons but "
-                      "%lu introns", mrnaid, gt_array_size(exons),
-                      gt_array_size(introns));
+        agn_logger_log(stream->logger, "error: mRNA '%s' has %lu exons but "
+                       "%lu introns", mrnaid, model->num_exons,
+                       model->num_introns);
         keepmrna = false;
       }
 
       GtRange generange = gt_genome_node_get_range(*gn);
-      GtRange mrnarange = gt_genome_node_get_range((GtGenomeNode *)current);
-      if(!gt_range_contains(&generange, &mrnarange))
+      if(!gt_range_contains(&generange, &model->range))
       {
         const char *mrnaid = agn_feature_node_get_label(current);
-        gt_logger_log(stream->logger, "mRNA '%s' extends beyond the range of "
-                      "its parent; ignoring", mrnaid);
+        agn_logger_log(stream->logger, "mRNA '%s' extends beyond the range of "
+                       "its parent; ignoring", mrnaid);
         keepmrna = false;
       }
 
       if(keepmrna)
+      {
+        agn_transcript_model_attach(current, model);
         num_valid_mrnas++;
+      }
       else
+      {
+        agn_transcript_model_delete(model);
         gt_queue_add(invalid_transcripts, current);
-
-      gt_array_delete(cds);
-      gt_array_delete(exons);
-      gt_array_delete(introns);
+      }
     }
     gt_feature_node_iterator_delete(iter);
     while(gt_queue_size(invalid_transcripts) > 0)
@@ -290,8 +300,8 @@ static int gene_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error)
     else
     {
       const char *label = agn_feature_node_get_label(fn);
-      gt_logger_log(stream->logger, "warning: found no valid mRNAs for gene "
-                    "'%s'", label);
+      agn_logger_log(stream->logger, "warning: found no valid mRNAs for gene "
+                     "'%s'", label);
       gt_genome_node_delete(*gn);
     }
   }
@@ -8,6 +8,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <pthread.h>
 #include <string.h>
 #include "core/queue_api.h"
 #include "extended/array_in_stream_api.h"
@@ -41,6 +42,11 @@ struct AgnIdFilterStream
  */
 static const GtNodeStreamClass* id_filter_stream_class(void);
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void id_filter_stream_class_init(void);
+
 /**
  * @function Class destructor.
  */
@@ -76,18 +82,22 @@ GtNodeStream* agn_id_filter_stream_new(GtNodeStream *in_stream,
   return ns;
 }
 
+static const GtNodeStreamClass *nsc = NULL;
+
 static const GtNodeStreamClass *id_filter_stream_class(void)
 {
-  static const GtNodeStreamClass *nsc = NULL;
-  if(!nsc)
-  {
-    nsc = gt_node_stream_class_new(sizeof (AgnIdFilterStream),
-                                   id_filter_stream_free,
-                                   id_filter_stream_next);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, id_filter_stream_class_init);
   return nsc;
 }
 
+static void id_filter_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnIdFilterStream),
+                                 id_filter_stream_free,
+                                 id_filter_stream_next);
+}
+
 static void id_filter_stream_free(GtNodeStream *ns)
 {
   AgnIdFilterStream *stream = id_filter_stream_cast(ns);
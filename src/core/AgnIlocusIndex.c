@@ -0,0 +1,759 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "core/cstr_api.h"
+#include "core/hashmap_api.h"
+#include "core/ma_api.h"
+#include "AgnIlocusIndex.h"
+#include "AgnUtils.h"
+
+#define ILOCUS_INDEX_MAGIC     "AGNILOCI"
+#define ILOCUS_INDEX_BYTEORDER 0x01020304
+#define ILOCUS_INDEX_VERSION   1
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+// Start of an index file; the header is followed by the sequence table, the
+// records, the hash table, and the string pool, in that order
+typedef struct
+{
+  char magic[8];
+  uint32_t byteorder;
+  uint32_t version;
+  uint64_t numseqids;
+  uint64_t numrecords;
+  uint64_t numbuckets;
+  uint64_t poolsize;
+} AgnIlocusIndexHeader;
+
+// Records on a single sequence; sequences are sorted by ID
+typedef struct
+{
+  uint32_t name;
+  uint32_t padding;
+  uint64_t first;
+  uint64_t count;
+} AgnIlocusIndexSeqid;
+
+// Used to sort sequence IDs while writing an index
+typedef struct
+{
+  const char *name;
+  uint32_t number;
+} AgnIlocusIndexSeqidOrder;
+
+struct AgnIlocusIndex
+{
+  // Used while building an index; sequences are numbered in the order they
+  // are first seen, and strings are stored as offsets into the pool
+  GtArray *records;
+  GtArray *pool;
+  GtHashmap *seqids;
+  GtArray *seqidnames;
+  GtHashmap *types;
+
+  // Used for an open index
+  void *map;
+  size_t mapsize;
+  const AgnIlocusIndexHeader *header;
+  const AgnIlocusIndexSeqid *seqidtable;
+  const AgnIlocusIndexRecord *recs;
+  const uint64_t *buckets;
+  const char *strings;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Add ``str`` to the string pool and return its offset. If
+ * ``offsets`` is not NULL, strings already in the pool are not added again.
+ */
+static uint32_t ilocus_index_add_string(AgnIlocusIndex *index,
+                                        GtHashmap *offsets, const char *str);
+
+/**
+ * @function Value of the numeric attribute ``key``, or 0 if ``fn`` has no such
+ * attribute.
+ */
+static uint64_t ilocus_index_attribute(GtFeatureNode *fn, const char *key);
+
+/**
+ * @function Check the structure of a mapped index file. Returns NULL if the
+ * index is valid, or a description of the problem otherwise.
+ */
+static const char *ilocus_index_check(AgnIlocusIndex *index);
+
+/**
+ * @function FNV-1a hash of ``label``.
+ */
+static uint64_t ilocus_index_hash(const char *label);
+
+/**
+ * @function Compare records by sequence number, then by coordinates.
+ */
+static int ilocus_index_record_compare(const void *p1, const void *p2);
+
+/**
+ * @function Compare sequences by ID.
+ */
+static int ilocus_index_seqid_compare(const void *p1, const void *p2);
+
+/**
+ * @function String at ``offset`` of the string pool of an open index, or an
+ * empty string if the offset is out of range.
+ */
+static const char *ilocus_index_string(AgnIlocusIndex *index, uint32_t offset);
+
+/**
+ * @function Create an iLocus feature for unit tests. Attributes are given as a
+ * comma-separated list of key=value pairs.
+ */
+static GtFeatureNode *ilocus_index_test_locus(GtStr *seqid, GtUword start,
+                                              GtUword end, const char *attrs);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_ilocus_index_add(AgnIlocusIndex *index, GtFeatureNode *locus)
+{
+  agn_assert(index && index->records && locus);
+  GtGenomeNode *gn = (GtGenomeNode *)locus;
+  GtRange range = gt_genome_node_get_range(gn);
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+
+  AgnIlocusIndexRecord rec;
+  memset(&rec, 0, sizeof (AgnIlocusIndexRecord));
+  rec.start = range.start;
+  rec.end = range.end;
+  rec.effective_length = ilocus_index_attribute(locus, "effective_length");
+  rec.left_flank = ilocus_index_attribute(locus, "liil");
+  rec.right_flank = ilocus_index_attribute(locus, "riil");
+  rec.genes = ilocus_index_attribute(locus, "child_gene");
+  rec.mrnas = ilocus_index_attribute(locus, "child_mRNA");
+
+  // Sequence numbers are stored in the hashmap plus one, since a NULL value
+  // indicates a missing key
+  uintptr_t seqnum = (uintptr_t)gt_hashmap_get(index->seqids, seqid);
+  if(seqnum == 0)
+  {
+    uint32_t name = ilocus_index_add_string(index, NULL, seqid);
+    gt_array_add(index->seqidnames, name);
+    seqnum = gt_array_size(index->seqidnames);
+    gt_hashmap_add(index->seqids, gt_cstr_dup(seqid), (void *)seqnum);
+  }
+  rec.seqid = seqnum - 1;
+
+  const char *label = gt_feature_node_get_attribute(locus, "Name");
+  if(label == NULL)
+    label = gt_feature_node_get_attribute(locus, "ID");
+  if(label == NULL)
+  {
+    char locuspos[1024];
+    snprintf(locuspos, sizeof (locuspos), "%s_%lu-%lu", seqid, range.start,
+             range.end);
+    rec.label = ilocus_index_add_string(index, NULL, locuspos);
+  }
+  else
+    rec.label = ilocus_index_add_string(index, NULL, label);
+
+  const char *type = gt_feature_node_get_attribute(locus, "iLocus_type");
+  rec.type = ilocus_index_add_string(index, index->types,
+                                     type == NULL ? "" : type);
+
+  const char *orient = gt_feature_node_get_attribute(locus, "fg_orient");
+  if(orient != NULL)
+    strncpy(rec.orient, orient, sizeof (rec.orient) - 1);
+
+  gt_array_add(index->records, rec);
+}
+
+void agn_ilocus_index_delete(AgnIlocusIndex *index)
+{
+  if(index == NULL)
+    return;
+
+  if(index->map != NULL)
+    munmap(index->map, index->mapsize);
+  else
+  {
+    gt_array_delete(index->records);
+    gt_array_delete(index->pool);
+    gt_hashmap_delete(index->seqids);
+    gt_array_delete(index->seqidnames);
+    gt_hashmap_delete(index->types);
+  }
+  gt_free(index);
+}
+
+bool agn_ilocus_index_find(AgnIlocusIndex *index, const char *label,
+                           GtUword *pos)
+{
+  agn_assert(index && index->map && label);
+  uint64_t mask = index->header->numbuckets - 1;
+  uint64_t bucket = ilocus_index_hash(label) & mask;
+  uint64_t probes;
+  for(probes = 0;
+      probes <= mask && index->buckets[bucket] != 0;
+      probes++, bucket = (bucket + 1) & mask)
+  {
+    uint64_t i = index->buckets[bucket] - 1;
+    if(i >= index->header->numrecords)
+      continue;
+    const char *reclabel = ilocus_index_string(index, index->recs[i].label);
+    if(strcmp(label, reclabel) == 0)
+    {
+      if(pos != NULL)
+        *pos = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+const AgnIlocusIndexRecord *agn_ilocus_index_get(AgnIlocusIndex *index,
+                                                 GtUword pos)
+{
+  agn_assert(index && index->map && pos < index->header->numrecords);
+  return index->recs + pos;
+}
+
+AgnIlocusIndex *agn_ilocus_index_new()
+{
+  AgnIlocusIndex *index = gt_malloc( sizeof(AgnIlocusIndex) );
+  memset(index, 0, sizeof (AgnIlocusIndex));
+  index->records = gt_array_new( sizeof(AgnIlocusIndexRecord) );
+  index->pool = gt_array_new( sizeof(char) );
+  index->seqids = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  index->seqidnames = gt_array_new( sizeof(uint32_t) );
+  index->types = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  return index;
+}
+
+AgnIlocusIndex *agn_ilocus_index_open(const char *filename, GtError *error)
+{
+  agn_assert(filename);
+  int fd = open(filename, O_RDONLY);
+  if(fd == -1)
+  {
+    gt_error_set(error, "could not open index file '%s': %s", filename,
+                 strerror(errno));
+    return NULL;
+  }
+  struct stat filestat;
+  if(fstat(fd, &filestat) != 0)
+  {
+    gt_error_set(error, "could not read index file '%s': %s", filename,
+                 strerror(errno));
+    close(fd);
+    return NULL;
+  }
+  if(filestat.st_size < (off_t)sizeof (AgnIlocusIndexHeader))
+  {
+    gt_error_set(error, "'%s' is not an iLocus index", filename);
+    close(fd);
+    return NULL;
+  }
+
+  void *map = mmap(NULL, filestat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    gt_error_set(error, "could not map index file '%s': %s", filename,
+                 strerror(errno));
+    return NULL;
+  }
+
+  AgnIlocusIndex *index = gt_malloc( sizeof(AgnIlocusIndex) );
+  memset(index, 0, sizeof (AgnIlocusIndex));
+  index->map = map;
+  index->mapsize = filestat.st_size;
+  index->header = map;
+  const char *problem = ilocus_index_check(index);
+  if(problem != NULL)
+  {
+    gt_error_set(error, "'%s' %s", filename, problem);
+    agn_ilocus_index_delete(index);
+    return NULL;
+  }
+  return index;
+}
+
+GtUword agn_ilocus_index_query(AgnIlocusIndex *index, const char *seqid,
+                               GtRange *range, GtArray *positions)
+{
+  agn_assert(index && index->map && seqid && range && positions);
+
+  const AgnIlocusIndexSeqid *entry = NULL;
+  GtUword low = 0, high = index->header->numseqids;
+  while(low < high)
+  {
+    GtUword mid = low + (high - low) / 2;
+    const char *name = ilocus_index_string(index, index->seqidtable[mid].name);
+    int result = strcmp(seqid, name);
+    if(result == 0)
+    {
+      entry = index->seqidtable + mid;
+      break;
+    }
+    else if(result < 0)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+  if(entry == NULL)
+    return 0;
+
+  // Records before the first one whose running maximum end reaches the query
+  // cannot overlap it, and neither can records that start after it
+  GtUword end = entry->first + entry->count;
+  low = entry->first;
+  high = end;
+  while(low < high)
+  {
+    GtUword mid = low + (high - low) / 2;
+    if(index->recs[mid].maxend < range->start)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  GtUword i, count = 0;
+  for(i = low; i < end && index->recs[i].start <= range->end; i++)
+  {
+    if(index->recs[i].end >= range->start)
+    {
+      gt_array_add(positions, i);
+      count++;
+    }
+  }
+  return count;
+}
+
+const char *agn_ilocus_index_record_label(AgnIlocusIndex *index,
+                                          const AgnIlocusIndexRecord *rec)
+{
+  agn_assert(index && index->map && rec);
+  return ilocus_index_string(index, rec->label);
+}
+
+const char *agn_ilocus_index_record_orient(AgnIlocusIndex *index,
+                                           const AgnIlocusIndexRecord *rec)
+{
+  agn_assert(index && index->map && rec);
+  if(rec->orient[0] == '\0' || rec->orient[sizeof (rec->orient) - 1] != '\0')
+    return "NA";
+  return rec->orient;
+}
+
+const char *agn_ilocus_index_record_seqid(AgnIlocusIndex *index,
+                                          const AgnIlocusIndexRecord *rec)
+{
+  agn_assert(index && index->map && rec);
+  if(rec->seqid >= index->header->numseqids)
+    return "";
+  return ilocus_index_string(index, index->seqidtable[rec->seqid].name);
+}
+
+const char *agn_ilocus_index_record_type(AgnIlocusIndex *index,
+                                         const AgnIlocusIndexRecord *rec)
+{
+  agn_assert(index && index->map && rec);
+  return ilocus_index_string(index, rec->type);
+}
+
+GtUword agn_ilocus_index_size(AgnIlocusIndex *index)
+{
+  agn_assert(index && index->map);
+  return index->header->numrecords;
+}
+
+bool agn_ilocus_index_unit_test(AgnUnitTest *test)
+{
+  GtStr *chr1 = gt_str_new_cstr("chr1");
+  GtStr *chr2 = gt_str_new_cstr("chr2");
+  GtArray *loci = gt_array_new( sizeof(GtFeatureNode *) );
+  GtFeatureNode *fn;
+  fn = ilocus_index_test_locus(chr2, 1, 1000,
+                               "Name=iLocus5,iLocus_type=fiLocus");
+  gt_array_add(loci, fn);
+  fn = ilocus_index_test_locus(chr2, 1001, 3000,
+                               "Name=iLocus6,iLocus_type=siLocus,child_gene=1,"
+                               "child_mRNA=2,effective_length=2000,riil=500");
+  gt_array_add(loci, fn);
+  fn = ilocus_index_test_locus(chr1, 501, 5000,
+                               "Name=iLocus2,iLocus_type=ciLocus,child_gene=3");
+  gt_array_add(loci, fn);
+  fn = ilocus_index_test_locus(chr1, 1, 500,
+                               "ID=locusA,iLocus_type=iiLocus,fg_orient=FR");
+  gt_array_add(loci, fn);
+  fn = ilocus_index_test_locus(chr1, 1001, 2000,
+                               "Name=iLocus3,iLocus_type=siLocus");
+  gt_array_add(loci, fn);
+  fn = ilocus_index_test_locus(chr1, 5001, 6000, "child_gene=1");
+  gt_array_add(loci, fn);
+
+  AgnIlocusIndex *index = agn_ilocus_index_new();
+  GtUword i;
+  for(i = 0; i < gt_array_size(loci); i++)
+  {
+    fn = *(GtFeatureNode **)gt_array_get(loci, i);
+    agn_ilocus_index_add(index, fn);
+    gt_genome_node_delete((GtGenomeNode *)fn);
+  }
+  gt_array_delete(loci);
+  gt_str_delete(chr1);
+  gt_str_delete(chr2);
+
+  GtError *error = gt_error_new();
+  char filename[] = "/tmp/AgnIlocusIndex-XXXXXX";
+  int fd = mkstemp(filename);
+  agn_assert(fd != -1);
+  close(fd);
+  int result = agn_ilocus_index_write(index, filename, error);
+  agn_ilocus_index_delete(index);
+  index = NULL;
+  if(result == 0)
+    index = agn_ilocus_index_open(filename, error);
+  bool test1 = index != NULL && agn_ilocus_index_size(index) == 6;
+  if(test1)
+  {
+    const AgnIlocusIndexRecord *rec0 = agn_ilocus_index_get(index, 0);
+    const AgnIlocusIndexRecord *rec5 = agn_ilocus_index_get(index, 5);
+    test1 = strcmp(agn_ilocus_index_record_seqid(index, rec0), "chr1") == 0 &&
+            strcmp(agn_ilocus_index_record_label(index, rec0), "locusA") == 0 &&
+            strcmp(agn_ilocus_index_record_orient(index, rec0), "FR") == 0 &&
+            strcmp(agn_ilocus_index_record_type(index, rec0), "iiLocus") == 0 &&
+            strcmp(agn_ilocus_index_record_seqid(index, rec5), "chr2") == 0 &&
+            strcmp(agn_ilocus_index_record_type(index, rec5), "siLocus") == 0 &&
+            rec5->start == 1001 && rec5->end == 3000 && rec5->genes == 1 &&
+            rec5->mrnas == 2 && rec5->effective_length == 2000 &&
+            rec5->left_flank == 0 && rec5->right_flank == 500;
+  }
+  agn_unit_test_result(test, "write and open", test1);
+
+  bool test2 = index != NULL;
+  if(test2)
+  {
+    GtUword pos1, pos2, pos3, pos4;
+    const AgnIlocusIndexRecord *rec3 = NULL;
+    test2 = agn_ilocus_index_find(index, "iLocus3", &pos1) && pos1 == 2 &&
+            agn_ilocus_index_find(index, "locusA", &pos2) && pos2 == 0 &&
+            agn_ilocus_index_find(index, "iLocus6", &pos3) && pos3 == 5 &&
+            agn_ilocus_index_find(index, "chr1_5001-6000", &pos4) &&
+            pos4 == 3 && !agn_ilocus_index_find(index, "iLocus4", NULL);
+    if(test2)
+    {
+      rec3 = agn_ilocus_index_get(index, pos4);
+      test2 = strcmp(agn_ilocus_index_record_type(index, rec3), "") == 0 &&
+              strcmp(agn_ilocus_index_record_orient(index, rec3), "NA") == 0;
+    }
+  }
+  agn_unit_test_result(test, "find by label", test2);
+
+  bool test3 = index != NULL;
+  if(test3)
+  {
+    GtArray *positions = gt_array_new( sizeof(GtUword) );
+    GtRange r1 = { 2500, 2600 }, r2 = { 1500, 1500 }, r3 = { 6001, 7000 },
+            r4 = { 900, 1100 };
+    test3 = agn_ilocus_index_query(index, "chr1", &r1, positions) == 1 &&
+            *(GtUword *)gt_array_get(positions, 0) == 1;
+    gt_array_reset(positions);
+    test3 = test3 &&
+            agn_ilocus_index_query(index, "chr1", &r2, positions) == 2 &&
+            *(GtUword *)gt_array_get(positions, 0) == 1 &&
+            *(GtUword *)gt_array_get(positions, 1) == 2;
+    gt_array_reset(positions);
+    test3 = test3 &&
+            agn_ilocus_index_query(index, "chr1", &r3, positions) == 0 &&
+            agn_ilocus_index_query(index, "chr3", &r1, positions) == 0 &&
+            agn_ilocus_index_query(index, "chr2", &r4, positions) == 2;
+    gt_array_delete(positions);
+  }
+  agn_unit_test_result(test, "query by region", test3);
+  agn_ilocus_index_delete(index);
+
+  FILE *outfile = fopen(filename, "w");
+  fputs("##gff-version 3\n", outfile);
+  fclose(outfile);
+  index = agn_ilocus_index_open(filename, error);
+  bool test4 = index == NULL && gt_error_is_set(error);
+  agn_unit_test_result(test, "invalid index", test4);
+  unlink(filename);
+
+  gt_error_delete(error);
+  return agn_unit_test_success(test);
+}
+
+int agn_ilocus_index_write(AgnIlocusIndex *index, const char *filename,
+                           GtError *error)
+{
+  agn_assert(index && index->records && filename);
+  GtUword poolsize = gt_array_size(index->pool);
+  if(poolsize > UINT32_MAX)
+  {
+    gt_error_set(error, "too many iLoci for index file '%s'", filename);
+    return -1;
+  }
+
+  // Number the sequences in order of their IDs, so that a sequence can be
+  // found by binary search, and sort a copy of the records accordingly
+  const char *pool = gt_array_get_space(index->pool);
+  GtUword numseqids = gt_array_size(index->seqidnames);
+  AgnIlocusIndexSeqidOrder *order =
+      gt_malloc( sizeof(AgnIlocusIndexSeqidOrder) * (numseqids + 1) );
+  uint32_t *ranks = gt_malloc( sizeof(uint32_t) * (numseqids + 1) );
+  AgnIlocusIndexSeqid *table =
+      gt_calloc(numseqids + 1, sizeof (AgnIlocusIndexSeqid));
+  GtUword i;
+  for(i = 0; i < numseqids; i++)
+  {
+    order[i].name = pool + *(uint32_t *)gt_array_get(index->seqidnames, i);
+    order[i].number = i;
+  }
+  qsort(order, numseqids, sizeof (AgnIlocusIndexSeqidOrder),
+        ilocus_index_seqid_compare);
+  for(i = 0; i < numseqids; i++)
+  {
+    ranks[order[i].number] = i;
+    table[i].name = *(uint32_t *)gt_array_get(index->seqidnames,
+                                              order[i].number);
+  }
+
+  GtArray *records = gt_array_clone(index->records);
+  GtUword numrecords = gt_array_size(records);
+  for(i = 0; i < numrecords; i++)
+  {
+    AgnIlocusIndexRecord *rec = gt_array_get(records, i);
+    rec->seqid = ranks[rec->seqid];
+  }
+  qsort(gt_array_get_space(records), numrecords,
+        sizeof (AgnIlocusIndexRecord), ilocus_index_record_compare);
+
+  uint64_t maxend = 0;
+  for(i = 0; i < numrecords; i++)
+  {
+    AgnIlocusIndexRecord *rec = gt_array_get(records, i);
+    if(table[rec->seqid].count == 0)
+    {
+      table[rec->seqid].first = i;
+      maxend = 0;
+    }
+    table[rec->seqid].count++;
+    if(rec->end > maxend)
+      maxend = rec->end;
+    rec->maxend = maxend;
+  }
+
+  uint64_t numbuckets = 2;
+  while(numbuckets < 2 * numrecords)
+    numbuckets *= 2;
+  uint64_t *buckets = gt_calloc(numbuckets, sizeof (uint64_t));
+  for(i = 0; i < numrecords; i++)
+  {
+    AgnIlocusIndexRecord *rec = gt_array_get(records, i);
+    uint64_t bucket = ilocus_index_hash(pool + rec->label) & (numbuckets - 1);
+    while(buckets[bucket] != 0)
+      bucket = (bucket + 1) & (numbuckets - 1);
+    buckets[bucket] = i + 1;
+  }
+
+  AgnIlocusIndexHeader header;
+  memset(&header, 0, sizeof (AgnIlocusIndexHeader));
+  memcpy(header.magic, ILOCUS_INDEX_MAGIC, sizeof (header.magic));
+  header.byteorder = ILOCUS_INDEX_BYTEORDER;
+  header.version = ILOCUS_INDEX_VERSION;
+  header.numseqids = numseqids;
+  header.numrecords = numrecords;
+  header.numbuckets = numbuckets;
+  header.poolsize = poolsize;
+
+  int result = 0;
+  FILE *outfile = fopen(filename, "wb");
+  if(outfile == NULL)
+  {
+    gt_error_set(error, "could not open index file '%s': %s", filename,
+                 strerror(errno));
+    result = -1;
+  }
+  else
+  {
+    bool success =
+      fwrite(&header, sizeof (header), 1, outfile) == 1 &&
+      fwrite(table, sizeof (AgnIlocusIndexSeqid), numseqids,
+             outfile) == numseqids &&
+      fwrite(gt_array_get_space(records), sizeof (AgnIlocusIndexRecord),
+             numrecords, outfile) == numrecords &&
+      fwrite(buckets, sizeof (uint64_t), numbuckets, outfile) == numbuckets &&
+      fwrite(pool, sizeof (char), poolsize, outfile) == poolsize;
+    if(fclose(outfile) != 0)
+      success = false;
+    if(!success)
+    {
+      gt_error_set(error, "could not write index file '%s': %s", filename,
+                   strerror(errno));
+      result = -1;
+    }
+  }
+
+  gt_free(buckets);
+  gt_array_delete(records);
+  gt_free(table);
+  gt_free(ranks);
+  gt_free(order);
+  return result;
+}
+
+static uint32_t ilocus_index_add_string(AgnIlocusIndex *index,
+                                        GtHashmap *offsets, const char *str)
+{
+  // Offsets are stored in the hashmap plus one, since a NULL value indicates a
+  // missing key
+  if(offsets != NULL)
+  {
+    uintptr_t offset = (uintptr_t)gt_hashmap_get(offsets, str);
+    if(offset > 0)
+      return offset - 1;
+  }
+
+  uintptr_t offset = gt_array_size(index->pool);
+  gt_array_add_elems(index->pool, (void *)str, strlen(str) + 1);
+  if(offsets != NULL)
+    gt_hashmap_add(offsets, gt_cstr_dup(str), (void *)(offset + 1));
+  return offset;
+}
+
+static uint64_t ilocus_index_attribute(GtFeatureNode *fn, const char *key)
+{
+  const char *value = gt_feature_node_get_attribute(fn, key);
+  if(value == NULL)
+    return 0;
+  return strtoull(value, NULL, 10);
+}
+
+static const char *ilocus_index_check(AgnIlocusIndex *index)
+{
+  const AgnIlocusIndexHeader *header = index->header;
+  if(memcmp(header->magic, ILOCUS_INDEX_MAGIC, sizeof (header->magic)) != 0)
+    return "is not an iLocus index";
+  if(header->byteorder != ILOCUS_INDEX_BYTEORDER)
+    return "was written on a machine with a different byte order";
+  if(header->version != ILOCUS_INDEX_VERSION)
+    return "was written by an incompatible version of LocusPocus";
+
+  // Bound each count before multiplying so that a corrupt header cannot
+  // overflow the size computation
+  size_t mapsize = index->mapsize;
+  if(header->numseqids > mapsize / sizeof (AgnIlocusIndexSeqid) ||
+     header->numrecords > mapsize / sizeof (AgnIlocusIndexRecord) ||
+     header->numbuckets > mapsize / sizeof (uint64_t) ||
+     header->poolsize > mapsize)
+    return "is truncated or corrupt";
+  uint64_t size = sizeof (AgnIlocusIndexHeader) +
+                  header->numseqids * sizeof (AgnIlocusIndexSeqid) +
+                  header->numrecords * sizeof (AgnIlocusIndexRecord) +
+                  header->numbuckets * sizeof (uint64_t) +
+                  header->poolsize;
+  if(size != mapsize || header->numbuckets == 0 ||
+     (header->numbuckets & (header->numbuckets - 1)) != 0)
+    return "is truncated or corrupt";
+
+  const char *data = index->map;
+  data += sizeof (AgnIlocusIndexHeader);
+  index->seqidtable = (const AgnIlocusIndexSeqid *)data;
+  data += header->numseqids * sizeof (AgnIlocusIndexSeqid);
+  index->recs = (const AgnIlocusIndexRecord *)data;
+  data += header->numrecords * sizeof (AgnIlocusIndexRecord);
+  index->buckets = (const uint64_t *)data;
+  data += header->numbuckets * sizeof (uint64_t);
+  index->strings = data;
+  if(header->poolsize > 0 && index->strings[header->poolsize - 1] != '\0')
+    return "is truncated or corrupt";
+
+  GtUword i;
+  for(i = 0; i < header->numseqids; i++)
+  {
+    const AgnIlocusIndexSeqid *entry = index->seqidtable + i;
+    if(entry->first > header->numrecords ||
+       entry->count > header->numrecords - entry->first)
+      return "is truncated or corrupt";
+  }
+  return NULL;
+}
+
+static uint64_t ilocus_index_hash(const char *label)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  const unsigned char *c;
+  for(c = (const unsigned char *)label; *c != '\0'; c++)
+  {
+    hash ^= *c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static int ilocus_index_record_compare(const void *p1, const void *p2)
+{
+  const AgnIlocusIndexRecord *r1 = p1;
+  const AgnIlocusIndexRecord *r2 = p2;
+  if(r1->seqid != r2->seqid)
+    return r1->seqid < r2->seqid ? -1 : 1;
+  if(r1->start != r2->start)
+    return r1->start < r2->start ? -1 : 1;
+  if(r1->end != r2->end)
+    return r1->end < r2->end ? -1 : 1;
+  return 0;
+}
+
+static int ilocus_index_seqid_compare(const void *p1, const void *p2)
+{
+  const AgnIlocusIndexSeqidOrder *s1 = p1;
+  const AgnIlocusIndexSeqidOrder *s2 = p2;
+  return strcmp(s1->name, s2->name);
+}
+
+static const char *ilocus_index_string(AgnIlocusIndex *index, uint32_t offset)
+{
+  if(offset >= index->header->poolsize)
+    return "";
+  return index->strings + offset;
+}
+
+static GtFeatureNode *ilocus_index_test_locus(GtStr *seqid, GtUword start,
+                                              GtUword end, const char *attrs)
+{
+  GtGenomeNode *gn = gt_feature_node_new(seqid, "locus", start, end,
+                                         GT_STRAND_BOTH);
+  GtFeatureNode *fn = gt_feature_node_cast(gn);
+  char *attrcopy = gt_cstr_dup(attrs);
+  char *saveptr, *keyvalue;
+  for(keyvalue = strtok_r(attrcopy, ",", &saveptr);
+      keyvalue != NULL;
+      keyvalue = strtok_r(NULL, ",", &saveptr))
+  {
+    char *value = strchr(keyvalue, '=');
+    *value = '\0';
+    gt_feature_node_add_attribute(fn, keyvalue, value + 1);
+  }
+  gt_free(attrcopy);
+  return fn;
+}
@@ -0,0 +1,210 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "core/cstr_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/region_node_api.h"
+#include "AgnIlocusIndex.h"
+#include "AgnIlocusIndexStream.h"
+#include "AgnUtils.h"
+
+#define ilocus_index_stream_cast(GS)\
+        gt_node_stream_cast(ilocus_index_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnIlocusIndexStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  AgnIlocusIndex *index;
+  char *filename;
+  bool written;
+  bool number_loci;
+  GtUword numloci;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *ilocus_index_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void ilocus_index_stream_class_init(void);
+
+/**
+ * @function Destructor: release instance data.
+ */
+static void ilocus_index_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pass the next node through, indexing it if it is an iLocus and
+ * writing the index at the end of the input.
+ */
+static int ilocus_index_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_ilocus_index_stream_new(GtNodeStream *in_stream,
+                                          const char *filename)
+{
+  agn_assert(in_stream && filename);
+  GtNodeStream *ns = gt_node_stream_create(ilocus_index_stream_class(), false);
+  AgnIlocusIndexStream *stream = ilocus_index_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->index = agn_ilocus_index_new();
+  stream->filename = gt_cstr_dup(filename);
+  stream->written = false;
+  stream->number_loci = false;
+  stream->numloci = 0;
+  return ns;
+}
+
+void agn_ilocus_index_stream_number_loci(AgnIlocusIndexStream *stream)
+{
+  agn_assert(stream);
+  stream->number_loci = true;
+}
+
+bool agn_ilocus_index_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn = gt_region_node_new(seqid, 1, 3000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(seqid, "locus", 1, 1000, GT_STRAND_BOTH);
+  gt_feature_node_add_attribute((GtFeatureNode *)gn, "Name", "iLocus1");
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(seqid, "locus", 1001, 3000, GT_STRAND_BOTH);
+  gt_feature_node_add_attribute((GtFeatureNode *)gn, "Name", "iLocus2");
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", 1500, 2500,
+                                           GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)gn, (GtFeatureNode *)gene);
+  gt_array_add(nodes, gn);
+  GtUword numnodes = gt_array_size(nodes);
+
+  char filename[] = "/tmp/AgnIlocusIndexStream-XXXXXX";
+  int fd = mkstemp(filename);
+  agn_assert(fd != -1);
+  close(fd);
+
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *iis = agn_ilocus_index_stream_new(ais, filename);
+  agn_ilocus_index_stream_number_loci((AgnIlocusIndexStream *)iis);
+  GtUword count = 0, numids = 0;
+  bool genelocusid = false;
+  int result;
+  while((result = gt_node_stream_next(iis, &gn, error)) == 0 && gn != NULL)
+  {
+    count++;
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    const char *id = fn ? gt_feature_node_get_attribute(fn, "ID") : NULL;
+    if(id != NULL)
+    {
+      numids++;
+      genelocusid = strcmp(id, "locus1") == 0 &&
+                    gt_feature_node_number_of_children(fn) == 1;
+    }
+    gt_genome_node_delete(gn);
+  }
+  gt_node_stream_delete(iis);
+  gt_node_stream_delete(ais);
+  bool test1 = result == 0 && count == numnodes;
+  agn_unit_test_result(test, "pass through", test1);
+  agn_unit_test_result(test, "number loci", numids == 1 && genelocusid);
+
+  AgnIlocusIndex *index = agn_ilocus_index_open(filename, error);
+  GtUword pos;
+  bool test2 = index != NULL && agn_ilocus_index_size(index) == 2 &&
+               agn_ilocus_index_find(index, "iLocus2", &pos) && pos == 1 &&
+               agn_ilocus_index_get(index, pos)->start == 1001;
+  agn_unit_test_result(test, "index", test2);
+  agn_ilocus_index_delete(index);
+  unlink(filename);
+
+  gt_error_delete(error);
+  gt_array_delete(nodes);
+  gt_str_delete(seqid);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *ilocus_index_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, ilocus_index_stream_class_init);
+  return nsc;
+}
+
+static void ilocus_index_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnIlocusIndexStream),
+                                 ilocus_index_stream_free,
+                                 ilocus_index_stream_next);
+}
+
+static void ilocus_index_stream_free(GtNodeStream *ns)
+{
+  AgnIlocusIndexStream *stream = ilocus_index_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  agn_ilocus_index_delete(stream->index);
+  gt_free(stream->filename);
+}
+
+static int ilocus_index_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnIlocusIndexStream *stream = ilocus_index_stream_cast(ns);
+  int result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result)
+    return result;
+
+  if(*gn == NULL)
+  {
+    if(stream->written)
+      return 0;
+    stream->written = true;
+    return agn_ilocus_index_write(stream->index, stream->filename, error);
+  }
+
+  GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+  if(fn == NULL || !gt_feature_node_has_type(fn, "locus"))
+    return 0;
+
+  if(stream->number_loci && gt_feature_node_number_of_children(fn) > 0 &&
+     gt_feature_node_get_attribute(fn, "ID") == NULL)
+  {
+    char locusid[64];
+    snprintf(locusid, sizeof (locusid), "locus%lu", ++stream->numloci);
+    gt_feature_node_set_attribute(fn, "ID", locusid);
+  }
+  agn_ilocus_index_add(stream->index, fn);
+  return 0;
+}
@@ -7,6 +7,7 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include "core/array_api.h"
 #include "AgnFilterStream.h"
 #include "AgnInferCDSVisitor.h"
@@ -69,6 +70,11 @@ static void infer_cds_visitor_check_stop(AgnInferCDSVisitor *v);
  */
 static const GtNodeVisitorClass *infer_cds_visitor_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void infer_cds_visitor_class_init(void);
+
 /**
  * @function Destructor.
  */
@@ -322,8 +328,8 @@ static void infer_cds_visitor_check_start(AgnInferCDSVisitor *v)
 
   if(gt_array_size(v->starts) > 1)
   {
-    gt_logger_log(v->logger, "mRNA '%s' (line %u) has %lu start codons", mrnaid,
-                  ln, gt_array_size(v->starts));
+    agn_logger_log(v->logger, "mRNA '%s' (line %u) has %lu start codons",
+                   mrnaid, ln, gt_array_size(v->starts));
   }
   else if(gt_array_size(v->starts) == 1)
   {
@@ -331,10 +337,10 @@ static void infer_cds_visitor_check_start(AgnInferCDSVisitor *v)
     GtRange testrange = gt_genome_node_get_range(*codon);
     if(gt_range_compare(&startrange, &testrange) != 0)
     {
-      gt_logger_log(v->logger, "start codon inferred from CDS [%lu, %lu] does "
-                    "not match explicitly provided start codon [%lu, %lu] for "
-                    "mRNA '%s'", startrange.start, startrange.end,
-                    testrange.start, testrange.end, mrnaid);
+      agn_logger_log(v->logger, "start codon inferred from CDS [%lu, %lu] does "
+                     "not match explicitly provided start codon [%lu, %lu] for "
+                     "mRNA '%s'", startrange.start, startrange.end,
+                     testrange.start, testrange.end, mrnaid);
     }
   }
   else // agn_assert(gt_array_size(v->starts) == 0)
@@ -375,8 +381,8 @@ static void infer_cds_visitor_check_stop(AgnInferCDSVisitor *v)
 
   if(gt_array_size(v->stops) > 1)
   {
-    gt_logger_log(v->logger, "mRNA '%s' (line %u) has %lu stop codons", mrnaid,
-                  ln, gt_array_size(v->starts));
+    agn_logger_log(v->logger, "mRNA '%s' (line %u) has %lu stop codons", mrnaid,
+                   ln, gt_array_size(v->starts));
   }
   else if(gt_array_size(v->stops) == 1)
   {
@@ -384,10 +390,10 @@ static void infer_cds_visitor_check_stop(AgnInferCDSVisitor *v)
     GtRange testrange = gt_genome_node_get_range(*codon);
     if(gt_range_compare(&stoprange, &testrange) != 0)
     {
-      gt_logger_log(v->logger, "stop codon inferred from CDS [%lu, %lu] does "
-                    "not match explicitly provided stop codon [%lu, %lu] for "
-                    "mRNA '%s'", stoprange.start, stoprange.end,
-                    testrange.start, testrange.end, mrnaid);
+      agn_logger_log(v->logger, "stop codon inferred from CDS [%lu, %lu] does "
+                     "not match explicitly provided stop codon [%lu, %lu] for "
+                     "mRNA '%s'", stoprange.start, stoprange.end,
+                     testrange.start, testrange.end, mrnaid);
     }
   }
   else // agn_assert(gt_array_size(v->stops) == 0)
@@ -405,19 +411,23 @@ static void infer_cds_visitor_check_stop(AgnInferCDSVisitor *v)
   }
 }
 
-static const GtNodeVisitorClass *infer_cds_visitor_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *infer_cds_visitor_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (AgnInferCDSVisitor),
-                                    infer_cds_visitor_free, NULL,
-                                    infer_cds_visitor_visit_feature_node, NULL,
-                                    NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, infer_cds_visitor_class_init);
   return nvc;
 }
 
+static void infer_cds_visitor_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (AgnInferCDSVisitor),
+                                  infer_cds_visitor_free, NULL,
+                                  infer_cds_visitor_visit_feature_node, NULL,
+                                  NULL, NULL);
+}
+
 static void infer_cds_visitor_free(GtNodeVisitor *nv)
 {
   AgnInferCDSVisitor *v = infer_cds_visitor_cast(nv);
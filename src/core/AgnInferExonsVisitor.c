@@ -7,6 +7,7 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include <string.h>
 #include "core/array_api.h"
 #include "core/queue_api.h"
@@ -43,6 +44,11 @@ struct AgnInferExonsVisitor
  */
 static const GtNodeVisitorClass* infer_exons_visitor_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void infer_exons_visitor_class_init(void);
+
 /**
  * @function Destructor.
  */
@@ -186,19 +192,23 @@ bool agn_infer_exons_visitor_unit_test(AgnUnitTest *test)
   return agn_unit_test_success(test);
 }
 
-static const GtNodeVisitorClass* infer_exons_visitor_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *infer_exons_visitor_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (AgnInferExonsVisitor),
-                                    infer_exons_visitor_free, NULL,
-                                    infer_exons_visitor_visit_feature_node,
-                                    NULL, NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, infer_exons_visitor_class_init);
   return nvc;
 }
 
+static void infer_exons_visitor_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (AgnInferExonsVisitor),
+                                  infer_exons_visitor_free, NULL,
+                                  infer_exons_visitor_visit_feature_node,
+                                  NULL, NULL, NULL);
+}
+
 static void infer_exons_visitor_free(GtNodeVisitor *nv)
 {
   AgnInferExonsVisitor *v = infer_exons_visitor_cast(nv);
@@ -322,9 +332,9 @@ infer_exons_visitor_visit_gene_collapse_feature(AgnInferExonsVisitor *v,
       const char *tid = gt_feature_node_get_attribute(mrna, "ID");
       if(strlen(tid) > 1023)
       {
-        gt_logger_log(v->logger, "[AgnInferExonsVisitor::infer_exons_visitor"
-                      "_visit_gene_collapse_feature] mRNA ID is too long (%lu "
-                      "characters), will be truncated\n", strlen(tid));
+        agn_logger_log(v->logger, "[AgnInferExonsVisitor::infer_exons_visitor"
+                       "_visit_gene_collapse_feature] mRNA ID is too long (%lu "
+                       "characters), will be truncated\n", strlen(tid));
       }
       char parentstr[1024];
       strncpy(parentstr, parentattr, 1023);
@@ -359,8 +369,8 @@ infer_exons_visitor_visit_gene_infer_exons(AgnInferExonsVisitor *v)
     bool cds_explicit = gt_array_size(cds) > 0;
     if(!cds_explicit)
     {
-      gt_logger_log(v->logger, "cannot infer missing exons for mRNA '%s' "
-                    "(line %u) without CDS feature(s)", mrnaid, ln);
+      agn_logger_log(v->logger, "cannot infer missing exons for mRNA '%s' "
+                     "(line %u) without CDS feature(s)", mrnaid, ln);
       continue;
     }
 
@@ -428,8 +438,8 @@ infer_exons_visitor_visit_gene_infer_exons(AgnInferExonsVisitor *v)
 
     if(gt_array_size(v->exons) == 0)
     {
-      gt_logger_log(v->logger, "unable to infer exons for mRNA '%s' (line %u)",
-                    mrnaid, ln);
+      agn_logger_log(v->logger, "unable to infer exons for mRNA '%s' (line %u)",
+                     mrnaid, ln);
     }
     gt_array_delete(cds);
     gt_array_delete(utrs);
@@ -470,8 +480,8 @@ infer_exons_visitor_visit_gene_infer_introns(AgnInferExonsVisitor *v)
 
       if(first_range.end == second_range.start - 1)
       {
-        gt_logger_log(v->logger, "mRNA '%s' (line %u) has directly adjacent "
-                      "exons", mrnaid, ln);
+        agn_logger_log(v->logger, "mRNA '%s' (line %u) has directly adjacent "
+                       "exons", mrnaid, ln);
         return;
       }
       else
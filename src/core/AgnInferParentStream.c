@@ -8,6 +8,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <pthread.h>
 #include <string.h>
 #include "extended/feature_node_iterator_api.h"
 #include "AgnInferParentStream.h"
@@ -38,6 +39,11 @@ struct AgnInferParentStream
  */
 static const GtNodeStreamClass* infer_parent_stream_class(void);
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void infer_parent_stream_class_init(void);
+
 /**
  * @function Class destructor.
  */
@@ -88,18 +94,22 @@ void agn_infer_parent_stream_set_source(AgnInferParentStream *stream,
   stream->source = gt_str_ref(source);
 }
 
+static const GtNodeStreamClass *nsc = NULL;
+
 static const GtNodeStreamClass *infer_parent_stream_class(void)
 {
-  static const GtNodeStreamClass *nsc = NULL;
-  if(!nsc)
-  {
-    nsc = gt_node_stream_class_new(sizeof (AgnInferParentStream),
-                                   infer_parent_stream_free,
-                                   infer_parent_stream_next);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, infer_parent_stream_class_init);
   return nsc;
 }
 
+static void infer_parent_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnInferParentStream),
+                                 infer_parent_stream_free,
+                                 infer_parent_stream_next);
+}
+
 static void infer_parent_stream_free(GtNodeStream *ns)
 {
   AgnInferParentStream *stream = infer_parent_stream_cast(ns);
@@ -12,9 +12,49 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "core/array_api.h"
 #include "extended/feature_node_iterator_api.h"
 #include "AgnLocus.h"
+#include "AgnSeqid.h"
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
 
+#define LOCUS_DATA_KEY "agn_locus_data"
+#define LOCUS_ARENA_BLOCK_SIZE 4096
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+/**
+ * @type State associated with a locus for comparative analysis. A locus holds
+ * at most one of these, allocated the first time it is needed, so loci that
+ * are never compared (such as those reported by LocusPocus) carry none of it.
+ * A cloned locus shares the cliques of the original; in this case ``borrowed``
+ * is set and only the comparison stats belong to the clone.
+ *
+ * Clique pairs are allocated from ``arena``, which is released in one step
+ * along with the rest of the state when the locus is deleted. Only the pair
+ * structures come from the arena: the transcript cliques they wrap are
+ * reference-counted feature nodes, and the arrays of pairs and cliques are
+ * allocated as usual.
+ *
+ * None of this state is needed to tell reference features from prediction
+ * features, which are tested for every feature in the locus. The source of
+ * each feature is tagged on the feature itself when it is added to the locus,
+ * using the GenomeTools mark bit: prediction features are marked and reference
+ * features are not. The mark bit of the locus itself is set once it holds any
+ * feature added with a source, so testing the source of a feature never looks
+ * up this state.
+ */
+typedef struct
+{
+  AgnComparison compstats;
+  GtArray *pairs2report;
+  GtArray *uniqrefr;
+  GtArray *uniqpred;
+  AgnArena *arena;
+  bool borrowed;
+} AgnLocusData;
+
+
 //------------------------------------------------------------------------------
 // Prototypes for private functions
 //------------------------------------------------------------------------------
@@ -61,6 +101,23 @@ static GtArray *locus_enumerate_cliques(AgnLocus *locus, GtArray *trans);
 static GtArray *locus_enumerate_pairs(AgnLocus *locus, GtArray *refrcliques,
                                       GtArray *predcliques);
 
+/**
+ * @function Retrieve the comparative analysis state associated with the locus,
+ * or NULL if none has been allocated.
+ */
+static AgnLocusData *locus_data(AgnLocus *locus);
+
+/**
+ * @function Retrieve the comparative analysis state associated with the locus,
+ * allocating it if necessary.
+ */
+static AgnLocusData *locus_data_create(AgnLocus *locus);
+
+/**
+ * @function Destructor for the locus comparative analysis state.
+ */
+static void locus_data_delete(AgnLocusData *data);
+
 /**
  * @function Wrapper for gt_genome_node_get_length, for use in locus filtering.
  */
@@ -70,7 +127,7 @@ static GtUword locus_length(AgnLocus *locus,
 /**
  * @function Determine which clique pairs will actually be reported.
  */
-static void locus_select_pairs(AgnLocus *locus, GtArray *refrcliques,
+static void locus_select_pairs(AgnLocusData *data, GtArray *refrcliques,
                                GtArray *predcliques, GtArray *clique_pairs);
 
 /**
@@ -124,25 +181,11 @@ void agn_locus_add(AgnLocus *locus, GtFeatureNode *feature,
   if(source == DEFAULTSOURCE)
     return;
 
-  GtHashmap *feats = gt_genome_node_get_user_data(locus, "refrfeats");
-  if(feats == NULL)
-  {
-    feats = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
-    gt_genome_node_add_user_data(locus, "refrfeats", feats,
-                                 (GtFree)gt_hashmap_delete);
-  }
+  gt_feature_node_mark((GtFeatureNode *)locus);
   if(source == REFERENCESOURCE)
-    gt_hashmap_add(feats, feature, feature);
-
-  feats = gt_genome_node_get_user_data(locus, "predfeats");
-  if(feats == NULL)
-  {
-    feats = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
-    gt_genome_node_add_user_data(locus, "predfeats", feats,
-                                 (GtFree)gt_hashmap_delete);
-  }
-  if(source == PREDICTIONSOURCE)
-    gt_hashmap_add(feats, feature, feature);
+    gt_feature_node_unmark(feature);
+  else
+    gt_feature_node_mark(feature);
 }
 
 AgnLocus *agn_locus_clone(AgnLocus *locus)
@@ -162,51 +205,21 @@ AgnLocus *agn_locus_clone(AgnLocus *locus)
     gt_feature_node_add_child(newlocusfn, fn);
     locus_update_range(newlocus, fn);
   }
+  if(gt_feature_node_is_marked(locusfn))
+    gt_feature_node_mark(newlocusfn);
 
-  GtHashmap *refr_feats = gt_genome_node_get_user_data(locus, "refrfeats");
-  if(refr_feats != NULL)
+  AgnLocusData *data = locus_data(locus);
+  if(data != NULL)
   {
-    gt_hashmap_ref(refr_feats);
-    gt_genome_node_add_user_data(newlocus, "refrfeats", refr_feats,
-                                 (GtFree)gt_hashmap_delete);
-  }
-  GtHashmap *pred_feats = gt_genome_node_get_user_data(locus, "predfeats");
-  if(pred_feats != NULL)
-  {
-    gt_hashmap_ref(pred_feats);
-    gt_genome_node_add_user_data(newlocus, "predfeats", pred_feats,
-                                 (GtFree)gt_hashmap_delete);
-  }
-
-  GtArray *pairs2report = gt_genome_node_get_user_data(locus, "pairs2report");
-  if(pairs2report != NULL)
-  {
-    gt_array_ref(pairs2report);
-    gt_genome_node_add_user_data(newlocus, "pairs2report", pairs2report,
-                                 (GtFree)gt_array_delete);
-  }
-
-  AgnComparison *compstats = gt_genome_node_get_user_data(locus, "compstats");
-  agn_assert(compstats != NULL);
-  AgnComparison *newstats = gt_malloc( sizeof(AgnComparison) );
-  agn_comparison_init(newstats);
-  agn_comparison_aggregate(newstats, compstats);
-  gt_genome_node_add_user_data(newlocus, "compstats", compstats,
-                               (GtFree)gt_free_func);
-
-  GtArray *uniqrefr = gt_genome_node_get_user_data(locus, "uniqrefr");
-  if(uniqrefr != NULL)
-  {
-    gt_array_ref(uniqrefr);
-    gt_genome_node_add_user_data(newlocus, "uniqrefr", uniqrefr,
-                                 (GtFree)gt_array_delete);
-  }
-  GtArray *uniqpred = gt_genome_node_get_user_data(locus, "uniqpred");
-  if(uniqpred != NULL)
-  {
-    gt_array_ref(uniqpred);
-    gt_genome_node_add_user_data(newlocus, "uniqpred", uniqpred,
-                                 (GtFree)gt_array_delete);
+    AgnLocusData *newdata = locus_data_create(newlocus);
+    agn_comparison_aggregate(&newdata->compstats, &data->compstats);
+    if(data->pairs2report != NULL)
+      newdata->pairs2report = gt_array_ref(data->pairs2report);
+    if(data->uniqrefr != NULL)
+      newdata->uniqrefr = gt_array_ref(data->uniqrefr);
+    if(data->uniqpred != NULL)
+      newdata->uniqpred = gt_array_ref(data->uniqpred);
+    newdata->borrowed = true;
   }
 
   return newlocus;
@@ -228,8 +241,8 @@ GtUword agn_locus_cds_length(AgnLocus *locus, AgnComparisonSource src)
 
 void agn_locus_comparative_analysis(AgnLocus *locus, GtLogger *logger)
 {
-  GtArray *pairs2report = gt_genome_node_get_user_data(locus, "pairs2report");
-  if(pairs2report != NULL)
+  AgnLocusData *data = locus_data_create(locus);
+  if(data->pairs2report != NULL)
     return;
 
   GtArray *refr_trans = agn_locus_refr_mrnas(locus);
@@ -264,7 +277,7 @@ void agn_locus_comparative_analysis(AgnLocus *locus, GtLogger *logger)
 
   GtArray *clique_pairs = locus_enumerate_pairs(locus,refrcliques,predcliques);
   gt_array_sort(clique_pairs, (GtCompare)agn_clique_pair_compare_reverse);
-  locus_select_pairs(locus, refrcliques, predcliques, clique_pairs);
+  locus_select_pairs(data, refrcliques, predcliques, clique_pairs);
 
   gt_array_delete(refrcliques);
   gt_array_delete(predcliques);
@@ -276,10 +289,9 @@ int agn_locus_array_compare(const void *p1, const void *p2)
   AgnLocus *l1 = *(AgnLocus **)p1;
   AgnLocus *l2 = *(AgnLocus **)p2;
 
-  GtStr *seq1 = gt_genome_node_get_seqid(l1);
-  GtStr *seq2 = gt_genome_node_get_seqid(l1);
-  if(gt_str_cmp(seq1, seq2) != 0)
-    return gt_str_cmp(seq1, seq2);
+  int seqcmp = agn_seqid_compare(l1, l2);
+  if(seqcmp != 0)
+    return seqcmp;
 
   GtRange l1r = gt_genome_node_get_range(l1);
   GtRange l2r = gt_genome_node_get_range(l2);
@@ -288,9 +300,9 @@ int agn_locus_array_compare(const void *p1, const void *p2)
 
 void agn_locus_comparison_aggregate(AgnLocus *locus, AgnComparison *comp)
 {
-  AgnComparison *stats = gt_genome_node_get_user_data(locus, "compstats");
-  agn_assert(stats != NULL);
-  agn_comparison_aggregate(comp, stats);
+  AgnLocusData *data = locus_data(locus);
+  if(data != NULL)
+    agn_comparison_aggregate(comp, &data->compstats);
 }
 
 void agn_locus_data_aggregate(AgnLocus *locus, AgnComparisonData *data)
@@ -408,6 +420,7 @@ GtUword agn_locus_exon_num(AgnLocus *locus, AgnComparisonSource src)
 void agn_locus_filter_parse(FILE *filterfile, GtArray *filters)
 {
   char buffer[256];
+  char *saveptr;
 
   agn_assert(filterfile && filters);
   while(fgets(buffer, 255, filterfile))
@@ -415,10 +428,10 @@ void agn_locus_filter_parse(FILE *filterfile, GtArray *filters)
     if(strlen(buffer) == 0 || buffer[0] == '\n' || buffer[0] == '#')
       continue;
 
-    char *filterstr = strtok(buffer, " \n");
-    char *opstr = strtok(NULL, " \n");
-    char *valuestr = strtok(NULL, " \n");
-    char *srcstr = strtok(NULL, " \n");
+    char *filterstr = strtok_r(buffer, " \n", &saveptr);
+    char *opstr = strtok_r(NULL, " \n", &saveptr);
+    char *valuestr = strtok_r(NULL, " \n", &saveptr);
+    char *srcstr = strtok_r(NULL, " \n", &saveptr);
 
     AgnLocusFilter filter;
     if(strcmp(filterstr, "LocusLength") == 0)
@@ -541,12 +554,14 @@ GtArray *agn_locus_get(AgnLocus *locus)
 
 GtArray *agn_locus_get_unique_pred_cliques(AgnLocus *locus)
 {
-  return gt_genome_node_get_user_data(locus, "uniqpred");
+  AgnLocusData *data = locus_data(locus);
+  return data == NULL ? NULL : data->uniqpred;
 }
 
 GtArray *agn_locus_get_unique_refr_cliques(AgnLocus *locus)
 {
-  return gt_genome_node_get_user_data(locus, "uniqrefr");
+  AgnLocusData *data = locus_data(locus);
+  return data == NULL ? NULL : data->uniqrefr;
 }
 
 GtArray *agn_locus_genes(AgnLocus *locus, AgnComparisonSource src)
@@ -560,7 +575,7 @@ GtArray *agn_locus_genes(AgnLocus *locus, AgnComparisonSource src)
       feature  = gt_feature_node_iterator_next(iter))
   {
     bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
+    bool meets_crit = isgene && locus_gene_source_test(locus, feature, src);
     if(isgene && meets_crit)
       gt_array_add(genes, feature);
   }
@@ -580,7 +595,7 @@ GtArray *agn_locus_gene_ids(AgnLocus *locus, AgnComparisonSource src)
       feature  = gt_feature_node_iterator_next(iter))
   {
     bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
+    bool meets_crit = isgene && locus_gene_source_test(locus, feature, src);
     if(isgene && meets_crit)
     {
       const char *id = gt_feature_node_get_attribute(feature, "ID");
@@ -603,7 +618,7 @@ GtUword agn_locus_gene_num(AgnLocus *locus, AgnComparisonSource src)
       feature  = gt_feature_node_iterator_next(iter))
   {
     bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
+    bool meets_crit = isgene && locus_gene_source_test(locus, feature, src);
     if(isgene && meets_crit)
       count++;
   }
@@ -657,7 +672,7 @@ GtArray *agn_locus_mrnas(AgnLocus *locus, AgnComparisonSource src)
       feature  = gt_feature_node_iterator_next(iter))
   {
     bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
+    bool meets_crit = isgene && locus_gene_source_test(locus, feature, src);
     if(!isgene || !meets_crit)
       continue;
 
@@ -688,7 +703,7 @@ GtArray *agn_locus_mrna_ids(AgnLocus *locus, AgnComparisonSource src)
       feature  = gt_feature_node_iterator_next(iter))
   {
     bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
+    bool meets_crit = isgene && locus_gene_source_test(locus, feature, src);
     if(!isgene || !meets_crit)
       continue;
 
@@ -722,7 +737,7 @@ GtUword agn_locus_mrna_num(AgnLocus *locus, AgnComparisonSource src)
       feature  = gt_feature_node_iterator_next(iter))
   {
     bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
+    bool meets_crit = isgene && locus_gene_source_test(locus, feature, src);
     if(!isgene || !meets_crit)
       continue;
 
@@ -745,16 +760,13 @@ GtUword agn_locus_mrna_num(AgnLocus *locus, AgnComparisonSource src)
 AgnLocus *agn_locus_new(GtStr *seqid)
 {
   AgnLocus *locus = gt_feature_node_new(seqid, "locus", 0, 0, GT_STRAND_BOTH);
-  AgnComparison *compstats = gt_malloc( sizeof(AgnComparison) );
-  agn_comparison_init(compstats);
-  gt_genome_node_add_user_data(locus, "compstats", compstats,
-                               (GtFree)gt_free_func);
   return locus;
 }
 
 GtArray *agn_locus_pairs_to_report(AgnLocus *locus)
 {
-  return gt_genome_node_get_user_data(locus, "pairs2report");
+  AgnLocusData *data = locus_data(locus);
+  return data == NULL ? NULL : data->pairs2report;
 }
 
 #ifndef WITHOUT_CAIRO
@@ -995,6 +1007,19 @@ bool agn_locus_unit_test(AgnUnitTest *test)
   c.overall_length  = 3110;
 
   AgnLocus *locus = gt_queue_get(queue);
+  GtArray *refrgenes = agn_locus_refr_genes(locus);
+  GtArray *predgenes = agn_locus_pred_genes(locus);
+  GtArray *allgenes = agn_locus_genes(locus, DEFAULTSOURCE);
+  bool sourcetest = locus_data(locus) == NULL &&
+                    gt_array_size(refrgenes) > 0 &&
+                    gt_array_size(predgenes) > 0 &&
+                    gt_array_size(refrgenes) + gt_array_size(predgenes) ==
+                    gt_array_size(allgenes);
+  agn_unit_test_result(test, "source without comparison data", sourcetest);
+  gt_array_delete(refrgenes);
+  gt_array_delete(predgenes);
+  gt_array_delete(allgenes);
+
   agn_locus_comparative_analysis(locus, logger);
   AgnComparison stats;
   agn_comparison_init(&stats);
@@ -1217,6 +1242,10 @@ static GtArray *locus_enumerate_pairs(AgnLocus *locus, GtArray *refrcliques,
 {
   agn_assert(refrcliques != NULL && predcliques != NULL);
 
+  AgnLocusData *data = locus_data_create(locus);
+  if(data->arena == NULL)
+    data->arena = agn_arena_new(LOCUS_ARENA_BLOCK_SIZE);
+
   GtArray *clique_pairs = gt_array_new( sizeof(AgnCliquePair *) );
   GtUword i,j;
   for(i = 0; i < gt_array_size(refrcliques); i++)
@@ -1226,7 +1255,9 @@ static GtArray *locus_enumerate_pairs(AgnLocus *locus, GtArray *refrcliques,
     for(j = 0; j < gt_array_size(predcliques); j++)
     {
       pred_clique = *(AgnTranscriptClique**)gt_array_get(predcliques, j);
-      AgnCliquePair *pair = agn_clique_pair_new(refr_clique, pred_clique);
+      AgnCliquePair *pair = agn_clique_pair_new_in_arena(data->arena,
+                                                         refr_clique,
+                                                         pred_clique);
       gt_array_add(clique_pairs, pair);
     }
   }
@@ -1234,20 +1265,64 @@ static GtArray *locus_enumerate_pairs(AgnLocus *locus, GtArray *refrcliques,
   return clique_pairs;
 }
 
+static AgnLocusData *locus_data(AgnLocus *locus)
+{
+  return gt_genome_node_get_user_data(locus, LOCUS_DATA_KEY);
+}
+
+static AgnLocusData *locus_data_create(AgnLocus *locus)
+{
+  AgnLocusData *data = locus_data(locus);
+  if(data != NULL)
+    return data;
+
+  data = gt_malloc( sizeof(AgnLocusData) );
+  agn_comparison_init(&data->compstats);
+  data->pairs2report = NULL;
+  data->uniqrefr = NULL;
+  data->uniqpred = NULL;
+  data->arena = NULL;
+  data->borrowed = false;
+  gt_genome_node_add_user_data(locus, LOCUS_DATA_KEY, data,
+                               (GtFree)locus_data_delete);
+  return data;
+}
+
+static void locus_data_delete(AgnLocusData *data)
+{
+  if(data->borrowed)
+  {
+    gt_array_delete(data->pairs2report);
+    gt_array_delete(data->uniqrefr);
+    gt_array_delete(data->uniqpred);
+  }
+  else
+  {
+    if(data->pairs2report != NULL)
+      locus_clique_pair_array_delete(data->pairs2report);
+    if(data->uniqrefr != NULL)
+      locus_clique_array_delete(data->uniqrefr);
+    if(data->uniqpred != NULL)
+      locus_clique_array_delete(data->uniqpred);
+    if(data->arena != NULL)
+      agn_arena_delete(data->arena);
+  }
+  gt_free(data);
+}
+
 static GtUword locus_length(AgnLocus *locus,
                             GT_UNUSED AgnComparisonSource source)
 {
   return gt_genome_node_get_length(locus);
 }
 
-static void locus_select_pairs(AgnLocus *locus, GtArray *refrcliques,
+static void locus_select_pairs(AgnLocusData *data, GtArray *refrcliques,
                                GtArray *predcliques, GtArray *clique_pairs)
 {
   GtHashmap *refrcliques_acctd = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
   GtHashmap *predcliques_acctd = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
 
-  AgnComparison *stats = gt_genome_node_get_user_data(locus, "compstats");
-  agn_assert(stats != NULL);
+  AgnComparison *stats = &data->compstats;
   GtArray *pairs2report = gt_array_new( sizeof(AgnCliquePair *) );
   GtUword i;
   for(i = 0; i < gt_array_size(clique_pairs); i++)
@@ -1268,9 +1343,7 @@ static void locus_select_pairs(AgnLocus *locus, GtArray *refrcliques,
       agn_transcript_clique_put_ids_in_hash(pclique, predcliques_acctd);
     }
   }
-  gt_genome_node_add_user_data(locus,"pairs2report",gt_array_ref(pairs2report),
-                               (GtFree)locus_clique_pair_array_delete);
-  gt_array_delete(pairs2report);
+  data->pairs2report = pairs2report;
   agn_comparison_resolve(stats);
 
   GtArray *uniqrefr = gt_array_new( sizeof(AgnTranscriptClique *) );
@@ -1287,11 +1360,9 @@ static void locus_select_pairs(AgnLocus *locus, GtArray *refrcliques,
     agn_transcript_clique_delete(refr_clique);
   }
   if(gt_array_size(uniqrefr) > 0)
-  {
-    gt_genome_node_add_user_data(locus, "uniqrefr", gt_array_ref(uniqrefr),
-                                 (GtFree)locus_clique_array_delete);
-  }
-  gt_array_delete(uniqrefr);
+    data->uniqrefr = uniqrefr;
+  else
+    gt_array_delete(uniqrefr);
 
   GtArray *uniqpred = gt_array_new( sizeof(AgnTranscriptClique *) );
   for(i = 0; i < gt_array_size(predcliques); i++)
@@ -1307,11 +1378,9 @@ static void locus_select_pairs(AgnLocus *locus, GtArray *refrcliques,
     agn_transcript_clique_delete(pred_clique);
   }
   if(gt_array_size(uniqpred) > 0)
-  {
-    gt_genome_node_add_user_data(locus, "uniqpred", gt_array_ref(uniqpred),
-                                 (GtFree)locus_clique_array_delete);
-  }
-  gt_array_delete(uniqpred);
+    data->uniqpred = uniqpred;
+  else
+    gt_array_delete(uniqpred);
 
   gt_hashmap_delete(refrcliques_acctd);
   gt_hashmap_delete(predcliques_acctd);
@@ -1429,16 +1498,12 @@ static bool locus_gene_source_test(AgnLocus *locus, GtFeatureNode *transcript,
   if(source == DEFAULTSOURCE)
     return true;
 
-  GtHashmap *refr_feats = gt_genome_node_get_user_data(locus, "refrfeats");
-  GtHashmap *pred_feats = gt_genome_node_get_user_data(locus, "predfeats");
-  bool inrefr = (gt_hashmap_get(refr_feats, transcript) != NULL);
-  bool inpred = (gt_hashmap_get(pred_feats, transcript) != NULL);
-  if(source == REFERENCESOURCE  && inrefr)
-    return true;
-  else if(source == PREDICTIONSOURCE && inpred)
-    return true;
+  if(!gt_feature_node_is_marked((GtFeatureNode *)locus))
+    return false;
 
-  return false;
+  if(source == REFERENCESOURCE)
+    return !gt_feature_node_is_marked(transcript);
+  return gt_feature_node_is_marked(transcript);
 }
 
 static void locus_update_range(AgnLocus *locus, GtFeatureNode *transcript)
@@ -7,8 +7,10 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include "AgnLocusFilterStream.h"
 #include "AgnLocus.h"
+#include "AgnUtils.h"
 
 //------------------------------------------------------------------------------
 // Data structure definition
@@ -34,6 +36,11 @@ struct AgnLocusFilterStream
  */
 static const GtNodeStreamClass* locus_filter_stream_class(void);
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void locus_filter_stream_class_init(void);
+
 /**
  * @function Class destructor.
  */
@@ -69,18 +76,22 @@ GtNodeStream* agn_locus_filter_stream_new(GtNodeStream *in_stream,
   return ns;
 }
 
+static const GtNodeStreamClass *nsc = NULL;
+
 static const GtNodeStreamClass *locus_filter_stream_class(void)
 {
-  static const GtNodeStreamClass *nsc = NULL;
-  if(!nsc)
-  {
-    nsc = gt_node_stream_class_new(sizeof (AgnLocusFilterStream),
-                                   locus_filter_stream_free,
-                                   locus_filter_stream_next);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, locus_filter_stream_class_init);
   return nsc;
 }
 
+static void locus_filter_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnLocusFilterStream),
+                                 locus_filter_stream_free,
+                                 locus_filter_stream_next);
+}
+
 static void locus_filter_stream_free(GtNodeStream *ns)
 {
   AgnLocusFilterStream *stream = locus_filter_stream_cast(ns);
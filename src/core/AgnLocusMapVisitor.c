@@ -7,6 +7,7 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include "AgnLocusMapVisitor.h"
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
@@ -35,6 +36,11 @@ struct AgnLocusMapVisitor
  */
 static const GtNodeVisitorClass *locus_map_visitor_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void locus_map_visitor_class_init(void);
+
 /**
  * @function FIXME
  */
@@ -62,17 +68,21 @@ GtNodeVisitor *agn_locus_map_visitor_new(FILE *genefh, FILE *mrnafh)
   return nv;
 }
 
-static const GtNodeVisitorClass *locus_map_visitor_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *locus_map_visitor_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (AgnLocusMapVisitor), NULL, NULL,
-                                    visit_feature_node, NULL, NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, locus_map_visitor_class_init);
   return nvc;
 }
 
+static void locus_map_visitor_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (AgnLocusMapVisitor), NULL, NULL,
+                                  visit_feature_node, NULL, NULL, NULL);
+}
+
 static int
 visit_feature_node(GtNodeVisitor *nv, GtFeatureNode *fn, GtError *error)
 {
@@ -0,0 +1,343 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "extended/array_in_stream_api.h"
+#include "AgnLocusOutStream.h"
+#include "AgnUtils.h"
+
+#define locus_out_stream_cast(GS)\
+        gt_node_stream_cast(locus_out_stream_class(), GS)
+
+// Output is buffered until it reaches this many bytes
+#define LOCUS_OUT_BUFFER_SIZE 1048576
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnLocusOutStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtFile *outfile;
+  GtStr *buffer;
+  bool version_shown;
+  bool fasta_shown;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *locus_out_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void locus_out_stream_class_init(void);
+
+/**
+ * @function Write any buffered output to the output file.
+ */
+static void locus_out_stream_flush(AgnLocusOutStream *stream);
+
+/**
+ * @function Destructor: flush any remaining output and release instance data.
+ */
+static void locus_out_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pass the next node through, writing it to the output buffer.
+ */
+static int locus_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                 GtError *error);
+
+/**
+ * @function Append a single GFF3 line for the given feature to the output
+ * buffer. Subfeatures are ignored.
+ */
+static void locus_out_stream_write_feature(AgnLocusOutStream *stream,
+                                           GtFeatureNode *fn);
+
+/**
+ * @function Append the given node to the output buffer.
+ */
+static void locus_out_stream_write_node(AgnLocusOutStream *stream,
+                                        GtGenomeNode *gn);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_locus_out_stream_new(GtNodeStream *in_stream,
+                                       GtFile *outfile)
+{
+  agn_assert(in_stream);
+  GtNodeStream *ns = gt_node_stream_create(locus_out_stream_class(), false);
+  AgnLocusOutStream *stream = locus_out_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->outfile = outfile;
+  stream->buffer = gt_str_new();
+  stream->version_shown = false;
+  stream->fasta_shown = false;
+  return ns;
+}
+
+bool agn_locus_out_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtStr *source = gt_str_new_cstr("AEGeAn");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn = gt_comment_node_new("!gff-spec-version 1.20");
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(seqid, 1, 3000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(seqid, "locus", 1, 1000, GT_STRAND_BOTH);
+  gt_feature_node_set_source((GtFeatureNode *)gn, source);
+  gt_feature_node_add_attribute((GtFeatureNode *)gn, "iLocus_type", "fiLocus");
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(seqid, "locus", 1001, 3000, GT_STRAND_FORWARD);
+  gt_feature_node_add_attribute((GtFeatureNode *)gn, "ID", "locus2");
+  gt_feature_node_add_attribute((GtFeatureNode *)gn, "child_gene", "1");
+  gt_feature_node_add_attribute((GtFeatureNode *)gn, "iLocus_type", "siLocus");
+  gt_feature_node_set_score((GtFeatureNode *)gn, 0.25);
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", 1500, 2500,
+                                           GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)gn, (GtFeatureNode *)gene);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(seqid, "locus", 2001, 3000, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  GtUword numnodes = gt_array_size(nodes);
+
+  char *buffer;
+  size_t buffersize;
+  FILE *outfp = open_memstream(&buffer, &buffersize);
+  GtFile *outfile = gt_file_new_from_fileptr(outfp);
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *los = agn_locus_out_stream_new(ais, outfile);
+  GtUword count = 0;
+  int result;
+  while((result = gt_node_stream_next(los, &gn, error)) == 0 && gn != NULL)
+  {
+    count++;
+    gt_genome_node_delete(gn);
+  }
+  gt_node_stream_delete(los);
+  gt_node_stream_delete(ais);
+  gt_file_delete_without_handle(outfile);
+  fclose(outfp);
+
+  bool test1 = result == 0 && count == numnodes;
+  agn_unit_test_result(test, "pass through", test1);
+
+  const char *exp = "##gff-version 3\n"
+                    "#!gff-spec-version 1.20\n"
+                    "##sequence-region   chr1 1 3000\n"
+                    "chr1\tAEGeAn\tlocus\t1\t1000\t.\t.\t.\t"
+                    "iLocus_type=fiLocus\n"
+                    "chr1\t.\tlocus\t1001\t3000\t0.25\t+\t.\t"
+                    "child_gene=1;iLocus_type=siLocus\n"
+                    "chr1\t.\tlocus\t2001\t3000\t.\t-\t.\t.\n";
+  bool test2 = strcmp(buffer, exp) == 0;
+  agn_unit_test_result(test, "output", test2);
+
+  free(buffer);
+  gt_error_delete(error);
+  gt_array_delete(nodes);
+  gt_str_delete(source);
+  gt_str_delete(seqid);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *locus_out_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, locus_out_stream_class_init);
+  return nsc;
+}
+
+static void locus_out_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnLocusOutStream),
+                                 locus_out_stream_free,
+                                 locus_out_stream_next);
+}
+
+static void locus_out_stream_flush(AgnLocusOutStream *stream)
+{
+  GtUword length = gt_str_length(stream->buffer);
+  if(length == 0)
+    return;
+
+  gt_file_xwrite(stream->outfile, gt_str_get(stream->buffer), length);
+  gt_str_reset(stream->buffer);
+}
+
+static void locus_out_stream_free(GtNodeStream *ns)
+{
+  AgnLocusOutStream *stream = locus_out_stream_cast(ns);
+  locus_out_stream_flush(stream);
+  gt_node_stream_delete(stream->in_stream);
+  gt_str_delete(stream->buffer);
+}
+
+static int locus_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                 GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnLocusOutStream *stream = locus_out_stream_cast(ns);
+  int result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result)
+    return result;
+
+  if(*gn == NULL)
+  {
+    locus_out_stream_flush(stream);
+    return 0;
+  }
+
+  locus_out_stream_write_node(stream, *gn);
+  if(gt_str_length(stream->buffer) >= LOCUS_OUT_BUFFER_SIZE)
+    locus_out_stream_flush(stream);
+  return 0;
+}
+
+static void locus_out_stream_write_feature(AgnLocusOutStream *stream,
+                                           GtFeatureNode *fn)
+{
+  GtGenomeNode *gn = (GtGenomeNode *)fn;
+  GtStr *buffer = stream->buffer;
+  gt_str_append_str(buffer, gt_genome_node_get_seqid(gn));
+  gt_str_append_char(buffer, '\t');
+  gt_str_append_cstr(buffer, gt_feature_node_get_source(fn));
+  gt_str_append_char(buffer, '\t');
+  gt_str_append_cstr(buffer, gt_feature_node_get_type(fn));
+  gt_str_append_char(buffer, '\t');
+  gt_str_append_uword(buffer, gt_genome_node_get_start(gn));
+  gt_str_append_char(buffer, '\t');
+  gt_str_append_uword(buffer, gt_genome_node_get_end(gn));
+  gt_str_append_char(buffer, '\t');
+  if(gt_feature_node_score_is_defined(fn))
+  {
+    char score[32];
+    snprintf(score, sizeof (score), "%.3g", gt_feature_node_get_score(fn));
+    gt_str_append_cstr(buffer, score);
+  }
+  else
+    gt_str_append_char(buffer, '.');
+  gt_str_append_char(buffer, '\t');
+  gt_str_append_char(buffer, GT_STRAND_CHARS[gt_feature_node_get_strand(fn)]);
+  gt_str_append_char(buffer, '\t');
+  gt_str_append_char(buffer, GT_PHASE_CHARS[gt_feature_node_get_phase(fn)]);
+  gt_str_append_char(buffer, '\t');
+
+  GtStrArray *attrs = gt_feature_node_get_attribute_list(fn);
+  bool shown = false;
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(attrs); i++)
+  {
+    const char *key = gt_str_array_get(attrs, i);
+    if(strcmp(key, "ID") == 0 || strcmp(key, "Parent") == 0)
+      continue;
+    if(shown)
+      gt_str_append_char(buffer, ';');
+    gt_str_append_cstr(buffer, key);
+    gt_str_append_char(buffer, '=');
+    gt_str_append_cstr(buffer, gt_feature_node_get_attribute(fn, key));
+    shown = true;
+  }
+  gt_str_array_delete(attrs);
+  if(!shown)
+    gt_str_append_char(buffer, '.');
+  gt_str_append_char(buffer, '\n');
+}
+
+static void locus_out_stream_write_node(AgnLocusOutStream *stream,
+                                        GtGenomeNode *gn)
+{
+  if(gt_eof_node_try_cast(gn))
+    return;
+
+  GtStr *buffer = stream->buffer;
+  if(!stream->version_shown)
+  {
+    gt_str_append_cstr(buffer, "##gff-version 3\n");
+    stream->version_shown = true;
+  }
+
+  GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+  if(fn != NULL)
+  {
+    locus_out_stream_write_feature(stream, fn);
+    return;
+  }
+
+  if(gt_region_node_try_cast(gn))
+  {
+    gt_str_append_cstr(buffer, "##sequence-region   ");
+    gt_str_append_str(buffer, gt_genome_node_get_seqid(gn));
+    gt_str_append_char(buffer, ' ');
+    gt_str_append_uword(buffer, gt_genome_node_get_start(gn));
+    gt_str_append_char(buffer, ' ');
+    gt_str_append_uword(buffer, gt_genome_node_get_end(gn));
+    gt_str_append_char(buffer, '\n');
+    return;
+  }
+
+  GtCommentNode *cn = gt_comment_node_try_cast(gn);
+  if(cn != NULL)
+  {
+    gt_str_append_char(buffer, '#');
+    gt_str_append_cstr(buffer, gt_comment_node_get_comment(cn));
+    gt_str_append_char(buffer, '\n');
+    return;
+  }
+
+  GtMetaNode *mn = gt_meta_node_try_cast(gn);
+  if(mn != NULL)
+  {
+    gt_str_append_cstr(buffer, "##");
+    gt_str_append_cstr(buffer, gt_meta_node_get_directive(mn));
+    if(gt_meta_node_get_data(mn) != NULL)
+    {
+      gt_str_append_char(buffer, ' ');
+      gt_str_append_cstr(buffer, gt_meta_node_get_data(mn));
+    }
+    gt_str_append_char(buffer, '\n');
+    return;
+  }
+
+  GtSequenceNode *sn = gt_sequence_node_try_cast(gn);
+  if(sn != NULL)
+  {
+    if(!stream->fasta_shown)
+    {
+      gt_str_append_cstr(buffer, "##FASTA\n");
+      stream->fasta_shown = true;
+    }
+    gt_str_append_char(buffer, '>');
+    gt_str_append_cstr(buffer, gt_sequence_node_get_description(sn));
+    gt_str_append_char(buffer, '\n');
+    gt_str_append_cstr_nt(buffer, gt_sequence_node_get_sequence(sn),
+                          gt_sequence_node_get_sequence_length(sn));
+    gt_str_append_char(buffer, '\n');
+  }
+}
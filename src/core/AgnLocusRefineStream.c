@@ -8,6 +8,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <pthread.h>
 #include <string.h>
 #include <math.h>
 #include "core/queue_api.h"
@@ -41,6 +42,19 @@ struct AgnLocusRefineStream
   FILE *ilenfile;
 };
 
+/**
+ * @type Per-feature data used while binning the children of a locus. The
+ * ``range`` is the range used to test for overlap: the CDS range for coding
+ * features when binning by CDS, the full feature range otherwise.
+ */
+typedef struct
+{
+  GtGenomeNode *gn;
+  GtRange fullrange;
+  GtRange range;
+  bool coding;
+} AgnRefineBinFeature;
+
 //------------------------------------------------------------------------------
 // Prototypes for private functions
 //------------------------------------------------------------------------------
@@ -54,6 +68,14 @@ static
 GtArray *locus_refine_stream_bin_features(AgnLocusRefineStream *stream,
                                           GtFeatureNode *locus);
 
+/**
+ * @function Same test as ``agn_overlap_ilocus``, applied to the overlap ranges
+ * computed for two features of the same locus.
+ */
+static bool locus_refine_stream_bin_overlap(AgnLocusRefineStream *stream,
+                                            AgnRefineBinFeature *f1,
+                                            AgnRefineBinFeature *f2);
+
 /**
  * @function Look for intron genes: a gene contained completely within the
  * intron of another gene. Currently does not support identifying cases where
@@ -67,6 +89,11 @@ static bool refine_locus_check_intron_genes(AgnLocusRefineStream *stream,
  */
 static const GtNodeStreamClass *locus_refine_stream_class(void);
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void locus_refine_stream_class_init(void);
+
 /**
  * @function Analogous to the AgnLocusStream class' extend function.
  */
@@ -115,12 +142,32 @@ static int locus_refine_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
 static GtArray *locus_refine_stream_resolve_bins(AgnLocusRefineStream *stream,
                                                  GtArray *bins);
 
+/**
+ * @function Bin the given genes with the given settings and check that bins
+ * are formed as expected: ``binsizes`` gives the number of genes in each bin,
+ * in order, terminated by 0.
+ */
+static bool locus_refine_stream_test_bins(GtFeatureNode **genes,
+                                          GtUword numgenes,
+                                          GtUword minoverlap, bool by_cds,
+                                          const GtUword *binsizes);
+
 /**
  * @function Load data for unit tests.
  */
 static void locus_refine_stream_test_data(const char *filename, GtQueue *queue,
                                           GtUword delta);
 
+/**
+ * @function Create a gene for unit tests, with a single exon spanning the
+ * gene and, if ``cdsend`` is not 0, a coding sequence.
+ */
+static GtFeatureNode *locus_refine_stream_test_gene(GtStr *seqid,
+                                                    GtUword start,
+                                                    GtUword end,
+                                                    GtUword cdsstart,
+                                                    GtUword cdsend);
+
 //------------------------------------------------------------------------------
 // Method definitions
 //------------------------------------------------------------------------------
@@ -222,6 +269,36 @@ bool agn_locus_refine_stream_unit_test(AgnUnitTest *test)
   agn_unit_test_result(test, "Megachile rotundata CST: elen", test2a);
   gt_queue_delete(queue);
 
+  // A non-coding gene between two coding genes separates them, even though
+  // their coding sequences overlap.
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtFeatureNode *genes[4];
+  genes[0] = locus_refine_stream_test_gene(seqid, 1000, 5000, 1200, 4800);
+  genes[1] = locus_refine_stream_test_gene(seqid, 2000, 3000, 0, 0);
+  genes[2] = locus_refine_stream_test_gene(seqid, 4000, 8000, 4500, 7500);
+  GtUword interleaved[] = { 1, 1, 1, 0 };
+  bool test3 = locus_refine_stream_test_bins(genes, 3, 1, true, interleaved);
+  agn_unit_test_result(test, "interleaved coding, non-coding", test3);
+
+  // Adjacent genes are binned together only if they overlap by at least
+  // ``minoverlap`` bp.
+  genes[0] = locus_refine_stream_test_gene(seqid, 1000, 2000, 0, 0);
+  genes[1] = locus_refine_stream_test_gene(seqid, 1950, 3000, 0, 0);
+  genes[2] = locus_refine_stream_test_gene(seqid, 2990, 4000, 0, 0);
+  genes[3] = locus_refine_stream_test_gene(seqid, 3900, 5000, 0, 0);
+  GtUword minoverlap50[] = { 2, 2, 0 };
+  bool test4 = locus_refine_stream_test_bins(genes, 4, 50, false,
+                                             minoverlap50);
+  genes[0] = locus_refine_stream_test_gene(seqid, 1000, 2000, 0, 0);
+  genes[1] = locus_refine_stream_test_gene(seqid, 1950, 3000, 0, 0);
+  genes[2] = locus_refine_stream_test_gene(seqid, 2990, 4000, 0, 0);
+  genes[3] = locus_refine_stream_test_gene(seqid, 3900, 5000, 0, 0);
+  GtUword minoverlap1[] = { 4, 0 };
+  test4 = test4 && locus_refine_stream_test_bins(genes, 4, 1, false,
+                                                 minoverlap1);
+  agn_unit_test_result(test, "minimum overlap", test4);
+  gt_str_delete(seqid);
+
   return agn_unit_test_success(test);
 }
 
@@ -229,44 +306,92 @@ static
 GtArray *locus_refine_stream_bin_features(AgnLocusRefineStream *stream,
                                           GtFeatureNode *locus)
 {
-  GtArray *features = agn_feature_node_get_children(locus);
-  GtUword numfeatures = gt_array_size(features);
+  GtArray *children = agn_feature_node_get_children(locus);
+  GtUword numfeatures = gt_array_size(children);
   agn_assert(numfeatures >= 2);
 
+  // Compute each feature's overlap range once, rather than walking the
+  // feature's subtree for every pairwise comparison.
+  AgnRefineBinFeature *features =
+      gt_malloc( sizeof(AgnRefineBinFeature) * numfeatures );
+  GtUword i, j;
+  for(i = 0; i < numfeatures; i++)
+  {
+    AgnRefineBinFeature *feature = features + i;
+    feature->gn = *(GtGenomeNode **)gt_array_get(children, i);
+    feature->fullrange = gt_genome_node_get_range(feature->gn);
+    feature->range = feature->fullrange;
+    feature->coding = false;
+    if(stream->by_cds)
+    {
+      GtRange cdsrange =
+          agn_feature_node_get_cds_range((GtFeatureNode *)feature->gn);
+      if(cdsrange.end != 0)
+      {
+        feature->range = cdsrange;
+        feature->coding = true;
+      }
+    }
+  }
+  gt_array_delete(children);
+
+  // Each feature joins the most recent bin if it overlaps any member of that
+  // bin, and starts a new bin otherwise. A feature can only overlap a member
+  // if it starts before the largest end coordinate among the members of its
+  // class (or, for a polycistron, among the full ranges of the coding
+  // members), so most features that start a new bin are not compared with
+  // each member.
   GtArray *bins = gt_array_new( sizeof(GtArray *) );
   GtArray *bin = gt_array_new( sizeof(GtGenomeNode *) );
-  GtGenomeNode **g1 = gt_array_get(features, 0);
-  gt_array_add(bin, *g1);
+  gt_array_add(bin, features[0].gn);
   gt_array_add(bins, bin);
-
-  GtUword i, j, current_bin = 0;
+  GtUword binstart = 0;
+  GtUword maxend[2] = { 0, 0 };
+  GtUword maxfullend = features[0].coding ? features[0].fullrange.end : 0;
+  maxend[features[0].coding] = features[0].range.end;
   for(i = 1; i < numfeatures; i++)
   {
-    GtGenomeNode **gn = gt_array_get(features, i);
-    bin = *(GtArray **)gt_array_get(bins, current_bin);
+    AgnRefineBinFeature *feature = features + i;
     bool overlaps = false;
-    for(j = 0; j < gt_array_size(bin); j++)
+    if(feature->range.start <= maxend[feature->coding] ||
+       (feature->coding && feature->fullrange.start <= maxfullend))
     {
-      GtGenomeNode **test_gn = gt_array_get(bin, j);
-      if(agn_overlap_ilocus(*gn, *test_gn, stream->minoverlap, stream->by_cds))
-      {
-        overlaps = true;
-        gt_array_add(bin, *gn);
-        break;
-      }
+      for(j = i; j > binstart && !overlaps; j--)
+        overlaps = locus_refine_stream_bin_overlap(stream, feature,
+                                                   features + j - 1);
     }
+
     if(!overlaps)
     {
-      bin = gt_array_new( sizeof(GtFeatureNode *) );
-      gt_array_add(bin, *gn);
+      bin = gt_array_new( sizeof(GtGenomeNode *) );
       gt_array_add(bins, bin);
-      current_bin++;
+      binstart = i;
+      maxend[0] = maxend[1] = maxfullend = 0;
     }
+    gt_array_add(bin, feature->gn);
+    if(feature->range.end > maxend[feature->coding])
+      maxend[feature->coding] = feature->range.end;
+    if(feature->coding && feature->fullrange.end > maxfullend)
+      maxfullend = feature->fullrange.end;
   }
-  gt_array_delete(features);
+  gt_free(features);
   return bins;
 }
 
+static bool locus_refine_stream_bin_overlap(AgnLocusRefineStream *stream,
+                                            AgnRefineBinFeature *f1,
+                                            AgnRefineBinFeature *f2)
+{
+  if(f1->coding != f2->coding)
+    return false;
+
+  // Polycistrons belong together
+  if(f1->coding && gt_range_compare(&f1->fullrange, &f2->fullrange) == 0)
+    return true;
+
+  return gt_range_overlap_delta(&f1->range, &f2->range, stream->minoverlap);
+}
+
 static bool refine_locus_check_intron_genes(AgnLocusRefineStream *stream,
                                             GtArray *bin, GtArray *iloci)
 {
@@ -329,18 +454,22 @@ static bool refine_locus_check_intron_genes(AgnLocusRefineStream *stream,
   return true;
 }
 
+static const GtNodeStreamClass *nsc = NULL;
+
 static const GtNodeStreamClass *locus_refine_stream_class(void)
 {
-  static const GtNodeStreamClass *nsc = NULL;
-  if(!nsc)
-  {
-    nsc = gt_node_stream_class_new(sizeof (AgnLocusRefineStream),
-                                   locus_refine_stream_free,
-                                   locus_refine_stream_next);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, locus_refine_stream_class_init);
   return nsc;
 }
 
+static void locus_refine_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnLocusRefineStream),
+                                 locus_refine_stream_free,
+                                 locus_refine_stream_next);
+}
+
 static void locus_refine_stream_extend(AgnLocusRefineStream *stream,
                                        GtArray *iloci, AgnLocus *orig)
 {
@@ -362,51 +491,23 @@ static void locus_refine_stream_extend(AgnLocusRefineStream *stream,
   GtUword numloci = gt_array_size(iloci);
   agn_assert(numloci > 0);
 
+  GtRange *ranges = gt_malloc( sizeof(GtRange) * numloci );
   GtUword i;
   for(i = 0; i < numloci; i++)
+  {
+    GtGenomeNode **gn = gt_array_get(iloci, i);
+    ranges[i] = gt_genome_node_get_range(*gn);
+  }
+  agn_ilocus_refine(ranges, numloci, &origrange, stream->delta);
+  for(i = 0; i < numloci; i++)
   {
     GtGenomeNode **gn = gt_array_get(iloci, i);
     GtFeatureNode *fn = gt_feature_node_cast(*gn);
-    GtRange gnrange = gt_genome_node_get_range(*gn);
-    if(origrange.start + stream->delta > gnrange.start)
-      gnrange.start = origrange.start;
-    else
-      gnrange.start -= stream->delta;
-    if(gnrange.end + stream->delta > origrange.end)
-      gnrange.end = origrange.end;
-    else
-      gnrange.end += stream->delta;
-
-    agn_locus_set_range(*gn, gnrange.start, gnrange.end);
-    agn_assert(gt_range_contains(&origrange, &gnrange));
+    agn_locus_set_range(*gn, ranges[i].start, ranges[i].end);
     gt_feature_node_set_source(fn, stream->source);
     gt_queue_add(stream->locusqueue, *gn);
   }
-
-  // Close any remaining gaps
-  GtGenomeNode **llocus = gt_array_get(iloci, 0);
-  GtGenomeNode **rlocus = gt_array_get(iloci, numloci-1);
-  GtRange lrange = gt_genome_node_get_range(*llocus);
-  GtRange rrange = gt_genome_node_get_range(*rlocus);
-  if(numloci > 1)
-  {
-    for(i = numloci - 1; i > 0; i--)
-    {
-      GtGenomeNode **testlocus = gt_array_get(iloci, i-1);
-      GtRange testrange = gt_genome_node_get_range(*testlocus);
-      if(testrange.end > rrange.end)
-      {
-        rlocus = testlocus;
-        rrange = testrange;
-      }
-    }
-  }
-
-  if(lrange.start > origrange.start)
-    agn_locus_set_range(*llocus, origrange.start, lrange.end);
-
-  if(rrange.end < origrange.end)
-    agn_locus_set_range(*rlocus, rrange.start, origrange.end);
+  gt_free(ranges);
 
   // Determine whether all of the iLoci are coding or if all are non-coding.
   // If so, that makes our job easier. If not, we only handle the simple case
@@ -738,7 +839,8 @@ static void locus_refine_stream_mint(AgnLocusRefineStream *stream,
   if(stream->nameformat)
   {
     char locusname[256];
-    sprintf(locusname, gt_str_get(stream->nameformat), stream->count);
+    snprintf(locusname, sizeof (locusname), gt_str_get(stream->nameformat),
+             stream->count);
     gt_feature_node_set_attribute((GtFeatureNode *)locus, "Name", locusname);
   }
 
@@ -882,6 +984,53 @@ static GtArray *locus_refine_stream_resolve_bins(AgnLocusRefineStream *stream,
   return iloci;
 }
 
+static bool locus_refine_stream_test_bins(GtFeatureNode **genes,
+                                          GtUword numgenes,
+                                          GtUword minoverlap, bool by_cds,
+                                          const GtUword *binsizes)
+{
+  GtError *error = gt_error_new();
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtUword progress = 0;
+  GtNodeStream *arraystream = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *ns = agn_locus_refine_stream_new(arraystream, 0, minoverlap,
+                                                 by_cds);
+  AgnLocusRefineStream *stream = locus_refine_stream_cast(ns);
+
+  AgnLocus *locus = agn_locus_new(gt_genome_node_get_seqid((GtGenomeNode *)
+                                                           genes[0]));
+  GtUword i;
+  for(i = 0; i < numgenes; i++)
+    agn_locus_add_feature(locus, genes[i]);
+
+  // Genes are expected in bins of the given sizes, in the order given.
+  GtArray *bins = locus_refine_stream_bin_features(stream,
+                                                   (GtFeatureNode *)locus);
+  GtUword gene = 0;
+  bool success = true;
+  for(i = 0; i < gt_array_size(bins); i++)
+  {
+    GtArray *bin = *(GtArray **)gt_array_get(bins, i);
+    success = success && binsizes[i] == gt_array_size(bin);
+    GtUword j;
+    for(j = 0; success && j < gt_array_size(bin); j++)
+    {
+      GtGenomeNode **gn = gt_array_get(bin, j);
+      success = *gn == (GtGenomeNode *)genes[gene++];
+    }
+    gt_array_delete(bin);
+  }
+  success = success && binsizes[i] == 0 && gene == numgenes;
+
+  gt_array_delete(bins);
+  agn_locus_delete(locus);
+  gt_node_stream_delete(ns);
+  gt_node_stream_delete(arraystream);
+  gt_array_delete(nodes);
+  gt_error_delete(error);
+  return success;
+}
+
 static void locus_refine_stream_test_data(const char *filename, GtQueue *queue,
                                           GtUword delta)
 {
@@ -942,3 +1091,26 @@ static void locus_refine_stream_test_data(const char *filename, GtQueue *queue,
   gt_error_delete(error);
   gt_array_delete(loci);
 }
+
+static GtFeatureNode *locus_refine_stream_test_gene(GtStr *seqid,
+                                                    GtUword start,
+                                                    GtUword end,
+                                                    GtUword cdsstart,
+                                                    GtUword cdsend)
+{
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", start, end,
+                                           GT_STRAND_FORWARD);
+  GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", start, end,
+                                           GT_STRAND_FORWARD);
+  GtGenomeNode *exon = gt_feature_node_new(seqid, "exon", start, end,
+                                           GT_STRAND_FORWARD);
+  gt_feature_node_add_child((GtFeatureNode *)gene, (GtFeatureNode *)mrna);
+  gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)exon);
+  if(cdsend != 0)
+  {
+    GtGenomeNode *cds = gt_feature_node_new(seqid, "CDS", cdsstart, cdsend,
+                                            GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)cds);
+  }
+  return (GtFeatureNode *)gene;
+}
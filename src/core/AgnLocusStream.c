@@ -8,15 +8,19 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <pthread.h>
 #include <string.h>
 #include "core/queue_api.h"
+#include "extended/array_in_stream_api.h"
 #include "extended/feature_index_memory_api.h"
 #include "extended/sort_stream_api.h"
 #include "AgnGeneStream.h"
 #include "AgnInferParentStream.h"
 #include "AgnLocusStream.h"
 #include "AgnLocus.h"
+#include "AgnSeqid.h"
 #include "AgnTypecheck.h"
+#include "AgnUtils.h"
 
 #define locus_stream_cast(GS)\
         gt_node_stream_cast(locus_stream_class(), GS)
@@ -32,6 +36,8 @@ struct AgnLocusStream
   GtUword delta;
   GtUword count;
   bool skip_iiLoci;
+  bool report_unannotated;
+  bool summarize;
   int endmode;
   GtFeatureIndex *seqranges;
   AgnLocus *prev_locus;
@@ -41,7 +47,10 @@ struct AgnLocusStream
   GtStr *nameformat;
   char *refrfile;
   char *predfile;
+  bool bymark;
   FILE *ilenfile;
+  GtArray *regions;
+  GtUword next_region;
 };
 
 //------------------------------------------------------------------------------
@@ -59,6 +68,11 @@ static int locus_stream_add_feature(AgnLocusStream *stream, AgnLocus *locus,
  */
 static const GtNodeStreamClass *locus_stream_class(void);
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void locus_stream_class_init(void);
+
 /**
  * @function Extend the locus coordinates.
  */
@@ -76,6 +90,14 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
  */
 static void locus_stream_free(GtNodeStream *ns);
 
+/**
+ * @function Queue an unannotated iLocus for each sequence whose region node
+ * was read before that of ``seqid`` (or for every remaining sequence if
+ * ``seqid`` is NULL) and which has no features.
+ */
+static void locus_stream_flush_unannotated(AgnLocusStream *stream,
+                                           GtStr *seqid);
+
 /**
  * @function Mint an ID for the given locus, tally counts of children and
  * grandchildren.
@@ -95,6 +117,18 @@ static int locus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
 static int locus_stream_rn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
                                    GtError *error);
 
+/**
+ * @function Create a copy of the given feature, with its type, coordinates,
+ * strand, source, and attributes, but none of its subfeatures.
+ */
+static GtFeatureNode *locus_stream_shallow_copy(GtFeatureNode *feature);
+
+/**
+ * @function Replace ``feature`` with a lean summary, as described for
+ * ``agn_locus_stream_summarize_features``, and delete the original.
+ */
+static GtFeatureNode *locus_stream_summarize(GtFeatureNode *feature);
+
 /**
  * @function Load data from the following file(s) for unit testing.
  */
@@ -118,6 +152,16 @@ static void locus_stream_unit_test_iloci(AgnUnitTest *test);
  */
 static void locus_stream_unit_test_loci(AgnUnitTest *test);
 
+/**
+ * @function Run unit tests for lean mode.
+ */
+static void locus_stream_unit_test_summarize(AgnUnitTest *test);
+
+/**
+ * @function Run unit tests for reporting sequences with no features.
+ */
+static void locus_stream_unit_test_unannotated(AgnUnitTest *test);
+
 //------------------------------------------------------------------------------
 // Method definitions
 //------------------------------------------------------------------------------
@@ -134,6 +178,12 @@ void agn_locus_stream_label_pairwise(AgnLocusStream *stream,
   stream->predfile = gt_cstr_dup(predfile);
 }
 
+void agn_locus_stream_label_pairwise_marked(AgnLocusStream *stream)
+{
+  agn_assert(stream);
+  stream->bymark = true;
+}
+
 GtNodeStream *agn_locus_stream_new(GtNodeStream *in_stream, GtUword delta)
 {
   GtNodeStream *ns = gt_node_stream_create(locus_stream_class(), false);
@@ -142,6 +192,8 @@ GtNodeStream *agn_locus_stream_new(GtNodeStream *in_stream, GtUword delta)
   stream->delta = delta;
   stream->count = 0;
   stream->skip_iiLoci = false;
+  stream->report_unannotated = false;
+  stream->summarize = false;
   stream->endmode = 0;
   stream->seqranges = gt_feature_index_memory_new();
   stream->prev_locus = NULL;
@@ -151,7 +203,10 @@ GtNodeStream *agn_locus_stream_new(GtNodeStream *in_stream, GtUword delta)
   stream->nameformat = NULL;
   stream->refrfile = NULL;
   stream->predfile = NULL;
+  stream->bymark = false;
   stream->ilenfile = NULL;
+  stream->regions = gt_array_new( sizeof(GtStr *) );
+  stream->next_region = 0;
   return ns;
 }
 
@@ -175,6 +230,18 @@ void agn_locus_stream_skip_iiLoci(AgnLocusStream *stream)
   stream->skip_iiLoci = true;
 }
 
+void agn_locus_stream_report_unannotated(AgnLocusStream *stream)
+{
+  agn_assert(stream);
+  stream->report_unannotated = true;
+}
+
+void agn_locus_stream_summarize_features(AgnLocusStream *stream)
+{
+  agn_assert(stream);
+  stream->summarize = true;
+}
+
 void agn_locus_stream_set_source(AgnLocusStream *stream, const char *source)
 {
   agn_assert(stream && source);
@@ -186,6 +253,8 @@ bool agn_locus_stream_unit_test(AgnUnitTest *test)
 {
   locus_stream_unit_test_loci(test);
   locus_stream_unit_test_iloci(test);
+  locus_stream_unit_test_unannotated(test);
+  locus_stream_unit_test_summarize(test);
   return agn_unit_test_success(test);
 }
 
@@ -198,10 +267,15 @@ static int locus_stream_add_feature(AgnLocusStream *stream, AgnLocus *locus,
                                     GtFeatureNode *feature, GtError *error)
 {
   agn_assert(stream && locus && feature && error);
-  if(stream->refrfile == NULL)
+  if(stream->bymark)
   {
-    agn_locus_add_feature(locus, feature);
+    if(gt_feature_node_is_marked(feature))
+      agn_locus_add_pred_feature(locus, feature);
+    else
+      agn_locus_add_refr_feature(locus, feature);
   }
+  else if(stream->refrfile == NULL)
+    agn_locus_add_feature(locus, feature);
   else
   {
     const char * filename = gt_genome_node_get_filename((GtGenomeNode*)feature);
@@ -230,18 +304,22 @@ static int locus_stream_add_feature(AgnLocusStream *stream, AgnLocus *locus,
   return 0;
 }
 
+static const GtNodeStreamClass *nsc = NULL;
+
 static const GtNodeStreamClass *locus_stream_class(void)
 {
-  static const GtNodeStreamClass *nsc = NULL;
-  if(!nsc)
-  {
-    nsc = gt_node_stream_class_new(sizeof (AgnLocusStream),
-                                   locus_stream_free,
-                                   locus_stream_next);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, locus_stream_class_init);
   return nsc;
 }
 
+static void locus_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnLocusStream),
+                                 locus_stream_free,
+                                 locus_stream_next);
+}
+
 static void locus_stream_extend(AgnLocusStream *stream, AgnLocus *locus)
 {
   agn_assert(stream && locus);
@@ -250,102 +328,54 @@ static void locus_stream_extend(AgnLocusStream *stream, AgnLocus *locus)
   GtRange seqrange;
   gt_feature_index_get_range_for_seqid(stream->seqranges, &seqrange,
                                        gt_str_get(seqid), NULL);
-  GtStr *prev_seqid = NULL;
-  if(stream->prev_locus)
-    prev_seqid = gt_genome_node_get_seqid(stream->prev_locus);
+  bool same_seqid = stream->prev_locus != NULL &&
+                    agn_seqid_equal(locus, stream->prev_locus);
 
   // Handle initial loci
-  if(stream->prev_locus == NULL || gt_str_cmp(seqid, prev_seqid) != 0)
+  if(!same_seqid)
   {
-    if(locusrange.start >= seqrange.start + (2*stream->delta))
-    {
-      agn_locus_set_range(locus, locusrange.start - stream->delta,
-                          locusrange.end);
-      if(stream->endmode >= 0 && !stream->skip_iiLoci &&
-				locusrange.start - stream->delta - 1 > 0)
-      {
-        AgnLocus *filocus = agn_locus_new(seqid);
-        GtRange irange = {seqrange.start, locusrange.start - stream->delta - 1};
-        agn_locus_set_range(filocus, irange.start, irange.end);
-        gt_genome_node_add_user_data(filocus, "iLocus_type",
-                                     gt_cstr_dup("fiLocus"), gt_free_func);
-        gt_queue_add(stream->locusqueue, filocus);
-      }
-    }
-    else
+    GtUword newstart = agn_ilocus_initial_start(locusrange.start, &seqrange,
+                                                stream->delta);
+    agn_locus_set_range(locus, newstart, locusrange.end);
+    if(newstart > seqrange.start && stream->endmode >= 0 && !stream->skip_iiLoci)
     {
-      agn_locus_set_range(locus, seqrange.start, locusrange.end);
+      AgnLocus *filocus = agn_locus_new(seqid);
+      GtRange irange = { seqrange.start, newstart - 1 };
+      agn_locus_set_range(filocus, irange.start, irange.end);
+      gt_genome_node_add_user_data(filocus, "iLocus_type",
+                                   gt_cstr_dup("fiLocus"), gt_free_func);
+      gt_queue_add(stream->locusqueue, filocus);
     }
   }
 
   // Handle internal loci
-  if(stream->prev_locus && gt_str_cmp(seqid, prev_seqid) == 0)
+  if(same_seqid)
   {
     GtFeatureNode *prevfn = gt_feature_node_cast(stream->prev_locus);
     GtFeatureNode *locusfn = gt_feature_node_cast(locus);
     GtRange prev_range = gt_genome_node_get_range(stream->prev_locus);
     const char *orientstrs[] = { "FF", "FR", "RF", "RR" };
     int orient = agn_locus_inner_orientation(stream->prev_locus, locus);
-    bool ovlp1 = prev_range.end + stream->delta >= locusrange.start;
-    bool ovlp2 = prev_range.end >= locusrange.start;
-    if(ovlp1 || ovlp2)
-    {
-      GtUword newend = prev_range.end + stream->delta;
-      if(newend > seqrange.end)
-        newend = seqrange.end;
-      agn_locus_set_range(stream->prev_locus, prev_range.start, newend);
-
-      GtUword newstart = locusrange.start - stream->delta;
-      if(seqrange.start + stream->delta > locusrange.start)
-        newstart = seqrange.start;
-      agn_locus_set_range(locus, newstart, locusrange.end);
-
-      GtUword overlap = newend - newstart + 1;
-      char ovrlp[16];
-      sprintf(ovrlp, "%lu", overlap);
-      gt_feature_node_add_attribute(prevfn, "right_overlap", ovrlp);
-      gt_feature_node_add_attribute(locusfn, "left_overlap", ovrlp);
-      gt_feature_node_add_attribute(prevfn, "iiLocus_exception",
-                                    "delta-overlap-gene");
-
-      if(stream->ilenfile != NULL) {
-        fprintf(stream->ilenfile, "%s\t0\t%s\n", gt_str_get(seqid),
-                orientstrs[orient]);
-      }
-      gt_feature_node_add_attribute(prevfn, "riil", "0");
-      gt_feature_node_add_attribute(locusfn, "liil", "0");
-    }
-    else if(prev_range.end + (2*stream->delta) >= locusrange.start)
+    GtUword newend, newstart;
+    AgnIlocusGap gap = agn_ilocus_gap(prev_range.end, locusrange.start,
+                                      &seqrange, stream->delta, &newend,
+                                      &newstart);
+    agn_locus_set_range(stream->prev_locus, prev_range.start, newend);
+    agn_locus_set_range(locus, newstart, locusrange.end);
+    if(gap != AGN_ILOCUS_GAP_IILOCUS)
     {
-      GtUword newend = prev_range.end + stream->delta;
-      if(newend > seqrange.end)
-        newend = seqrange.end;
-      agn_locus_set_range(stream->prev_locus, prev_range.start, newend);
-      agn_locus_set_range(locus, locusrange.start - stream->delta,
-                          locusrange.end);
-
-      GtUword overlap = prev_range.end-locusrange.start+(2*stream->delta)+1;
-      char ovrlp[16];
-      sprintf(ovrlp, "%lu", overlap);
-      gt_feature_node_add_attribute(prevfn, "right_overlap", ovrlp);
-      gt_feature_node_add_attribute(locusfn, "left_overlap", ovrlp);
-      gt_feature_node_add_attribute(prevfn, "iiLocus_exception",
-                                    "delta-overlap-delta");
-
-      if(stream->ilenfile != NULL) {
-        fprintf(stream->ilenfile, "%s\t0\t%s\n", gt_str_get(seqid),
-                orientstrs[orient]);
+      const char *exceptions[] = { "delta-overlap-gene", "delta-overlap-delta",
+                                   "delta-re-extend" };
+      if(gap != AGN_ILOCUS_GAP_RE_EXTEND)
+      {
+        GtUword overlap = newend - newstart + 1;
+        char ovrlp[16];
+        sprintf(ovrlp, "%lu", overlap);
+        gt_feature_node_add_attribute(prevfn, "right_overlap", ovrlp);
+        gt_feature_node_add_attribute(locusfn, "left_overlap", ovrlp);
       }
-      gt_feature_node_add_attribute(prevfn, "riil", "0");
-      gt_feature_node_add_attribute(locusfn, "liil", "0");
-    }
-    else if(prev_range.end + (3*stream->delta) >= locusrange.start)
-    {
-      GtUword midpoint = (prev_range.end + locusrange.start) / 2;
-      agn_locus_set_range(stream->prev_locus, prev_range.start, midpoint);
-      agn_locus_set_range(locus, midpoint + 1, locusrange.end);
       gt_feature_node_add_attribute(prevfn, "iiLocus_exception",
-                                    "delta-re-extend");
+                                    exceptions[gap]);
 
       if(stream->ilenfile != NULL) {
         fprintf(stream->ilenfile, "%s\t0\t%s\n", gt_str_get(seqid),
@@ -356,17 +386,9 @@ static void locus_stream_extend(AgnLocusStream *stream, AgnLocus *locus)
     }
     else
     {
-      GtUword newend = prev_range.end + stream->delta;
-      if(newend > seqrange.end)
-        newend = seqrange.end;
-      agn_locus_set_range(stream->prev_locus, prev_range.start, newend);
-      agn_locus_set_range(locus, locusrange.start - stream->delta,
-                          locusrange.end);
-
       if(stream->endmode <= 0 && !stream->skip_iiLoci)
       {
-        GtRange irange = { prev_range.end + stream->delta + 1,
-                           locusrange.start - stream->delta - 1 };
+        GtRange irange = { newend + 1, newstart - 1 };
 	//If the two iLoci overlap, do not create an iiLocus:
         if(irange.start > irange.end) goto noiilocus;
 
@@ -410,27 +432,19 @@ static void locus_stream_extend(AgnLocusStream *stream, AgnLocus *locus)
     buffer_seqid = gt_genome_node_get_seqid(stream->buffer);
   if(stream->buffer == NULL || buffer_seqid == NULL ||
      gt_feature_node_try_cast(stream->buffer) == NULL ||
-     gt_str_cmp(seqid, buffer_seqid) != 0)
+     !agn_seqid_equal(locus, stream->buffer))
   {
-    if(seqrange.end > (2*stream->delta) &&
-       locusrange.end <= seqrange.end - (2*stream->delta))
+    GtUword newend = agn_ilocus_terminal_end(locusrange.end, &seqrange,
+                                             stream->delta);
+    agn_locus_set_range(locus, locusrange.start, newend);
+    if(newend < seqrange.end && stream->endmode >= 0 && !stream->skip_iiLoci)
     {
-      agn_locus_set_range(locus, locusrange.start,
-                          locusrange.end + stream->delta);
-      if(stream->endmode >= 0 && !stream->skip_iiLoci &&
-			locusrange.end + stream->delta + 1 <= seqrange.end)
-      {
-        AgnLocus *filocus = agn_locus_new(seqid);
-        GtRange irange = {locusrange.end + stream->delta + 1, seqrange.end};
-        agn_locus_set_range(filocus, irange.start, irange.end);
-        gt_genome_node_add_user_data(filocus, "iLocus_type",
-                                     gt_cstr_dup("fiLocus"), gt_free_func);
-        gt_queue_add(stream->locusqueue, filocus);
-      }
-    }
-    else
-    {
-      agn_locus_set_range(locus, locusrange.start, seqrange.end);
+      AgnLocus *filocus = agn_locus_new(seqid);
+      GtRange irange = { newend + 1, seqrange.end };
+      agn_locus_set_range(filocus, irange.start, irange.end);
+      gt_genome_node_add_user_data(filocus, "iLocus_type",
+                                   gt_cstr_dup("fiLocus"), gt_free_func);
+      gt_queue_add(stream->locusqueue, filocus);
     }
   }
 }
@@ -440,10 +454,15 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
 {
   agn_assert(stream && gn && error);
 
+  // Input is sorted, so a feature overlaps the open locus if and only if it
+  // is on the same sequence and starts before the largest end coordinate of
+  // the features collected so far.
   GtArray *current_locus = gt_array_new( sizeof(GtFeatureNode *) );
+  GtUword maxend = 0;
   if(stream->buffer != NULL)
   {
     gt_array_add(current_locus, stream->buffer);
+    maxend = gt_genome_node_get_end(stream->buffer);
     stream->buffer = NULL;
   }
 
@@ -464,21 +483,24 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
       stream->buffer = *gn;
       break;
     }
+    if(stream->summarize && stream->refrfile == NULL && !stream->bymark)
+    {
+      GtFeatureNode *fn = gt_feature_node_cast(*gn);
+      *gn = (GtGenomeNode *)locus_stream_summarize(fn);
+    }
 
-    GtUword i;
     bool overlap = false;
-    for(i = 0; i < gt_array_size(current_locus); i++)
+    if(gt_array_size(current_locus) > 0)
     {
-      GtGenomeNode **oldfeature = gt_array_get(current_locus, i);
-      if(agn_overlap_ilocus(*gn, *oldfeature, 1, false))
-      {
-        overlap = true;
-        break;
-      }
+      GtGenomeNode **first = gt_array_get(current_locus, 0);
+      overlap = agn_seqid_equal(*gn, *first) &&
+                gt_genome_node_get_start(*gn) <= maxend;
     }
     if(overlap || gt_array_size(current_locus) == 0)
     {
       gt_array_add(current_locus, *gn);
+      if(gt_genome_node_get_end(*gn) > maxend)
+        maxend = gt_genome_node_get_end(*gn);
       again = true;
     }
     else
@@ -495,6 +517,8 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
   {
     GtGenomeNode **rep = gt_array_get(current_locus, 0);
     GtStr *seqid = gt_genome_node_get_seqid(*rep);
+    if(stream->prev_locus == NULL || !agn_seqid_equal(*rep, stream->prev_locus))
+      locus_stream_flush_unannotated(stream, seqid);
     AgnLocus *locus = agn_locus_new(seqid);
     while(gt_array_size(current_locus) > 0)
     {
@@ -522,6 +546,41 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
   return 0;
 }
 
+static void locus_stream_flush_unannotated(AgnLocusStream *stream,
+                                           GtStr *seqid)
+{
+  GtUword numregions = gt_array_size(stream->regions);
+  GtUword last = numregions;
+  if(seqid != NULL)
+  {
+    for(last = stream->next_region; last < numregions; last++)
+    {
+      GtStr **regionseqid = gt_array_get(stream->regions, last);
+      if(gt_str_cmp(*regionseqid, seqid) == 0)
+        break;
+    }
+    if(last == numregions)
+      return;
+  }
+
+  for(; stream->next_region < last; stream->next_region++)
+  {
+    GtStr **regionseqid = gt_array_get(stream->regions, stream->next_region);
+    GtRange seqrange;
+    gt_feature_index_get_range_for_seqid(stream->seqranges, &seqrange,
+                                         gt_str_get(*regionseqid), NULL);
+    AgnLocus *uilocus = agn_locus_new(*regionseqid);
+    agn_locus_set_range(uilocus, seqrange.start, seqrange.end);
+    GtFeatureNode *uilocfn = gt_feature_node_cast(uilocus);
+    gt_feature_node_add_attribute(uilocfn, "unannot", "true");
+    gt_genome_node_add_user_data(uilocus, "iLocus_type",
+                                 gt_cstr_dup("fiLocus"), gt_free_func);
+    gt_queue_add(stream->locusqueue, uilocus);
+  }
+  if(seqid != NULL)
+    stream->next_region++;
+}
+
 static void locus_stream_free(GtNodeStream *ns)
 {
   agn_assert(ns);
@@ -534,6 +593,12 @@ static void locus_stream_free(GtNodeStream *ns)
     gt_str_delete(stream->nameformat);
   gt_free(stream->refrfile);
   gt_free(stream->predfile);
+  while(gt_array_size(stream->regions) > 0)
+  {
+    GtStr **seqid = gt_array_pop(stream->regions);
+    gt_str_delete(*seqid);
+  }
+  gt_array_delete(stream->regions);
 }
 
 static void locus_stream_mint(AgnLocusStream *stream, AgnLocus *locus)
@@ -545,7 +610,8 @@ static void locus_stream_mint(AgnLocusStream *stream, AgnLocus *locus)
   if(stream->nameformat)
   {
     char locusname[256];
-    sprintf(locusname, gt_str_get(stream->nameformat), stream->count);
+    snprintf(locusname, sizeof (locusname), gt_str_get(stream->nameformat),
+             stream->count);
     gt_feature_node_set_attribute((GtFeatureNode *)locus, "Name", locusname);
   }
 
@@ -643,8 +709,18 @@ static int locus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
   }
 
   int result = gt_node_stream_next(stream->in_stream, gn, error);
-  if(result || !*gn)
+  if(result)
     return result;
+  if(!*gn)
+  {
+    locus_stream_flush_unannotated(stream, NULL);
+    if(gt_queue_size(stream->locusqueue) > 0)
+    {
+      *gn = gt_queue_get(stream->locusqueue);
+      locus_stream_mint(stream, *gn);
+    }
+    return 0;
+  }
 
   if(gt_feature_node_try_cast(*gn))
     return locus_stream_fn_handler(stream, gn, error);
@@ -660,9 +736,124 @@ static int locus_stream_rn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
 {
   agn_assert(stream && gn && error);
   GtRegionNode *rn = gt_region_node_cast(*gn);
+  if(stream->report_unannotated)
+  {
+    GtStr *seqid = gt_genome_node_get_seqid(*gn);
+    GtUword numregions = gt_array_size(stream->regions);
+    GtStr **lastseqid = NULL;
+    if(numregions > 0)
+      lastseqid = gt_array_get(stream->regions, numregions - 1);
+    if(lastseqid == NULL || gt_str_cmp(*lastseqid, seqid) != 0)
+    {
+      seqid = gt_str_ref(seqid);
+      gt_array_add(stream->regions, seqid);
+    }
+  }
   return gt_feature_index_add_region_node(stream->seqranges, rn, error);
 }
 
+static GtFeatureNode *locus_stream_shallow_copy(GtFeatureNode *feature)
+{
+  GtGenomeNode *gn = (GtGenomeNode *)feature;
+  GtRange range = gt_genome_node_get_range(gn);
+  GtGenomeNode *copy = gt_feature_node_new(gt_genome_node_get_seqid(gn),
+                                           gt_feature_node_get_type(feature),
+                                           range.start, range.end,
+                                           gt_feature_node_get_strand(feature));
+  GtFeatureNode *copyfn = (GtFeatureNode *)copy;
+  GtStr *source = gt_str_new_cstr(gt_feature_node_get_source(feature));
+  gt_feature_node_set_source(copyfn, source);
+  gt_str_delete(source);
+
+  GtStrArray *attrs = gt_feature_node_get_attribute_list(feature);
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(attrs); i++)
+  {
+    const char *key = gt_str_array_get(attrs, i);
+    const char *value = gt_feature_node_get_attribute(feature, key);
+    gt_feature_node_add_attribute(copyfn, key, value);
+  }
+  gt_str_array_delete(attrs);
+  return copyfn;
+}
+
+static GtFeatureNode *locus_stream_summarize(GtFeatureNode *feature)
+{
+  GtFeatureNode *summary = locus_stream_shallow_copy(feature);
+  GtStr *seqid = gt_genome_node_get_seqid((GtGenomeNode *)feature);
+  GtStrand strand = gt_feature_node_get_strand(feature);
+  GtArray *exons = gt_array_new( sizeof(GtRange) );
+  GtFeatureNode *firstchild = NULL;
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(feature);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    // Exons that are direct children of the feature are kept as copies, so
+    // they are not merged below and not placed under another exon.
+    GtFeatureNode *childcopy = locus_stream_shallow_copy(child);
+    gt_feature_node_add_child(summary, childcopy);
+    if(firstchild == NULL && !agn_typecheck_exon(child))
+      firstchild = childcopy;
+
+    GtRange cdsrange = { 0, 0 };
+    GtFeatureNodeIterator *subiter = gt_feature_node_iterator_new(child);
+    GtFeatureNode *subfeature;
+    for(subfeature  = gt_feature_node_iterator_next(subiter);
+        subfeature != NULL;
+        subfeature  = gt_feature_node_iterator_next(subiter))
+    {
+      if(subfeature == child)
+        continue;
+      GtRange range = gt_genome_node_get_range((GtGenomeNode *)subfeature);
+      if(agn_typecheck_exon(subfeature))
+        gt_array_add(exons, range);
+      else if(agn_typecheck_cds(subfeature))
+      {
+        if(cdsrange.end == 0)
+          cdsrange = range;
+        else
+          cdsrange = gt_range_join(&cdsrange, &range);
+      }
+    }
+    gt_feature_node_iterator_delete(subiter);
+
+    if(cdsrange.end != 0)
+    {
+      GtGenomeNode *cds = gt_feature_node_new(seqid, "CDS", cdsrange.start,
+                                              cdsrange.end,
+                                              gt_feature_node_get_strand(child));
+      gt_feature_node_add_child(childcopy, (GtFeatureNode *)cds);
+    }
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  // Exons shared by several transcripts are only stored once.
+  gt_array_sort(exons, (GtCompare)gt_range_compare);
+  GtUword i = 0;
+  while(firstchild != NULL && i < gt_array_size(exons))
+  {
+    GtRange merged = *(GtRange *)gt_array_get(exons, i);
+    for(i++; i < gt_array_size(exons); i++)
+    {
+      GtRange *range = gt_array_get(exons, i);
+      if(range->start > merged.end)
+        break;
+      if(range->end > merged.end)
+        merged.end = range->end;
+    }
+    GtGenomeNode *exon = gt_feature_node_new(seqid, "exon", merged.start,
+                                             merged.end, strand);
+    gt_feature_node_add_child(firstchild, (GtFeatureNode *)exon);
+  }
+  gt_array_delete(exons);
+
+  gt_genome_node_delete((GtGenomeNode *)feature);
+  return summary;
+}
+
 static void locus_stream_test_data(GtQueue *queue, int numfiles,
                                    const char **filenames, bool pairwise)
 {
@@ -887,3 +1078,188 @@ static void locus_stream_unit_test_loci(AgnUnitTest *test)
 
   gt_queue_delete(queue);
 }
+
+static void locus_stream_unit_test_summarize(AgnUnitTest *test)
+{
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *region = gt_region_node_new(seqid, 1, 10000);
+  gt_array_add(nodes, region);
+
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", 1000, 5000,
+                                           GT_STRAND_FORWARD);
+  gt_feature_node_add_attribute((GtFeatureNode *)gene, "ID", "gene1");
+  GtRange exons[] = { {1000, 1500}, {2000, 2500}, {4000, 5000},
+                      {1000, 1500}, {2200, 2600}, {4000, 4800} };
+  GtRange cds[] = { {1200, 4500}, {1300, 4200} };
+  int i, j;
+  for(i = 0; i < 2; i++)
+  {
+    GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", 1000,
+                                             i == 0 ? 5000 : 4800,
+                                             GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)gene, (GtFeatureNode *)mrna);
+    for(j = 0; j < 3; j++)
+    {
+      GtRange *range = exons + (i*3) + j;
+      GtGenomeNode *exon = gt_feature_node_new(seqid, "exon", range->start,
+                                               range->end, GT_STRAND_FORWARD);
+      gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)exon);
+    }
+    GtGenomeNode *cdsfeat = gt_feature_node_new(seqid, "CDS", cds[i].start,
+                                                cds[i].end, GT_STRAND_FORWARD);
+    gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)cdsfeat);
+  }
+  gt_array_add(nodes, gene);
+
+  // A gene with exons as direct children, as for some pseudogenes
+  gene = gt_feature_node_new(seqid, "gene", 7000, 9000, GT_STRAND_REVERSE);
+  gt_feature_node_add_attribute((GtFeatureNode *)gene, "ID", "gene2");
+  for(j = 0; j < 2; j++)
+  {
+    GtGenomeNode *exon = gt_feature_node_new(seqid, "exon", 7000 + j*1500,
+                                             7500 + j*1500, GT_STRAND_REVERSE);
+    gt_feature_node_add_child((GtFeatureNode *)gene, (GtFeatureNode *)exon);
+  }
+  gt_array_add(nodes, gene);
+
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *ls = agn_locus_stream_new(ais, 500);
+  agn_locus_stream_skip_iiLoci((AgnLocusStream *)ls);
+  agn_locus_stream_summarize_features((AgnLocusStream *)ls);
+  GtGenomeNode *locus = NULL, *locus2 = NULL;
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(ls, &gn, error)) == 0 && gn != NULL)
+  {
+    if(gt_feature_node_try_cast(gn) && locus == NULL)
+      locus = gn;
+    else if(gt_feature_node_try_cast(gn) && locus2 == NULL)
+      locus2 = gn;
+    else
+      gt_genome_node_delete(gn);
+  }
+
+  bool test1 = result == 0 && locus != NULL;
+  if(test1)
+  {
+    GtFeatureNode *locusfn = (GtFeatureNode *)locus;
+    GtRange range = gt_genome_node_get_range(locus);
+    const char *numgenes = gt_feature_node_get_attribute(locusfn,
+                                                         "child_gene");
+    const char *nummrnas = gt_feature_node_get_attribute(locusfn,
+                                                         "child_mRNA");
+    test1 = range.start == 1 && range.end == 5500 &&
+            numgenes != NULL && strcmp(numgenes, "1") == 0 &&
+            nummrnas != NULL && strcmp(nummrnas, "2") == 0;
+
+    GtArray *genes = agn_typecheck_select(locusfn, agn_typecheck_gene);
+    test1 = test1 && gt_array_size(genes) == 1;
+    if(test1)
+    {
+      GtFeatureNode *genefn = *(GtFeatureNode **)gt_array_get(genes, 0);
+      const char *geneid = gt_feature_node_get_attribute(genefn, "ID");
+      GtRange cdsrange = agn_feature_node_get_cds_range(genefn);
+      test1 = geneid != NULL && strcmp(geneid, "gene1") == 0 &&
+              cdsrange.start == 1200 && cdsrange.end == 4500 &&
+              agn_typecheck_count(genefn, agn_typecheck_cds) == 2 &&
+              agn_typecheck_count(genefn, agn_typecheck_exon) == 3;
+    }
+    gt_array_delete(genes);
+    gt_genome_node_delete(locus);
+  }
+  agn_unit_test_result(test, "lean mode", test1);
+
+  bool test2 = result == 0 && locus2 != NULL;
+  if(test2)
+  {
+    GtFeatureNode *locusfn = (GtFeatureNode *)locus2;
+    GtRange range = gt_genome_node_get_range(locus2);
+    const char *numexons = gt_feature_node_get_attribute(locusfn,
+                                                         "child_exon");
+    test2 = range.start == 6500 && range.end == 9500 &&
+            numexons != NULL && strcmp(numexons, "2") == 0 &&
+            gt_feature_node_get_attribute(locusfn, "child_mRNA") == NULL &&
+            agn_typecheck_count(locusfn, agn_typecheck_exon) == 2;
+    gt_genome_node_delete(locus2);
+  }
+  agn_unit_test_result(test, "lean mode, exons as gene children", test2);
+
+  gt_node_stream_delete(ls);
+  gt_node_stream_delete(ais);
+  gt_array_delete(nodes);
+  gt_error_delete(error);
+  gt_str_delete(seqid);
+}
+
+static void locus_stream_unit_test_unannotated(AgnUnitTest *test)
+{
+  const char *seqids[] = { "chr1", "chr2", "chr3" };
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtStr *seqid = NULL;
+  int i;
+  for(i = 0; i < 3; i++)
+  {
+    seqid = gt_str_new_cstr(seqids[i]);
+    GtGenomeNode *gn = gt_region_node_new(seqid, 1, 5000);
+    gt_array_add(nodes, gn);
+    if(i < 2)
+      gt_str_delete(seqid);
+  }
+  GtGenomeNode *gn = gt_feature_node_new(seqid, "gene", 2000, 3000,
+                                         GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gt_str_delete(seqid);
+
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *ls = agn_locus_stream_new(ais, 500);
+  agn_locus_stream_report_unannotated((AgnLocusStream *)ls);
+  agn_locus_stream_skip_iiLoci((AgnLocusStream *)ls);
+  GtArray *loci = gt_array_new( sizeof(GtGenomeNode *) );
+  int result;
+  while((result = gt_node_stream_next(ls, &gn, error)) == 0 && gn != NULL)
+  {
+    if(gt_feature_node_try_cast(gn))
+      gt_array_add(loci, gn);
+    else
+      gt_genome_node_delete(gn);
+  }
+
+  bool test1 = result == 0 && gt_array_size(loci) == 3;
+  const char *expseqids[] = { "chr1", "chr2", "chr3" };
+  bool expunannot[] = { true, true, false };
+  GtUword k;
+  for(k = 0; test1 && k < gt_array_size(loci); k++)
+  {
+    GtGenomeNode *locus = *(GtGenomeNode **)gt_array_get(loci, k);
+    const char *unannot = gt_feature_node_get_attribute((GtFeatureNode *)locus,
+                                                        "unannot");
+    test1 = strcmp(gt_str_get(gt_genome_node_get_seqid(locus)),
+                   expseqids[k]) == 0 && expunannot[k] == (unannot != NULL);
+    if(expunannot[k])
+    {
+      GtRange range = gt_genome_node_get_range(locus);
+      const char *type = gt_genome_node_get_user_data(locus, "iLocus_type");
+      test1 = test1 && range.start == 1 && range.end == 5000 &&
+              type != NULL && strcmp(type, "fiLocus") == 0 &&
+              gt_feature_node_get_attribute((GtFeatureNode *)locus,
+                                            "fragment") == NULL;
+    }
+  }
+  agn_unit_test_result(test, "unannotated sequences", test1);
+
+  while(gt_array_size(loci) > 0)
+  {
+    GtGenomeNode **locus = gt_array_pop(loci);
+    gt_genome_node_delete(*locus);
+  }
+  gt_array_delete(loci);
+  gt_node_stream_delete(ls);
+  gt_node_stream_delete(ais);
+  gt_array_delete(nodes);
+  gt_error_delete(error);
+}
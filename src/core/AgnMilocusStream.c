@@ -0,0 +1,551 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "extended/array_in_stream_api.h"
+#include "extended/gff3_visitor_api.h"
+#include "AgnMilocusStream.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define milocus_stream_cast(GS)\
+        gt_node_stream_cast(milocus_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnMilocusStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtNodeVisitor *writer;
+  GtArray *iloci;
+  GtArray *sums;
+  GtStrArray *genes;
+};
+
+typedef struct
+{
+  char *key;
+  GtUword sum;
+} AgnMilocusAttribute;
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Buffer a copy of ``ilocus`` for merging, along with its numeric
+ * attributes and a description of each of its genes. Genes are recorded now,
+ * since downstream streams may remove them before the merge is complete.
+ */
+static void milocus_stream_add(AgnMilocusStream *stream, GtFeatureNode *ilocus);
+
+/**
+ * @function Compare two ``AgnMilocusAttribute`` objects by key.
+ */
+static int milocus_stream_attribute_compare(const void *p1, const void *p2);
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *milocus_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void milocus_stream_class_init(void);
+
+/**
+ * @function Create a copy of ``ilocus`` without its subfeatures and without
+ * ``ID`` and ``Name`` attributes.
+ */
+static GtGenomeNode *milocus_stream_copy(GtFeatureNode *ilocus);
+
+/**
+ * @function Merge the buffered iLoci and write the result. A single buffered
+ * iLocus is written as is.
+ */
+static int milocus_stream_flush(AgnMilocusStream *stream, GtError *error);
+
+/**
+ * @function Destructor: release instance data.
+ */
+static void milocus_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Returns true if ``ilocus`` can be merged with its neighbors.
+ */
+static bool milocus_stream_is_mergeable(GtFeatureNode *ilocus);
+
+/**
+ * @function Returns true if ``value`` is a non-negative integer.
+ */
+static bool milocus_stream_is_numeric(const char *value);
+
+/**
+ * @function Create a single miLocus from the buffered iLoci, attributes, and
+ * gene descriptions.
+ */
+static GtGenomeNode *milocus_stream_merge(AgnMilocusStream *stream);
+
+/**
+ * @function Pass the next node through, merging and writing iLoci as needed.
+ */
+static int milocus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error);
+
+/**
+ * @function Release the buffered iLoci and attribute sums.
+ */
+static void milocus_stream_reset(AgnMilocusStream *stream);
+
+/**
+ * @function Add a gene feature to an iLocus for unit tests.
+ */
+static void milocus_stream_test_gene(GtFeatureNode *ilocus, const char *name,
+                                     GtUword start, GtUword end,
+                                     GtStrand strand);
+
+/**
+ * @function Create an iLocus feature for unit tests. Additional attributes are
+ * given as a comma-separated list of key=value pairs.
+ */
+static GtFeatureNode *milocus_stream_test_ilocus(GtStr *seqid, GtUword start,
+                                                 GtUword end, const char *type,
+                                                 const char *attrs);
+
+/**
+ * @function Write the given genome node, taking ownership of it.
+ */
+static int milocus_stream_write(AgnMilocusStream *stream, GtGenomeNode *gn,
+                                GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_milocus_stream_new(GtNodeStream *in_stream, GtFile *outfile)
+{
+  agn_assert(in_stream);
+  GtNodeStream *ns = gt_node_stream_create(milocus_stream_class(), false);
+  AgnMilocusStream *stream = milocus_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->writer = gt_gff3_visitor_new(outfile);
+  stream->iloci = gt_array_new( sizeof(GtGenomeNode *) );
+  stream->sums = gt_array_new( sizeof(AgnMilocusAttribute) );
+  stream->genes = gt_str_array_new();
+  return ns;
+}
+
+bool agn_milocus_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn = gt_region_node_new(seqid, 1, 8000);
+  gt_array_add(nodes, gn);
+
+  GtFeatureNode *fn = milocus_stream_test_ilocus(seqid, 1, 1000, "fiLocus",
+                                                 "effective_length=1000");
+  gt_array_add(nodes, fn);
+  fn = milocus_stream_test_ilocus(seqid, 1001, 3000, "siLocus",
+                                  "child_gene=1,child_mRNA=1,"
+                                  "effective_length=2000,right_overlap=200");
+  milocus_stream_test_gene(fn, "GeneA", 1500, 2500, GT_STRAND_FORWARD);
+  gt_array_add(nodes, fn);
+  fn = milocus_stream_test_ilocus(seqid, 2801, 5000, "niLocus",
+                                  "child_gene=2,child_mRNA=3,"
+                                  "effective_length=2000,left_overlap=200");
+  milocus_stream_test_gene(fn, "GeneB", 3000, 4000, GT_STRAND_REVERSE);
+  milocus_stream_test_gene(fn, NULL, 4200, 4800, GT_STRAND_FORWARD);
+  gt_array_add(nodes, fn);
+  fn = milocus_stream_test_ilocus(seqid, 5001, 6000, "iiLocus",
+                                  "effective_length=1000");
+  gt_array_add(nodes, fn);
+  fn = milocus_stream_test_ilocus(seqid, 6001, 7000, "siLocus",
+                                  "child_gene=1,effective_length=1000");
+  milocus_stream_test_gene(fn, "GeneD", 6200, 6800, GT_STRAND_REVERSE);
+  gt_array_add(nodes, fn);
+  fn = milocus_stream_test_ilocus(seqid, 7001, 8000, "siLocus",
+                                  "child_gene=1,effective_length=1000,"
+                                  "iiLocus_exception=intron-gene");
+  milocus_stream_test_gene(fn, "GeneE", 7200, 7800, GT_STRAND_REVERSE);
+  gt_array_add(nodes, fn);
+  GtUword numnodes = gt_array_size(nodes);
+
+  char *buffer = NULL;
+  size_t buffersize = 0;
+  FILE *outfp = open_memstream(&buffer, &buffersize);
+  GtFile *outfile = gt_file_new_from_fileptr(outfp);
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *mls = agn_milocus_stream_new(ais, outfile);
+  GtUword count = 0;
+  int result;
+  while((result = gt_node_stream_next(mls, &gn, error)) == 0 && gn != NULL)
+  {
+    count++;
+    gt_genome_node_delete(gn);
+  }
+  gt_node_stream_delete(mls);
+  gt_node_stream_delete(ais);
+  gt_file_delete_without_handle(outfile);
+  fclose(outfp);
+
+  bool test1 = result == 0 && count == numnodes;
+  agn_unit_test_result(test, "pass through", test1);
+
+  GtUword numloci = 0;
+  const char *line;
+  for(line = strstr(buffer, "\tlocus\t");
+      line != NULL;
+      line = strstr(line + 1, "\tlocus\t"))
+  {
+    numloci++;
+  }
+  const char *mattrs = "iLocus_type=miLocus;child_gene=3;child_mRNA=4;"
+                       "effective_length=4000;miLocusGene1=GeneA on + strand "
+                       "from 1500 to 2500;miLocusGene2=GeneB on - strand from "
+                       "3000 to 4000;miLocusGene3=unnamed on + strand from 4200 "
+                       "to 4800";
+  bool test2 = numloci == 5 && strstr(buffer, mattrs) != NULL &&
+               strstr(buffer, "\t1001\t5000\t2\t") != NULL;
+  agn_unit_test_result(test, "merge", test2);
+
+  bool test3 = strstr(buffer, "\t6001\t7000\t") != NULL &&
+               strstr(buffer, "\t7001\t8000\t") != NULL &&
+               strstr(buffer, "miLocusGene4") == NULL &&
+               strstr(buffer, "Name=") == NULL;
+  agn_unit_test_result(test, "copy", test3);
+
+  free(buffer);
+  gt_error_delete(error);
+  gt_array_delete(nodes);
+  gt_str_delete(seqid);
+  return agn_unit_test_success(test);
+}
+
+static void milocus_stream_add(AgnMilocusStream *stream, GtFeatureNode *ilocus)
+{
+  GtGenomeNode *copy = milocus_stream_copy(ilocus);
+  gt_array_add(stream->iloci, copy);
+
+  GtStrArray *attrkeys = gt_feature_node_get_attribute_list(ilocus);
+  GtUword i, j;
+  for(i = 0; i < gt_str_array_size(attrkeys); i++)
+  {
+    const char *key = gt_str_array_get(attrkeys, i);
+    const char *value = gt_feature_node_get_attribute(ilocus, key);
+    if(strcmp(key, "left_overlap") == 0 || strcmp(key, "right_overlap") == 0 ||
+       !milocus_stream_is_numeric(value))
+      continue;
+
+    GtUword number = strtoul(value, NULL, 10);
+    for(j = 0; j < gt_array_size(stream->sums); j++)
+    {
+      AgnMilocusAttribute *attr = gt_array_get(stream->sums, j);
+      if(strcmp(attr->key, key) == 0)
+      {
+        attr->sum += number;
+        break;
+      }
+    }
+    if(j == gt_array_size(stream->sums))
+    {
+      AgnMilocusAttribute attr = { gt_cstr_dup(key), number };
+      gt_array_add(stream->sums, attr);
+    }
+  }
+  gt_str_array_delete(attrkeys);
+
+  char coords[64];
+  GtStr *description = gt_str_new();
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(ilocus);
+  GtFeatureNode *fn;
+  for(fn = gt_feature_node_iterator_next(iter);
+      fn != NULL;
+      fn = gt_feature_node_iterator_next(iter))
+  {
+    if(!agn_typecheck_gene(fn))
+      continue;
+
+    const char *name = gt_feature_node_get_attribute(fn, "Name");
+    GtRange range = gt_genome_node_get_range((GtGenomeNode *)fn);
+    GtStrand strand = gt_feature_node_get_strand(fn);
+    gt_str_reset(description);
+    gt_str_append_cstr(description, name == NULL ? "unnamed" : name);
+    gt_str_append_cstr(description, " on ");
+    gt_str_append_char(description, GT_STRAND_CHARS[strand]);
+    sprintf(coords, " strand from %lu to %lu", range.start, range.end);
+    gt_str_append_cstr(description, coords);
+    gt_str_array_add(stream->genes, description);
+  }
+  gt_feature_node_iterator_delete(iter);
+  gt_str_delete(description);
+}
+
+static int milocus_stream_attribute_compare(const void *p1, const void *p2)
+{
+  const AgnMilocusAttribute *a1 = p1;
+  const AgnMilocusAttribute *a2 = p2;
+  return strcmp(a1->key, a2->key);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *milocus_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, milocus_stream_class_init);
+  return nsc;
+}
+
+static void milocus_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnMilocusStream),
+                                 milocus_stream_free,
+                                 milocus_stream_next);
+}
+
+static GtGenomeNode *milocus_stream_copy(GtFeatureNode *ilocus)
+{
+  GtGenomeNode *gn = (GtGenomeNode *)ilocus;
+  GtRange range = gt_genome_node_get_range(gn);
+  GtGenomeNode *copy = gt_feature_node_new(gt_genome_node_get_seqid(gn),
+                                           gt_feature_node_get_type(ilocus),
+                                           range.start, range.end,
+                                           gt_feature_node_get_strand(ilocus));
+  GtFeatureNode *copyfn = gt_feature_node_cast(copy);
+  GtStr *source = gt_str_new_cstr(gt_feature_node_get_source(ilocus));
+  gt_feature_node_set_source(copyfn, source);
+  gt_str_delete(source);
+  if(gt_feature_node_score_is_defined(ilocus))
+    gt_feature_node_set_score(copyfn, gt_feature_node_get_score(ilocus));
+
+  GtStrArray *attrkeys = gt_feature_node_get_attribute_list(ilocus);
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(attrkeys); i++)
+  {
+    const char *key = gt_str_array_get(attrkeys, i);
+    if(strcmp(key, "ID") == 0 || strcmp(key, "Name") == 0)
+      continue;
+    const char *value = gt_feature_node_get_attribute(ilocus, key);
+    gt_feature_node_add_attribute(copyfn, key, value);
+  }
+  gt_str_array_delete(attrkeys);
+  return copy;
+}
+
+static int milocus_stream_flush(AgnMilocusStream *stream, GtError *error)
+{
+  GtUword numiloci = gt_array_size(stream->iloci);
+  if(numiloci == 0)
+    return 0;
+
+  GtGenomeNode *gn;
+  if(numiloci == 1)
+    gn = gt_genome_node_ref(*(GtGenomeNode **)gt_array_get(stream->iloci, 0));
+  else
+    gn = milocus_stream_merge(stream);
+  milocus_stream_reset(stream);
+  return milocus_stream_write(stream, gn, error);
+}
+
+static void milocus_stream_free(GtNodeStream *ns)
+{
+  AgnMilocusStream *stream = milocus_stream_cast(ns);
+  milocus_stream_reset(stream);
+  gt_node_stream_delete(stream->in_stream);
+  gt_node_visitor_delete(stream->writer);
+  gt_array_delete(stream->iloci);
+  gt_array_delete(stream->sums);
+  gt_str_array_delete(stream->genes);
+}
+
+static bool milocus_stream_is_mergeable(GtFeatureNode *ilocus)
+{
+  const char *type = gt_feature_node_get_attribute(ilocus, "iLocus_type");
+  if(type == NULL || (strcmp(type, "siLocus") && strcmp(type, "niLocus")))
+    return false;
+
+  const char *exc = gt_feature_node_get_attribute(ilocus, "iiLocus_exception");
+  return exc == NULL || strstr(exc, "intron-gene") == NULL;
+}
+
+static bool milocus_stream_is_numeric(const char *value)
+{
+  if(*value == '\0')
+    return false;
+  for(; *value != '\0'; value++)
+  {
+    if(*value < '0' || *value > '9')
+      return false;
+  }
+  return true;
+}
+
+static GtGenomeNode *milocus_stream_merge(AgnMilocusStream *stream)
+{
+  GtUword numiloci = gt_array_size(stream->iloci);
+  GtGenomeNode *first = *(GtGenomeNode **)gt_array_get(stream->iloci, 0);
+  GtRange range = gt_genome_node_get_range(first);
+  GtUword i;
+  for(i = 1; i < numiloci; i++)
+  {
+    GtGenomeNode *ilocus = *(GtGenomeNode **)gt_array_get(stream->iloci, i);
+    GtRange ilocusrange = gt_genome_node_get_range(ilocus);
+    range = gt_range_join(&range, &ilocusrange);
+  }
+
+  GtGenomeNode *gn = gt_feature_node_new(gt_genome_node_get_seqid(first),
+                                         "locus", range.start, range.end,
+                                         GT_STRAND_BOTH);
+  GtFeatureNode *milocus = gt_feature_node_cast(gn);
+  const char *srcstr = gt_feature_node_get_source((GtFeatureNode *)first);
+  GtStr *source = gt_str_new_cstr(srcstr);
+  gt_feature_node_set_source(milocus, source);
+  gt_str_delete(source);
+  gt_feature_node_set_score(milocus, (float)numiloci);
+  gt_feature_node_add_attribute(milocus, "iLocus_type", "miLocus");
+
+  char key[32];
+  char value[32];
+  gt_array_sort(stream->sums, milocus_stream_attribute_compare);
+  for(i = 0; i < gt_array_size(stream->sums); i++)
+  {
+    AgnMilocusAttribute *attr = gt_array_get(stream->sums, i);
+    sprintf(value, "%lu", attr->sum);
+    gt_feature_node_add_attribute(milocus, attr->key, value);
+  }
+  for(i = 0; i < gt_str_array_size(stream->genes); i++)
+  {
+    sprintf(key, "miLocusGene%lu", i + 1);
+    gt_feature_node_add_attribute(milocus, key,
+                                  gt_str_array_get(stream->genes, i));
+  }
+
+  return gn;
+}
+
+static int milocus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnMilocusStream *stream = milocus_stream_cast(ns);
+  int result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result)
+    return result;
+  if(*gn == NULL)
+    return milocus_stream_flush(stream, error);
+
+  GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+  if(fn == NULL)
+  {
+    if(milocus_stream_flush(stream, error))
+      return -1;
+    if(gt_region_node_try_cast(*gn))
+      return gt_genome_node_accept(*gn, stream->writer, error);
+    return 0;
+  }
+  if(strcmp(gt_feature_node_get_type(fn), "locus") != 0)
+    return 0;
+
+  if(gt_array_size(stream->iloci) > 0)
+  {
+    GtGenomeNode *prev = *(GtGenomeNode **)gt_array_get(stream->iloci, 0);
+    if(gt_str_cmp(gt_genome_node_get_seqid(prev),
+                  gt_genome_node_get_seqid(*gn)) != 0)
+    {
+      if(milocus_stream_flush(stream, error))
+        return -1;
+    }
+  }
+
+  if(milocus_stream_is_mergeable(fn))
+  {
+    milocus_stream_add(stream, fn);
+    return 0;
+  }
+
+  if(milocus_stream_flush(stream, error))
+    return -1;
+  return milocus_stream_write(stream, milocus_stream_copy(fn), error);
+}
+
+static void milocus_stream_reset(AgnMilocusStream *stream)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->iloci); i++)
+  {
+    GtGenomeNode **ilocus = gt_array_get(stream->iloci, i);
+    gt_genome_node_delete(*ilocus);
+  }
+  gt_array_reset(stream->iloci);
+
+  for(i = 0; i < gt_array_size(stream->sums); i++)
+  {
+    AgnMilocusAttribute *attr = gt_array_get(stream->sums, i);
+    gt_free(attr->key);
+  }
+  gt_array_reset(stream->sums);
+
+  gt_str_array_delete(stream->genes);
+  stream->genes = gt_str_array_new();
+}
+
+static void milocus_stream_test_gene(GtFeatureNode *ilocus, const char *name,
+                                     GtUword start, GtUword end,
+                                     GtStrand strand)
+{
+  GtStr *seqid = gt_genome_node_get_seqid((GtGenomeNode *)ilocus);
+  GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", start, end, strand);
+  if(name != NULL)
+    gt_feature_node_add_attribute((GtFeatureNode *)gene, "Name", name);
+  gt_feature_node_add_child(ilocus, (GtFeatureNode *)gene);
+}
+
+static GtFeatureNode *milocus_stream_test_ilocus(GtStr *seqid, GtUword start,
+                                                 GtUword end, const char *type,
+                                                 const char *attrs)
+{
+  GtGenomeNode *gn = gt_feature_node_new(seqid, "locus", start, end,
+                                         GT_STRAND_BOTH);
+  GtFeatureNode *fn = gt_feature_node_cast(gn);
+  char name[32];
+  sprintf(name, "iLocus%lu", start);
+  gt_feature_node_add_attribute(fn, "Name", name);
+  gt_feature_node_add_attribute(fn, "iLocus_type", type);
+
+  char *attrcopy = gt_cstr_dup(attrs);
+  char *saveptr, *keyvalue;
+  for(keyvalue = strtok_r(attrcopy, ",", &saveptr);
+      keyvalue != NULL;
+      keyvalue = strtok_r(NULL, ",", &saveptr))
+  {
+    char *value = strchr(keyvalue, '=');
+    *value = '\0';
+    gt_feature_node_add_attribute(fn, keyvalue, value + 1);
+  }
+  gt_free(attrcopy);
+  return fn;
+}
+
+static int milocus_stream_write(AgnMilocusStream *stream, GtGenomeNode *gn,
+                                GtError *error)
+{
+  int result = gt_genome_node_accept(gn, stream->writer, error);
+  gt_genome_node_delete(gn);
+  return result;
+}
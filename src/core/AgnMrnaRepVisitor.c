@@ -7,6 +7,7 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include <string.h>
 #include "core/array_api.h"
 #include "AgnFilterStream.h"
@@ -39,6 +40,11 @@ struct AgnMrnaRepVisitor
  */
 static const GtNodeVisitorClass *mrna_rep_visitor_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void mrna_rep_visitor_class_init(void);
+
 /**
  * @function Release memory.
  */
@@ -110,19 +116,23 @@ bool agn_mrna_rep_visitor_unit_test(AgnUnitTest *test)
   return agn_unit_test_success(test);
 }
 
-static const GtNodeVisitorClass *mrna_rep_visitor_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *mrna_rep_visitor_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (AgnMrnaRepVisitor),
-                                    mrna_rep_visitor_free, NULL,
-                                    mrna_rep_visit_feature_node, NULL, NULL,
-                                    NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, mrna_rep_visitor_class_init);
   return nvc;
 }
 
+static void mrna_rep_visitor_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (AgnMrnaRepVisitor),
+                                  mrna_rep_visitor_free, NULL,
+                                  mrna_rep_visit_feature_node, NULL, NULL,
+                                  NULL);
+}
+
 static void mrna_rep_visitor_free(GtNodeVisitor *nv)
 {
   AgnMrnaRepVisitor *v = mrna_rep_visitor_cast(nv);
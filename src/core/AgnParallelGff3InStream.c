@@ -0,0 +1,1083 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "core/cstr_api.h"
+#include "core/cstr_table_api.h"
+#include "core/file_api.h"
+#include "core/hashmap_api.h"
+#include "core/ma_api.h"
+#include "core/queue_api.h"
+#include "core/thread_api.h"
+#include "extended/gff3_in_stream_api.h"
+#include "extended/gff3_parser_api.h"
+#include "extended/gff3_visitor_api.h"
+#include "AgnParallelGff3InStream.h"
+#include "AgnUtils.h"
+
+#define parallel_gff3_in_stream_cast(GS)\
+        gt_node_stream_cast(parallel_gff3_in_stream_class(), GS)
+
+// Default chunk size: 4 MB
+#define PARALLEL_GFF3_CHUNK_SIZE (1 << 22)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+// A ##sequence-region directive found while scanning a chunk
+typedef struct
+{
+  char *seqid;
+  const char *line;
+  GtUword length;
+  GtUword chunk;
+} AgnGff3Region;
+
+// An ID attribute and the line on which it occurs
+typedef struct
+{
+  const char *id;
+  GtUword line;
+} AgnGff3Id;
+
+// A section of an input file that is parsed by its own GFF3 parser; data is
+// NULL if the entire file is read through a GtFile
+typedef struct
+{
+  GtUword file;
+  const char *data;
+  GtUword length;
+  bool last;
+  GtUword numlines;
+  bool fasta;
+  GtArray *regions;
+  GtArray *seqidlist;
+  GtHashmap *seqids;
+  GtStr *header;
+  GtUword headerlines;
+  GtUword linenum;
+  GtHashmap *replayed;
+  GtArray *nodes;
+  GtUword next;
+  GtArray *ids;
+  bool parsed;
+  int result;
+  GtError *error;
+} AgnGff3Chunk;
+
+// An input file, memory-mapped if it can be split into chunks
+typedef struct
+{
+  const char *filename;
+  void *map;
+  GtUword mapsize;
+  GtUword firstchunk;
+  GtUword numchunks;
+} AgnGff3File;
+
+struct AgnParallelGff3InStream
+{
+  const GtNodeStream parent_instance;
+  GtArray *files;
+  GtArray *chunks;
+  GtUword chunksize;
+  int numthreads;
+  bool split;
+  GtUword current;
+  GtUword nextjob;
+  GtUword window;
+  bool stop;
+  GtHashmap *ids;
+  GtUword idfile;
+  pthread_t *threads;
+  pthread_mutex_t lock;
+  pthread_cond_t parsed_cond;
+  pthread_cond_t window_cond;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Add a new chunk of a file to the stream.
+ */
+static AgnGff3Chunk *parallel_gff3_in_stream_add_chunk(
+                                             AgnParallelGff3InStream *stream,
+                                             GtUword file, const char *data,
+                                             GtUword length);
+
+/**
+ * @function Before a chunk is passed downstream, check that none of the IDs it
+ * uses occurred in a preceding chunk of the same file.
+ */
+static int parallel_gff3_in_stream_check_ids(AgnParallelGff3InStream *stream,
+                                             AgnGff3Chunk *chunk,
+                                             GtError *error);
+
+/**
+ * @function Free the scan data of a chunk once it is no longer needed.
+ */
+static void parallel_gff3_in_stream_chunk_clear(AgnGff3Chunk *chunk);
+
+/**
+ * @function Destructor for chunks, deleting any nodes not passed downstream.
+ */
+static void parallel_gff3_in_stream_chunk_delete(AgnGff3Chunk *chunk);
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *parallel_gff3_in_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void parallel_gff3_in_stream_class_init(void);
+
+/**
+ * @function Record the IDs used by a parsed chunk.
+ */
+static void parallel_gff3_in_stream_collect_ids(AgnGff3Chunk *chunk);
+
+/**
+ * @function Destructor: stop the parsing threads and release all memory.
+ */
+static void parallel_gff3_in_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pass the nodes of each chunk downstream once it has been parsed.
+ */
+static int parallel_gff3_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                        GtError *error);
+
+/**
+ * @function Memory-map the given file and split it into chunks, or add a
+ * single chunk for the entire file if it is compressed, empty, or standard
+ * input.
+ */
+static int parallel_gff3_in_stream_open(AgnParallelGff3InStream *stream,
+                                        GtUword file, GtError *error);
+
+/**
+ * @function Parse a chunk, discarding the region nodes created by the
+ * directives replayed from preceding chunks.
+ */
+static void parallel_gff3_in_stream_parse(AgnParallelGff3InStream *stream,
+                                          AgnGff3Chunk *chunk);
+
+/**
+ * @function Parsing thread: parse chunks in order, staying no more than a
+ * fixed number of chunks ahead of the chunk being passed downstream.
+ */
+static void *parallel_gff3_in_stream_parse_chunks(void *data);
+
+/**
+ * @function Merge all chunks of a file into a single chunk spanning the
+ * file's first ``length`` bytes.
+ */
+static void parallel_gff3_in_stream_merge(AgnParallelGff3InStream *stream,
+                                          AgnGff3File *file, GtUword length);
+
+/**
+ * @function Scan the lines of a chunk, recording the sequence IDs of its
+ * features, its ``##sequence-region`` directives, its number of lines, and
+ * whether it contains the start of a FASTA section.
+ */
+static void parallel_gff3_in_stream_scan(AgnGff3Chunk *chunk);
+
+/**
+ * @function Scanning thread: scan chunks until none remain.
+ */
+static void *parallel_gff3_in_stream_scan_chunks(void *data);
+
+/**
+ * @function Open and split all input files, scan the chunks in parallel, and
+ * start the parsing threads.
+ */
+static int parallel_gff3_in_stream_split(AgnParallelGff3InStream *stream,
+                                         GtError *error);
+
+/**
+ * @function Compute the line numbers and headers of a file's chunks from their
+ * scan data, or merge them if the file cannot be parsed in chunks.
+ */
+static void parallel_gff3_in_stream_stitch(AgnParallelGff3InStream *stream,
+                                           AgnGff3File *file);
+
+/**
+ * @function Return the offset just past the first ``###`` line starting at or
+ * after ``start``, or ``length`` if there is none.
+ */
+static GtUword parallel_gff3_in_stream_terminator(const char *data,
+                                                  GtUword length,
+                                                  GtUword start);
+
+/**
+ * @function Read a file with the serial GFF3 parser and with the parallel
+ * parser using the given chunk size, and compare the nodes produced.
+ */
+static bool parallel_gff3_in_stream_test_compare(int numfiles,
+                                                 const char **filenames,
+                                                 GtUword chunksize,
+                                                 int numthreads,
+                                                 bool *linenums);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_parallel_gff3_in_stream_new(int numfiles,
+                                              const char **filenames,
+                                              int numthreads)
+{
+  agn_assert(numfiles > 0 && filenames && numthreads > 0);
+  GtNodeStream *ns = gt_node_stream_create(parallel_gff3_in_stream_class(),
+                                           false);
+  AgnParallelGff3InStream *stream = parallel_gff3_in_stream_cast(ns);
+  stream->files = gt_array_new( sizeof(AgnGff3File) );
+  int i;
+  for(i = 0; i < numfiles; i++)
+  {
+    AgnGff3File file = { filenames[i], NULL, 0, 0, 0 };
+    gt_array_add(stream->files, file);
+  }
+  stream->chunks = gt_array_new( sizeof(AgnGff3Chunk *) );
+  stream->chunksize = PARALLEL_GFF3_CHUNK_SIZE;
+  stream->numthreads = numthreads;
+  stream->split = false;
+  stream->current = 0;
+  stream->nextjob = 0;
+  stream->window = 2 * numthreads;
+  stream->stop = false;
+  stream->ids = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  stream->idfile = 0;
+  stream->threads = NULL;
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->parsed_cond, NULL);
+  pthread_cond_init(&stream->window_cond, NULL);
+  return ns;
+}
+
+void agn_parallel_gff3_in_stream_set_chunk_size(AgnParallelGff3InStream *stream,
+                                                GtUword chunksize)
+{
+  agn_assert(stream && chunksize > 0 && !stream->split);
+  stream->chunksize = chunksize;
+}
+
+bool agn_parallel_gff3_in_stream_unit_test(AgnUnitTest *test)
+{
+  const char *amel[] = { "data/gff3/amel-ogs-g7.gff3" };
+  bool linenums;
+  bool test1 = parallel_gff3_in_stream_test_compare(1, amel, 4096, 3,
+                                                    &linenums);
+  agn_unit_test_result(test, "many chunks", test1);
+  agn_unit_test_result(test, "line numbers", linenums);
+
+  bool test2 = parallel_gff3_in_stream_test_compare(1, amel, 4096, 1,
+                                                    &linenums);
+  agn_unit_test_result(test, "single thread", test2 && linenums);
+
+  const char *grape[] = { "data/gff3/grape-refr.gff3",
+                          "data/gff3/grape-pred.gff3" };
+  bool test3 = parallel_gff3_in_stream_test_compare(2, grape, 2048, 4,
+                                                    &linenums);
+  agn_unit_test_result(test, "multiple files", test3 && linenums);
+
+  const char *nosplit[] = { "data/gff3/grape-refr.gff3" };
+  bool test4 = parallel_gff3_in_stream_test_compare(1, nosplit,
+                                                    PARALLEL_GFF3_CHUNK_SIZE,
+                                                    2, &linenums);
+  agn_unit_test_result(test, "single chunk", test4 && linenums);
+
+  return agn_unit_test_success(test);
+}
+
+static AgnGff3Chunk *parallel_gff3_in_stream_add_chunk(
+                                             AgnParallelGff3InStream *stream,
+                                             GtUword file, const char *data,
+                                             GtUword length)
+{
+  AgnGff3Chunk *chunk = gt_malloc( sizeof(AgnGff3Chunk) );
+  memset(chunk, 0, sizeof (AgnGff3Chunk));
+  chunk->file = file;
+  chunk->data = data;
+  chunk->length = length;
+  chunk->error = gt_error_new();
+  gt_array_add(stream->chunks, chunk);
+  return chunk;
+}
+
+static int parallel_gff3_in_stream_check_ids(AgnParallelGff3InStream *stream,
+                                             AgnGff3Chunk *chunk,
+                                             GtError *error)
+{
+  if(chunk->ids == NULL)
+    return 0;
+  if(chunk->file != stream->idfile)
+  {
+    gt_hashmap_reset(stream->ids);
+    stream->idfile = chunk->file;
+  }
+
+  // IDs shared by the parts of a multi-feature all occur in the same chunk.
+  AgnGff3File *file = gt_array_get(stream->files, chunk->file);
+  GtUword i;
+  for(i = 0; i < gt_array_size(chunk->ids); i++)
+  {
+    AgnGff3Id *id = gt_array_get(chunk->ids, i);
+    GtUword prevline = (GtUword)gt_hashmap_get(stream->ids, id->id);
+    if(prevline == 0)
+      gt_hashmap_add(stream->ids, gt_cstr_dup(id->id), (void *)id->line);
+    else if(prevline <= chunk->linenum)
+    {
+      gt_error_set(error, "the ID \"%s\" on line %lu in file \"%s\" has been "
+                   "used before (line %lu)", id->id, id->line, file->filename,
+                   prevline);
+      return -1;
+    }
+  }
+  gt_array_delete(chunk->ids);
+  chunk->ids = NULL;
+  return 0;
+}
+
+static void parallel_gff3_in_stream_chunk_clear(AgnGff3Chunk *chunk)
+{
+  GtUword i;
+  if(chunk->regions != NULL)
+  {
+    for(i = 0; i < gt_array_size(chunk->regions); i++)
+    {
+      AgnGff3Region *region = gt_array_get(chunk->regions, i);
+      gt_free(region->seqid);
+    }
+    gt_array_delete(chunk->regions);
+    chunk->regions = NULL;
+  }
+  if(chunk->seqidlist != NULL)
+  {
+    for(i = 0; i < gt_array_size(chunk->seqidlist); i++)
+      gt_free(*(char **)gt_array_get(chunk->seqidlist, i));
+    gt_array_delete(chunk->seqidlist);
+    gt_hashmap_delete(chunk->seqids);
+    chunk->seqidlist = NULL;
+    chunk->seqids = NULL;
+  }
+}
+
+static void parallel_gff3_in_stream_chunk_delete(AgnGff3Chunk *chunk)
+{
+  parallel_gff3_in_stream_chunk_clear(chunk);
+  if(chunk->nodes != NULL)
+  {
+    GtUword i;
+    for(i = chunk->next; i < gt_array_size(chunk->nodes); i++)
+    {
+      GtGenomeNode **gn = gt_array_get(chunk->nodes, i);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(chunk->nodes);
+  }
+  if(chunk->ids != NULL)
+    gt_array_delete(chunk->ids);
+  if(chunk->header != NULL)
+    gt_str_delete(chunk->header);
+  if(chunk->replayed != NULL)
+    gt_hashmap_delete(chunk->replayed);
+  gt_error_delete(chunk->error);
+  gt_free(chunk);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *parallel_gff3_in_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, parallel_gff3_in_stream_class_init);
+  return nsc;
+}
+
+static void parallel_gff3_in_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnParallelGff3InStream),
+                                 parallel_gff3_in_stream_free,
+                                 parallel_gff3_in_stream_next);
+}
+
+static void parallel_gff3_in_stream_collect_ids(AgnGff3Chunk *chunk)
+{
+  chunk->ids = gt_array_new( sizeof(AgnGff3Id) );
+  GtUword i;
+  for(i = 0; i < gt_array_size(chunk->nodes); i++)
+  {
+    GtGenomeNode **gn = gt_array_get(chunk->nodes, i);
+    GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+    if(fn == NULL)
+      continue;
+
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *current;
+    for(current = gt_feature_node_iterator_next(iter);
+        current != NULL;
+        current = gt_feature_node_iterator_next(iter))
+    {
+      if(gt_feature_node_is_pseudo(current))
+        continue;
+      const char *id = gt_feature_node_get_attribute(current, "ID");
+      if(id == NULL)
+        continue;
+      GtGenomeNode *node = (GtGenomeNode *)current;
+      AgnGff3Id newid = { id, gt_genome_node_get_line_number(node) };
+      gt_array_add(chunk->ids, newid);
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+}
+
+static void parallel_gff3_in_stream_free(GtNodeStream *ns)
+{
+  AgnParallelGff3InStream *stream = parallel_gff3_in_stream_cast(ns);
+  if(stream->threads != NULL)
+  {
+    pthread_mutex_lock(&stream->lock);
+    stream->stop = true;
+    pthread_cond_broadcast(&stream->window_cond);
+    pthread_mutex_unlock(&stream->lock);
+    int i;
+    for(i = 0; i < stream->numthreads; i++)
+      pthread_join(stream->threads[i], NULL);
+    gt_free(stream->threads);
+  }
+
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->chunks); i++)
+  {
+    AgnGff3Chunk *chunk = *(AgnGff3Chunk **)gt_array_get(stream->chunks, i);
+    if(chunk != NULL)
+      parallel_gff3_in_stream_chunk_delete(chunk);
+  }
+  gt_array_delete(stream->chunks);
+  for(i = 0; i < gt_array_size(stream->files); i++)
+  {
+    AgnGff3File *file = gt_array_get(stream->files, i);
+    if(file->map != NULL)
+      munmap(file->map, file->mapsize);
+  }
+  gt_array_delete(stream->files);
+  gt_hashmap_delete(stream->ids);
+  pthread_cond_destroy(&stream->parsed_cond);
+  pthread_cond_destroy(&stream->window_cond);
+  pthread_mutex_destroy(&stream->lock);
+}
+
+static int parallel_gff3_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                        GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnParallelGff3InStream *stream = parallel_gff3_in_stream_cast(ns);
+  if(!stream->split)
+  {
+    stream->split = true;
+    if(parallel_gff3_in_stream_split(stream, error))
+      return -1;
+  }
+
+  while(stream->current < gt_array_size(stream->chunks))
+  {
+    AgnGff3Chunk **chunk = gt_array_get(stream->chunks, stream->current);
+    if(stream->threads == NULL && !(*chunk)->parsed)
+    {
+      parallel_gff3_in_stream_parse(stream, *chunk);
+      (*chunk)->parsed = true;
+    }
+    pthread_mutex_lock(&stream->lock);
+    while(!(*chunk)->parsed)
+      pthread_cond_wait(&stream->parsed_cond, &stream->lock);
+    pthread_mutex_unlock(&stream->lock);
+
+    if((*chunk)->result)
+    {
+      gt_error_set(error, "%s", gt_error_get((*chunk)->error));
+      return -1;
+    }
+    if(parallel_gff3_in_stream_check_ids(stream, *chunk, error))
+      return -1;
+    if((*chunk)->next < gt_array_size((*chunk)->nodes))
+    {
+      *gn = *(GtGenomeNode **)gt_array_get((*chunk)->nodes, (*chunk)->next);
+      (*chunk)->next++;
+      return 0;
+    }
+
+    parallel_gff3_in_stream_chunk_delete(*chunk);
+    *chunk = NULL;
+    pthread_mutex_lock(&stream->lock);
+    stream->current++;
+    pthread_cond_broadcast(&stream->window_cond);
+    pthread_mutex_unlock(&stream->lock);
+  }
+
+  *gn = NULL;
+  return 0;
+}
+
+static int parallel_gff3_in_stream_open(AgnParallelGff3InStream *stream,
+                                        GtUword fileindex, GtError *error)
+{
+  AgnGff3File *file = gt_array_get(stream->files, fileindex);
+  file->firstchunk = gt_array_size(stream->chunks);
+  file->numchunks = 1;
+  if(strcmp(file->filename, "-") == 0 ||
+     gt_file_mode_determine(file->filename) != GT_FILE_MODE_UNCOMPRESSED)
+  {
+    AgnGff3Chunk *chunk = parallel_gff3_in_stream_add_chunk(stream, fileindex,
+                                                            NULL, 0);
+    chunk->last = true;
+    return 0;
+  }
+
+  int fd = open(file->filename, O_RDONLY);
+  if(fd == -1)
+  {
+    gt_error_set(error, "could not open GFF3 file '%s': %s", file->filename,
+                 strerror(errno));
+    return -1;
+  }
+  struct stat filestat;
+  if(fstat(fd, &filestat) != 0)
+  {
+    gt_error_set(error, "could not read GFF3 file '%s': %s", file->filename,
+                 strerror(errno));
+    close(fd);
+    return -1;
+  }
+  if(!S_ISREG(filestat.st_mode) || filestat.st_size == 0)
+  {
+    close(fd);
+    AgnGff3Chunk *chunk = parallel_gff3_in_stream_add_chunk(stream, fileindex,
+                                                            NULL, 0);
+    chunk->last = true;
+    return 0;
+  }
+
+  void *map = mmap(NULL, filestat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    gt_error_set(error, "could not map GFF3 file '%s': %s", file->filename,
+                 strerror(errno));
+    return -1;
+  }
+  file->map = map;
+  file->mapsize = filestat.st_size;
+
+  const char *data = map;
+  GtUword start = 0;
+  file->numchunks = 0;
+  while(start < file->mapsize)
+  {
+    GtUword end = file->mapsize;
+    if(file->mapsize - start > stream->chunksize)
+    {
+      end = parallel_gff3_in_stream_terminator(data, file->mapsize,
+                                               start + stream->chunksize);
+    }
+    parallel_gff3_in_stream_add_chunk(stream, fileindex, data + start,
+                                      end - start);
+    file->numchunks++;
+    start = end;
+  }
+  AgnGff3Chunk **last = gt_array_get(stream->chunks,
+                                     gt_array_size(stream->chunks) - 1);
+  (*last)->last = true;
+  return 0;
+}
+
+static void parallel_gff3_in_stream_parse(AgnParallelGff3InStream *stream,
+                                          AgnGff3Chunk *chunk)
+{
+  AgnGff3File *file = gt_array_get(stream->files, chunk->file);
+  chunk->nodes = gt_array_new( sizeof(GtGenomeNode *) );
+
+  FILE *instream = NULL;
+  char *buffer = NULL;
+  GtFile *infile;
+  if(chunk->data == NULL && strcmp(file->filename, "-") == 0)
+    infile = gt_file_new_from_fileptr(stdin);
+  else if(chunk->data == NULL)
+  {
+    infile = gt_file_new(file->filename, "r", chunk->error);
+    if(infile == NULL)
+    {
+      chunk->result = -1;
+      return;
+    }
+  }
+  else
+  {
+    // The replayed directives precede the chunk's own lines.
+    GtUword headerlength = 0;
+    if(chunk->header != NULL)
+      headerlength = gt_str_length(chunk->header);
+    if(headerlength > 0)
+    {
+      buffer = gt_malloc(headerlength + chunk->length);
+      memcpy(buffer, gt_str_get(chunk->header), headerlength);
+      memcpy(buffer + headerlength, chunk->data, chunk->length);
+      instream = fmemopen(buffer, headerlength + chunk->length, "r");
+    }
+    else
+      instream = fmemopen((void *)chunk->data, chunk->length, "r");
+    if(instream == NULL)
+    {
+      gt_error_set(chunk->error, "unable to read GFF3 file '%s': %s",
+                   file->filename, strerror(errno));
+      gt_free(buffer);
+      chunk->result = -1;
+      return;
+    }
+    infile = gt_file_new_from_fileptr(instream);
+  }
+
+  GtStr *filename = gt_str_new_cstr(file->filename);
+  GtCstrTable *used_types = gt_cstr_table_new();
+  GtQueue *queue = gt_queue_new();
+  GtGFF3Parser *parser = gt_gff3_parser_new(NULL);
+  gt_gff3_parser_check_id_attributes(parser);
+  gt_gff3_parser_enable_tidy_mode(parser);
+
+  GtUword line_number = chunk->linenum - chunk->headerlines;
+  int status = 0;
+  while(chunk->result == 0 && status != EOF)
+  {
+    chunk->result = gt_gff3_parser_parse_genome_nodes(parser, &status, queue,
+                                                      used_types, filename,
+                                                      &line_number, infile,
+                                                      chunk->error);
+    while(gt_queue_size(queue) > 0)
+    {
+      GtGenomeNode *gn = gt_queue_get(queue);
+      GtRegionNode *rn = gt_region_node_try_cast(gn);
+      bool replayed = rn != NULL && chunk->replayed != NULL &&
+                      gt_hashmap_get(chunk->replayed,
+                               gt_str_get(gt_genome_node_get_seqid(gn))) != NULL;
+      if(replayed || (gt_eof_node_try_cast(gn) && !chunk->last))
+        gt_genome_node_delete(gn);
+      else
+        gt_array_add(chunk->nodes, gn);
+    }
+  }
+
+  gt_gff3_parser_delete(parser);
+  gt_queue_delete(queue);
+  gt_cstr_table_delete(used_types);
+  gt_str_delete(filename);
+  if(instream != NULL)
+  {
+    gt_file_delete_without_handle(infile);
+    fclose(instream);
+  }
+  else if(chunk->data == NULL && strcmp(file->filename, "-") == 0)
+    gt_file_delete_without_handle(infile);
+  else
+    gt_file_delete(infile);
+  gt_free(buffer);
+
+  if(chunk->result == 0 && file->numchunks > 1)
+    parallel_gff3_in_stream_collect_ids(chunk);
+}
+
+static void *parallel_gff3_in_stream_parse_chunks(void *data)
+{
+  AgnParallelGff3InStream *stream = data;
+  pthread_mutex_lock(&stream->lock);
+  while(1)
+  {
+    GtUword numchunks = gt_array_size(stream->chunks);
+    while(!stream->stop && stream->nextjob < numchunks &&
+          stream->nextjob >= stream->current + stream->window)
+      pthread_cond_wait(&stream->window_cond, &stream->lock);
+    if(stream->stop || stream->nextjob >= numchunks)
+      break;
+
+    AgnGff3Chunk *chunk = *(AgnGff3Chunk **)gt_array_get(stream->chunks,
+                                                         stream->nextjob);
+    stream->nextjob++;
+    pthread_mutex_unlock(&stream->lock);
+
+    parallel_gff3_in_stream_parse(stream, chunk);
+
+    pthread_mutex_lock(&stream->lock);
+    chunk->parsed = true;
+    pthread_cond_broadcast(&stream->parsed_cond);
+  }
+  pthread_mutex_unlock(&stream->lock);
+  return NULL;
+}
+
+static void parallel_gff3_in_stream_merge(AgnParallelGff3InStream *stream,
+                                          AgnGff3File *file, GtUword length)
+{
+  AgnGff3Chunk **first = gt_array_get(stream->chunks, file->firstchunk);
+  (*first)->length = length;
+  (*first)->last = true;
+  if((*first)->header != NULL)
+  {
+    gt_str_delete((*first)->header);
+    (*first)->header = NULL;
+  }
+  (*first)->headerlines = 0;
+
+  GtUword i;
+  for(i = 1; i < file->numchunks; i++)
+  {
+    AgnGff3Chunk **chunk = gt_array_get(stream->chunks, file->firstchunk + i);
+    parallel_gff3_in_stream_chunk_delete(*chunk);
+    *chunk = NULL;
+  }
+  file->numchunks = 1;
+}
+
+static void parallel_gff3_in_stream_scan(AgnGff3Chunk *chunk)
+{
+  chunk->regions = gt_array_new( sizeof(AgnGff3Region) );
+  chunk->seqidlist = gt_array_new( sizeof(char *) );
+  chunk->seqids = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  GtStr *seqid = gt_str_new();
+  const char *prevseqid = NULL;
+  GtUword prevlength = 0;
+  const char *regiondirective = "##sequence-region";
+  GtUword regionlength = strlen(regiondirective);
+
+  const char *line = chunk->data;
+  const char *end = chunk->data + chunk->length;
+  while(line < end)
+  {
+    const char *eol = memchr(line, '\n', end - line);
+    if(eol == NULL)
+      eol = end;
+    else
+      chunk->numlines++;
+    GtUword length = eol - line;
+    if(length > 0 && line[length - 1] == '\r')
+      length--;
+
+    if(length == 0)
+      ; // Blank lines are skipped by the parser.
+    else if(line[0] == '>' || (length >= 7 && strncmp(line, "##FASTA", 7) == 0))
+    {
+      chunk->fasta = true;
+      break;
+    }
+    else if(length > regionlength &&
+            strncmp(line, regiondirective, regionlength) == 0)
+    {
+      const char *token = line + regionlength;
+      const char *lineend = line + length;
+      while(token < lineend && (*token == ' ' || *token == '\t'))
+        token++;
+      const char *tokenend = token;
+      while(tokenend < lineend && *tokenend != ' ' && *tokenend != '\t')
+        tokenend++;
+      if(tokenend > token)
+      {
+        AgnGff3Region region;
+        region.seqid = gt_cstr_dup_nt(token, tokenend - token);
+        region.line = line;
+        region.length = length;
+        region.chunk = 0;
+        gt_array_add(chunk->regions, region);
+      }
+    }
+    else if(line[0] != '#')
+    {
+      const char *tab = memchr(line, '\t', length);
+      GtUword seqidlength = tab == NULL ? length : (GtUword)(tab - line);
+      if(prevseqid == NULL || seqidlength != prevlength ||
+         strncmp(line, prevseqid, seqidlength) != 0)
+      {
+        gt_str_reset(seqid);
+        gt_str_append_cstr_nt(seqid, line, seqidlength);
+        if(gt_hashmap_get(chunk->seqids, gt_str_get(seqid)) == NULL)
+        {
+          char *newseqid = gt_cstr_dup(gt_str_get(seqid));
+          gt_array_add(chunk->seqidlist, newseqid);
+          gt_hashmap_add(chunk->seqids, newseqid, newseqid);
+        }
+        prevseqid = line;
+        prevlength = seqidlength;
+      }
+    }
+    line = eol + 1;
+  }
+  gt_str_delete(seqid);
+}
+
+static void *parallel_gff3_in_stream_scan_chunks(void *data)
+{
+  AgnParallelGff3InStream *stream = data;
+  while(1)
+  {
+    AgnGff3Chunk *chunk = NULL;
+    pthread_mutex_lock(&stream->lock);
+    while(stream->nextjob < gt_array_size(stream->chunks) && chunk == NULL)
+    {
+      chunk = *(AgnGff3Chunk **)gt_array_get(stream->chunks, stream->nextjob);
+      AgnGff3File *file = gt_array_get(stream->files, chunk->file);
+      if(file->numchunks == 1)
+        chunk = NULL;
+      stream->nextjob++;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    if(chunk == NULL)
+      break;
+    parallel_gff3_in_stream_scan(chunk);
+  }
+  return NULL;
+}
+
+static int parallel_gff3_in_stream_split(AgnParallelGff3InStream *stream,
+                                         GtError *error)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->files); i++)
+  {
+    if(parallel_gff3_in_stream_open(stream, i, error))
+      return -1;
+  }
+
+  // Without thread support in GenomeTools, chunks are scanned and parsed on
+  // the calling thread.
+  int j;
+  if(gt_multithread_support())
+  {
+    stream->threads = gt_malloc( sizeof(pthread_t) * stream->numthreads );
+    for(j = 0; j < stream->numthreads; j++)
+    {
+      pthread_create(stream->threads + j, NULL,
+                     parallel_gff3_in_stream_scan_chunks, stream);
+    }
+    for(j = 0; j < stream->numthreads; j++)
+      pthread_join(stream->threads[j], NULL);
+  }
+  else
+    parallel_gff3_in_stream_scan_chunks(stream);
+
+  for(i = 0; i < gt_array_size(stream->files); i++)
+  {
+    AgnGff3File *file = gt_array_get(stream->files, i);
+    if(file->numchunks > 1)
+      parallel_gff3_in_stream_stitch(stream, file);
+  }
+
+  // Remove the chunks of files that were merged.
+  GtArray *chunks = gt_array_new( sizeof(AgnGff3Chunk *) );
+  for(i = 0; i < gt_array_size(stream->files); i++)
+  {
+    AgnGff3File *file = gt_array_get(stream->files, i);
+    AgnGff3Chunk **filechunks = gt_array_get(stream->chunks, file->firstchunk);
+    file->firstchunk = gt_array_size(chunks);
+    GtUword k;
+    for(k = 0; k < file->numchunks; k++)
+      gt_array_add(chunks, filechunks[k]);
+  }
+  gt_array_delete(stream->chunks);
+  stream->chunks = chunks;
+
+  stream->nextjob = 0;
+  for(j = 0; stream->threads != NULL && j < stream->numthreads; j++)
+  {
+    pthread_create(stream->threads + j, NULL,
+                   parallel_gff3_in_stream_parse_chunks, stream);
+  }
+  return 0;
+}
+
+static void parallel_gff3_in_stream_stitch(AgnParallelGff3InStream *stream,
+                                           AgnGff3File *file)
+{
+  AgnGff3Chunk **chunks = gt_array_get(stream->chunks, file->firstchunk);
+  GtUword i, j;
+
+  // A FASTA section is parsed with the chunk in which it starts.
+  for(i = 0; i < file->numchunks; i++)
+  {
+    if(chunks[i]->fasta)
+    {
+      chunks[i]->length = (const char *)file->map + file->mapsize -
+                          chunks[i]->data;
+      chunks[i]->last = true;
+      for(j = i + 1; j < file->numchunks; j++)
+      {
+        parallel_gff3_in_stream_chunk_delete(chunks[j]);
+        chunks[j] = NULL;
+      }
+      file->numchunks = i + 1;
+      break;
+    }
+  }
+
+  GtHashmap *declared = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  bool serial = file->numchunks == 1;
+  GtUword linenum = 0;
+  for(i = 0; i < file->numchunks && !serial; i++)
+  {
+    AgnGff3Chunk *chunk = chunks[i];
+    chunk->linenum = linenum;
+    linenum += chunk->numlines;
+
+    for(j = 0; j < gt_array_size(chunk->regions); j++)
+    {
+      AgnGff3Region *region = gt_array_get(chunk->regions, j);
+      region->chunk = i;
+      if(gt_hashmap_get(declared, region->seqid) != NULL)
+        serial = true;
+      else
+        gt_hashmap_add(declared, region->seqid, region);
+    }
+
+    // Sequences without a ##sequence-region directive get a region node only
+    // once the whole file has been read.
+    for(j = 0; j < gt_array_size(chunk->seqidlist) && !serial; j++)
+    {
+      const char *seqid = *(char **)gt_array_get(chunk->seqidlist, j);
+      AgnGff3Region *region = gt_hashmap_get(declared, seqid);
+      if(region == NULL)
+        serial = true;
+      else if(region->chunk < i)
+      {
+        if(chunk->header == NULL)
+        {
+          chunk->header = gt_str_new_cstr("##gff-version 3\n");
+          chunk->headerlines = 1;
+          chunk->replayed = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                           NULL);
+        }
+        gt_str_append_cstr_nt(chunk->header, region->line, region->length);
+        gt_str_append_char(chunk->header, '\n');
+        chunk->headerlines++;
+        gt_hashmap_add(chunk->replayed, gt_cstr_dup(seqid), region);
+      }
+    }
+  }
+  gt_hashmap_delete(declared);
+
+  for(i = 0; i < file->numchunks; i++)
+    parallel_gff3_in_stream_chunk_clear(chunks[i]);
+  if(serial)
+  {
+    GtUword length = chunks[file->numchunks - 1]->data +
+                     chunks[file->numchunks - 1]->length - chunks[0]->data;
+    parallel_gff3_in_stream_merge(stream, file, length);
+  }
+}
+
+static GtUword parallel_gff3_in_stream_terminator(const char *data,
+                                                  GtUword length,
+                                                  GtUword start)
+{
+  const char *end = data + length;
+  const char *pos = data + start - 1;
+  while((pos = memchr(pos, '\n', end - pos)) != NULL)
+  {
+    const char *line = pos + 1;
+    const char *eol = line + 3;
+    if(eol < end && memcmp(line, "###", 3) == 0)
+    {
+      if(*eol == '\r')
+        eol++;
+      if(eol == end)
+        break;
+      if(*eol == '\n')
+        return eol + 1 - data;
+    }
+    pos = line;
+  }
+  return length;
+}
+
+static bool parallel_gff3_in_stream_test_compare(int numfiles,
+                                                 const char **filenames,
+                                                 GtUword chunksize,
+                                                 int numthreads,
+                                                 bool *linenums)
+{
+  GtError *error = gt_error_new();
+  GtNodeStream *serial = gt_gff3_in_stream_new_unsorted(numfiles, filenames);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)serial);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)serial);
+  GtNodeStream *parallel = agn_parallel_gff3_in_stream_new(numfiles, filenames,
+                                                           numthreads);
+  agn_parallel_gff3_in_stream_set_chunk_size(
+                                   (AgnParallelGff3InStream *)parallel,
+                                   chunksize);
+
+  char *expbuffer, *buffer;
+  size_t expbuffersize, buffersize;
+  FILE *expfp = open_memstream(&expbuffer, &expbuffersize);
+  FILE *fp = open_memstream(&buffer, &buffersize);
+  GtFile *expfile = gt_file_new_from_fileptr(expfp);
+  GtFile *outfile = gt_file_new_from_fileptr(fp);
+  GtNodeVisitor *expvisitor = gt_gff3_visitor_new(expfile);
+  GtNodeVisitor *visitor = gt_gff3_visitor_new(outfile);
+  gt_gff3_visitor_retain_id_attributes((GtGFF3Visitor *)expvisitor);
+  gt_gff3_visitor_retain_id_attributes((GtGFF3Visitor *)visitor);
+
+  *linenums = true;
+  bool samecount = true;
+  int result = 0;
+  while(result == 0)
+  {
+    GtGenomeNode *expgn, *gn;
+    result = gt_node_stream_next(serial, &expgn, error);
+    if(result == 0)
+      result = gt_node_stream_next(parallel, &gn, error);
+    if(result)
+      break;
+    if(expgn == NULL || gn == NULL)
+    {
+      samecount = expgn == gn;
+      gt_genome_node_delete(expgn);
+      gt_genome_node_delete(gn);
+      break;
+    }
+    *linenums = *linenums && gt_genome_node_get_line_number(expgn) ==
+                             gt_genome_node_get_line_number(gn);
+    result = gt_genome_node_accept(expgn, expvisitor, error);
+    if(result == 0)
+      result = gt_genome_node_accept(gn, visitor, error);
+    gt_genome_node_delete(expgn);
+    gt_genome_node_delete(gn);
+  }
+
+  gt_node_visitor_delete(expvisitor);
+  gt_node_visitor_delete(visitor);
+  gt_file_delete_without_handle(expfile);
+  gt_file_delete_without_handle(outfile);
+  fclose(expfp);
+  fclose(fp);
+  bool match = result == 0 && samecount && strcmp(buffer, expbuffer) == 0;
+  free(expbuffer);
+  free(buffer);
+  gt_node_stream_delete(serial);
+  gt_node_stream_delete(parallel);
+  gt_error_delete(error);
+  return match;
+}
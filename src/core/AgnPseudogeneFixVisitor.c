@@ -7,10 +7,12 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include <string.h>
 #include "core/array_api.h"
 #include "AgnPseudogeneFixVisitor.h"
 #include "AgnTypecheck.h"
+#include "AgnUtils.h"
 
 
 //------------------------------------------------------------------------------
@@ -22,6 +24,11 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
  */
 static const GtNodeVisitorClass *pseudogene_fix_visitor_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void pseudogene_fix_visitor_class_init(void);
+
 /**
  * @function Generate data for unit testing.
  */
@@ -122,17 +129,21 @@ bool agn_pseudogene_fix_visitor_unit_test(AgnUnitTest *test)
   return agn_unit_test_success(test);
 }
 
-static const GtNodeVisitorClass *pseudogene_fix_visitor_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *pseudogene_fix_visitor_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (GtNodeVisitor), NULL, NULL,
-                                    visit_feature_node, NULL, NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, pseudogene_fix_visitor_class_init);
   return nvc;
 }
 
+static void pseudogene_fix_visitor_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (GtNodeVisitor), NULL, NULL,
+                                  visit_feature_node, NULL, NULL, NULL);
+}
+
 static void pseudogene_fix_visitor_test_data(GtQueue *queue)
 {
   GtArray *source, *dest;
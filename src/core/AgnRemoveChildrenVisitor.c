@@ -7,6 +7,7 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <pthread.h>
 #include "AgnRemoveChildrenVisitor.h"
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
@@ -21,6 +22,11 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
  */
 static const GtNodeVisitorClass *remove_children_visitor_class();
 
+/**
+ * @function Create the class object, exactly once.
+ */
+static void remove_children_visitor_class_init(void);
+
 /**
  * @function Generate data for unit testing.
  */
@@ -67,17 +73,21 @@ bool agn_remove_children_visitor_unit_test(AgnUnitTest *test)
   return agn_unit_test_success(test);
 }
 
-static const GtNodeVisitorClass *remove_children_visitor_class()
+static const GtNodeVisitorClass *nvc = NULL;
+
+static const GtNodeVisitorClass *remove_children_visitor_class(void)
 {
-  static const GtNodeVisitorClass *nvc = NULL;
-  if(!nvc)
-  {
-    nvc = gt_node_visitor_class_new(sizeof (GtNodeVisitor), NULL, NULL,
-                                    visit_feature_node, NULL, NULL, NULL);
-  }
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, remove_children_visitor_class_init);
   return nvc;
 }
 
+static void remove_children_visitor_class_init(void)
+{
+  nvc = gt_node_visitor_class_new(sizeof (GtNodeVisitor), NULL, NULL,
+                                  visit_feature_node, NULL, NULL, NULL);
+}
+
 static void remove_children_visitor_test_data(GtQueue *queue)
 {
   GtError *error = gt_error_new();
@@ -0,0 +1,228 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <math.h>
+#include <string.h>
+#include "core/ma_api.h"
+#include "AgnSeqComposition.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Count the bases of ``seq`` one character at a time.
+ */
+static void seq_composition_count_scalar(AgnSeqComposition *comp,
+                                         const char *seq, GtUword length);
+
+#if defined(__SSE2__)
+/**
+ * @function Count the bases of ``seq`` 16 characters at a time, stopping short
+ * of the last ``length % 16`` characters. Returns the number of characters
+ * counted.
+ */
+static GtUword seq_composition_count_sse2(AgnSeqComposition *comp,
+                                          const char *seq, GtUword length);
+
+/**
+ * @function Sum the 16 byte counters in ``acc``.
+ */
+static GtUword seq_composition_sum(__m128i acc);
+#endif
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_seq_composition_count(AgnSeqComposition *comp, const char *seq,
+                               GtUword length)
+{
+  GtUword counted = 0;
+#if defined(__SSE2__)
+  counted = seq_composition_count_sse2(comp, seq, length);
+#endif
+  seq_composition_count_scalar(comp, seq + counted, length - counted);
+}
+
+double agn_seq_composition_gc_content(AgnSeqComposition *comp)
+{
+  if(comp->at + comp->gc == 0)
+    return 0.0;
+  return (double)comp->gc / (double)(comp->at + comp->gc);
+}
+
+double agn_seq_composition_gc_skew(AgnSeqComposition *comp)
+{
+  if(comp->g + comp->c == 0)
+    return 0.0;
+  return ((double)comp->g - (double)comp->c) / (double)(comp->g + comp->c);
+}
+
+double agn_seq_composition_n_content(AgnSeqComposition *comp)
+{
+  if(comp->length == 0)
+    return 0.0;
+  return (double)comp->n / (double)comp->length;
+}
+
+void agn_seq_composition_reset(AgnSeqComposition *comp)
+{
+  memset(comp, 0, sizeof(AgnSeqComposition));
+}
+
+void agn_seq_composition_reverse(AgnSeqComposition *comp)
+{
+  GtUword g = comp->g;
+  comp->g = comp->c;
+  comp->c = g;
+}
+
+bool agn_seq_composition_unit_test(AgnUnitTest *test)
+{
+  AgnSeqComposition comp;
+  agn_seq_composition_reset(&comp);
+  agn_seq_composition_count(&comp, "ACGTNNGGCCSW", 12);
+  bool test1 = comp.length == 12 && comp.at == 3 && comp.gc == 7 &&
+               comp.g == 3 && comp.c == 3 && comp.n == 2 &&
+               fabs(agn_seq_composition_gc_content(&comp) - 0.7) < 1e-9 &&
+               agn_seq_composition_gc_skew(&comp) == 0.0 &&
+               fabs(agn_seq_composition_n_content(&comp) - 2.0/12.0) < 1e-9;
+  agn_unit_test_result(test, "short sequence", test1);
+
+  // Long enough to overflow the byte counters of the vectorized path several
+  // times, with a tail that is not a multiple of 16.
+  const char *repeat = "acgtNxgsw-";
+  GtUword i, length = 10003;
+  char *seq = gt_malloc( sizeof(char) * (length + 1) );
+  for(i = 0; i < length; i++)
+    seq[i] = repeat[i % 10];
+  seq[length] = '\0';
+  agn_seq_composition_reset(&comp);
+  agn_seq_composition_count(&comp, seq, length);
+  bool test2 = comp.length == 10003 && comp.at == 3001 && comp.gc == 4002 &&
+               comp.g == 2001 && comp.c == 1001 && comp.n == 2000;
+  agn_unit_test_result(test, "long sequence", test2);
+
+  agn_seq_composition_count(&comp, seq, 7);
+  bool test3 = comp.length == 10010 && comp.at == 3003 && comp.gc == 4005 &&
+               comp.g == 2003 && comp.c == 1002 && comp.n == 2002;
+  agn_unit_test_result(test, "accumulate", test3);
+  gt_free(seq);
+
+  agn_seq_composition_reverse(&comp);
+  bool test4 = comp.g == 1002 && comp.c == 2003 &&
+               agn_seq_composition_gc_skew(&comp) < 0.0;
+  agn_unit_test_result(test, "reverse", test4);
+
+  agn_seq_composition_reset(&comp);
+  agn_seq_composition_count(&comp, "", 0);
+  bool test5 = agn_seq_composition_gc_content(&comp) == 0.0 &&
+               agn_seq_composition_gc_skew(&comp) == 0.0 &&
+               agn_seq_composition_n_content(&comp) == 0.0;
+  agn_unit_test_result(test, "empty sequence", test5);
+
+  return agn_unit_test_success(test);
+}
+
+static void seq_composition_count_scalar(AgnSeqComposition *comp,
+                                         const char *seq, GtUword length)
+{
+  GtUword i;
+  comp->length += length;
+  for(i = 0; i < length; i++)
+  {
+    switch(seq[i])
+    {
+      case 'A': case 'a': case 'T': case 't': case 'W': case 'w':
+        comp->at++;
+        break;
+      case 'G': case 'g':
+        comp->g++;
+        comp->gc++;
+        break;
+      case 'C': case 'c':
+        comp->c++;
+        comp->gc++;
+        break;
+      case 'S': case 's':
+        comp->gc++;
+        break;
+      case 'N': case 'n': case 'X': case 'x':
+        comp->n++;
+        break;
+    }
+  }
+}
+
+#if defined(__SSE2__)
+static GtUword seq_composition_count_sse2(AgnSeqComposition *comp,
+                                          const char *seq, GtUword length)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i lower = _mm_set1_epi8(0x20);
+  const __m128i base_a = _mm_set1_epi8('a');
+  const __m128i base_t = _mm_set1_epi8('t');
+  const __m128i base_w = _mm_set1_epi8('w');
+  const __m128i base_g = _mm_set1_epi8('g');
+  const __m128i base_c = _mm_set1_epi8('c');
+  const __m128i base_s = _mm_set1_epi8('s');
+  const __m128i base_n = _mm_set1_epi8('n');
+  const __m128i base_x = _mm_set1_epi8('x');
+
+  GtUword i = 0;
+  while(length - i >= 16)
+  {
+    // Each matching byte of a comparison is 0xff, i.e. -1, so subtracting the
+    // comparison result increments the per-byte counters. The counters are
+    // summed before any of them can overflow.
+    __m128i at = zero, g = zero, c = zero, s = zero, n = zero;
+    unsigned iterations;
+    for(iterations = 0; iterations < 255 && length - i >= 16; iterations++)
+    {
+      // Setting bit 0x20 lowercases letters and maps no other byte onto one
+      // of the lowercase bases.
+      __m128i bases = _mm_loadu_si128((const __m128i *)(seq + i));
+      bases = _mm_or_si128(bases, lower);
+      __m128i is_at = _mm_or_si128(_mm_cmpeq_epi8(bases, base_a),
+                                   _mm_cmpeq_epi8(bases, base_t));
+      is_at = _mm_or_si128(is_at, _mm_cmpeq_epi8(bases, base_w));
+      __m128i is_n  = _mm_or_si128(_mm_cmpeq_epi8(bases, base_n),
+                                   _mm_cmpeq_epi8(bases, base_x));
+      at = _mm_sub_epi8(at, is_at);
+      g  = _mm_sub_epi8(g, _mm_cmpeq_epi8(bases, base_g));
+      c  = _mm_sub_epi8(c, _mm_cmpeq_epi8(bases, base_c));
+      s  = _mm_sub_epi8(s, _mm_cmpeq_epi8(bases, base_s));
+      n  = _mm_sub_epi8(n, is_n);
+      i += 16;
+    }
+    GtUword gcount = seq_composition_sum(g);
+    GtUword ccount = seq_composition_sum(c);
+    comp->at += seq_composition_sum(at);
+    comp->g  += gcount;
+    comp->c  += ccount;
+    comp->gc += gcount + ccount + seq_composition_sum(s);
+    comp->n  += seq_composition_sum(n);
+  }
+  comp->length += i;
+  return i;
+}
+
+static GtUword seq_composition_sum(__m128i acc)
+{
+  __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+  return (GtUword)_mm_cvtsi128_si32(sums) +
+         (GtUword)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+}
+#endif
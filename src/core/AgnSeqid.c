@@ -0,0 +1,108 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "extended/feature_node_api.h"
+#include "AgnSeqid.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Return true if the two sequence ID strings are identical.
+ */
+static bool seqid_str_equal(GtStr *seqid1, GtStr *seqid2);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+int agn_seqid_compare(GtGenomeNode *gn1, GtGenomeNode *gn2)
+{
+  GtStr *seqid1 = gt_genome_node_get_seqid(gn1);
+  GtStr *seqid2 = gt_genome_node_get_seqid(gn2);
+  if(seqid_str_equal(seqid1, seqid2))
+    return 0;
+  return strcmp(gt_str_get(seqid1), gt_str_get(seqid2));
+}
+
+bool agn_seqid_equal(GtGenomeNode *gn1, GtGenomeNode *gn2)
+{
+  return seqid_str_equal(gt_genome_node_get_seqid(gn1),
+                         gt_genome_node_get_seqid(gn2));
+}
+
+bool agn_seqid_unit_test(AgnUnitTest *test)
+{
+  GtStr *seqid = gt_str_new_cstr("NW_0123456789.1");
+  GtStr *copy = gt_str_new_cstr("NW_0123456789.1");
+  GtStr *sameprefix = gt_str_new_cstr("NW_0123456790.1");
+  GtStr *longer = gt_str_new_cstr("NW_0123456789.10");
+  GtGenomeNode *f1 = gt_feature_node_new(seqid, "gene", 1000, 2000,
+                                         GT_STRAND_FORWARD);
+  GtGenomeNode *f2 = gt_feature_node_new(seqid, "gene", 3000, 4000,
+                                         GT_STRAND_FORWARD);
+  GtGenomeNode *f3 = gt_feature_node_new(copy, "gene", 1000, 2000,
+                                         GT_STRAND_FORWARD);
+  GtGenomeNode *f4 = gt_feature_node_new(sameprefix, "gene", 1000, 2000,
+                                         GT_STRAND_FORWARD);
+  GtGenomeNode *f5 = gt_feature_node_new(longer, "gene", 1000, 2000,
+                                         GT_STRAND_FORWARD);
+
+  bool test1 = agn_seqid_equal(f1, f2) && agn_seqid_compare(f1, f2) == 0;
+  agn_unit_test_result(test, "same object", test1);
+
+  bool test2 = agn_seqid_equal(f1, f3) && agn_seqid_compare(f1, f3) == 0 &&
+               agn_seqid_compare(f3, f1) == 0;
+  agn_unit_test_result(test, "same string", test2);
+
+  bool test3 = !agn_seqid_equal(f1, f4) && agn_seqid_compare(f1, f4) < 0 &&
+               agn_seqid_compare(f4, f1) > 0;
+  agn_unit_test_result(test, "shared prefix", test3);
+
+  bool test4 = !agn_seqid_equal(f1, f5) && agn_seqid_compare(f1, f5) < 0 &&
+               agn_seqid_compare(f5, f4) < 0;
+  agn_unit_test_result(test, "different length", test4);
+
+  gt_genome_node_delete(f1);
+  gt_genome_node_delete(f2);
+  gt_genome_node_delete(f3);
+  gt_genome_node_delete(f4);
+  gt_genome_node_delete(f5);
+  gt_str_delete(seqid);
+  gt_str_delete(copy);
+  gt_str_delete(sameprefix);
+  gt_str_delete(longer);
+  return agn_unit_test_success(test);
+}
+
+static bool seqid_str_equal(GtStr *seqid1, GtStr *seqid2)
+{
+  agn_assert(seqid1 != NULL && seqid2 != NULL);
+  if(seqid1 == seqid2)
+    return true;
+
+  GtUword length = gt_str_length(seqid1);
+  if(length != gt_str_length(seqid2))
+    return false;
+
+  // Sequence IDs of the same assembly tend to share a long prefix (such as
+  // "NW_0123456789.1" and "NW_0123456790.1"), so compare from the end.
+  const char *str1 = gt_str_get(seqid1);
+  const char *str2 = gt_str_get(seqid2);
+  while(length > 0)
+  {
+    length--;
+    if(str1[length] != str2[length])
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,296 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <pthread.h>
+#include <string.h>
+#include "core/hashmap_api.h"
+#include "extended/array_in_stream_api.h"
+#include "AgnSeqid.h"
+#include "AgnSortCheckStream.h"
+#include "AgnUtils.h"
+
+#define sort_check_stream_cast(GS)\
+        gt_node_stream_cast(sort_check_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnSortCheckStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtHashmap *regions;
+  GtHashmap *finished;
+  GtGenomeNode *prev;
+  bool seqid_order;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Set an error describing the out-of-order feature ``gn``.
+ */
+static void sort_check_stream_error(GtGenomeNode *gn, const char *problem,
+                                    GtError *error);
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *sort_check_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void sort_check_stream_class_init(void);
+
+/**
+ * @function Destructor: release instance data.
+ */
+static void sort_check_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pass the next node through, checking its position.
+ */
+static int sort_check_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error);
+
+/**
+ * @function Run the given nodes through a sort check stream, returning the
+ * number of nodes passed through before an error (or the end of the input).
+ */
+static GtUword sort_check_stream_test_run(GtArray *nodes, bool seqid_order,
+                                          bool *had_err);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_sort_check_stream_new(GtNodeStream *in_stream)
+{
+  agn_assert(in_stream);
+  GtNodeStream *ns = gt_node_stream_create(sort_check_stream_class(), true);
+  AgnSortCheckStream *stream = sort_check_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->regions = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  stream->finished = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  stream->prev = NULL;
+  stream->seqid_order = false;
+  return ns;
+}
+
+void agn_sort_check_stream_check_seqid_order(AgnSortCheckStream *stream)
+{
+  agn_assert(stream);
+  stream->seqid_order = true;
+}
+
+bool agn_sort_check_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *chr1 = gt_str_new_cstr("chr1");
+  GtStr *chr2 = gt_str_new_cstr("chr2");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn;
+  bool had_err;
+
+  gn = gt_region_node_new(chr1, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(chr2, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr2, "gene", 500, 1500, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr2, "gene", 1200, 1800, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 100, 900, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  GtUword count = sort_check_stream_test_run(nodes, false, &had_err);
+  agn_unit_test_result(test, "sorted input", count == 5 && !had_err);
+
+  gn = gt_region_node_new(chr1, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 500, 1500, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 400, 1800, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  count = sort_check_stream_test_run(nodes, false, &had_err);
+  agn_unit_test_result(test, "unsorted starts", count == 2 && had_err);
+
+  gn = gt_region_node_new(chr1, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(chr2, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 500, 1500, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr2, "gene", 400, 1800, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 2000, 2500, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  count = sort_check_stream_test_run(nodes, false, &had_err);
+  agn_unit_test_result(test, "interleaved sequences", count == 4 && had_err);
+
+  gn = gt_feature_node_new(chr1, "gene", 500, 1500, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  count = sort_check_stream_test_run(nodes, false, &had_err);
+  agn_unit_test_result(test, "missing region", count == 0 && had_err);
+
+  gn = gt_region_node_new(chr1, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(chr2, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 500, 1500, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr2, "gene", 400, 1800, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  count = sort_check_stream_test_run(nodes, true, &had_err);
+  agn_unit_test_result(test, "sequence order", count == 4 && !had_err);
+
+  gn = gt_region_node_new(chr1, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(chr2, 1, 10000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr2, "gene", 500, 1500, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr1, "gene", 400, 1800, GT_STRAND_REVERSE);
+  gt_array_add(nodes, gn);
+  count = sort_check_stream_test_run(nodes, true, &had_err);
+  agn_unit_test_result(test, "unsorted sequences", count == 3 && had_err);
+
+  gt_array_delete(nodes);
+  gt_str_delete(chr1);
+  gt_str_delete(chr2);
+  return agn_unit_test_success(test);
+}
+
+static void sort_check_stream_error(GtGenomeNode *gn, const char *problem,
+                                    GtError *error)
+{
+  GtFeatureNode *fn = gt_feature_node_cast(gn);
+  gt_error_set(error, "input is not sorted: %s feature %s:%lu-%lu (file %s, "
+               "line %u) %s", gt_feature_node_get_type(fn),
+               gt_str_get(gt_genome_node_get_seqid(gn)),
+               gt_genome_node_get_start(gn), gt_genome_node_get_end(gn),
+               gt_genome_node_get_filename(gn),
+               gt_genome_node_get_line_number(gn), problem);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *sort_check_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, sort_check_stream_class_init);
+  return nsc;
+}
+
+static void sort_check_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnSortCheckStream),
+                                 sort_check_stream_free,
+                                 sort_check_stream_next);
+}
+
+static void sort_check_stream_free(GtNodeStream *ns)
+{
+  AgnSortCheckStream *stream = sort_check_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  gt_hashmap_delete(stream->regions);
+  gt_hashmap_delete(stream->finished);
+  if(stream->prev != NULL)
+    gt_genome_node_delete(stream->prev);
+}
+
+static int sort_check_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                  GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnSortCheckStream *stream = sort_check_stream_cast(ns);
+  int result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result || !*gn)
+    return result;
+
+  GtStr *seqid = gt_genome_node_get_seqid(*gn);
+  if(gt_region_node_try_cast(*gn))
+  {
+    if(gt_hashmap_get(stream->regions, gt_str_get(seqid)) == NULL)
+    {
+      char *key = gt_cstr_dup(gt_str_get(seqid));
+      gt_hashmap_add(stream->regions, key, key);
+    }
+    return 0;
+  }
+  if(gt_feature_node_try_cast(*gn) == NULL)
+    return 0;
+
+  const char *problem = NULL;
+  GtGenomeNode *prev = stream->prev;
+  if(prev != NULL && agn_seqid_equal(*gn, prev))
+  {
+    if(gt_genome_node_get_start(*gn) < gt_genome_node_get_start(prev))
+      problem = "starts before the preceding feature";
+  }
+  else if(gt_hashmap_get(stream->finished, gt_str_get(seqid)) != NULL)
+    problem = "follows features from another sequence";
+  else if(stream->seqid_order && prev != NULL &&
+          agn_seqid_compare(*gn, prev) < 0)
+    problem = "follows features from a sequence that sorts after its own";
+  else if(gt_hashmap_get(stream->regions, gt_str_get(seqid)) == NULL)
+    problem = "precedes the sequence-region for its sequence";
+  else if(prev != NULL)
+  {
+    char *key = gt_cstr_dup(gt_str_get(gt_genome_node_get_seqid(prev)));
+    gt_hashmap_add(stream->finished, key, key);
+  }
+
+  if(problem != NULL)
+  {
+    sort_check_stream_error(*gn, problem, error);
+    gt_genome_node_delete(*gn);
+    *gn = NULL;
+    return -1;
+  }
+  if(prev != NULL)
+    gt_genome_node_delete(prev);
+  stream->prev = gt_genome_node_ref(*gn);
+  return 0;
+}
+
+static GtUword sort_check_stream_test_run(GtArray *nodes, bool seqid_order,
+                                          bool *had_err)
+{
+  GtError *error = gt_error_new();
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *scs = agn_sort_check_stream_new(ais);
+  if(seqid_order)
+    agn_sort_check_stream_check_seqid_order((AgnSortCheckStream *)scs);
+  GtUword count = 0;
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(scs, &gn, error)) == 0 && gn != NULL)
+  {
+    count++;
+    gt_genome_node_delete(gn);
+  }
+  *had_err = result == -1;
+
+  GtUword i;
+  for(i = progress; i < gt_array_size(nodes); i++)
+  {
+    GtGenomeNode **unread = gt_array_get(nodes, i);
+    gt_genome_node_delete(*unread);
+  }
+  gt_array_reset(nodes);
+  gt_node_stream_delete(scs);
+  gt_node_stream_delete(ais);
+  gt_error_delete(error);
+  return count;
+}
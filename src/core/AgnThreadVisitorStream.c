@@ -0,0 +1,392 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core/queue_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/gff3_out_stream_api.h"
+#include "extended/gff3_visitor_api.h"
+#include "AgnThreadVisitorStream.h"
+#include "AgnUtils.h"
+
+#define thread_visitor_stream_cast(GS)\
+        gt_node_stream_cast(thread_visitor_stream_class(), GS)
+
+// Nodes are handed to the visitor thread in batches of this size
+#define THREAD_VISITOR_BATCH_SIZE 256
+
+// At most this many batches are read ahead of the nodes passed downstream
+#define THREAD_VISITOR_MAX_BATCHES 16
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnThreadVisitorStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtNodeVisitor *visitor;
+  GtArray *filling;
+  GtArray *draining;
+  GtUword drained;
+  GtUword inflight;
+  bool in_done;
+  bool started;
+  bool stop;
+  GtQueue *todo;
+  GtQueue *done;
+  int visit_result;
+  GtError *visit_error;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t todo_cond;
+  pthread_cond_t done_cond;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the node stream interface.
+ */
+static const GtNodeStreamClass *thread_visitor_stream_class(void);
+
+/**
+ * @function Create the class object, exactly once.
+ */
+static void thread_visitor_stream_class_init(void);
+
+/**
+ * @function Delete the given batch of nodes, starting at position ``start``.
+ */
+static void thread_visitor_stream_delete_batch(GtArray *batch, GtUword start);
+
+/**
+ * @function Destructor: stop the visitor thread and release instance data,
+ * including any nodes that were not passed downstream.
+ */
+static void thread_visitor_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pass the next visited node downstream, reading more nodes from the
+ * input stream while the visitor thread is busy.
+ */
+static int thread_visitor_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                      GtError *error);
+
+/**
+ * @function Queue the batch of nodes being filled for the visitor thread.
+ */
+static void thread_visitor_stream_submit(AgnThreadVisitorStream *stream);
+
+/**
+ * @function Build the nodes used for unit testing.
+ */
+static GtArray *thread_visitor_stream_test_data(GtStr *seqid);
+
+/**
+ * @function Visitor thread: visit each queued batch of nodes in order.
+ */
+static void *thread_visitor_stream_visit(void *data);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_thread_visitor_stream_new(GtNodeStream *in_stream,
+                                            GtNodeVisitor *visitor)
+{
+  agn_assert(in_stream && visitor);
+  GtNodeStream *ns = gt_node_stream_create(thread_visitor_stream_class(),
+                                           false);
+  AgnThreadVisitorStream *stream = thread_visitor_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->visitor = visitor;
+  stream->filling = gt_array_new( sizeof(GtGenomeNode *) );
+  stream->draining = NULL;
+  stream->drained = 0;
+  stream->inflight = 0;
+  stream->in_done = false;
+  stream->started = false;
+  stream->stop = false;
+  stream->todo = gt_queue_new();
+  stream->done = gt_queue_new();
+  stream->visit_result = 0;
+  stream->visit_error = gt_error_new();
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->todo_cond, NULL);
+  pthread_cond_init(&stream->done_cond, NULL);
+  return ns;
+}
+
+bool agn_thread_visitor_stream_unit_test(AgnUnitTest *test)
+{
+  GtStr *seqid = gt_str_new_cstr("chr1");
+  GtError *error = gt_error_new();
+
+  // Reference output from the generic GFF3 writer
+  GtArray *nodes = thread_visitor_stream_test_data(seqid);
+  char *expbuffer;
+  size_t expbuffersize;
+  FILE *outfp = open_memstream(&expbuffer, &expbuffersize);
+  GtFile *outfile = gt_file_new_from_fileptr(outfp);
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *gff3 = gt_gff3_out_stream_new(ais, outfile);
+  int result = gt_node_stream_pull(gff3, error);
+  gt_node_stream_delete(gff3);
+  gt_node_stream_delete(ais);
+  gt_file_delete_without_handle(outfile);
+  fclose(outfp);
+  gt_array_delete(nodes);
+
+  // The same output written from the visitor thread
+  nodes = thread_visitor_stream_test_data(seqid);
+  GtUword numnodes = gt_array_size(nodes);
+  GtArray *expnodes = gt_array_clone(nodes);
+  char *buffer;
+  size_t buffersize;
+  outfp = open_memstream(&buffer, &buffersize);
+  outfile = gt_file_new_from_fileptr(outfp);
+  progress = 0;
+  ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *tvs = agn_thread_visitor_stream_new(ais,
+                                                    gt_gff3_visitor_new(outfile));
+  GtUword count = 0;
+  bool inorder = true;
+  GtGenomeNode *gn;
+  while(result == 0 && (result = gt_node_stream_next(tvs, &gn, error)) == 0 &&
+        gn != NULL)
+  {
+    GtGenomeNode **expgn = gt_array_get(expnodes, count);
+    inorder = inorder && gn == *expgn;
+    count++;
+    gt_genome_node_delete(gn);
+  }
+  gt_node_stream_delete(tvs);
+  gt_node_stream_delete(ais);
+  gt_file_delete_without_handle(outfile);
+  fclose(outfp);
+
+  bool test1 = result == 0 && inorder && count == numnodes;
+  agn_unit_test_result(test, "pass through", test1);
+
+  bool test2 = strcmp(buffer, expbuffer) == 0;
+  agn_unit_test_result(test, "output", test2);
+
+  free(buffer);
+  free(expbuffer);
+  gt_array_delete(expnodes);
+  gt_array_delete(nodes);
+  gt_error_delete(error);
+  gt_str_delete(seqid);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *nsc = NULL;
+
+static const GtNodeStreamClass *thread_visitor_stream_class(void)
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, thread_visitor_stream_class_init);
+  return nsc;
+}
+
+static void thread_visitor_stream_class_init(void)
+{
+  nsc = gt_node_stream_class_new(sizeof (AgnThreadVisitorStream),
+                                 thread_visitor_stream_free,
+                                 thread_visitor_stream_next);
+}
+
+static void thread_visitor_stream_delete_batch(GtArray *batch, GtUword start)
+{
+  GtUword i;
+  for(i = start; i < gt_array_size(batch); i++)
+  {
+    GtGenomeNode **gn = gt_array_get(batch, i);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(batch);
+}
+
+static void thread_visitor_stream_free(GtNodeStream *ns)
+{
+  AgnThreadVisitorStream *stream = thread_visitor_stream_cast(ns);
+  if(stream->started)
+  {
+    pthread_mutex_lock(&stream->lock);
+    stream->stop = true;
+    pthread_cond_signal(&stream->todo_cond);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+  }
+
+  while(gt_queue_size(stream->todo) > 0)
+    thread_visitor_stream_delete_batch(gt_queue_get(stream->todo), 0);
+  while(gt_queue_size(stream->done) > 0)
+    thread_visitor_stream_delete_batch(gt_queue_get(stream->done), 0);
+  if(stream->draining != NULL)
+    thread_visitor_stream_delete_batch(stream->draining, stream->drained);
+  thread_visitor_stream_delete_batch(stream->filling, 0);
+
+  gt_queue_delete(stream->todo);
+  gt_queue_delete(stream->done);
+  gt_error_delete(stream->visit_error);
+  pthread_cond_destroy(&stream->todo_cond);
+  pthread_cond_destroy(&stream->done_cond);
+  pthread_mutex_destroy(&stream->lock);
+  gt_node_visitor_delete(stream->visitor);
+  gt_node_stream_delete(stream->in_stream);
+}
+
+static int thread_visitor_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                      GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnThreadVisitorStream *stream = thread_visitor_stream_cast(ns);
+
+  if(!stream->started)
+  {
+    pthread_create(&stream->thread, NULL, thread_visitor_stream_visit, stream);
+    stream->started = true;
+  }
+
+  if(stream->draining != NULL &&
+     stream->drained == gt_array_size(stream->draining))
+  {
+    gt_array_delete(stream->draining);
+    stream->draining = NULL;
+  }
+
+  while(stream->draining == NULL)
+  {
+    // Take the next visited batch, if there is one.
+    pthread_mutex_lock(&stream->lock);
+    if(gt_queue_size(stream->done) > 0)
+    {
+      stream->draining = gt_queue_get(stream->done);
+      stream->drained = 0;
+      stream->inflight--;
+    }
+    else if(stream->in_done || stream->inflight >= THREAD_VISITOR_MAX_BATCHES)
+    {
+      if(stream->inflight == 0)
+      {
+        pthread_mutex_unlock(&stream->lock);
+        *gn = NULL;
+        return 0;
+      }
+      pthread_cond_wait(&stream->done_cond, &stream->lock);
+    }
+    int visit_result = stream->visit_result;
+    pthread_mutex_unlock(&stream->lock);
+
+    if(visit_result == -1)
+    {
+      gt_error_set(error, "%s", gt_error_get(stream->visit_error));
+      return -1;
+    }
+    if(stream->draining != NULL || stream->in_done ||
+       stream->inflight >= THREAD_VISITOR_MAX_BATCHES)
+      continue;
+
+    // Otherwise, read ahead while the visitor thread works.
+    GtGenomeNode *node;
+    int result = gt_node_stream_next(stream->in_stream, &node, error);
+    if(result)
+      return result;
+    if(node == NULL)
+    {
+      stream->in_done = true;
+      if(gt_array_size(stream->filling) > 0)
+        thread_visitor_stream_submit(stream);
+      continue;
+    }
+    gt_array_add(stream->filling, node);
+    if(gt_array_size(stream->filling) == THREAD_VISITOR_BATCH_SIZE)
+      thread_visitor_stream_submit(stream);
+  }
+
+  GtGenomeNode **node = gt_array_get(stream->draining, stream->drained);
+  stream->drained++;
+  *gn = *node;
+  return 0;
+}
+
+static void thread_visitor_stream_submit(AgnThreadVisitorStream *stream)
+{
+  pthread_mutex_lock(&stream->lock);
+  gt_queue_add(stream->todo, stream->filling);
+  stream->inflight++;
+  pthread_cond_signal(&stream->todo_cond);
+  pthread_mutex_unlock(&stream->lock);
+  stream->filling = gt_array_new( sizeof(GtGenomeNode *) );
+}
+
+static GtArray *thread_visitor_stream_test_data(GtStr *seqid)
+{
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn = gt_region_node_new(seqid, 1, 1000000);
+  gt_array_add(nodes, gn);
+
+  GtUword i;
+  for(i = 0; i < 1000; i++)
+  {
+    GtUword start = (i * 1000) + 1;
+    GtStrand strand = i % 2 ? GT_STRAND_REVERSE : GT_STRAND_FORWARD;
+    gn = gt_feature_node_new(seqid, "gene", start, start + 799, strand);
+    GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", start + 100,
+                                             start + 699, strand);
+    gt_feature_node_add_child((GtFeatureNode *)gn, (GtFeatureNode *)mrna);
+    char id[32];
+    sprintf(id, "gene%lu", i + 1);
+    gt_feature_node_add_attribute((GtFeatureNode *)gn, "ID", id);
+    gt_array_add(nodes, gn);
+  }
+  return nodes;
+}
+
+static void *thread_visitor_stream_visit(void *data)
+{
+  AgnThreadVisitorStream *stream = data;
+  pthread_mutex_lock(&stream->lock);
+  while(1)
+  {
+    while(gt_queue_size(stream->todo) == 0 && !stream->stop)
+      pthread_cond_wait(&stream->todo_cond, &stream->lock);
+    if(stream->stop)
+      break;
+
+    GtArray *batch = gt_queue_get(stream->todo);
+    int result = stream->visit_result;
+    pthread_mutex_unlock(&stream->lock);
+
+    GtUword i;
+    for(i = 0; i < gt_array_size(batch) && result == 0; i++)
+    {
+      GtGenomeNode **gn = gt_array_get(batch, i);
+      result = gt_genome_node_accept(*gn, stream->visitor,
+                                     stream->visit_error);
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    stream->visit_result = result;
+    gt_queue_add(stream->done, batch);
+    pthread_cond_signal(&stream->done_cond);
+  }
+  pthread_mutex_unlock(&stream->lock);
+  return NULL;
+}
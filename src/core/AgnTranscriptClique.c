@@ -10,6 +10,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include <string.h>
 #include "core/queue_api.h"
 #include "AgnTranscriptClique.h"
+#include "AgnTranscriptModel.h"
 #include "AgnTypecheck.h"
 
 //------------------------------------------------------------------------------
@@ -86,6 +87,13 @@ static void clique_traverse_direct(AgnTranscriptClique *clique,
  */
 static void clique_utr_count(GtFeatureNode *fn, GtWord *count);
 
+/**
+ * @function Mark each of the given ranges in the clique's model vector with the
+ * character ``c``.
+ */
+static void clique_vector_fill(char *modelvector, GtRange *locusrange,
+                               GtRange *ranges, GtUword count, char c);
+
 /**
  * @function Update the clique's model vector whenever a new transcript is
  * added.
@@ -177,8 +185,7 @@ bool agn_transcript_clique_has_id_in_hash(AgnTranscriptClique *clique,
 
 char *agn_transcript_clique_id(AgnTranscriptClique *clique)
 {
-  char id[32768];
-  char *idptr = id;
+  GtStr *id = gt_str_new();
   unsigned count = 0;
 
   GtFeatureNode *cliquefn = gt_feature_node_cast(clique);
@@ -191,12 +198,14 @@ char *agn_transcript_clique_id(AgnTranscriptClique *clique)
     agn_assert(agn_typecheck_transcript(current));
     count++;
     if(count > 1)
-      idptr += sprintf(idptr, ",");
-    idptr += sprintf(idptr, "%s", gt_feature_node_get_attribute(current, "ID"));
+      gt_str_append_char(id, ',');
+    gt_str_append_cstr(id, gt_feature_node_get_attribute(current, "ID"));
   }
   gt_feature_node_iterator_delete(iter);
 
-  return gt_cstr_dup(id);
+  char *idstr = gt_cstr_dup(gt_str_get(id));
+  gt_str_delete(id);
+  return idstr;
 }
 
 GtArray *agn_transcript_clique_ids(AgnTranscriptClique *clique)
@@ -529,6 +538,21 @@ static void clique_utr_count(GtFeatureNode *fn, GtWord *count)
     (*count)++;
 }
 
+static void clique_vector_fill(char *modelvector, GtRange *locusrange,
+                               GtRange *ranges, GtUword count, char c)
+{
+  GtUword i, j;
+  for(i = 0; i < count; i++)
+  {
+    for(j = ranges[i].start - locusrange->start;
+        j < ranges[i].end - locusrange->start + 1;
+        j++)
+    {
+      modelvector[j] = c;
+    }
+  }
+}
+
 static void clique_vector_update(AgnTranscriptClique *clique,
                                  GtFeatureNode *transcript)
 {
@@ -538,6 +562,20 @@ static void clique_vector_update(AgnTranscriptClique *clique,
   agn_assert(gt_range_contains(&locusrange, &transrange));
   agn_assert(gt_range_length(&locusrange) == strlen(modelvector));
 
+  AgnTranscriptModel *model = agn_transcript_model_get(transcript);
+  if(model != NULL)
+  {
+    clique_vector_fill(modelvector, &locusrange, model->cds,
+                       model->num_cds, 'C');
+    clique_vector_fill(modelvector, &locusrange, model->utr5p,
+                       model->num_utr5p, 'F');
+    clique_vector_fill(modelvector, &locusrange, model->utr3p,
+                       model->num_utr3p, 'T');
+    clique_vector_fill(modelvector, &locusrange, model->introns,
+                       model->num_introns, 'I');
+    return;
+  }
+
   GtFeatureNode *fn;
   GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(transcript);
   for(fn = gt_feature_node_iterator_next(iter);
@@ -573,3 +611,4 @@ static void clique_vector_update(AgnTranscriptClique *clique,
   }
   gt_feature_node_iterator_delete(iter);
 }
+
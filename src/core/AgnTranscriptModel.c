@@ -0,0 +1,350 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include "core/ma_api.h"
+#include "core/queue_api.h"
+#include "extended/array_out_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "extended/gff3_in_stream_api.h"
+#include "AgnGeneStream.h"
+#include "AgnTranscriptModel.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define TRANSCRIPT_MODEL_KEY "agn_transcript_model"
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Sort the ``count`` features in ``nodes`` by position and copy the
+ * coordinates of each into ``ranges``, returning their combined length. The
+ * sort is stable, like the one in ``agn_typecheck_select``, so features are
+ * listed in the same order whether or not a model is attached.
+ */
+static GtUword transcript_model_fill_ranges(GtFeatureNode **nodes,
+                                            GtRange *ranges, GtUword count);
+
+/**
+ * @function Generate data for unit testing.
+ */
+static void transcript_model_test_data(GtQueue *queue);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_transcript_model_attach(GtFeatureNode *transcript,
+                                 AgnTranscriptModel *model)
+{
+  agn_assert(transcript && model);
+  gt_genome_node_add_user_data((GtGenomeNode *)transcript,
+                               TRANSCRIPT_MODEL_KEY, model,
+                               (GtFree)agn_transcript_model_delete);
+}
+
+void agn_transcript_model_delete(AgnTranscriptModel *model)
+{
+  gt_free(model);
+}
+
+AgnTranscriptModel *agn_transcript_model_get(GtFeatureNode *transcript)
+{
+  agn_assert(transcript);
+  return gt_genome_node_get_user_data((GtGenomeNode *)transcript,
+                                      TRANSCRIPT_MODEL_KEY);
+}
+
+bool agn_transcript_model_lookup(AgnTranscriptModel *model,
+                                 bool (*func)(GtFeatureNode *),
+                                 GtFeatureNode ***nodes, GtUword *count,
+                                 GtUword *length)
+{
+  agn_assert(model && func);
+  GtFeatureNode **selnodes;
+  GtUword selcount, sellength;
+  if(func == agn_typecheck_exon)
+  {
+    selnodes  = model->exon_nodes;
+    selcount  = model->num_exons;
+    sellength = model->exon_length;
+  }
+  else if(func == agn_typecheck_cds)
+  {
+    selnodes  = model->cds_nodes;
+    selcount  = model->num_cds;
+    sellength = model->cds_length;
+  }
+  else if(func == agn_typecheck_utr5p)
+  {
+    selnodes  = model->utr5p_nodes;
+    selcount  = model->num_utr5p;
+    sellength = model->utr5p_length;
+  }
+  else if(func == agn_typecheck_utr3p)
+  {
+    selnodes  = model->utr3p_nodes;
+    selcount  = model->num_utr3p;
+    sellength = model->utr3p_length;
+  }
+  else if(func == agn_typecheck_intron)
+  {
+    selnodes  = model->intron_nodes;
+    selcount  = model->num_introns;
+    sellength = 0;
+    GtUword i;
+    for(i = 0; i < selcount; i++)
+      sellength += gt_range_length(model->introns + i);
+  }
+  else
+    return false;
+
+  if(nodes != NULL)
+    *nodes = selnodes;
+  if(count != NULL)
+    *count = selcount;
+  if(length != NULL)
+    *length = sellength;
+  return true;
+}
+
+AgnTranscriptModel *agn_transcript_model_new(GtFeatureNode *transcript)
+{
+  agn_assert(transcript);
+
+  // First pass: count subfeatures of each type so that the entire model can
+  // be allocated in a single block.
+  GtUword counts[5] = { 0, 0, 0, 0, 0 };
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(transcript);
+  GtFeatureNode *current;
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    switch(agn_typecheck_class(current))
+    {
+      case AGN_FEATURE_EXON:   counts[0]++; break;
+      case AGN_FEATURE_CDS:    counts[1]++; break;
+      case AGN_FEATURE_UTR5P:  counts[2]++; break;
+      case AGN_FEATURE_UTR3P:  counts[3]++; break;
+      case AGN_FEATURE_INTRON: counts[4]++; break;
+      default: break;
+    }
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  GtUword total = counts[0] + counts[1] + counts[2] + counts[3] + counts[4];
+  AgnTranscriptModel *model = gt_malloc(sizeof(AgnTranscriptModel) +
+                                        total * sizeof(GtRange) +
+                                        total * sizeof(GtFeatureNode *));
+  GtRange *ranges = (GtRange *)(model + 1);
+  GtFeatureNode **nodes = (GtFeatureNode **)(ranges + total);
+
+  model->range       = gt_genome_node_get_range((GtGenomeNode *)transcript);
+  model->num_exons   = counts[0];
+  model->num_cds     = counts[1];
+  model->num_utr5p   = counts[2];
+  model->num_utr3p   = counts[3];
+  model->num_introns = counts[4];
+
+  model->exons   = ranges;
+  model->cds     = model->exons + model->num_exons;
+  model->utr5p   = model->cds   + model->num_cds;
+  model->utr3p   = model->utr5p + model->num_utr5p;
+  model->introns = model->utr3p + model->num_utr3p;
+
+  model->exon_nodes   = nodes;
+  model->cds_nodes    = model->exon_nodes  + model->num_exons;
+  model->utr5p_nodes  = model->cds_nodes   + model->num_cds;
+  model->utr3p_nodes  = model->utr5p_nodes + model->num_utr5p;
+  model->intron_nodes = model->utr3p_nodes + model->num_utr3p;
+
+  // Second pass: collect the subfeatures.
+  GtUword filled[5] = { 0, 0, 0, 0, 0 };
+  iter = gt_feature_node_iterator_new(transcript);
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    switch(agn_typecheck_class(current))
+    {
+      case AGN_FEATURE_EXON:
+        model->exon_nodes[filled[0]++] = current;
+        break;
+      case AGN_FEATURE_CDS:
+        model->cds_nodes[filled[1]++] = current;
+        break;
+      case AGN_FEATURE_UTR5P:
+        model->utr5p_nodes[filled[2]++] = current;
+        break;
+      case AGN_FEATURE_UTR3P:
+        model->utr3p_nodes[filled[3]++] = current;
+        break;
+      case AGN_FEATURE_INTRON:
+        model->intron_nodes[filled[4]++] = current;
+        break;
+      default:
+        break;
+    }
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  model->exon_length  = transcript_model_fill_ranges(model->exon_nodes,
+                                                     model->exons,
+                                                     model->num_exons);
+  model->cds_length   = transcript_model_fill_ranges(model->cds_nodes,
+                                                     model->cds,
+                                                     model->num_cds);
+  model->utr5p_length = transcript_model_fill_ranges(model->utr5p_nodes,
+                                                     model->utr5p,
+                                                     model->num_utr5p);
+  model->utr3p_length = transcript_model_fill_ranges(model->utr3p_nodes,
+                                                     model->utr3p,
+                                                     model->num_utr3p);
+  transcript_model_fill_ranges(model->intron_nodes, model->introns,
+                               model->num_introns);
+
+  model->cds_range.start = 0;
+  model->cds_range.end   = 0;
+  if(model->num_cds > 0)
+  {
+    GtUword i;
+    model->cds_range = model->cds[0];
+    for(i = 1; i < model->num_cds; i++)
+      model->cds_range = gt_range_join(&model->cds_range, model->cds + i);
+  }
+
+  return model;
+}
+
+bool agn_transcript_model_unit_test(AgnUnitTest *test)
+{
+  GtQueue *queue = gt_queue_new();
+  transcript_model_test_data(queue);
+  agn_assert(gt_queue_size(queue) == 4);
+
+  GtGenomeNode *gene = gt_queue_get(queue);
+  gt_genome_node_delete(gene);
+  gene = gt_queue_get(queue);
+  gt_genome_node_delete(gene);
+
+  gene = gt_queue_get(queue);
+  GtArray *mrnas = agn_typecheck_select(gt_feature_node_cast(gene),
+                                        agn_typecheck_mrna);
+  agn_assert(gt_array_size(mrnas) == 1);
+  GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, 0);
+  AgnTranscriptModel *model = agn_transcript_model_get(mrna);
+  bool test1 = model != NULL;
+  agn_unit_test_result(test, "model attached", test1);
+
+  if(model != NULL)
+  {
+    bool test2 = model->num_exons == 4 && model->num_cds == 4 &&
+                 model->num_introns == 3 && model->num_utr5p == 0 &&
+                 model->num_utr3p == 1;
+    agn_unit_test_result(test, "subfeature counts", test2);
+
+    bool test3 = model->exons[0].start == 30600 &&
+                 model->exons[0].end   == 30850 &&
+                 model->exons[3].start == 32802 &&
+                 model->exons[3].end   == 33035 &&
+                 model->introns[1].start == 31223 &&
+                 model->introns[1].end   == 32156 &&
+                 model->utr3p[0].start == 32926 &&
+                 model->utr3p[0].end   == 33035;
+    agn_unit_test_result(test, "subfeature coordinates", test3);
+
+    bool test4 = model->cds_range.start == 30600 &&
+                 model->cds_range.end   == 32925 &&
+                 model->cds_length      == 726   &&
+                 model->exon_length     == 836   &&
+                 model->utr3p_length    == 110   &&
+                 model->utr5p_length    == 0;
+    agn_unit_test_result(test, "lengths and ranges", test4);
+
+    GtArray *introns = agn_typecheck_select(mrna, agn_typecheck_intron);
+    GtRange cdsrange = agn_feature_node_get_cds_range(mrna);
+    bool test5 = gt_array_size(introns) == 3 &&
+                 *(GtFeatureNode **)gt_array_get(introns, 0) ==
+                 model->intron_nodes[0] &&
+                 gt_range_compare(&cdsrange, &model->cds_range) == 0 &&
+                 agn_mrna_cds_length(mrna) == 726;
+    agn_unit_test_result(test, "typecheck shortcuts", test5);
+    gt_array_delete(introns);
+  }
+  gt_array_delete(mrnas);
+  gt_genome_node_delete(gene);
+
+  while(gt_queue_size(queue) > 0)
+  {
+    gene = gt_queue_get(queue);
+    gt_genome_node_delete(gene);
+  }
+  gt_queue_delete(queue);
+  return agn_unit_test_success(test);
+}
+
+static GtUword transcript_model_fill_ranges(GtFeatureNode **nodes,
+                                            GtRange *ranges, GtUword count)
+{
+  // Insertion sort: subfeatures are few and mostly in order already.
+  GtUword i, length = 0;
+  for(i = 1; i < count; i++)
+  {
+    GtFeatureNode *node = nodes[i];
+    GtUword j = i;
+    while(j > 0 && agn_genome_node_compare((GtGenomeNode **)(nodes + j - 1),
+                                           (GtGenomeNode **)&node) > 0)
+    {
+      nodes[j] = nodes[j - 1];
+      j--;
+    }
+    nodes[j] = node;
+  }
+  for(i = 0; i < count; i++)
+  {
+    ranges[i] = gt_genome_node_get_range((GtGenomeNode *)nodes[i]);
+    length += gt_range_length(ranges + i);
+  }
+  return length;
+}
+
+static void transcript_model_test_data(GtQueue *queue)
+{
+  GtError *error = gt_error_new();
+  const char *file = "data/gff3/gene-stream-data.gff3";
+  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &file);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
+  GtLogger *logger = gt_logger_new(false, "", stderr);
+  GtNodeStream *stream = agn_gene_stream_new(gff3in, logger);
+  GtArray *feats = gt_array_new( sizeof(GtFeatureNode *) );
+  GtNodeStream *arraystream = gt_array_out_stream_new(stream, feats, error);
+  int pullresult = gt_node_stream_pull(arraystream, error);
+  if(pullresult == -1)
+  {
+    fprintf(stderr, "[AgnTranscriptModel::transcript_model_test_data] error "
+            "processing features: %s\n", gt_error_get(error));
+  }
+  gt_node_stream_delete(gff3in);
+  gt_node_stream_delete(stream);
+  gt_node_stream_delete(arraystream);
+  gt_logger_delete(logger);
+  gt_array_sort(feats, (GtCompare)agn_genome_node_compare);
+  gt_array_reverse(feats);
+  while(gt_array_size(feats) > 0)
+  {
+    GtGenomeNode *fn = *(GtGenomeNode **)gt_array_pop(feats);
+    gt_queue_add(queue, fn);
+  }
+  gt_array_delete(feats);
+  gt_error_delete(error);
+}
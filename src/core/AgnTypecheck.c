@@ -7,21 +7,134 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <stdint.h>
 #include <string.h>
 #include "extended/feature_node_iterator_api.h"
+#include "AgnTranscriptModel.h"
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
 
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+  const char *type;
+  AgnFeatureClass fclass;
+} AgnTypeSynonym;
+
+static const AgnTypeSynonym type_synonyms[] =
+{
+  { "gene",                            AGN_FEATURE_GENE        },
+  { "pseudogene",                      AGN_FEATURE_PSEUDOGENE  },
+  { "mRNA",                            AGN_FEATURE_MRNA        },
+  { "messenger RNA",                   AGN_FEATURE_MRNA        },
+  { "messenger_RNA",                   AGN_FEATURE_MRNA        },
+  { "tRNA",                            AGN_FEATURE_TRNA        },
+  { "transfer RNA",                    AGN_FEATURE_TRNA        },
+  { "rRNA",                            AGN_FEATURE_RRNA        },
+  { "ribosomal RNA",                   AGN_FEATURE_RRNA        },
+  { "exon",                            AGN_FEATURE_EXON        },
+  { "intron",                          AGN_FEATURE_INTRON      },
+  { "CDS",                             AGN_FEATURE_CDS         },
+  { "coding sequence",                 AGN_FEATURE_CDS         },
+  { "coding_sequence",                 AGN_FEATURE_CDS         },
+  { "UTR",                             AGN_FEATURE_UTR         },
+  { "untranslated region",             AGN_FEATURE_UTR         },
+  { "untranslated_region",             AGN_FEATURE_UTR         },
+  { "3' UTR",                          AGN_FEATURE_UTR3P       },
+  { "3'UTR",                           AGN_FEATURE_UTR3P       },
+  { "three prime UTR",                 AGN_FEATURE_UTR3P       },
+  { "three_prime_UTR",                 AGN_FEATURE_UTR3P       },
+  { "three prime untranslated region", AGN_FEATURE_UTR3P       },
+  { "three_prime_untranslated_region", AGN_FEATURE_UTR3P       },
+  { "5' UTR",                          AGN_FEATURE_UTR5P       },
+  { "5'UTR",                           AGN_FEATURE_UTR5P       },
+  { "five prime UTR",                  AGN_FEATURE_UTR5P       },
+  { "five_prime_UTR",                  AGN_FEATURE_UTR5P       },
+  { "five prime untranslated region",  AGN_FEATURE_UTR5P       },
+  { "five_prime_untranslated_region",  AGN_FEATURE_UTR5P       },
+  { "start_codon",                     AGN_FEATURE_START_CODON },
+  { "start codon",                     AGN_FEATURE_START_CODON },
+  { "initiation codon",                AGN_FEATURE_START_CODON },
+  { "stop_codon",                      AGN_FEATURE_STOP_CODON  },
+  { "stop codon",                      AGN_FEATURE_STOP_CODON  },
+  // What about 'termination codon'?
+  { NULL,                              AGN_FEATURE_OTHER       }
+};
+
+// Open-addressed table keyed by the interned type symbol of each feature.
+// GenomeTools stores every feature type via ``gt_symbol``, so all features of
+// a given type share a single type pointer. Only half of the table is ever
+// filled; any types beyond that are classified by string comparison. Each
+// thread keeps its own table, so lookups never need to be synchronized.
+#define AGN_TYPE_CACHE_SIZE 256
+
+typedef struct
+{
+  const char *symbol;
+  AgnFeatureClass fclass;
+} AgnTypeCacheEntry;
+
+static __thread AgnTypeCacheEntry type_cache[AGN_TYPE_CACHE_SIZE];
+static __thread GtUword type_cache_count = 0;
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Determine the class of the given type string by comparing it
+ * against each known type synonym.
+ */
+static AgnFeatureClass typecheck_classify(const char *type);
+
+/**
+ * @function Retrieve the transcript model attached to ``fn``. Only transcripts
+ * carry a model, so other features are rejected by their (cached) type class
+ * without a user data lookup.
+ */
+static AgnTranscriptModel *typecheck_model(GtFeatureNode *fn);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
 bool agn_typecheck_cds(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "CDS") ||
-         gt_feature_node_has_type(fn, "coding sequence") ||
-         gt_feature_node_has_type(fn, "coding_sequence");
+  return agn_typecheck_class(fn) == AGN_FEATURE_CDS;
+}
+
+AgnFeatureClass agn_typecheck_class(GtFeatureNode *fn)
+{
+  const char *type = gt_feature_node_get_type(fn);
+  GtUword mask = AGN_TYPE_CACHE_SIZE - 1;
+  GtUword slot = ((uintptr_t)type >> 3) & mask;
+  while(type_cache[slot].symbol != NULL)
+  {
+    if(type_cache[slot].symbol == type)
+      return type_cache[slot].fclass;
+    slot = (slot + 1) & mask;
+  }
+
+  AgnFeatureClass fclass = typecheck_classify(type);
+  if(type_cache_count < AGN_TYPE_CACHE_SIZE / 2)
+  {
+    type_cache[slot].symbol = type;
+    type_cache[slot].fclass = fclass;
+    type_cache_count++;
+  }
+  return fclass;
 }
 
 GtUword agn_typecheck_count(GtFeatureNode *fn, bool (*func)(GtFeatureNode *))
 {
   GtUword count = 0;
+  AgnTranscriptModel *model = typecheck_model(fn);
+  if(model && agn_transcript_model_lookup(model, func, NULL, &count, NULL))
+    return count;
+
   GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
   GtFeatureNode *feature;
   for(feature  = gt_feature_node_iterator_next(iter);
@@ -38,13 +151,17 @@ GtUword agn_typecheck_count(GtFeatureNode *fn, bool (*func)(GtFeatureNode *))
 
 bool agn_typecheck_exon(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "exon");
+  return agn_typecheck_class(fn) == AGN_FEATURE_EXON;
 }
 
 GtUword agn_typecheck_feature_combined_length(GtFeatureNode *root,
                                               bool (*func)(GtFeatureNode *))
 {
   GtUword totallength = 0;
+  AgnTranscriptModel *model = typecheck_model(root);
+  if(model && agn_transcript_model_lookup(model, func, NULL, NULL,&totallength))
+    return totallength;
+
   const char *id = NULL;
   GtArray *parts = agn_typecheck_select(root, func);
   while(gt_array_size(parts) > 0)
@@ -67,29 +184,36 @@ GtUword agn_typecheck_feature_combined_length(GtFeatureNode *root,
 
 bool agn_typecheck_gene(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "gene");
+  return agn_typecheck_class(fn) == AGN_FEATURE_GENE;
 }
 
 bool agn_typecheck_intron(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "intron");
+  return agn_typecheck_class(fn) == AGN_FEATURE_INTRON;
 }
 
 bool agn_typecheck_mrna(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "mRNA") ||
-         gt_feature_node_has_type(fn, "messenger RNA") ||
-         gt_feature_node_has_type(fn, "messenger_RNA");
+  return agn_typecheck_class(fn) == AGN_FEATURE_MRNA;
 }
 
 bool agn_typecheck_pseudogene(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "pseudogene");
+  return agn_typecheck_class(fn) == AGN_FEATURE_PSEUDOGENE;
 }
 
 GtArray *agn_typecheck_select(GtFeatureNode *fn, bool (*func)(GtFeatureNode *))
 {
   GtArray *children = gt_array_new( sizeof(GtFeatureNode *) );
+  GtFeatureNode **nodes;
+  GtUword count;
+  AgnTranscriptModel *model = typecheck_model(fn);
+  if(model && agn_transcript_model_lookup(model, func, &nodes, &count, NULL))
+  {
+    gt_array_add_elems(children, nodes, count * sizeof(GtFeatureNode *));
+    return children;
+  }
+
   GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
   GtFeatureNode *current;
   for(current = gt_feature_node_iterator_next(iter);
@@ -100,7 +224,7 @@ GtArray *agn_typecheck_select(GtFeatureNode *fn, bool (*func)(GtFeatureNode *))
       gt_array_add(children, current);
   }
   gt_feature_node_iterator_delete(iter);
-  gt_array_sort(children, (GtCompare)agn_genome_node_compare);
+  gt_array_sort_stable(children, (GtCompare)agn_genome_node_compare);
   return children;
 }
 
@@ -123,52 +247,54 @@ GtArray *agn_typecheck_select_str(GtFeatureNode *fn, const char *type)
 
 bool agn_typecheck_start_codon(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "start_codon") ||
-         gt_feature_node_has_type(fn, "start codon") ||
-         gt_feature_node_has_type(fn, "initiation codon");
+  return agn_typecheck_class(fn) == AGN_FEATURE_START_CODON;
 }
 
 bool agn_typecheck_stop_codon(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "stop_codon") ||
-         gt_feature_node_has_type(fn, "stop codon");
-         // What about 'termination codon'?
+  return agn_typecheck_class(fn) == AGN_FEATURE_STOP_CODON;
 }
 
 bool agn_typecheck_transcript(GtFeatureNode *fn)
 {
-  return agn_typecheck_mrna(fn) ||
-         gt_feature_node_has_type(fn, "tRNA") ||
-         gt_feature_node_has_type(fn, "transfer RNA") ||
-         gt_feature_node_has_type(fn, "rRNA") ||
-         gt_feature_node_has_type(fn, "ribosomal RNA");
+  AgnFeatureClass fclass = agn_typecheck_class(fn);
+  return fclass == AGN_FEATURE_MRNA ||
+         fclass == AGN_FEATURE_TRNA ||
+         fclass == AGN_FEATURE_RRNA;
 }
 
 bool agn_typecheck_utr(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "UTR") ||
-         gt_feature_node_has_type(fn, "untranslated region") ||
-         gt_feature_node_has_type(fn, "untranslated_region") ||
-         agn_typecheck_utr3p(fn) ||
-         agn_typecheck_utr5p(fn);
+  AgnFeatureClass fclass = agn_typecheck_class(fn);
+  return fclass == AGN_FEATURE_UTR   ||
+         fclass == AGN_FEATURE_UTR3P ||
+         fclass == AGN_FEATURE_UTR5P;
 }
 
 bool agn_typecheck_utr3p(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "3' UTR") ||
-         gt_feature_node_has_type(fn, "3'UTR") ||
-         gt_feature_node_has_type(fn, "three prime UTR") ||
-         gt_feature_node_has_type(fn, "three_prime_UTR") ||
-         gt_feature_node_has_type(fn, "three prime untranslated region") ||
-         gt_feature_node_has_type(fn, "three_prime_untranslated_region");
+  return agn_typecheck_class(fn) == AGN_FEATURE_UTR3P;
 }
 
 bool agn_typecheck_utr5p(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "5' UTR") ||
-         gt_feature_node_has_type(fn, "5'UTR") ||
-         gt_feature_node_has_type(fn, "five prime UTR") ||
-         gt_feature_node_has_type(fn, "five_prime_UTR") ||
-         gt_feature_node_has_type(fn, "five prime untranslated region") ||
-         gt_feature_node_has_type(fn, "five_prime_untranslated_region");
+  return agn_typecheck_class(fn) == AGN_FEATURE_UTR5P;
+}
+
+static AgnFeatureClass typecheck_classify(const char *type)
+{
+  GtUword i;
+  for(i = 0; type_synonyms[i].type != NULL; i++)
+  {
+    if(strcmp(type, type_synonyms[i].type) == 0)
+      return type_synonyms[i].fclass;
+  }
+  return AGN_FEATURE_OTHER;
+}
+
+static AgnTranscriptModel *typecheck_model(GtFeatureNode *fn)
+{
+  if(!agn_typecheck_transcript(fn))
+    return NULL;
+  return agn_transcript_model_get(fn);
 }
@@ -7,9 +7,12 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <stdarg.h>
 #include <string.h>
 #include "core/hashmap_api.h"
 #include "extended/feature_node_iterator_api.h"
+#include "AgnSeqid.h"
+#include "AgnTranscriptModel.h"
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
 #include "AgnVersion.h"
@@ -136,6 +139,10 @@ bool agn_feature_overlap_check(GtArray *feats)
 GtRange agn_feature_node_get_cds_range(GtFeatureNode *fn)
 {
   GtRange cds_range = {0,0};
+  AgnTranscriptModel *model = agn_transcript_model_get(fn);
+  if(model != NULL)
+    return model->cds_range;
+
   GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
   GtFeatureNode *child;
   for(child = gt_feature_node_iterator_next(iter);
@@ -221,6 +228,99 @@ int agn_genome_node_compare(GtGenomeNode **gn_a, GtGenomeNode **gn_b)
   return gt_genome_node_cmp(*gn_a, *gn_b);
 }
 
+AgnIlocusGap agn_ilocus_gap(GtUword prevend, GtUword start, GtRange *seqrange,
+                            GtUword delta, GtUword *newend, GtUword *newstart)
+{
+  agn_assert(seqrange && newend && newstart);
+  if(prevend + (2*delta) < start && prevend + (3*delta) >= start)
+  {
+    *newend = (prevend + start) / 2;
+    *newstart = *newend + 1;
+    return AGN_ILOCUS_GAP_RE_EXTEND;
+  }
+
+  *newend = prevend + delta;
+  if(*newend > seqrange->end)
+    *newend = seqrange->end;
+  *newstart = start - delta;
+  if(prevend + delta >= start)
+  {
+    if(seqrange->start + delta > start)
+      *newstart = seqrange->start;
+    return AGN_ILOCUS_GAP_OVERLAP_GENE;
+  }
+  if(prevend + (2*delta) >= start)
+    return AGN_ILOCUS_GAP_OVERLAP_DELTA;
+  return AGN_ILOCUS_GAP_IILOCUS;
+}
+
+GtUword agn_ilocus_initial_start(GtUword start, GtRange *seqrange,
+                                 GtUword delta)
+{
+  agn_assert(seqrange);
+  if(start >= seqrange->start + (2*delta))
+    return start - delta;
+  return seqrange->start;
+}
+
+void agn_ilocus_refine(GtRange *ranges, GtUword num, GtRange *origrange,
+                       GtUword delta)
+{
+  agn_assert(ranges && num > 0 && origrange);
+  GtUword i, rightmost = num - 1;
+  for(i = 0; i < num; i++)
+  {
+    if(origrange->start + delta > ranges[i].start)
+      ranges[i].start = origrange->start;
+    else
+      ranges[i].start -= delta;
+    if(ranges[i].end + delta > origrange->end)
+      ranges[i].end = origrange->end;
+    else
+      ranges[i].end += delta;
+    agn_assert(gt_range_contains(origrange, ranges + i));
+  }
+
+  // Close any remaining gaps. Of iLoci reaching equally far right, the last
+  // one is stretched; if that is also the first iLocus and it must be
+  // stretched right, it keeps its own start, as refined iLoci always have.
+  for(i = num - 1; i > 0; i--)
+  {
+    if(ranges[i-1].end > ranges[rightmost].end)
+      rightmost = i - 1;
+  }
+  GtRange right = ranges[rightmost];
+  ranges[0].start = origrange->start;
+  if(right.end < origrange->end)
+  {
+    right.end = origrange->end;
+    ranges[rightmost] = right;
+  }
+}
+
+GtUword agn_ilocus_terminal_end(GtUword end, GtRange *seqrange, GtUword delta)
+{
+  agn_assert(seqrange);
+  if(seqrange->end > (2*delta) && end <= seqrange->end - (2*delta))
+    return end + delta;
+  return seqrange->end;
+}
+
+void agn_logger_log(GtLogger *logger, const char *format, ...)
+{
+  agn_assert(logger && format);
+  if(!gt_logger_enabled(logger))
+    return;
+
+  FILE *target = gt_logger_target(logger);
+  va_list ap;
+  va_start(ap, format);
+  flockfile(target);
+  gt_logger_log_va(logger, format, ap);
+  funlockfile(target);
+  va_end(ap);
+}
+
 GtUword agn_mrna_3putr_length(GtFeatureNode *mrna)
 {
   return agn_typecheck_feature_combined_length(mrna, agn_typecheck_utr3p);
@@ -264,9 +364,7 @@ GtRange agn_multi_child_range(GtFeatureNode *top, GtFeatureNode *rep)
 bool agn_overlap_ilocus(GtGenomeNode *f1, GtGenomeNode *f2,
                         GtUword minoverlap, bool by_cds)
 {
-  GtStr *seqid1 = gt_genome_node_get_seqid(f1);
-  GtStr *seqid2 = gt_genome_node_get_seqid(f2);
-  if(gt_str_cmp(seqid1, seqid2) != 0)
+  if(!agn_seqid_equal(f1, f2))
     return false;
 
   GtRange r1 = gt_genome_node_get_range(f1);
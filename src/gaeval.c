@@ -14,6 +14,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnGaevalVisitor.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
+#include "AgnThreadVisitorStream.h"
 #include "AgnUtils.h"
 
 typedef struct
@@ -188,8 +189,9 @@ int main(int argc, char **argv)
   gt_queue_add(streams, stream);
   last_stream = stream;
 
-  stream = gt_gff3_out_stream_new(last_stream, NULL);
-  gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
+  GtNodeVisitor *gff3 = gt_gff3_visitor_new(NULL);
+  gt_gff3_visitor_retain_id_attributes((GtGFF3Visitor *)gff3);
+  stream = agn_thread_visitor_stream_new(last_stream, gff3);
   gt_queue_add(streams, stream);
   last_stream = stream;
 
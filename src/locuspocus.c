@@ -8,7 +8,9 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <ctype.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <string.h>
 #include "genometools.h"
 #include "aegean.h"
@@ -33,9 +35,77 @@ typedef struct
   bool by_cds;
   GtUword minoverlap;
   FILE *ilenfile;
+  GtFile *milocusfile;
+  char *indexfile;
   bool retain;
+  int numthreads;
+  GtUword chunksize;
+  GtUword sortbuffer;
+  bool presorted;
+  bool unannot;
+  GtArray *deltas;
+  FILE *sweepfile;
+  char *patchfile;
+  bool lean;
 } LocusPocusOptions;
 
+// A run of consecutive nodes from the sorted input that share a sequence ID
+// and are handled by a single locus stream; nodes that need no processing
+// (such as region nodes) are placed in a run of their own
+typedef struct
+{
+  GtArray *nodes;
+  GtGenomeNode *region;
+  bool process;
+  char *ilens;
+  size_t ilenslength;
+} LocusPocusRun;
+
+// All runs for a single sequence, processed in order by one thread; nodes
+// from the same sequence share GtStr objects and must not be touched by
+// several threads at once
+typedef struct
+{
+  GtArray *runs;
+  GtError *error;
+  int result;
+} LocusPocusJob;
+
+// Jobs shared among worker threads
+typedef struct
+{
+  LocusPocusOptions *options;
+  GtArray *jobs;
+  GtUword next;
+  pthread_mutex_t lock;
+} LocusPocusWorkers;
+
+// A locus from the previous output in --patch mode, with the extent of the
+// genes it contains (if any) and whether the patch touches it
+typedef struct
+{
+  GtGenomeNode *locus;
+  GtRange generange;
+  bool genes;
+  bool dirty;
+} LocusPocusPrevLocus;
+
+// A feature ID in the patch, and whether it was found in the previous output
+typedef struct
+{
+  bool deleted;
+  bool found;
+} LocusPocusPatchId;
+
+// The largest numbers used in the Names and IDs of the loci in the previous
+// output in --patch mode; recomputed loci that match no previous locus are
+// numbered after them
+typedef struct
+{
+  GtUword name;
+  GtUword id;
+} LocusPocusPatchCounts;
+
 // Set default values for program
 static void set_option_defaults(LocusPocusOptions *options)
 {
@@ -58,7 +128,18 @@ static void set_option_defaults(LocusPocusOptions *options)
   options->by_cds = false;
   options->minoverlap = 1;
   options->ilenfile = NULL;
+  options->milocusfile = NULL;
+  options->indexfile = NULL;
   options->retain = false;
+  options->numthreads = 1;
+  options->chunksize = 0;
+  options->sortbuffer = 0;
+  options->presorted = false;
+  options->unannot = false;
+  options->deltas = gt_array_new( sizeof(GtUword) );
+  options->sweepfile = NULL;
+  options->patchfile = NULL;
+  options->lean = false;
 }
 
 static void free_option_memory(LocusPocusOptions *options)
@@ -74,6 +155,15 @@ static void free_option_memory(LocusPocusOptions *options)
     gt_free(options->nameformat);
   if(options->ilenfile != NULL)
     fclose(options->ilenfile);
+  if(options->milocusfile != NULL)
+    gt_file_delete(options->milocusfile);
+  if(options->indexfile != NULL)
+    gt_free(options->indexfile);
+  gt_array_delete(options->deltas);
+  if(options->sweepfile != NULL)
+    fclose(options->sweepfile);
+  if(options->patchfile != NULL)
+    gt_free(options->patchfile);
 }
 
 // Usage statement
@@ -83,21 +173,62 @@ static void print_usage(FILE *outstream)
 "\nLocusPocus: calculate locus coordinates for the given gene annotation\n"
 "Usage: locuspocus [options] gff3file1 [gff3file2 gff3file3 ...]\n"
 "  Basic options:\n"
+"    -b|--sortbuffer: INT   sort input in external memory, holding at most\n"
+"                           INT features in memory at a time; temporary\n"
+"                           files are written to $TMPDIR (default /tmp)\n"
 "    -d|--debug             print detailed debugging messages to terminal\n"
 "                           (standard error)\n"
 "    -h|--help              print this help message and exit\n"
+"    -j|--threads: INT      number of threads used to parse the input and to\n"
+"                           process sequences concurrently; output is\n"
+"                           identical regardless of this setting; values\n"
+"                           above 1 require GenomeTools compiled with\n"
+"                           threads=yes; default is 1\n"
+"    -k|--chunksize: INT    with --threads, split each input file into\n"
+"                           chunks of at least INT bytes for parsing;\n"
+"                           default is 4194304\n"
+"    -L|--lean              reduce memory use by replacing each gene with a\n"
+"                           compact summary (its transcripts, CDS range, and\n"
+"                           exons) as soon as it is read; iLocus coordinates,\n"
+"                           types, and counts are unchanged, but subfeatures\n"
+"                           cannot be reported, so this conflicts with\n"
+"                           --verbose; requires --presorted or --sortbuffer\n"
+"                           (otherwise, all genes are held in memory in full\n"
+"                           while the input is sorted) and a single thread\n"
 "    -v|--version           print version number and exit\n\n"
 "  iLocus parsing:\n"
 "    -l|--delta: INT        when parsing interval loci, use the following\n"
 "                           delta to extend gene loci and include potential\n"
 "                           regulatory regions; default is 500\n"
+"    -D|--deltas: LIST      comma-separated list of delta values for which\n"
+"                           iLocus boundaries are reported with --sweep;\n"
+"                           default is the value of --delta\n"
 "    -s|--skipends          when enumerating interval loci, exclude\n"
 "                           unannotated (and presumably incomplete) iLoci at\n"
 "                           either end of the sequence\n"
 "    -e|--endsonly          report only incomplete iLocus fragments at the\n"
 "                           unannotated ends of sequences (complement of\n"
 "                           --skipends)\n"
-"    -y|--skipiiloci        do not report intergenic iLoci\n\n"
+"    -y|--skipiiloci        do not report intergenic iLoci\n"
+"    -U|--unannot           report an iLocus spanning each sequence that has\n"
+"                           no annotated features, with the attribute\n"
+"                           'unannot=true' (typed as an fiLocus with --cds\n"
+"                           or --refine); these are reported even with\n"
+"                           --skipends or --skipiiloci\n"
+"    -P|--patch: FILE       update the iLoci in the input, which must be\n"
+"                           the output of a previous run with --verbose and\n"
+"                           --retainids, with the genes in the given GFF3\n"
+"                           file; a gene replaces the gene with the same ID,\n"
+"                           a gene with the attribute 'deleted=true' removes\n"
+"                           it, and other genes are added; only iLoci up to\n"
+"                           the nearest unchanged gene iLocus on either side\n"
+"                           of each change are recomputed, and recomputed\n"
+"                           iLoci keep the Name and ID of the previous iLocus\n"
+"                           with the same genes, or are numbered after all\n"
+"                           iLoci of the previous run; all other iLocus\n"
+"                           parsing options should match those of the\n"
+"                           previous run; requires --retainids, and is not\n"
+"                           supported with --ilens, --lean, or --threads\n\n"
 "  Refinement options:\n"
 "    -r|--refine            by default genes are grouped in the same iLocus\n"
 "                           if they have any overlap; 'refine' mode allows\n"
@@ -117,6 +248,17 @@ static void print_usage(FILE *outstream)
 "                           with a long unsigned integer value\n"
 "    -i|--ilens: FILE       create a file with the lengths of each intergenic\n"
 "                           iLocus\n"
+"    -w|--sweep: FILE       write a table of the boundaries of each\n"
+"                           gene-containing iLocus (refined, in 'refine'\n"
+"                           mode) for each value of --deltas to the given\n"
+"                           file, computed in the same pass\n"
+"    -I|--index: FILE       write a binary index of the iLoci to the given\n"
+"                           file, for region and ID queries with 'lpquery';\n"
+"                           iLoci are looked up by Name, or by ID in\n"
+"                           'verbose' mode\n"
+"    -M|--miloci: FILE      merge adjacent gene-containing iLoci into miLoci\n"
+"                           and write them to the given file; implies\n"
+"                           'refine' mode\n"
 "    -g|--genemap: FILE     print a mapping from each gene annotation to its\n"
 "                           corresponding locus to the given file\n"
 "    -o|--outfile: FILE     name of file to which results will be written;\n"
@@ -137,7 +279,18 @@ static void print_usage(FILE *outstream)
 "                           for example, mRNA:gene will create a gene feature\n"
 "                           as a parent for any top-level mRNA feature;\n"
 "                           this option can be specified multiple times\n"
-"    -u|--pseudo            correct erroneously labeled pseudogenes\n\n");
+"    -u|--pseudo            correct erroneously labeled pseudogenes\n"
+"    -S|--presorted         input is already sorted by sequence and start\n"
+"                           position (as by 'gt gff3 -sort -tidy'); skip\n"
+"                           sorting and process features as they are read,\n"
+"                           failing at the first feature out of order;\n"
+"                           each input file is checked on its own and must\n"
+"                           list its sequences in sorted order if there are\n"
+"                           several; overrides --sortbuffer; features are\n"
+"                           only read one at a time from files that declare\n"
+"                           each sequence with a ##sequence-region pragma,\n"
+"                           otherwise all features are held until the end\n"
+"                           of the file\n\n");
 }
 
 // Adjust program settings from command-line arguments/options
@@ -146,29 +299,40 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "cdef:g:hi:l:m:n:o:p:rsTt:uVvy";
+  const char *optstr = "b:cD:def:g:hI:i:j:k:Ll:M:m:n:o:P:p:rSsTt:UuVvw:y";
   const char *key, *value, *oldvalue;
   const struct option locuspocus_options[] =
   {
+    { "sortbuffer", required_argument, NULL, 'b' },
     { "cds",        no_argument,       NULL, 'c' },
+    { "deltas",     required_argument, NULL, 'D' },
     { "debug",      no_argument,       NULL, 'd' },
     { "endsonly",   no_argument,       NULL, 'e' },
     { "filter",     required_argument, NULL, 'f' },
     { "genemap",    required_argument, NULL, 'g' },
     { "help",       no_argument,       NULL, 'h' },
+    { "index",      required_argument, NULL, 'I' },
     { "ilens",      required_argument, NULL, 'i' },
+    { "threads",    required_argument, NULL, 'j' },
+    { "chunksize",  required_argument, NULL, 'k' },
+    { "lean",       no_argument,       NULL, 'L' },
     { "delta",      required_argument, NULL, 'l' },
+    { "miloci",     required_argument, NULL, 'M' },
     { "minoverlap", required_argument, NULL, 'm' },
     { "namefmt",    required_argument, NULL, 'n' },
     { "outfile",    required_argument, NULL, 'o' },
+    { "patch",      required_argument, NULL, 'P' },
     { "parent",     required_argument, NULL, 'p' },
     { "refine",     no_argument,       NULL, 'r' },
+    { "presorted",  no_argument,       NULL, 'S' },
     { "skipends",   no_argument,       NULL, 's' },
     { "retainids",  no_argument,       NULL, 'T' },
     { "transmap",   required_argument, NULL, 't' },
+    { "unannot",    no_argument,       NULL, 'U' },
     { "pseudo",     no_argument,       NULL, 'u' },
     { "version",    no_argument,       NULL, 'v' },
     { "verbose",    no_argument,       NULL, 'V' },
+    { "sweep",      required_argument, NULL, 'w' },
     { "skipiiloci", no_argument,       NULL, 'y' },
     { NULL,         no_argument,       NULL,  0  },
   };
@@ -176,11 +340,34 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
        opt != -1;
        opt = getopt_long(argc, argv + 0, optstr, locuspocus_options, &optindex))
   {
-    if(opt == 'c')
+    if(opt == 'b')
+    {
+      if(sscanf(optarg, "%lu", &options->sortbuffer) != 1)
+      {
+        gt_error_set(error, "could not convert sort buffer '%s' to an "
+                     "integer", optarg);
+      }
+    }
+    else if(opt == 'c')
     {
       options->by_cds = 1;
       options->refine = 1;
     }
+    else if(opt == 'D')
+    {
+      gt_array_reset(options->deltas);
+      for(value = strtok(optarg, ","); value; value = strtok(NULL, ","))
+      {
+        GtUword delta;
+        if(sscanf(value, "%lu", &delta) != 1)
+        {
+          gt_error_set(error, "could not convert delta '%s' to an integer",
+                       value);
+          break;
+        }
+        gt_array_add(options->deltas, delta);
+      }
+    }
     else if(opt == 'd')
       options->debug = 1;
     else if(opt == 'e')
@@ -221,12 +408,38 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       print_usage(stdout);
       exit(0);
     }
+    else if(opt == 'I')
+    {
+      if(options->indexfile != NULL)
+        gt_free(options->indexfile);
+      options->indexfile = gt_cstr_dup(optarg);
+    }
     else if(opt == 'i')
     {
       options->ilenfile = fopen(optarg, "w");
       if(options->ilenfile == NULL)
         gt_error_set(error, "could not open ilenfile file '%s'", optarg);
     }
+    else if(opt == 'j')
+    {
+      if(sscanf(optarg, "%d", &options->numthreads) != 1 ||
+         options->numthreads < 1)
+      {
+        gt_error_set(error, "could not convert thread count '%s' to a "
+                     "positive integer", optarg);
+      }
+    }
+    else if(opt == 'k')
+    {
+      if(sscanf(optarg, "%lu", &options->chunksize) != 1 ||
+         options->chunksize == 0)
+      {
+        gt_error_set(error, "could not convert chunk size '%s' to a "
+                     "positive integer", optarg);
+      }
+    }
+    else if(opt == 'L')
+      options->lean = true;
     else if(opt == 'l')
     {
       if(sscanf(optarg, "%lu", &options->delta) == EOF)
@@ -235,6 +448,13 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
                      optarg);
       }
     }
+    else if(opt == 'M')
+    {
+      if(options->milocusfile != NULL)
+        gt_file_delete(options->milocusfile);
+      options->milocusfile = gt_file_new(optarg, "w", error);
+      options->refine = 1;
+    }
     else if(opt == 'm')
     {
       if(sscanf(optarg, "%lu", &options->minoverlap) == EOF)
@@ -255,6 +475,12 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       options->outstream = gt_file_new(optarg, "w", error);
       options->filefreefunc = gt_file_delete;
     }
+    else if(opt == 'P')
+    {
+      if(options->patchfile != NULL)
+        gt_free(options->patchfile);
+      options->patchfile = gt_cstr_dup(optarg);
+    }
     else if(opt == 'p')
     {
       key = strtok(optarg, ":");
@@ -273,6 +499,8 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
     }
     else if(opt == 'r')
       options->refine = 1;
+    else if(opt == 'S')
+      options->presorted = true;
     else if(opt == 's')
     {
       if(options->endmode > 0)
@@ -290,6 +518,8 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       if(options->transstream == NULL)
         gt_error_set(error, "could not open transmap file '%s'", optarg);
     }
+    else if(opt == 'U')
+      options->unannot = true;
     else if(opt == 'u')
       options->pseudofix = 1;
     else if(opt == 'v')
@@ -299,55 +529,100 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
     }
     else if(opt == 'V')
       options->verbose = 1;
+    else if(opt == 'w')
+    {
+      if(options->sweepfile != NULL)
+        fclose(options->sweepfile);
+      options->sweepfile = fopen(optarg, "w");
+      if(options->sweepfile == NULL)
+        gt_error_set(error, "could not open sweep file '%s'", optarg);
+    }
     else if(opt == 'y')
       options->skipiiLoci = true;
   }
+
+  if(gt_array_size(options->deltas) > 0 && options->sweepfile == NULL)
+    gt_error_set(error, "the 'deltas' option requires the 'sweep' option");
+  if(options->patchfile != NULL && !options->retain)
+    gt_error_set(error, "the 'patch' option requires the 'retainids' option");
+  if(options->patchfile != NULL && options->ilenfile != NULL)
+    gt_error_set(error, "the 'ilens' option is not supported with 'patch'");
+  if(options->patchfile != NULL && options->lean)
+    gt_error_set(error, "the 'lean' option is not supported with 'patch'");
+  if(options->lean && options->verbose)
+    gt_error_set(error, "the 'lean' option is not supported with 'verbose'");
+  if(options->lean && !options->presorted && options->sortbuffer == 0)
+  {
+    gt_error_set(error, "the 'lean' option requires the 'presorted' or "
+                 "'sortbuffer' option");
+  }
+  if(options->lean && options->numthreads > 1)
+    gt_error_set(error, "the 'lean' option is not supported with 'threads'");
+  if(options->numthreads > 1 && !gt_multithread_support())
+  {
+    gt_error_set(error, "the 'threads' option requires GenomeTools compiled "
+                 "with 'threads=yes'");
+  }
+  if(options->patchfile != NULL && options->numthreads > 1)
+    gt_error_set(error, "the 'threads' option is not supported with 'patch'");
 }
 
-// Main program
-int main(int argc, char **argv)
+// Add the stream that parses the GFF3 input to the pipeline; with several
+// threads, each file is parsed in chunks concurrently
+static GtNodeStream *add_gff3_in_stream(LocusPocusOptions *options,
+                                        GtQueue *streams, int numfiles,
+                                        const char **filenames)
 {
-  GtError *error;
-  GtLogger *logger;
-  GtQueue *streams;
-  GtNodeStream *current_stream, *last_stream;
-  gt_lib_init();
-
-  // Parse command-line options
-  LocusPocusOptions options;
-  set_option_defaults(&options);
-  error = gt_error_new();
-  parse_options(argc, argv, &options, error);
-  if(gt_error_is_set(error))
+  GtNodeStream *current_stream;
+  if(options->numthreads > 1)
   {
-    fprintf(stderr, "[LocusPocus] error: %s", gt_error_get(error));
-    return 1;
+    current_stream = agn_parallel_gff3_in_stream_new(numfiles, filenames,
+                                                     options->numthreads);
+    if(options->chunksize > 0)
+    {
+      agn_parallel_gff3_in_stream_set_chunk_size(
+          (AgnParallelGff3InStream *)current_stream, options->chunksize);
+    }
   }
-  int numfiles = argc - optind;
-  if(numfiles < 1)
+  else
   {
-    fprintf(stderr, "[LocusPocus] error: must provide at least one GFF3 file "
-            "as input; use '-' if you want to provide data via standard "
-            "input\n");
-    print_usage(stderr);
-    return 1;
+    current_stream = gt_gff3_in_stream_new_unsorted(numfiles, filenames);
+    gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+    gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
   }
+  gt_queue_add(streams, current_stream);
+  return current_stream;
+}
 
-  logger = gt_logger_new(true, "", stderr);
-  streams = gt_queue_new();
-
-
-  //----- Set up the node processing stream -----//
-  //---------------------------------------------//
+// Add the streams that read, preprocess, and sort the input to the pipeline
+static GtNodeStream *add_input_streams(LocusPocusOptions *options,
+                                       GtQueue *streams, int numfiles,
+                                       const char **filenames)
+{
+  GtNodeStream *current_stream, *last_stream;
 
-  current_stream = gt_gff3_in_stream_new_unsorted(numfiles,
-                                                  (const char **)argv + optind);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  if(options->presorted && numfiles > 1)
+  {
+    // Check each file on its own, and merge the sorted files.
+    GtArray *checked = gt_array_new( sizeof(GtNodeStream *) );
+    int i;
+    for(i = 0; i < numfiles; i++)
+    {
+      last_stream = add_gff3_in_stream(options, streams, 1, filenames + i);
+      current_stream = agn_sort_check_stream_new(last_stream);
+      agn_sort_check_stream_check_seqid_order(
+          (AgnSortCheckStream *)current_stream);
+      gt_queue_add(streams, current_stream);
+      gt_array_add(checked, current_stream);
+    }
+    last_stream = gt_merge_stream_new(checked);
+    gt_queue_add(streams, last_stream);
+    gt_array_delete(checked);
+  }
+  else
+    last_stream = add_gff3_in_stream(options, streams, numfiles, filenames);
 
-  if(options.pseudofix)
+  if(options->pseudofix)
   {
     current_stream = agn_pseudogene_fix_stream_new(last_stream);
     gt_queue_add(streams, current_stream);
@@ -355,84 +630,1163 @@ int main(int argc, char **argv)
   }
 
   current_stream = agn_infer_parent_stream_new(last_stream,
-                                               options.type_parents);
+                                               options->type_parents);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = agn_filter_stream_new(last_stream, options.filter);
+  current_stream = agn_filter_stream_new(last_stream, options->filter);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = gt_sort_stream_new(last_stream);
+  // Files that were checked individually are already merged in order.
+  if(options->presorted && numfiles > 1)
+    return last_stream;
+
+  if(options->presorted)
+    current_stream = agn_sort_check_stream_new(last_stream);
+  else if(options->sortbuffer > 0)
+    current_stream = agn_external_sort_stream_new(last_stream,
+                                                  options->sortbuffer);
+  else
+    current_stream = gt_sort_stream_new(last_stream);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = agn_locus_stream_new(last_stream, options.delta);
+  return last_stream;
+}
+
+// Add the locus parsing streams (and refinement streams, if requested) to the
+// pipeline
+static GtNodeStream *add_locus_streams(LocusPocusOptions *options,
+                                       GtQueue *streams,
+                                       GtNodeStream *last_stream,
+                                       FILE *ilenfile)
+{
+  GtNodeStream *current_stream;
+
+  current_stream = agn_locus_stream_new(last_stream, options->delta);
   AgnLocusStream *ls = (AgnLocusStream*)current_stream;
   agn_locus_stream_set_source(ls, "AEGeAn::LocusPocus");
-  agn_locus_stream_set_endmode(ls, options.endmode);
-  agn_locus_stream_track_ilens(ls, options.ilenfile);
-  if(options.nameformat != NULL)
-    agn_locus_stream_set_name_format(ls, options.nameformat);
-  if(options.skipiiLoci)
+  agn_locus_stream_set_endmode(ls, options->endmode);
+  agn_locus_stream_track_ilens(ls, ilenfile);
+  if(options->nameformat != NULL)
+    agn_locus_stream_set_name_format(ls, options->nameformat);
+  if(options->skipiiLoci)
     agn_locus_stream_skip_iiLoci(ls);
+  if(options->unannot)
+    agn_locus_stream_report_unannotated(ls);
+  if(options->lean)
+    agn_locus_stream_summarize_features(ls);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  if(options.refine)
+  if(options->refine)
   {
-    current_stream = agn_locus_refine_stream_new(last_stream, options.delta,
-                                                 options.minoverlap,
-                                                 options.by_cds);
+    current_stream = agn_locus_refine_stream_new(last_stream, options->delta,
+                                                 options->minoverlap,
+                                                 options->by_cds);
     AgnLocusRefineStream *lrs = (AgnLocusRefineStream *)current_stream;
     agn_locus_refine_stream_set_source(lrs, "AEGeAn::LocusPocus");
-    agn_locus_refine_stream_track_ilens(lrs, options.ilenfile);
-    if(options.nameformat != NULL)
-      agn_locus_refine_stream_set_name_format(lrs, options.nameformat);
+    agn_locus_refine_stream_track_ilens(lrs, ilenfile);
+    if(options->nameformat != NULL)
+      agn_locus_refine_stream_set_name_format(lrs, options->nameformat);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  return last_stream;
+}
+
+// Add the miLocus, index, delta sweep, gene/transcript mapping, and output
+// streams to the pipeline
+static GtNodeStream *add_output_streams(LocusPocusOptions *options,
+                                        GtQueue *streams,
+                                        GtNodeStream *last_stream)
+{
+  GtNodeStream *current_stream;
+
+  if(options->milocusfile != NULL)
+  {
+    current_stream = agn_milocus_stream_new(last_stream, options->milocusfile);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  if(options->indexfile != NULL)
+  {
+    current_stream = agn_ilocus_index_stream_new(last_stream,
+                                                 options->indexfile);
+    if(options->verbose)
+    {
+      AgnIlocusIndexStream *iis = (AgnIlocusIndexStream *)current_stream;
+      agn_ilocus_index_stream_number_loci(iis);
+    }
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  if(options->sweepfile != NULL)
+  {
+    if(gt_array_size(options->deltas) == 0)
+      gt_array_add(options->deltas, options->delta);
+    current_stream = agn_delta_sweep_stream_new(last_stream, options->deltas,
+                                                options->sweepfile);
+    if(options->refine)
+      agn_delta_sweep_stream_refine((AgnDeltaSweepStream *)current_stream);
     gt_queue_add(streams, current_stream);
     last_stream = current_stream;
   }
 
-  if(options.genestream != NULL || options.transstream != NULL)
+  if(options->genestream != NULL || options->transstream != NULL)
   {
-    current_stream = agn_locus_map_stream_new(last_stream, options.genestream,
-                                              options.transstream);
+    current_stream = agn_locus_map_stream_new(last_stream, options->genestream,
+                                              options->transstream);
     gt_queue_add(streams, current_stream);
     last_stream = current_stream;
   }
 
-  if(options.verbose == 0)
+  if(options->verbose == 0 && !options->retain)
+  {
+    current_stream = agn_locus_out_stream_new(last_stream, options->outstream);
+    gt_queue_add(streams, current_stream);
+    return current_stream;
+  }
+
+  if(options->verbose == 0)
   {
     current_stream = agn_remove_children_stream_new(last_stream);
     gt_queue_add(streams, current_stream);
     last_stream = current_stream;
   }
 
-  current_stream = gt_gff3_out_stream_new(last_stream, options.outstream);
-  if(options.retain)
-    gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)current_stream);
+  GtNodeVisitor *gff3 = gt_gff3_visitor_new(options->outstream);
+  if(options->retain)
+    gt_gff3_visitor_retain_id_attributes((GtGFF3Visitor *)gff3);
+  current_stream = agn_thread_visitor_stream_new(last_stream, gff3);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  return last_stream;
+}
+
+// Delete every stream in the queue, along with the queue itself
+static void delete_streams(GtQueue *streams)
+{
+  while(gt_queue_size(streams) > 0)
+  {
+    GtNodeStream *stream = gt_queue_get(streams);
+    gt_node_stream_delete(stream);
+  }
+  gt_queue_delete(streams);
+}
+
+// Delete the nodes of an array that were never read by an array in stream
+static void delete_unread_nodes(GtArray *nodes, GtUword progress)
+{
+  GtUword i;
+  for(i = progress; i < gt_array_size(nodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(nodes, i);
+    gt_genome_node_delete(gn);
+  }
+  gt_array_reset(nodes);
+}
+
+// Create a new run and add it to the list of runs
+static LocusPocusRun *run_new(GtArray *runs, bool process)
+{
+  LocusPocusRun *run = gt_malloc( sizeof(LocusPocusRun) );
+  run->nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  run->region = NULL;
+  run->process = process;
+  run->ilens = NULL;
+  run->ilenslength = 0;
+  gt_array_add(runs, run);
+  return run;
+}
+
+// Create a new job and add it to the list of jobs
+static LocusPocusJob *job_new(GtArray *jobs)
+{
+  LocusPocusJob *job = gt_malloc( sizeof(LocusPocusJob) );
+  job->runs = gt_array_new( sizeof(LocusPocusRun *) );
+  job->error = gt_error_new();
+  job->result = 0;
+  gt_array_add(jobs, job);
+  return job;
+}
+
+// Create a run and a job for each region node read before that of the given
+// sequence (or for every remaining region node if seqid is NULL), so that the
+// locus stream reports an iLocus for each sequence that has no features
+static void partition_unannotated(GtArray *runs, GtArray *jobs,
+                                  GtArray *regionorder, GtUword *next,
+                                  const char *seqid)
+{
+  GtUword last = gt_array_size(regionorder);
+  if(seqid != NULL)
+  {
+    GtUword i;
+    for(i = *next; i < gt_array_size(regionorder); i++)
+    {
+      GtGenomeNode **region = gt_array_get(regionorder, i);
+      if(strcmp(gt_str_get(gt_genome_node_get_seqid(*region)), seqid) == 0)
+        break;
+    }
+    if(i == gt_array_size(regionorder))
+      return;
+    last = i;
+  }
+
+  for(; *next < last; (*next)++)
+  {
+    GtGenomeNode **region = gt_array_get(regionorder, *next);
+    LocusPocusRun *run = run_new(runs, true);
+    run->region = gt_genome_node_ref(*region);
+    gt_array_add(run->nodes, run->region);
+    LocusPocusJob *job = job_new(jobs);
+    gt_array_add(job->runs, run);
+  }
+  if(seqid != NULL)
+    (*next)++;
+}
+
+// Pull every node from the input stream and split the nodes into runs, in
+// order, and into one job per sequence
+static int partition_input(LocusPocusOptions *options, GtNodeStream *in_stream,
+                           GtArray *runs, GtArray *jobs, GtError *error)
+{
+  GtArray *regionorder = gt_array_new( sizeof(GtGenomeNode *) );
+  GtUword nextregion = 0;
+  GtHashmap *regions = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  GtHashmap *jobsbyseqid = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  LocusPocusRun *current = NULL;
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(in_stream, &gn, error)) == 0 && gn)
+  {
+    if(gt_region_node_try_cast(gn))
+    {
+      // The locus stream resets its state at each region node, so runs may
+      // not span them.
+      const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+      if(gt_hashmap_get(regions, seqid) == NULL)
+      {
+        gt_hashmap_add(regions, (char *)seqid, gn);
+        gt_array_add(regionorder, gn);
+      }
+      current = NULL;
+      LocusPocusRun *run = run_new(runs, false);
+      gt_array_add(run->nodes, gn);
+    }
+    else if(gt_feature_node_try_cast(gn))
+    {
+      GtGenomeNode **first = NULL;
+      if(current != NULL)
+        first = gt_array_get(current->nodes, current->region ? 1 : 0);
+      if(current == NULL || !agn_seqid_equal(gn, *first))
+      {
+        const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+        LocusPocusJob *job = gt_hashmap_get(jobsbyseqid, seqid);
+        if(job == NULL && options->unannot)
+          partition_unannotated(runs, jobs, regionorder, &nextregion, seqid);
+        current = run_new(runs, true);
+        GtGenomeNode *region = gt_hashmap_get(regions, seqid);
+        if(region != NULL)
+        {
+          current->region = gt_genome_node_ref(region);
+          gt_array_add(current->nodes, current->region);
+        }
+
+        if(job == NULL)
+        {
+          job = job_new(jobs);
+          gt_hashmap_add(jobsbyseqid, (char *)seqid, job);
+        }
+        gt_array_add(job->runs, current);
+      }
+      gt_array_add(current->nodes, gn);
+    }
+    else if(current != NULL)
+      gt_array_add(current->nodes, gn);
+    else
+    {
+      LocusPocusRun *run = run_new(runs, false);
+      gt_array_add(run->nodes, gn);
+    }
+  }
+  if(result == 0 && options->unannot)
+    partition_unannotated(runs, jobs, regionorder, &nextregion, NULL);
+  gt_array_delete(regionorder);
+  gt_hashmap_delete(regions);
+  gt_hashmap_delete(jobsbyseqid);
+  return result;
+}
+
+// Compute loci for a single run, replacing the run's input nodes with the
+// resulting loci
+static int process_run(LocusPocusOptions *options, LocusPocusRun *run,
+                       GtError *error)
+{
+  FILE *ilenfile = NULL;
+  if(options->ilenfile != NULL)
+    ilenfile = open_memstream(&run->ilens, &run->ilenslength);
+
+  GtArray *input = run->nodes;
+  run->nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *current_stream, *last_stream;
+  GtUword progress = 0;
+
+  current_stream = gt_array_in_stream_new(input, &progress, error);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
+  last_stream = add_locus_streams(options, streams, last_stream, ilenfile);
+
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(last_stream, &gn, error)) == 0 && gn)
+  {
+    // The region node was borrowed from the input to give the locus stream
+    // the sequence's boundaries; it is written where it was found instead.
+    if(gn == run->region)
+      gt_genome_node_delete(gn);
+    else
+      gt_array_add(run->nodes, gn);
+  }
+  delete_streams(streams);
+  if(result == -1)
+    delete_unread_nodes(input, progress);
+  gt_array_delete(input);
+  if(ilenfile != NULL)
+    fclose(ilenfile);
+  return result;
+}
+
+// Worker thread: process jobs until none remain
+static void *process_jobs(void *data)
+{
+  LocusPocusWorkers *workers = data;
+  while(1)
+  {
+    LocusPocusJob *job = NULL;
+    pthread_mutex_lock(&workers->lock);
+    if(workers->next < gt_array_size(workers->jobs))
+    {
+      job = *(LocusPocusJob **)gt_array_get(workers->jobs, workers->next);
+      workers->next++;
+    }
+    pthread_mutex_unlock(&workers->lock);
+    if(job == NULL)
+      break;
+
+    GtUword i;
+    for(i = 0; i < gt_array_size(job->runs) && job->result == 0; i++)
+    {
+      LocusPocusRun *run = *(LocusPocusRun **)gt_array_get(job->runs, i);
+      job->result = process_run(workers->options, run, job->error);
+    }
+  }
+  return NULL;
+}
+
+// Compute loci for each sequence in a separate thread. Runs are then
+// reassembled in their original order and loci renamed with a single counter,
+// so that output is identical to that of a single pipeline.
+static int run_parallel(LocusPocusOptions *options, GtNodeStream *in_stream,
+                        GtError *error)
+{
+  GtArray *runs = gt_array_new( sizeof(LocusPocusRun *) );
+  GtArray *jobs = gt_array_new( sizeof(LocusPocusJob *) );
+  int result = partition_input(options, in_stream, runs, jobs, error);
+
+  if(result == 0)
+  {
+    LocusPocusWorkers workers;
+    workers.options = options;
+    workers.jobs = jobs;
+    workers.next = 0;
+    pthread_mutex_init(&workers.lock, NULL);
+    pthread_t *threads = gt_malloc( sizeof(pthread_t) * options->numthreads );
+    int i;
+    for(i = 0; i < options->numthreads; i++)
+      pthread_create(threads + i, NULL, process_jobs, &workers);
+    for(i = 0; i < options->numthreads; i++)
+      pthread_join(threads[i], NULL);
+    gt_free(threads);
+    pthread_mutex_destroy(&workers.lock);
+  }
+
+  GtUword i;
+  for(i = 0; i < gt_array_size(jobs); i++)
+  {
+    LocusPocusJob *job = *(LocusPocusJob **)gt_array_get(jobs, i);
+    if(result == 0 && job->result == -1)
+    {
+      gt_error_set(error, "%s", gt_error_get(job->error));
+      result = -1;
+    }
+    gt_array_delete(job->runs);
+    gt_error_delete(job->error);
+    gt_free(job);
+  }
+  gt_array_delete(jobs);
+
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtUword count = 0;
+  for(i = 0; i < gt_array_size(runs); i++)
+  {
+    LocusPocusRun *run = *(LocusPocusRun **)gt_array_get(runs, i);
+    GtUword j;
+    for(j = 0; j < gt_array_size(run->nodes); j++)
+    {
+      GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(run->nodes, j);
+      if(result == -1)
+      {
+        gt_genome_node_delete(gn);
+        continue;
+      }
+      if(run->process && options->nameformat != NULL &&
+         gt_feature_node_try_cast(gn))
+      {
+        char locusname[256];
+        snprintf(locusname, sizeof (locusname), options->nameformat, ++count);
+        gt_feature_node_set_attribute((GtFeatureNode *)gn, "Name", locusname);
+      }
+      gt_array_add(nodes, gn);
+    }
+    if(result == 0 && run->ilens != NULL)
+      fwrite(run->ilens, 1, run->ilenslength, options->ilenfile);
+    if(run->ilens != NULL)
+      free(run->ilens);
+    gt_array_delete(run->nodes);
+    gt_free(run);
+  }
+  gt_array_delete(runs);
+
+  if(result == 0)
+  {
+    GtQueue *streams = gt_queue_new();
+    GtNodeStream *last_stream;
+    GtUword progress = 0;
+    last_stream = gt_array_in_stream_new(nodes, &progress, error);
+    gt_queue_add(streams, last_stream);
+    last_stream = add_output_streams(options, streams, last_stream);
+    result = gt_node_stream_pull(last_stream, error);
+    delete_streams(streams);
+    if(result == -1)
+      delete_unread_nodes(nodes, progress);
+  }
+  gt_array_delete(nodes);
+  return result;
+}
+
+// Delete the locus and the nodes of a --patch run that fall outside of the
+// recomputed neighborhood, copying the attributes on the outer side of the
+// anchor loci from the previous output
+static void patch_trim_run(GtArray *runnodes, GtArray *kept, bool leftanchor,
+                           bool rightanchor, GtGenomeNode *leftlocus,
+                           GtGenomeNode *rightlocus)
+{
+  GtUword numnodes = gt_array_size(runnodes);
+  GtUword first = numnodes, last = 0, i;
+  for(i = 0; i < numnodes; i++)
+  {
+    GtFeatureNode **fn = gt_array_get(runnodes, i);
+    if(gt_feature_node_number_of_children(*fn) > 0)
+    {
+      if(first == numnodes)
+        first = i;
+      last = i;
+    }
+  }
+  if(!leftanchor)
+    first = 0;
+  if(!rightanchor)
+    last = numnodes - 1;
+
+  const char *leftattrs[] = { "liil", "left_overlap", NULL };
+  const char *rightattrs[] = { "riil", "right_overlap", "iiLocus_exception",
+                               NULL };
+  for(i = 0; i < numnodes; i++)
+  {
+    GtGenomeNode **gn = gt_array_get(runnodes, i);
+    if(i < first || i > last)
+    {
+      gt_genome_node_delete(*gn);
+      continue;
+    }
+
+    const char **attrs = NULL;
+    GtFeatureNode *oldfn = NULL;
+    if(i == first && leftanchor)
+    {
+      attrs = leftattrs;
+      oldfn = gt_feature_node_cast(leftlocus);
+    }
+    else if(i == last && rightanchor)
+    {
+      attrs = rightattrs;
+      oldfn = gt_feature_node_cast(rightlocus);
+    }
+    for(; attrs != NULL && *attrs != NULL; attrs++)
+    {
+      const char *value = gt_feature_node_get_attribute(oldfn, *attrs);
+      if(value != NULL)
+        gt_feature_node_set_attribute((GtFeatureNode *)*gn, *attrs, value);
+    }
+    gt_array_add(kept, *gn);
+  }
+}
+
+// Return true and set `number` if `value` is the given printf-style format,
+// with a single integer conversion, printed with some number
+static bool patch_format_number(const char *format, const char *value,
+                                GtUword *number)
+{
+  const char *c;
+  for(c = value; *c != '\0'; c++)
+  {
+    if(!isdigit(*c) || (c > value && isdigit(c[-1])))
+      continue;
+    GtUword candidate = strtoul(c, NULL, 10);
+    char printed[256];
+    snprintf(printed, sizeof (printed), format, candidate);
+    if(strcmp(printed, value) == 0)
+    {
+      *number = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Raise the counts to cover the Name and ID of a locus from the previous
+// output; IDs are numbered as GenomeTools numbers the IDs it creates
+static void patch_count_locus(LocusPocusOptions *options, GtFeatureNode *locus,
+                              LocusPocusPatchCounts *counts)
+{
+  GtUword number;
+  const char *name = gt_feature_node_get_attribute(locus, "Name");
+  if(name != NULL && options->nameformat != NULL &&
+     patch_format_number(options->nameformat, name, &number) &&
+     number > counts->name)
+    counts->name = number;
+
+  const char *id = gt_feature_node_get_attribute(locus, "ID");
+  if(id == NULL)
+    return;
+  GtStr *idformat = gt_str_new_cstr(gt_feature_node_get_type(locus));
+  gt_str_append_cstr(idformat, "%lu");
+  if(patch_format_number(gt_str_get(idformat), id, &number) &&
+     number > counts->id)
+    counts->id = number;
+  gt_str_delete(idformat);
+}
+
+// Give a recomputed locus the Name and ID of the previous locus with the same
+// genes (or, for loci without genes, with the same coordinates), or else a
+// new Name and ID following those of the previous output
+static void patch_name_locus(LocusPocusOptions *options, GtFeatureNode *locus,
+                             GtArray *loci, GtUword lo, GtUword hi,
+                             GtHashmap *oldbygene,
+                             LocusPocusPatchCounts *counts)
+{
+  GtFeatureNode *match = NULL;
+  GtUword numchildren = gt_feature_node_number_of_children(locus);
+  if(numchildren > 0)
+  {
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(locus);
+    GtFeatureNode *child;
+    bool first = true;
+    for(child  = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child  = gt_feature_node_iterator_next(iter))
+    {
+      const char *id = gt_feature_node_get_attribute(child, "ID");
+      GtFeatureNode *old = id ? gt_hashmap_get(oldbygene, id) : NULL;
+      if(first)
+        match = old;
+      if(old == NULL || old != match)
+      {
+        match = NULL;
+        break;
+      }
+      first = false;
+    }
+    gt_feature_node_iterator_delete(iter);
+    if(match && gt_feature_node_number_of_children(match) != numchildren)
+      match = NULL;
+  }
+  else
+  {
+    GtRange range = gt_genome_node_get_range((GtGenomeNode *)locus);
+    GtUword i;
+    for(i = lo; i <= hi && match == NULL; i++)
+    {
+      LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+      GtRange oldrange = gt_genome_node_get_range(prev->locus);
+      if(!prev->genes && gt_range_compare(&range, &oldrange) == 0)
+        match = gt_feature_node_cast(prev->locus);
+    }
+  }
+
+  if(match == NULL)
+  {
+    if(options->nameformat != NULL)
+    {
+      char locusname[256];
+      snprintf(locusname, sizeof (locusname), options->nameformat,
+               ++counts->name);
+      gt_feature_node_set_attribute(locus, "Name", locusname);
+    }
+    if(options->retain)
+    {
+      GtStr *id = gt_str_new_cstr(gt_feature_node_get_type(locus));
+      gt_str_append_uword(id, ++counts->id);
+      gt_feature_node_set_attribute(locus, "ID", gt_str_get(id));
+      gt_str_delete(id);
+    }
+    return;
+  }
+
+  const char *attrs[] = { "ID", "Name", NULL };
+  const char **attr;
+  for(attr = attrs; *attr != NULL; attr++)
+  {
+    const char *value = gt_feature_node_get_attribute(match, *attr);
+    if(value != NULL)
+      gt_feature_node_set_attribute(locus, *attr, value);
+    else if(gt_feature_node_get_attribute(locus, *attr) != NULL)
+      gt_feature_node_remove_attribute(locus, *attr);
+  }
+}
+
+// Recompute the loci lo through hi of a sequence from the previous output,
+// with the genes they contain and the added or changed genes between them.
+// Unless the neighborhood extends to the end of the sequence, the first and
+// last of these loci are gene loci that the patch does not touch; their
+// outer boundaries do not depend on the patch, and the locus stream
+// reproduces them when the neighborhood is treated as a sequence of its own.
+static int patch_run(LocusPocusOptions *options, GtArray *loci, GtUword lo,
+                     GtUword hi, bool leftanchor, bool rightanchor,
+                     GtArray *patch, GtHashmap *patchids,
+                     GtGenomeNode *region, LocusPocusPatchCounts *counts,
+                     GtArray *nodes, GtError *error)
+{
+  GtUword m = gt_array_size(loci);
+  LocusPocusPrevLocus *left = gt_array_get(loci, lo);
+  LocusPocusPrevLocus *right = gt_array_get(loci, hi);
+  GtStr *seqid = gt_genome_node_get_seqid(left->locus);
+  GtRange span;
+  if(leftanchor)
+    span.start = gt_genome_node_get_start(left->locus);
+  else if(region != NULL)
+    span.start = gt_genome_node_get_start(region);
+  else
+    span.start = gt_genome_node_get_start(left->locus);
+  if(rightanchor)
+    span.end = gt_genome_node_get_end(right->locus);
+  else if(region != NULL)
+    span.end = gt_genome_node_get_end(region);
+  else
+  {
+    LocusPocusPrevLocus *lastlocus = gt_array_get(loci, m - 1);
+    span.end = gt_genome_node_get_end(lastlocus->locus);
+  }
+
+  LocusPocusRun run = { gt_array_new( sizeof(GtGenomeNode *) ), NULL, true,
+                        NULL, 0 };
+  GtArray *genes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtHashmap *oldbygene = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  GtUword i;
+  for(i = lo; i <= hi; i++)
+  {
+    LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+    if(!prev->genes)
+      continue;
+
+    GtFeatureNode *locusfn = gt_feature_node_cast(prev->locus);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(locusfn);
+    GtFeatureNode *child;
+    for(child  = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child  = gt_feature_node_iterator_next(iter))
+    {
+      const char *id = gt_feature_node_get_attribute(child, "ID");
+      if(id != NULL)
+        gt_hashmap_add(oldbygene, (char *)id, locusfn);
+      if(id == NULL || gt_hashmap_get(patchids, id) == NULL)
+      {
+        GtGenomeNode *gene = gt_genome_node_ref((GtGenomeNode *)child);
+        gt_array_add(genes, gene);
+      }
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+  for(i = 0; patch != NULL && i < gt_array_size(patch); i++)
+  {
+    GtGenomeNode **gn = gt_array_get(patch, i);
+    if(*gn == NULL)
+      continue;
+    GtRange range = gt_genome_node_get_range(*gn);
+    if((!leftanchor || range.start > left->generange.end) &&
+       (!rightanchor || range.end < right->generange.start))
+    {
+      gt_array_add(genes, *gn);
+      *gn = NULL;
+    }
+  }
+  gt_array_sort(genes, (GtCompare)agn_genome_node_compare);
+
+  run.region = gt_region_node_new(seqid, span.start, span.end);
+  gt_array_add(run.nodes, run.region);
+  gt_array_add_array(run.nodes, genes);
+  gt_array_delete(genes);
+  int result = process_run(options, &run, error);
+  if(result == 0)
+  {
+    GtArray *kept = gt_array_new( sizeof(GtGenomeNode *) );
+    patch_trim_run(run.nodes, kept, leftanchor, rightanchor, left->locus,
+                   right->locus);
+    for(i = 0; i < gt_array_size(kept); i++)
+    {
+      GtGenomeNode **gn = gt_array_get(kept, i);
+      patch_name_locus(options, gt_feature_node_cast(*gn), loci, lo, hi,
+                       oldbygene, counts);
+      gt_array_add(nodes, *gn);
+    }
+    gt_array_delete(kept);
+  }
+  else
+    delete_unread_nodes(run.nodes, 0);
+  gt_array_delete(run.nodes);
+  gt_hashmap_delete(oldbygene);
+
+  for(i = lo; i <= hi; i++)
+  {
+    LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+    gt_genome_node_delete(prev->locus);
+    prev->locus = NULL;
+  }
+  return result;
+}
+
+// Apply the patch to the loci of a single sequence from the previous output,
+// appending the resulting loci to the given list of nodes
+static int patch_sequence(LocusPocusOptions *options, GtArray *loci,
+                          GtArray *patch, GtHashmap *patchids,
+                          GtGenomeNode *region,
+                          LocusPocusPatchCounts *counts, GtArray *nodes,
+                          GtError *error)
+{
+  GtUword m = gt_array_size(loci);
+  GtUword numpatch = patch == NULL ? 0 : gt_array_size(patch);
+  GtUword i, j;
+
+  // Loci containing changed or deleted genes, or overlapping added or changed
+  // genes, must be recomputed.
+  for(i = 0; i < m; i++)
+  {
+    LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+    if(!prev->genes)
+      continue;
+
+    GtFeatureNode *locusfn = gt_feature_node_cast(prev->locus);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(locusfn);
+    GtFeatureNode *child;
+    for(child  = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child  = gt_feature_node_iterator_next(iter))
+    {
+      const char *id = gt_feature_node_get_attribute(child, "ID");
+      LocusPocusPatchId *pid = id ? gt_hashmap_get(patchids, id) : NULL;
+      if(pid != NULL)
+      {
+        pid->found = true;
+        prev->dirty = true;
+      }
+    }
+    gt_feature_node_iterator_delete(iter);
+
+    for(j = 0; j < numpatch; j++)
+    {
+      GtGenomeNode **gn = gt_array_get(patch, j);
+      GtRange range = gt_genome_node_get_range(*gn);
+      if(gt_range_overlap(&prev->generange, &range))
+        prev->dirty = true;
+    }
+  }
+
+  // Each affected range is recomputed together with everything up to the
+  // nearest untouched gene locus on either side (or the end of the sequence).
+  GtArray *affected = gt_array_new( sizeof(GtRange) );
+  for(j = 0; j < numpatch; j++)
+  {
+    GtGenomeNode **gn = gt_array_get(patch, j);
+    GtRange range = gt_genome_node_get_range(*gn);
+    gt_array_add(affected, range);
+  }
+  for(i = 0; i < m; i++)
+  {
+    LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+    if(prev->dirty)
+      gt_array_add(affected, prev->generange);
+  }
+
+  bool *recompute = gt_calloc(m, sizeof (bool));
+  bool fromstart = false, toend = false;
+  for(j = 0; j < gt_array_size(affected); j++)
+  {
+    GtRange *range = gt_array_get(affected, j);
+    GtUword lo = 0, hi = m - 1;
+    bool leftfound = false, rightfound = false;
+    for(i = 0; i < m; i++)
+    {
+      LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+      if(!prev->genes || prev->dirty)
+        continue;
+      if(prev->generange.end < range->start)
+      {
+        lo = i;
+        leftfound = true;
+      }
+      else if(prev->generange.start > range->end && !rightfound)
+      {
+        hi = i;
+        rightfound = true;
+      }
+    }
+    fromstart = fromstart || !leftfound;
+    toend = toend || !rightfound;
+    for(i = lo; i <= hi; i++)
+      recompute[i] = true;
+  }
+  gt_array_delete(affected);
+
+  int result = 0;
+  for(i = 0; i < m && result == 0; i++)
+  {
+    LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+    if(!recompute[i])
+    {
+      gt_array_add(nodes, prev->locus);
+      prev->locus = NULL;
+      continue;
+    }
+
+    GtUword hi = i;
+    while(hi + 1 < m && recompute[hi + 1])
+      hi++;
+    bool leftanchor = !(i == 0 && fromstart);
+    bool rightanchor = !(hi == m - 1 && toend);
+    result = patch_run(options, loci, i, hi, leftanchor, rightanchor, patch,
+                       patchids, region, counts, nodes, error);
+    i = hi;
+  }
+  gt_free(recompute);
+  return result;
+}
+
+// Read the patch file. Features with a 'deleted=true' attribute are recorded
+// by ID and discarded, and all other features are recorded by ID and stored by
+// sequence ID.
+static int read_patch(LocusPocusOptions *options, GtHashmap *added,
+                      GtArray *seqids, GtHashmap *patchids, GtError *error)
+{
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *last_stream;
+  const char *patchfile = options->patchfile;
+  last_stream = add_input_streams(options, streams, 1, &patchfile);
+
+  GtGenomeNode *gn;
+  int result;
+  while((result = gt_node_stream_next(last_stream, &gn, error)) == 0 && gn)
+  {
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn == NULL)
+    {
+      gt_genome_node_delete(gn);
+      continue;
+    }
+
+    const char *id = gt_feature_node_get_attribute(fn, "ID");
+    const char *deleted = gt_feature_node_get_attribute(fn, "deleted");
+    bool isdeleted = deleted != NULL && strcmp(deleted, "true") == 0;
+    if(id != NULL)
+    {
+      LocusPocusPatchId *pid = gt_malloc( sizeof(LocusPocusPatchId) );
+      pid->deleted = isdeleted;
+      pid->found = false;
+      gt_hashmap_add(patchids, gt_cstr_dup(id), pid);
+    }
+    else if(isdeleted)
+    {
+      gt_error_set(error, "feature marked as deleted at line %u of '%s' has "
+                   "no ID", gt_genome_node_get_line_number(gn),
+                   gt_genome_node_get_filename(gn));
+      gt_genome_node_delete(gn);
+      result = -1;
+      break;
+    }
+    if(isdeleted)
+    {
+      gt_genome_node_delete(gn);
+      continue;
+    }
+
+    const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+    GtArray *features = gt_hashmap_get(added, seqid);
+    if(features == NULL)
+    {
+      features = gt_array_new( sizeof(GtGenomeNode *) );
+      char *seqidcopy = gt_cstr_dup(seqid);
+      gt_hashmap_add(added, seqidcopy, features);
+      gt_array_add(seqids, seqidcopy);
+    }
+    gt_array_add(features, gn);
+  }
+  delete_streams(streams);
+  return result;
+}
+
+// Check that a feature marked as deleted in the patch was found in the
+// previous output
+static int patch_check_deleted(void *key, void *value, GT_UNUSED void *data,
+                               GtError *error)
+{
+  LocusPocusPatchId *pid = value;
+  if(pid->deleted && !pid->found)
+  {
+    gt_error_set(error, "feature '%s' marked as deleted in the patch is not in "
+                 "the previous output", (const char *)key);
+    return -1;
+  }
+  return 0;
+}
+
+// Recompute the loci of the previous output (read from the given stream)
+// affected by the patch, and write the combined loci with the output streams
+static int run_patch(LocusPocusOptions *options, GtNodeStream *in_stream,
+                     GtError *error)
+{
+  GtHashmap *added = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                    (GtFree)gt_array_delete);
+  GtArray *seqids = gt_array_new( sizeof(char *) );
+  GtHashmap *patchids = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                       gt_free_func);
+  int result = read_patch(options, added, seqids, patchids, error);
+
+  // New loci are numbered after every locus of the previous output, so the
+  // whole output is read before any sequence is patched.
+  GtArray *input = gt_array_new( sizeof(GtGenomeNode *) );
+  LocusPocusPatchCounts counts = { 0, 0 };
+  GtUword numloci = 0, next = 0;
+  GtGenomeNode *gn = NULL;
+  while(result == 0)
+  {
+    result = gt_node_stream_next(in_stream, &gn, error);
+    if(result != 0 || gn == NULL)
+      break;
+    gt_array_add(input, gn);
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn != NULL)
+    {
+      patch_count_locus(options, fn, &counts);
+      numloci++;
+    }
+  }
+  if(counts.name < numloci)
+    counts.name = numloci;
+
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtArray *loci = gt_array_new( sizeof(LocusPocusPrevLocus) );
+  GtHashmap *regions = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  while(result == 0)
+  {
+    gn = NULL;
+    if(next < gt_array_size(input))
+      gn = *(GtGenomeNode **)gt_array_get(input, next++);
+
+    if(gn != NULL && gt_feature_node_try_cast(gn) == NULL)
+    {
+      if(gt_region_node_try_cast(gn))
+      {
+        gt_hashmap_add(regions, gt_str_get(gt_genome_node_get_seqid(gn)),
+                       gn);
+      }
+      gt_array_add(nodes, gn);
+      continue;
+    }
+
+    LocusPocusPrevLocus *first = NULL;
+    if(gt_array_size(loci) > 0)
+      first = gt_array_get(loci, 0);
+    if(first != NULL && (gn == NULL || !agn_seqid_equal(gn, first->locus)))
+    {
+      const char *seqid = gt_str_get(gt_genome_node_get_seqid(first->locus));
+      result = patch_sequence(options, loci, gt_hashmap_get(added, seqid),
+                              patchids, gt_hashmap_get(regions, seqid),
+                              &counts, nodes, error);
+      GtUword i;
+      for(i = 0; i < gt_array_size(loci); i++)
+      {
+        LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+        gt_genome_node_delete(prev->locus);
+      }
+      gt_array_reset(loci);
+      GtArray *features = gt_hashmap_get(added, seqid);
+      if(features != NULL)
+        delete_unread_nodes(features, 0);
+    }
+    if(gn == NULL)
+      break;
+
+    LocusPocusPrevLocus prev = { gn, { 0, 0 }, false, false };
+    GtFeatureNode *fn = gt_feature_node_cast(gn);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+    GtFeatureNode *child;
+    for(child  = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child  = gt_feature_node_iterator_next(iter))
+    {
+      GtRange childrange = gt_genome_node_get_range((GtGenomeNode *)child);
+      if(prev.genes)
+        prev.generange = gt_range_join(&prev.generange, &childrange);
+      else
+        prev.generange = childrange;
+      prev.genes = true;
+    }
+    gt_feature_node_iterator_delete(iter);
+    gt_array_add(loci, prev);
+  }
+
+  GtUword i;
+  for(i = 0; i < gt_array_size(loci); i++)
+  {
+    LocusPocusPrevLocus *prev = gt_array_get(loci, i);
+    gt_genome_node_delete(prev->locus);
+  }
+  gt_array_delete(loci);
+  delete_unread_nodes(input, next);
+  gt_array_delete(input);
+  gt_hashmap_delete(regions);
+
+  for(i = 0; i < gt_array_size(seqids); i++)
+  {
+    const char *seqid = *(const char **)gt_array_get(seqids, i);
+    GtArray *features = gt_hashmap_get(added, seqid);
+    if(gt_array_size(features) == 0)
+      continue;
+    if(result == 0)
+    {
+      gt_error_set(error, "patch contains features on sequence '%s', which "
+                   "has no loci in the previous output", seqid);
+      result = -1;
+    }
+    delete_unread_nodes(features, 0);
+  }
+  gt_array_delete(seqids);
+  gt_hashmap_delete(added);
+
+  if(result == 0)
+    result = gt_hashmap_foreach(patchids, patch_check_deleted, NULL, error);
+  gt_hashmap_delete(patchids);
+
+  if(result == 0)
+  {
+    GtQueue *streams = gt_queue_new();
+    GtNodeStream *last_stream;
+    GtUword progress = 0;
+    last_stream = gt_array_in_stream_new(nodes, &progress, error);
+    gt_queue_add(streams, last_stream);
+    last_stream = add_output_streams(options, streams, last_stream);
+    result = gt_node_stream_pull(last_stream, error);
+    delete_streams(streams);
+    if(result == -1)
+      delete_unread_nodes(nodes, progress);
+  }
+  else
+    delete_unread_nodes(nodes, 0);
+  gt_array_delete(nodes);
+  return result;
+}
+
+// Main program
+int main(int argc, char **argv)
+{
+  GtError *error;
+  GtLogger *logger;
+  GtQueue *streams;
+  GtNodeStream *last_stream;
+  gt_lib_init();
+
+  // Parse command-line options
+  LocusPocusOptions options;
+  set_option_defaults(&options);
+  error = gt_error_new();
+  parse_options(argc, argv, &options, error);
+  if(gt_error_is_set(error))
+  {
+    fprintf(stderr, "[LocusPocus] error: %s", gt_error_get(error));
+    return 1;
+  }
+  int numfiles = argc - optind;
+  if(numfiles < 1)
+  {
+    fprintf(stderr, "[LocusPocus] error: must provide at least one GFF3 file "
+            "as input; use '-' if you want to provide data via standard "
+            "input\n");
+    print_usage(stderr);
+    return 1;
+  }
+
+  logger = gt_logger_new(true, "", stderr);
+  streams = gt_queue_new();
+
+
+  //----- Set up the node processing stream -----//
+  //---------------------------------------------//
+
+  // In patch mode, the input is the (sorted) output of a previous run, and the
+  // remaining streams are created by run_patch.
+  if(options.patchfile != NULL)
+  {
+    last_stream = add_gff3_in_stream(&options, streams, numfiles,
+                                     (const char **)argv + optind);
+  }
+  else
+    last_stream = add_input_streams(&options, streams, numfiles,
+                                    (const char **)argv + optind);
+
+  // In multithreaded mode, the remaining streams are created per sequence.
+  if(options.numthreads == 1 && options.patchfile == NULL)
+  {
+    last_stream = add_locus_streams(&options, streams, last_stream,
+                                    options.ilenfile);
+    last_stream = add_output_streams(&options, streams, last_stream);
+  }
 
 
   //----- Execute the node processing stream -----//
   //----------------------------------------------//
 
-  int result = gt_node_stream_pull(last_stream, error);
+  int result;
+  if(options.patchfile != NULL)
+    result = run_patch(&options, last_stream, error);
+  else if(options.numthreads > 1)
+    result = run_parallel(&options, last_stream, error);
+  else
+    result = gt_node_stream_pull(last_stream, error);
   if(result == -1)
     fprintf(stderr, "[LocusPocus] error: %s", gt_error_get(error));
 
 
   // Free memory and terminate
-  while(gt_queue_size(streams) > 0)
-  {
-    current_stream = gt_queue_get(streams);
-    gt_node_stream_delete(current_stream);
-  }
-  gt_queue_delete(streams);
+  delete_streams(streams);
   gt_logger_delete(logger);
   gt_error_delete(error);
   free_option_memory(&options);
   gt_lib_clean();
-  return 0;
+  return result == -1 ? 1 : 0;
 }
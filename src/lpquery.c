@@ -0,0 +1,226 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <getopt.h>
+#include <string.h>
+#include "genometools.h"
+#include "aegean.h"
+
+// Simple data structure for program options
+typedef struct
+{
+  FILE *outfile;
+  bool ids;
+  GtUword neighbors;
+} LpQueryOptions;
+
+// Usage statement
+static void print_usage(FILE *outstream)
+{
+  fputs("\nlpquery: look up iLoci in an index created with 'locuspocus "
+        "--index'\n\n"
+"Usage: lpquery [options] index query [query ...]\n"
+"  A query of the form SEQID:START-END reports every iLocus overlapping the\n"
+"  given region; any other query reports the iLocus with that label: its\n"
+"  Name, or its ID if it has no Name, or SEQID_START-END if it has neither.\n"
+"  Options:\n"
+"    -h|--help              print this help message and exit\n"
+"    -i|--ids               treat every query as an iLocus label\n"
+"    -n|--neighbors: INT    for label queries, also report up to INT\n"
+"                           iLoci on either side on the same sequence;\n"
+"                           default is 0\n"
+"    -o|--outfile: FILE     file to which output will be written; default\n"
+"                           is terminal (stdout)\n"
+"    -v|--version           print version number and exit\n\n", outstream);
+}
+
+// Adjust program settings from command-line arguments/options
+static void parse_options(int argc, char **argv, LpQueryOptions *options,
+                          GtError *error)
+{
+  int opt = 0;
+  int optindex = 0;
+  const char *optstr = "hin:o:v";
+  const struct option lpquery_options[] =
+  {
+    { "help",      no_argument,       NULL, 'h' },
+    { "ids",       no_argument,       NULL, 'i' },
+    { "neighbors", required_argument, NULL, 'n' },
+    { "outfile",   required_argument, NULL, 'o' },
+    { "version",   no_argument,       NULL, 'v' },
+    { NULL,        no_argument,       NULL,  0  },
+  };
+  for(opt = getopt_long(argc, argv, optstr, lpquery_options, &optindex);
+      opt != -1;
+      opt = getopt_long(argc, argv, optstr, lpquery_options, &optindex))
+  {
+    if(opt == 'h')
+    {
+      print_usage(stdout);
+      exit(0);
+    }
+    else if(opt == 'i')
+      options->ids = true;
+    else if(opt == 'n')
+    {
+      if(sscanf(optarg, "%lu", &options->neighbors) != 1)
+      {
+        gt_error_set(error, "could not convert neighbors '%s' to an integer",
+                     optarg);
+      }
+    }
+    else if(opt == 'o')
+    {
+      if(options->outfile != stdout)
+        fclose(options->outfile);
+      options->outfile = fopen(optarg, "w");
+      if(options->outfile == NULL)
+      {
+        gt_error_set(error, "could not open output file '%s'", optarg);
+        options->outfile = stdout;
+      }
+    }
+    else if(opt == 'v')
+    {
+      agn_print_version("lpquery", stdout);
+      exit(0);
+    }
+  }
+}
+
+// Parse a query of the form SEQID:START-END; returns false if the query is not
+// a region
+static bool parse_region(const char *query, GtStr *seqid, GtRange *range)
+{
+  const char *colon = strrchr(query, ':');
+  if(colon == NULL || colon == query)
+    return false;
+
+  char trailing;
+  if(sscanf(colon + 1, "%lu-%lu%c", &range->start, &range->end,
+            &trailing) != 2 || range->start > range->end)
+    return false;
+
+  gt_str_reset(seqid);
+  gt_str_append_cstr_nt(seqid, query, colon - query);
+  return true;
+}
+
+// Print a single iLocus
+static void print_record(AgnIlocusIndex *index, GtUword pos, FILE *outfile)
+{
+  const AgnIlocusIndexRecord *rec = agn_ilocus_index_get(index, pos);
+  const char *type = agn_ilocus_index_record_type(index, rec);
+  fprintf(outfile, "%s\t%s\t%lu\t%lu\t%lu\t%s\t%lu\t%lu\t%lu\t%lu\t%s\n",
+          agn_ilocus_index_record_label(index, rec),
+          agn_ilocus_index_record_seqid(index, rec),
+          (GtUword)rec->start, (GtUword)rec->end,
+          (GtUword)rec->effective_length, type[0] == '\0' ? "NA" : type,
+          (GtUword)rec->genes, (GtUword)rec->mrnas, (GtUword)rec->left_flank,
+          (GtUword)rec->right_flank,
+          agn_ilocus_index_record_orient(index, rec));
+}
+
+// Print the iLocus with the given label and its neighbors; returns false if
+// there is no such iLocus
+static bool query_label(AgnIlocusIndex *index, const char *label,
+                        LpQueryOptions *options)
+{
+  GtUword pos;
+  if(!agn_ilocus_index_find(index, label, &pos))
+  {
+    fprintf(stderr, "[lpquery] warning: no iLocus named '%s'\n", label);
+    return false;
+  }
+
+  uint32_t seqid = agn_ilocus_index_get(index, pos)->seqid;
+  GtUword first = pos, last = pos;
+  while(pos - first < options->neighbors && first > 0 &&
+        agn_ilocus_index_get(index, first - 1)->seqid == seqid)
+    first--;
+  while(last - pos < options->neighbors &&
+        last + 1 < agn_ilocus_index_size(index) &&
+        agn_ilocus_index_get(index, last + 1)->seqid == seqid)
+    last++;
+
+  GtUword i;
+  for(i = first; i <= last; i++)
+    print_record(index, i, options->outfile);
+  return true;
+}
+
+// Print every iLocus overlapping the given region
+static void query_region(AgnIlocusIndex *index, GtStr *seqid, GtRange *range,
+                         GtArray *positions, LpQueryOptions *options)
+{
+  gt_array_reset(positions);
+  agn_ilocus_index_query(index, gt_str_get(seqid), range, positions);
+  GtUword i;
+  for(i = 0; i < gt_array_size(positions); i++)
+  {
+    GtUword pos = *(GtUword *)gt_array_get(positions, i);
+    print_record(index, pos, options->outfile);
+  }
+}
+
+// Main method
+int main(int argc, char **argv)
+{
+  GtError *error;
+  LpQueryOptions options = { stdout, false, 0 };
+
+  gt_lib_init();
+  error = gt_error_new();
+  parse_options(argc, argv, &options, error);
+  if(gt_error_is_set(error))
+  {
+    fprintf(stderr, "[lpquery] error: %s\n", gt_error_get(error));
+    return 1;
+  }
+  if(argc - optind < 2)
+  {
+    fprintf(stderr, "[lpquery] error: must provide an index file and at "
+            "least one query\n");
+    print_usage(stderr);
+    return 1;
+  }
+
+  AgnIlocusIndex *index = agn_ilocus_index_open(argv[optind], error);
+  if(index == NULL)
+  {
+    fprintf(stderr, "[lpquery] error: %s\n", gt_error_get(error));
+    return 1;
+  }
+
+  fputs("LocusId\tSeqID\tStart\tEnd\tEffectiveLength\tLocusClass\tGeneCount\t"
+        "mRNACount\tLeftFlank\tRightFlank\tFlankGeneOrient\n",
+        options.outfile);
+  GtStr *seqid = gt_str_new();
+  GtArray *positions = gt_array_new( sizeof(GtUword) );
+  bool found = true;
+  int i;
+  for(i = optind + 1; i < argc; i++)
+  {
+    GtRange range;
+    if(!options.ids && parse_region(argv[i], seqid, &range))
+      query_region(index, seqid, &range, positions, &options);
+    else if(!query_label(index, argv[i], &options))
+      found = false;
+  }
+
+  gt_array_delete(positions);
+  gt_str_delete(seqid);
+  agn_ilocus_index_delete(index);
+  if(options.outfile != stdout)
+    fclose(options.outfile);
+  gt_error_delete(error);
+  gt_lib_clean();
+  return found ? 0 : 1;
+}
@@ -23,6 +23,7 @@ typedef struct
   FILE *idfile;
   GtHashmap *ids2keep;
   FILE *outfile;
+  bool stats;
   bool typeoverride;
   GtHashmap *typestoextract;
   bool verbose;
@@ -97,6 +98,14 @@ static void
 xt_print_feature_sequence(GtGenomeNode *gn, const GtUchar *sequence,
                           GtUword seqlength, XtractoreOptions *options);
 
+/**
+ * @function Given a feature encoded by ``gn``, print a line of tab-delimited
+ * composition statistics for the sequence corresponding to that feature.
+ */
+static void
+xt_print_feature_stats(GtGenomeNode *gn, const GtUchar *sequence,
+                       GtUword seqlength, XtractoreOptions *options);
+
 /**
  * @function Print the program's usage statement.
  */
@@ -122,7 +131,7 @@ static void xtract_options_parse(int argc, char **argv,
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "dhi:o:t:Vvw:";
+  const char *optstr = "dhi:o:st:Vvw:";
   char *type;
   const struct option xtractore_options[] =
   {
@@ -130,6 +139,7 @@ static void xtract_options_parse(int argc, char **argv,
     { "help",     no_argument,       NULL, 'h' },
     { "idfile",   required_argument, NULL, 'i' },
     { "outfile",  required_argument, NULL, 'o' },
+    { "stats",    no_argument,       NULL, 's' },
     { "type",     required_argument, NULL, 't' },
     { "verbose",  no_argument,       NULL, 'V' },
     { "version",  no_argument,       NULL, 'v' },
@@ -161,6 +171,10 @@ static void xtract_options_parse(int argc, char **argv,
       if(options->outfile == NULL)
         gt_error_set(error, "could not open output file '%s'", optarg);
     }
+    else if(opt == 's')
+    {
+      options->stats = true;
+    }
     else if(opt == 't')
     {
       if(options->typeoverride == false)
@@ -211,6 +225,7 @@ static void xtract_options_set_defaults(XtractoreOptions *options)
   options->idfile = NULL;
   options->ids2keep = NULL;
   options->outfile = stdout;
+  options->stats = false;
   options->typeoverride = false;
   options->typestoextract = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
   char *defaulttype = gt_cstr_dup("gene");
@@ -391,6 +406,63 @@ xt_print_feature_sequence(GtGenomeNode *gn, const GtUchar *sequence,
   gt_free(feat_seq);
 }
 
+static void
+xt_print_feature_stats(GtGenomeNode *gn, const GtUchar *sequence,
+                       GtUword seqlength, XtractoreOptions *options)
+{
+  AgnSeqComposition comp;
+  GtFeatureNode *fn = gt_feature_node_cast(gn);
+  GtRange range = gt_genome_node_get_range(gn);
+  GtStr *seqid = gt_genome_node_get_seqid(gn);
+  GtArray *regions = xt_get_regions(gn);
+  GtStrand strand = GT_STRAND_UNKNOWN;
+  GtUword i;
+
+  // Count bases directly in the genomic sequence rather than extracting a
+  // copy; only the G and C counts depend on the strand.
+  agn_seq_composition_reset(&comp);
+  for(i = 0; i < gt_array_size(regions); i++)
+  {
+    XtractRegion *region = gt_array_get(regions, i);
+    if(i == 0)
+      strand = region->s;
+    else if(region->s != strand)
+    {
+      fprintf(stderr, "[xtractore] error: feature at %s[%lu, %lu] belongs to "
+              "a multifeature with strand inconsistencies\n", gt_str_get(seqid),
+              region->r.start, region->r.end);
+      exit(1);
+    }
+    if(region->r.end > seqlength)
+    {
+      fprintf(stderr, "[xtractore] error: feature at %s[%lu, %lu] exceeds "
+              "sequence length of %lu\n", gt_str_get(seqid), region->r.start,
+              region->r.end, seqlength);
+      exit(1);
+    }
+    agn_seq_composition_count(&comp,
+                              (const char *)sequence + region->r.start - 1,
+                              gt_range_length(&region->r));
+  }
+  gt_array_delete(regions);
+  if(strand == GT_STRAND_REVERSE)
+    agn_seq_composition_reverse(&comp);
+
+  const char *featlabel = agn_feature_node_get_label(fn);
+  if(gt_feature_node_is_pseudo(fn))
+  {
+    GtFeatureNodeIterator *it = gt_feature_node_iterator_new_direct(fn);
+    GtFeatureNode *child = gt_feature_node_iterator_next(it);
+    featlabel = agn_feature_node_get_label(child);
+    gt_feature_node_iterator_delete(it);
+  }
+  fprintf(options->outfile, "%s\t%s\t%s_%lu-%lu\t%lu\t%.3f\t%.3f\t%.3f\n",
+          featlabel, gt_str_get(seqid), gt_str_get(seqid), range.start,
+          range.end, comp.length, agn_seq_composition_gc_content(&comp),
+          agn_seq_composition_gc_skew(&comp),
+          agn_seq_composition_n_content(&comp));
+}
+
 static void xt_print_usage(FILE *outstream)
 {
   fprintf(outstream,
@@ -405,6 +477,9 @@ static void xt_print_usage(FILE *outstream)
 "                          IDs in this file will be extracted\n"
 "    -o|--outfile: FILE    file to which output sequences will be written;\n"
 "                          default is terminal (stdout)\n"
+"    -s|--stats            instead of sequences, print a tab-delimited table\n"
+"                          with the length, GC content, GC skew, and N\n"
+"                          content of each feature\n"
 "    -t|--type: STRING     feature type to extract; can be used multiple\n"
 "                          times to extract features of multiple types\n"
 "    -v|--version          print version number and exit\n"
@@ -487,6 +562,11 @@ int main(int argc, char **argv)
   gt_str_array_add_cstr(seqfastas, seqfile);
   seqiter = gt_seq_iterator_sequence_buffer_new(seqfastas, error);
   GtUword featcounter = 0;
+  if(options.stats)
+  {
+    fputs("Id\tSeqID\tLocusPos\tLength\tGCContent\tGCSkew\tNContent\n",
+          options.outfile);
+  }
   while((result = gt_seq_iterator_next(seqiter, &sequence, &seqlength, &seqdesc,
                                        error)) > 0)
   {
@@ -508,7 +588,10 @@ int main(int argc, char **argv)
     for(i = 0; i < nfeats; i++)
     {
       GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(seqfeatures, i);
-      xt_print_feature_sequence(gn, sequence, seqlength, &options);
+      if(options.stats)
+        xt_print_feature_stats(gn, sequence, seqlength, &options);
+      else
+        xt_print_feature_sequence(gn, sequence, seqlength, &options);
       featcounter += 1;
       if(featcounter % 1000 == 0 && options.debug)
         fputs("..........", stderr);
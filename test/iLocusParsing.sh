@@ -51,6 +51,18 @@ run_func_test "A. echinatior (intron gene + ncRNA)" data/gff3/aech-dachsous-out.
 run_func_test "iiLocus Flank Orientations (test 1)" data/misc/zitest-01-ilens.tsv --ilens=${tempfile} --cds data/gff3/zitest-01.gff3
 run_func_test "iiLocus Flank Orientations (test 2)" data/misc/zitest-02-ilens.tsv --ilens=${tempfile} --cds data/gff3/zitest-02.gff3
 run_func_test "iiLocus Flank Orientations (test 3)" data/misc/zitest-03-ilens.tsv --ilens=${tempfile} --cds data/gff3/zitest-03.gff3
+run_func_test "default (4 threads)" data/gff3/ilocus.out.noskipends.gff3 --threads=4 --delta=200 --outfile=${tempfile} --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "end skip (4 threads)" data/gff3/ilocus.out.skipends.gff3 --threads=4 --delta=200 --outfile=${tempfile} --skipends --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "Apis mellifera LSM (4 threads)" data/gff3/amel-lsm-out-cds.gff3 --threads=4 --outfile=${tempfile} --skipends --cds data/gff3/amel-lsm.gff3
+run_func_test "default (external sort)" data/gff3/ilocus.out.noskipends.gff3 --sortbuffer=10 --delta=200 --outfile=${tempfile} --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "Apis mellifera LSM (external sort)" data/gff3/amel-lsm-out-cds.gff3 --sortbuffer=10 --outfile=${tempfile} --skipends --cds data/gff3/amel-lsm.gff3
+run_func_test "default (presorted)" data/gff3/ilocus.out.noskipends.gff3 --presorted --delta=200 --outfile=${tempfile} --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "Apis mellifera LSM (presorted)" data/gff3/amel-lsm-out-cds.gff3 --presorted --outfile=${tempfile} --skipends --cds data/gff3/amel-lsm.gff3
+run_func_test "iiLocus lengths (4 threads)" data/misc/amel-ogs-ilens.txt --threads=4 --delta=300 --ilens=${tempfile} --cds data/gff3/amel-ogs-g716.gff3
+run_func_test "default (small chunks)" data/gff3/ilocus.out.noskipends.gff3 --threads=4 --chunksize=256 --delta=200 --outfile=${tempfile} --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "end skip (small chunks)" data/gff3/ilocus.out.skipends.gff3 --threads=4 --chunksize=256 --delta=200 --outfile=${tempfile} --skipends --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "Apis mellifera LSM (small chunks)" data/gff3/amel-lsm-out-cds.gff3 --threads=4 --chunksize=256 --outfile=${tempfile} --skipends --cds data/gff3/amel-lsm.gff3
+run_func_test "iiLocus lengths (small chunks)" data/misc/amel-ogs-ilens.txt --threads=4 --chunksize=256 --delta=300 --ilens=${tempfile} --cds data/gff3/amel-ogs-g716.gff3
 
 
 exit $failures
@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+set -eo pipefail
+
+if [[ $1 == "memcheck" ]]; then
+  memcheckcmd="valgrind --leak-check=full --show-reachable=yes --suppressions=data/misc/libpixman.supp --suppressions=data/misc/libpango.supp --error-exitcode=1"
+fi
+echo "    AEGeAn::LocusPocus (lean mode)"
+leanfile="lean-ft.gff3"
+fullfile="lean-ft-full.gff3"
+amelfile="lean-ft-amel.gff3"
+
+# Transcript-rich Amel genes, and genes with exons as direct children (the
+# pseudogenes), in a single sorted file.
+gt gff3 -retainids -sort -tidy data/gff3/amel-gene-multitrans.gff3 \
+    data/gff3/amel-ogs-g716.gff3 data/gff3/amel-pseudo.gff3 \
+    2> /dev/null > $amelfile
+
+# Lean mode must report the same iLoci, attributes, and iLocus lengths as a
+# normal run, with or without refinement.
+check()
+{
+  local label=$1
+  shift
+  bin/locuspocus "$@" --ilens=$fullfile.ilens --outfile=$fullfile $infiles
+  $memcheckcmd \
+  bin/locuspocus --lean --presorted "$@" --ilens=$leanfile.ilens \
+      --outfile=$leanfile $infiles
+
+  result="FAIL"
+  if diff $leanfile $fullfile > /dev/null && \
+     diff $leanfile.ilens $fullfile.ilens > /dev/null && \
+     grep -q $'\tlocus\t' $leanfile
+  then
+    result="PASS"
+  fi
+  printf "        | %-36s | %s\n" "$label" $result
+}
+
+infiles="data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3"
+check "grape"
+check "grape, refined" --delta=2000 --refine
+check "grape, refined by CDS" --delta=2000 --refine --cds
+result="FAIL"
+if grep -q 'iiLocus_exception=' $leanfile; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape, iiLocus exceptions" $result
+
+infiles=$amelfile
+check "Amel"
+result="FAIL"
+if grep -q 'child_exon=6' $leanfile; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "Amel, exons as gene children" $result
+check "Amel, refined" --refine
+check "Amel, refined by CDS" --refine --cds
+
+rm -f $leanfile $leanfile.ilens $fullfile $fullfile.ilens $amelfile
@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+set -eo pipefail
+
+if [[ $1 == "memcheck" ]]; then
+  memcheckcmd="valgrind --leak-check=full --show-reachable=yes --suppressions=data/misc/libpixman.supp --suppressions=data/misc/libpango.supp --error-exitcode=1"
+fi
+echo "    AEGeAn::LocusPocus (patch)"
+prevfile="patch-prev.gff3"
+patchedfile="patch-patched.gff3"
+fullfile="patch-full.gff3"
+tempfile="patch-temp.gff3"
+options="--delta=200 --verbose --retainids --namefmt=iLocus%lu"
+
+# Drop the Names and IDs of loci (and the references to them), which a full
+# run numbers afresh, and put the remaining attributes in a fixed order.
+normalize()
+{
+  python3 - "$1" <<'PYEOF'
+import re
+import sys
+for line in open(sys.argv[1]):
+    fields = line.rstrip('\n').split('\t')
+    if line.startswith('#') or len(fields) < 9:
+        sys.stdout.write(line)
+        continue
+    attrs = [attr for attr in fields[8].split(';') if attr and not
+             re.match(r'((ID|Parent)=locus|Name=iLocus)\d+$', attr)]
+    fields[8] = ';'.join(sorted(attrs))
+    print('\t'.join(fields))
+PYEOF
+}
+
+# The same annotation as the previous run with the patch applied, for a full
+# run to compare against.
+grep -v -e 'ID=test4.1b;' -e 'ID=test6.1;' data/gff3/ilocus.in.genes.gff3 \
+    > $patchedfile
+grep -v -e '^#' -e 'deleted=true' data/gff3/ilocus.patch.gff3 >> $patchedfile
+
+bin/locuspocus $options --outfile=$prevfile data/gff3/ilocus.in.genes.gff3
+$memcheckcmd \
+bin/locuspocus $options --outfile=$tempfile \
+    --patch=data/gff3/ilocus.patch.gff3 $prevfile
+bin/locuspocus $options --outfile=$fullfile $patchedfile
+
+result="FAIL"
+if diff <(normalize $tempfile) <(normalize $fullfile) > /dev/null && \
+   [[ -z $(grep -o 'ID=[^;]*' $tempfile | sort | uniq -d) ]] && \
+   [[ -z $(grep -o 'Name=[^;]*' $tempfile | sort | uniq -d) ]] && \
+   [[ $(awk -F'\t' '$3 == "locus" && $9 !~ /ID=/' $tempfile | wc -l) == 0 ]]
+then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "changes on three sequences" $result
+
+# Options that patch mode does not support are rejected.
+check_rejected()
+{
+  local label=$1
+  local message=$2
+  shift 2
+  result="FAIL"
+  if ! bin/locuspocus "$@" --outfile=$tempfile \
+         --patch=data/gff3/ilocus.patch.gff3 $prevfile 2> $tempfile.err && \
+     grep -q "$message" $tempfile.err
+  then
+    result="PASS"
+  fi
+  printf "        | %-36s | %s\n" "$label" $result
+  rm -f $tempfile.err
+}
+check_rejected "no --retainids" "requires the 'retainids' option" \
+    --delta=200 --verbose
+check_rejected "--threads" "'threads' option is not supported" \
+    $options --threads=2
+rm -f $prevfile $patchedfile $fullfile $tempfile
@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+set -eo pipefail
+
+if [[ $1 == "memcheck" ]]; then
+  memcheckcmd="valgrind --leak-check=full --show-reachable=yes --suppressions=data/misc/libpixman.supp --suppressions=data/misc/libpango.supp --error-exitcode=1"
+fi
+echo "    AEGeAn::LocusPocus (delta sweep)"
+outfile="sweep-ft.gff3"
+sweepfile="sweep-ft.tsv"
+infiles="data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3"
+
+# The boundaries in the sweep table for the delta used in the run must be
+# those of the gene-containing iLoci in the output, in the same order.
+for mode in "" "--refine" "--cds"
+do
+  for delta in 0 250 500
+  do
+    $memcheckcmd \
+    bin/locuspocus $mode --delta=$delta --deltas=0,250,500,1000 \
+        --sweep=$sweepfile --outfile=$outfile $infiles
+
+    result="FAIL"
+    if diff <(awk -F'\t' -v OFS='\t' '$3 == "locus" && $9 ~ /child_/ \
+                  { print $1, $4, $5 }' $outfile) \
+            <(awk -F'\t' -v OFS='\t' -v delta=$delta '
+                  NR == 1 {
+                    for(i = 1; i <= NF; i++)
+                    {
+                      if($i == "Start_" delta) startcol = i
+                      if($i == "End_" delta) endcol = i
+                    }
+                    next
+                  }
+                  { print $1, $startcol, $endcol }' $sweepfile) > /dev/null
+    then
+      result="PASS"
+    fi
+    label="delta=$delta${mode:+, $mode}"
+    printf "        | %-36s | %s\n" "$label" $result
+  done
+done
+rm $outfile $sweepfile
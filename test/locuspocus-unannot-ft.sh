@@ -0,0 +1,68 @@
+#!/usr/bin/env bash
+set -eo pipefail
+
+if [[ $1 == "memcheck" ]]; then
+  memcheckcmd="valgrind --leak-check=full --show-reachable=yes --suppressions=data/misc/libpixman.supp --suppressions=data/misc/libpango.supp --error-exitcode=1"
+fi
+echo "    AEGeAn::LocusPocus (unannotated sequences)"
+infile="unannot-in.gff3"
+oldfile="unannot-old.gff3"
+tempfile="unannot-temp.gff3"
+
+# Drop the IDs of loci (and the references to them), which the two pipelines
+# number differently, and the source of loci. Put the remaining attributes in
+# a fixed order, and the lines too, since the Names fix the order of loci.
+normalize()
+{
+  python3 - "$1" <<'PYEOF' | sort
+import re
+import sys
+for line in open(sys.argv[1]):
+    fields = line.rstrip('\n').split('\t')
+    if line.startswith('#') or len(fields) < 9:
+        continue
+    if fields[2] == 'locus':
+        fields[1] = '.'
+    attrs = [attr for attr in fields[8].split(';') if attr and not
+             re.match(r'(ID|Parent)=locus\d+$', attr)]
+    fields[8] = ';'.join(sorted(attrs))
+    print('\t'.join(fields))
+PYEOF
+}
+
+# Three sequences with no features: before, between, and after the annotated
+# sequences.
+awk '{ print }
+     NR == 1  { print "##sequence-region   seq00 1 5000" }
+     NR == 13 { print "##sequence-region   seq12a 1 3000" }
+     NR == 26 { print "##sequence-region   seq99 1 4000" }' \
+    data/gff3/ilocus.in.genes.gff3 > $infile
+
+# The previous pipeline: LocusPocus, then uloci.py, then sorting and renaming
+# the combined output with gt gff3.
+bin/locuspocus --verbose --cds --delta=500 --namefmt=prelocus%lu \
+    --outfile=$tempfile $infile
+numloci=$(grep -c $'\tlocus\t' $tempfile)
+python3 data/scripts/uloci.py --counter $((numloci + 1)) \
+    --src AEGeAn::uloci.py $infile > $tempfile.ul
+gt gff3 -retainids -sort -tidy $tempfile $tempfile.ul \
+    | awk -F'\t' -v OFS='\t' \
+      '$3 == "locus" { sub(/Name=[^;]+/, "Name=locus" ++count, $9) } { print }' \
+    > $oldfile
+rm $tempfile.ul
+
+for threads in 1 2
+do
+  $memcheckcmd \
+  bin/locuspocus --verbose --cds --unannot --delta=500 --namefmt=locus%lu \
+      --threads=$threads --outfile=$tempfile $infile
+
+  result="FAIL"
+  if diff <(normalize $tempfile) <(normalize $oldfile) > /dev/null && \
+     [[ $(grep -c 'unannot=true' $tempfile) == 3 ]]
+  then
+    result="PASS"
+  fi
+  printf "        | %-36s | %s\n" "same as uloci.py, $threads thread(s)" $result
+done
+rm -f $infile $oldfile $tempfile
@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+set -eo pipefail
+
+if [[ $1 == "memcheck" ]]; then
+  memcheckcmd="valgrind --leak-check=full --show-reachable=yes --suppressions=data/misc/libpixman.supp --suppressions=data/misc/libpango.supp --error-exitcode=1"
+fi
+echo "    AEGeAn::LocusPocus (iLocus index)"
+indexfile="lpquery-ft.idx"
+outfile="lpquery-ft.gff3"
+infiles="data/gff3/grape-refr.gff3 data/gff3/grape-pred.gff3"
+
+# Label, sequence, and coordinates of each iLocus in the output that has the
+# given attribute (ID or Name), as reported by lpquery.
+expected()
+{
+  awk -F'\t' -v OFS='\t' -v key="$1" '
+      $3 == "locus" && match($9, "(^|;)" key "=[^;]+") {
+        label = substr($9, RSTART, RLENGTH)
+        sub(/^;/, "", label)
+        sub(/^[^=]+=/, "", label)
+        print label, $1, $4, $5
+      }' $outfile
+}
+
+check()
+{
+  local key=$1
+  local label=$2
+  expected $key > $outfile.exp
+  result="FAIL"
+  if [[ -s $outfile.exp ]] && \
+     diff <($memcheckcmd bin/lpquery --ids $indexfile $(cut -f 1 $outfile.exp) \
+            | cut -f 1-4) $outfile.exp > /dev/null
+  then
+    result="PASS"
+  fi
+  printf "        | %-36s | %s\n" "$label" $result
+  rm $outfile.exp
+}
+
+$memcheckcmd \
+bin/locuspocus --verbose --index=$indexfile --outfile=$outfile $infiles
+check ID "IDs from verbose output"
+
+$memcheckcmd \
+bin/locuspocus --verbose --retainids --index=$indexfile --outfile=$outfile \
+    $infiles
+check ID "IDs from verbose output, retained"
+
+$memcheckcmd \
+bin/locuspocus --refine --namefmt=GrapeLocus%03lu --index=$indexfile \
+    --outfile=$outfile $infiles
+check Name "Names from refined output"
+
+# A region query, with neighbors, reports the iLoci of the output it overlaps.
+result="FAIL"
+numloci=$(awk -F'\t' '$1 == "chr8" && $3 == "locus" && $4 <= 100000' $outfile \
+          | wc -l)
+if [[ $($memcheckcmd bin/lpquery --neighbors=1 $indexfile chr8:1-100000 \
+        | wc -l) == $numloci ]]
+then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "region query" $result
+rm $indexfile $outfile
@@ -0,0 +1,61 @@
+#!/usr/bin/env bash
+set -eo pipefail
+
+echo "    AEGeAn::ParsEval server"
+socket="pe-server.sock"
+tempfile="pe-server.temp"
+
+bin/parseval --server=$socket data/gff3/grape-refr.gff3 2> /dev/null &
+server=$!
+for i in $(seq 1 50); do
+  [[ -S $socket ]] && break
+  sleep 0.1
+done
+
+python3 - $socket data/gff3/grape-pred.gff3 > $tempfile <<'PYEOF'
+import socket
+import sys
+
+def request(client, data):
+    client.sendall(b'%d\n' % len(data) + data)
+    reply = b''
+    while not reply.endswith(b'###\n'):
+        chunk = client.recv(65536)
+        if not chunk:
+            break
+        reply += chunk
+    return reply.decode()
+
+with open(sys.argv[2], 'rb') as infile:
+    data = infile.read()
+first = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+first.connect(sys.argv[1])
+# The second connection stays open while the first is served, whether or not
+# the server handles connections concurrently.
+second = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+second.connect(sys.argv[1])
+reply1 = request(first, data)
+reply2 = request(first, data)
+first.close()
+reply3 = request(second, data)
+second.close()
+sys.stdout.write(reply1)
+if reply2 != reply1:
+    sys.stdout.write('#error\tsecond request on one connection differs\n')
+if reply3 != reply1:
+    sys.stdout.write('#error\tsecond connection differs\n')
+PYEOF
+
+kill -TERM $server
+status=0
+wait $server || status=$?
+
+result="FAIL"
+if [[ $status == 0 ]] && [[ ! -e $socket ]] && \
+   head -n 1 $tempfile | grep -q '^#seqid' && \
+   ! grep -q '^#error' $tempfile && \
+   [[ $(grep -vc '^#' $tempfile) -gt 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "grape, repeated queries" $result
+rm -f $tempfile
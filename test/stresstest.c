@@ -0,0 +1,175 @@
+/**
+
+Copyright (c) 2010-2015, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+/*
+ * Runs several independent locus parsing and comparison pipelines
+ * concurrently, each in its own thread, and checks that every pipeline
+ * produces the same result as a single pipeline run on its own. Intended to
+ * be built with ThreadSanitizer (see the ``tsan-test`` target in the
+ * Makefile); GenomeTools must be built with ``threads=yes``.
+ */
+#include <pthread.h>
+#include "genometools.h"
+#include "aegean.h"
+
+#define STRESS_DEFAULT_THREADS 8
+
+typedef struct
+{
+  GtLogger *logger;
+  GtUword numloci;
+  AgnComparison comp;
+  int status;
+} StressPipeline;
+
+static void stress_pipeline_run(StressPipeline *pipeline)
+{
+  const char *filenames[] = { "data/gff3/grape-refr.gff3",
+                              "data/gff3/grape-pred.gff3" };
+  GtNodeStream *current_stream, *last_stream;
+  GtQueue *streams = gt_queue_new();
+  GtError *error = gt_error_new();
+
+  current_stream = gt_gff3_in_stream_new_unsorted(2, filenames);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_sort_stream_new(last_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_gene_stream_new(last_stream, pipeline->logger);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_locus_stream_new(last_stream, 0);
+  agn_locus_stream_label_pairwise((AgnLocusStream *)current_stream,
+                                  filenames[0], filenames[1]);
+  agn_locus_stream_skip_iiLoci((AgnLocusStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  GtArray *loci = gt_array_new( sizeof(AgnLocus *) );
+  current_stream = gt_array_out_stream_new(last_stream, loci, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  pipeline->status = gt_node_stream_pull(last_stream, error);
+  if(pipeline->status == -1)
+  {
+    fprintf(stderr, "[StressTest] error processing node stream: %s\n",
+            gt_error_get(error));
+  }
+
+  pipeline->numloci = gt_array_size(loci);
+  agn_comparison_init(&pipeline->comp);
+  GtUword i;
+  for(i = 0; i < gt_array_size(loci); i++)
+  {
+    AgnLocus *locus = *(AgnLocus **)gt_array_get(loci, i);
+    agn_locus_comparative_analysis(locus, pipeline->logger);
+    agn_locus_comparison_aggregate(locus, &pipeline->comp);
+    agn_locus_delete(locus);
+  }
+
+  while(gt_queue_size(streams) > 0)
+  {
+    current_stream = gt_queue_get(streams);
+    gt_node_stream_delete(current_stream);
+  }
+  gt_queue_delete(streams);
+  gt_array_delete(loci);
+  gt_error_delete(error);
+}
+
+static void *stress_pipeline_thread(void *data)
+{
+  stress_pipeline_run((StressPipeline *)data);
+  return NULL;
+}
+
+static bool stress_pipeline_matches(StressPipeline *p1, StressPipeline *p2)
+{
+  AgnComparison *c1 = &p1->comp;
+  AgnComparison *c2 = &p2->comp;
+  return p1->status == p2->status &&
+         p1->numloci == p2->numloci &&
+         c1->overall_matches == c2->overall_matches &&
+         c1->overall_length == c2->overall_length &&
+         c1->cds_nuc_stats.tp == c2->cds_nuc_stats.tp &&
+         c1->cds_nuc_stats.fp == c2->cds_nuc_stats.fp &&
+         c1->cds_nuc_stats.fn == c2->cds_nuc_stats.fn &&
+         c1->cds_struc_stats.correct == c2->cds_struc_stats.correct &&
+         c1->cds_struc_stats.missing == c2->cds_struc_stats.missing &&
+         c1->cds_struc_stats.wrong == c2->cds_struc_stats.wrong &&
+         c1->exon_struc_stats.correct == c2->exon_struc_stats.correct &&
+         c1->exon_struc_stats.missing == c2->exon_struc_stats.missing &&
+         c1->exon_struc_stats.wrong == c2->exon_struc_stats.wrong &&
+         c1->utr_struc_stats.correct == c2->utr_struc_stats.correct &&
+         c1->utr_struc_stats.missing == c2->utr_struc_stats.missing &&
+         c1->utr_struc_stats.wrong == c2->utr_struc_stats.wrong;
+}
+
+int main(int argc, char **argv)
+{
+  int numthreads = STRESS_DEFAULT_THREADS;
+  if(argc > 1)
+    numthreads = atoi(argv[1]);
+  if(numthreads < 1)
+  {
+    fprintf(stderr, "usage: %s [numthreads]\n", argv[0]);
+    return 1;
+  }
+
+  puts("AEGeAn Thread Stress Test");
+  gt_lib_init();
+  if(!gt_multithread_support())
+  {
+    fputs("error: GenomeTools must be compiled with 'threads=yes'\n", stderr);
+    gt_lib_clean();
+    return 1;
+  }
+
+  // All pipelines share one logger, as the command-line programs do.
+  FILE *logfile = fopen("/dev/null", "w");
+  GtLogger *logger = gt_logger_new(true, "", logfile);
+
+  StressPipeline reference;
+  reference.logger = logger;
+  stress_pipeline_run(&reference);
+
+  StressPipeline *pipelines = gt_malloc(sizeof (StressPipeline) * numthreads);
+  pthread_t *threads = gt_malloc(sizeof (pthread_t) * numthreads);
+  int i;
+  for(i = 0; i < numthreads; i++)
+  {
+    pipelines[i].logger = logger;
+    pthread_create(threads + i, NULL, stress_pipeline_thread, pipelines + i);
+  }
+
+  int failures = 0;
+  for(i = 0; i < numthreads; i++)
+  {
+    pthread_join(threads[i], NULL);
+    if(!stress_pipeline_matches(&reference, pipelines + i))
+      failures++;
+  }
+  printf("    %d concurrent pipelines, %lu loci each: %s\n", numthreads,
+         reference.numloci, failures == 0 ? "passed" : "FAILED");
+
+  gt_free(pipelines);
+  gt_free(threads);
+  gt_logger_delete(logger);
+  fclose(logfile);
+  gt_lib_clean();
+  return failures == 0 ? 0 : 1;
+}
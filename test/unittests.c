@@ -8,22 +8,36 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 #include <string.h>
+#include "AgnApi.h"
+#include "AgnArena.h"
 #include "AgnAttributeFilterStream.h"
 #include "AgnCliquePair.h"
+#include "AgnDeltaSweepStream.h"
+#include "AgnExternalSortStream.h"
 #include "AgnFilterStream.h"
 #include "AgnGaevalVisitor.h"
 #include "AgnGeneStream.h"
 #include "AgnIdFilterStream.h"
+#include "AgnIlocusIndex.h"
+#include "AgnIlocusIndexStream.h"
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
 #include "AgnInferParentStream.h"
 #include "AgnLocus.h"
+#include "AgnLocusOutStream.h"
 #include "AgnLocusRefineStream.h"
 #include "AgnLocusStream.h"
+#include "AgnMilocusStream.h"
 #include "AgnMrnaRepVisitor.h"
+#include "AgnParallelGff3InStream.h"
 #include "AgnPseudogeneFixVisitor.h"
 #include "AgnRemoveChildrenVisitor.h"
+#include "AgnSeqComposition.h"
+#include "AgnSeqid.h"
+#include "AgnSortCheckStream.h"
+#include "AgnThreadVisitorStream.h"
 #include "AgnTranscriptClique.h"
+#include "AgnTranscriptModel.h"
 
 int main(int argc, char **argv)
 {
@@ -55,6 +69,10 @@ int main(int argc, char **argv)
                                         agn_infer_exons_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnGeneStream",
                                         agn_gene_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnTranscriptModel",
+                                        agn_transcript_model_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnArena",
+                                        agn_arena_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusStream",
                                         agn_locus_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusRefineStream",
@@ -63,6 +81,30 @@ int main(int argc, char **argv)
                                         agn_gaeval_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnIdFilterStream",
                                         agn_id_filter_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnApi",
+                                        agn_api_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnExternalSortStream",
+                                        agn_external_sort_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnSortCheckStream",
+                                        agn_sort_check_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnMilocusStream",
+                                        agn_milocus_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnSeqComposition",
+                                        agn_seq_composition_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnIlocusIndex",
+                                        agn_ilocus_index_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnIlocusIndexStream",
+                                        agn_ilocus_index_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusOutStream",
+                                        agn_locus_out_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnDeltaSweepStream",
+                                        agn_delta_sweep_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnThreadVisitorStream",
+                                        agn_thread_visitor_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnParallelGff3InStream",
+                                        agn_parallel_gff3_in_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnSeqid",
+                                        agn_seqid_unit_test));
 
   unsigned passes   = 0;
   unsigned failures = 0;
@@ -21,3 +21,18 @@ if [[ $status == 0 ]]; then
 fi
 printf "        | %-36s | %s\n" "major royal jelly" $result
 rm $tempfile
+
+$memcheckcmd \
+bin/xtractore --type CDS \
+              --outfile $tempfile \
+              --stats \
+              data/gff3/mrj.gff3 data/fasta/mrj.gdna.fa
+
+diff $tempfile data/misc/mrj-cds-stats.tsv > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "major royal jelly (stats)" $result
+rm $tempfile